@@ -0,0 +1,243 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+// Copyright 2007      Carlos Licea     <carlos _licea@hotmail.com>
+// Copyright 2011      Bernhard Beschow <bbeschow@cs.tu-berlin.de>
+//
+
+
+// local
+#include "CylindricalScanlineTextureMapper.h"
+
+// std
+#include <cstring>
+
+// Qt
+#include <QtCore/QRunnable>
+#include <QtCore/QVector>
+
+// Marble
+#include "GeoPainter.h"
+#include "ScanlineTextureMapperContext.h"
+#include "StackedTileLoader.h"
+#include "TextureColorizer.h"
+#include "ViewportParams.h"
+
+using namespace Marble;
+
+CylindricalScanlineTextureMapper::CylindricalScanlineTextureMapper( StackedTileLoader *tileLoader )
+    : TextureMapperInterface(),
+      m_tileLoader( tileLoader ),
+      m_radius( 0 ),
+      m_oldYPaintedTop( 0 ),
+      m_tileZoomLevel( -1 ),
+      m_mapQuality( NormalQuality )
+{
+}
+
+void CylindricalScanlineTextureMapper::setCenterChanged()
+{
+    // pans are detected in mapTexture() by comparing the center offsets
+}
+
+void CylindricalScanlineTextureMapper::mapTexture( GeoPainter *painter,
+                                                   const ViewportParams *viewport,
+                                                   int tileZoomLevel,
+                                                   const QRect &dirtyRect,
+                                                   TextureColorizer *texColorizer )
+{
+    if ( m_canvasImage.size() != viewport->size() || m_radius != viewport->radius() ) {
+        const QImage::Format optimalFormat = ScanlineTextureMapperContext::optimalCanvasImageFormat( viewport );
+
+        if ( m_canvasImage.size() != viewport->size() || m_canvasImage.format() != optimalFormat ) {
+            m_canvasImage = QImage( viewport->size(), optimalFormat );
+        }
+
+        if ( !viewport->mapCoversViewport() ) {
+            m_canvasImage.fill( 0 );
+        }
+
+        m_radius = viewport->radius();
+        m_repaintNeeded = true;
+    }
+
+    const QPoint centerOffset = canvasCenterOffset( viewport );
+    const MapQuality mapQuality = painter->mapQuality();
+
+    if ( m_repaintNeeded || tileZoomLevel != m_tileZoomLevel || mapQuality != m_mapQuality ) {
+        m_centerOffset = centerOffset;
+        m_tileZoomLevel = tileZoomLevel;
+        m_mapQuality = mapQuality;
+
+        mapTexture( viewport );
+
+        if ( texColorizer ) {
+            m_colorizedImage = m_canvasImage.copy();
+            texColorizer->colorize( &m_canvasImage, &m_colorizedImage, viewport, mapQuality, m_canvasImage.rect() );
+        }
+
+        m_repaintNeeded = false;
+    }
+    else if ( centerOffset != m_centerOffset ) {
+        scrollTexture( viewport, centerOffset, texColorizer );
+    }
+
+    painter->drawImage( dirtyRect, texColorizer ? m_colorizedImage : m_canvasImage, dirtyRect );
+}
+
+void CylindricalScanlineTextureMapper::mapTexture( const ViewportParams *viewport )
+{
+    // Reset backend
+    m_tileLoader->resetTilehash();
+
+    // Initialize needed constants:
+
+    const int imageHeight = m_canvasImage.height();
+    const int halfMapHeight = mapHeight( viewport ) / 2;
+
+    const int yCenterOffset = m_centerOffset.y();
+
+    // Calculate y-range the represented by the center point, yTop and
+    // what actually can be painted
+    const int yTop     = imageHeight / 2 - halfMapHeight + yCenterOffset;
+    int yPaintedTop    = imageHeight / 2 - halfMapHeight + yCenterOffset;
+    int yPaintedBottom = imageHeight / 2 + halfMapHeight + yCenterOffset;
+
+    if (yPaintedTop < 0)                yPaintedTop = 0;
+    if (yPaintedTop > imageHeight)    yPaintedTop = imageHeight;
+    if (yPaintedBottom < 0)             yPaintedBottom = 0;
+    if (yPaintedBottom > imageHeight) yPaintedBottom = imageHeight;
+
+    // Remove unused lines
+    const int clearStart = ( yPaintedTop - m_oldYPaintedTop <= 0 ) ? yPaintedBottom : 0;
+    const int clearStop  = ( yPaintedTop - m_oldYPaintedTop <= 0 ) ? imageHeight  : yTop;
+
+    QRgb * const itClearBegin = (QRgb*)( m_canvasImage.scanLine( clearStart ) );
+    QRgb * const itClearEnd   = (QRgb*)( m_canvasImage.scanLine( clearStop ) );
+
+    for ( QRgb * it = itClearBegin; it < itClearEnd; ++it ) {
+        *(it) = 0;
+    }
+
+    mapRect( viewport, 0, m_canvasImage.width(), yPaintedTop, yPaintedBottom );
+
+    m_oldYPaintedTop = yPaintedTop;
+    m_scrolled = QPoint();
+
+    m_tileLoader->cleanupTilehash();
+    m_tileLoader->cleanupPendingTiles();
+}
+
+void CylindricalScanlineTextureMapper::scrollTexture( const ViewportParams *viewport, const QPoint &centerOffset,
+                                                      TextureColorizer *texColorizer )
+{
+    const int imageHeight = m_canvasImage.height();
+    const int imageWidth  = m_canvasImage.width();
+    const qint64  radius  = viewport->radius();
+
+    // The canvas content moves opposite to the center in x direction and along
+    // with it in y direction. The map repeats itself every 4 * radius pixels.
+    const int globalWidth = 4 * radius;
+    int dx = ( m_centerOffset.x() - centerOffset.x() ) % globalWidth;
+    if ( dx > globalWidth / 2 )
+        dx -= globalWidth;
+    else if ( dx < -globalWidth / 2 )
+        dx += globalWidth;
+    const int dy = centerOffset.y() - m_centerOffset.y();
+
+    // The tiles scrolled out of view are only released by a full repaint, so
+    // do one once the canvas has been scrolled by a whole width or height.
+    const QPoint scrolled = m_scrolled + QPoint( qAbs( dx ), qAbs( dy ) );
+
+    if ( scrolled.x() >= imageWidth || scrolled.y() >= imageHeight ) {
+        m_centerOffset = centerOffset;
+        mapTexture( viewport );
+        if ( texColorizer ) {
+            m_colorizedImage = m_canvasImage.copy();
+            texColorizer->colorize( &m_canvasImage, &m_colorizedImage, viewport, m_mapQuality, m_canvasImage.rect() );
+        }
+        return;
+    }
+
+    m_centerOffset = centerOffset;
+    m_scrolled = scrolled;
+
+    ScanlineTextureMapperContext::scrollImage( &m_canvasImage, dx, dy );
+    if ( texColorizer ) {
+        ScanlineTextureMapperContext::scrollImage( &m_colorizedImage, dx, dy );
+    }
+
+    // Determine the strips which have been exposed by scrolling
+    QVector<QRect> exposedRects;
+    if ( dy > 0 ) {
+        exposedRects << QRect( 0, 0, imageWidth, dy );
+    } else if ( dy < 0 ) {
+        exposedRects << QRect( 0, imageHeight + dy, imageWidth, -dy );
+    }
+    const int yRestTop = qMax( 0, dy );
+    const int yRestBottom = imageHeight + qMin( 0, dy );
+    if ( dx > 0 ) {
+        exposedRects << QRect( 0, yRestTop, dx, yRestBottom - yRestTop );
+    } else if ( dx < 0 ) {
+        exposedRects << QRect( imageWidth + dx, yRestTop, -dx, yRestBottom - yRestTop );
+    }
+
+    // Calculate the y-range that can actually be painted
+    const int halfMapHeight = mapHeight( viewport ) / 2;
+    const int yPaintedTop    = qBound( 0, imageHeight / 2 - halfMapHeight + centerOffset.y(), imageHeight );
+    const int yPaintedBottom = qBound( 0, imageHeight / 2 + halfMapHeight + centerOffset.y(), imageHeight );
+
+    // The tile hash isn't reset, as the tiles of the scrolled canvas are still in view.
+    foreach ( const QRect &rect, exposedRects ) {
+        const int yStart = qMax( rect.top(), yPaintedTop );
+        const int yEnd   = qMin( rect.bottom() + 1, yPaintedBottom );
+
+        // clear the exposed lines which are not covered by the map
+        for ( int y = rect.top(); y <= rect.bottom(); ++y ) {
+            if ( y >= yStart && y < yEnd )
+                continue;
+            QRgb *const itClearBegin = (QRgb*)( m_canvasImage.scanLine( y ) ) + rect.left();
+            QRgb *const itClearEnd = itClearBegin + rect.width();
+            for ( QRgb * it = itClearBegin; it < itClearEnd; ++it ) {
+                *(it) = 0;
+            }
+        }
+
+        if ( yStart >= yEnd )
+            continue;
+
+        mapRect( viewport, rect.left(), rect.right() + 1, yStart, yEnd );
+    }
+
+    m_oldYPaintedTop = yPaintedTop;
+
+    if ( texColorizer ) {
+        texColorizer->scrollCoastImage( viewport, m_mapQuality, dx, dy, exposedRects );
+
+        foreach ( const QRect &rect, exposedRects ) {
+            for ( int y = rect.top(); y <= rect.bottom(); ++y ) {
+                memcpy( (QRgb*)( m_colorizedImage.scanLine( y ) ) + rect.left(),
+                        (QRgb*)( m_canvasImage.scanLine( y ) ) + rect.left(),
+                        rect.width() * sizeof( QRgb ) );
+            }
+            texColorizer->colorize( &m_canvasImage, &m_colorizedImage, viewport, m_mapQuality, rect );
+        }
+    }
+}
+
+void CylindricalScanlineTextureMapper::mapRect( const ViewportParams *viewport, int xLeft, int xRight, int yTop, int yBottom )
+{
+    const int numThreads = m_threadPool.maxThreadCount();
+    ScanlineRowQueue rowQueue( yTop, yBottom, numThreads );
+    for ( int i = 0; i < numThreads; ++i ) {
+        QRunnable *const job = createRenderJob( m_tileLoader, m_tileZoomLevel, &m_canvasImage, viewport, m_mapQuality,
+                                                m_centerOffset, xLeft, xRight, &rowQueue );
+        m_threadPool.start( job );
+    }
+
+    m_threadPool.waitForDone();
+}
@@ -0,0 +1,101 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+// Copyright 2007      Carlos Licea     <carlos _licea@hotmail.com>
+// Copyright 2011      Bernhard Beschow <bbeschow@cs.tu-berlin.de>
+//
+
+#ifndef MARBLE_CYLINDRICALSCANLINETEXTUREMAPPER_H
+#define MARBLE_CYLINDRICALSCANLINETEXTUREMAPPER_H
+
+
+#include "TextureMapperInterface.h"
+
+#include "MarbleGlobal.h"
+
+#include <QtCore/QPoint>
+#include <QtCore/QThreadPool>
+#include <QtGui/QImage>
+
+class QRunnable;
+
+namespace Marble
+{
+
+class ScanlineRowQueue;
+
+/**
+ * Base class of the scanline texture mappers for cylindrical projections.
+ *
+ * In these projections a pan at a fixed zoom level translates the map, so
+ * the previous canvas gets scrolled and only the exposed strips are mapped.
+ * Subclasses provide the projection specific parts.
+ */
+class CylindricalScanlineTextureMapper : public TextureMapperInterface
+{
+ public:
+    explicit CylindricalScanlineTextureMapper( StackedTileLoader *tileLoader );
+
+    virtual void mapTexture( GeoPainter *painter,
+                             const ViewportParams *viewport,
+                             int tileZoomLevel,
+                             const QRect &dirtyRect,
+                             TextureColorizer *texColorizer );
+
+    virtual void setCenterChanged();
+
+ protected:
+    /**
+     * Returns the position of the map center in canvas pixels, snapped to
+     * whole pixels so that the canvas contents of two frames at the same
+     * zoom level differ by an integer translation.
+     */
+    virtual QPoint canvasCenterOffset( const ViewportParams *viewport ) const = 0;
+
+    /**
+     * Returns the height of the whole map in pixels.
+     */
+    virtual int mapHeight( const ViewportParams *viewport ) const = 0;
+
+    /**
+     * Creates a job which maps the rows taken from @p rowQueue between @p xLeft and @p xRight.
+     */
+    virtual QRunnable *createRenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage,
+                                        const ViewportParams *viewport, MapQuality mapQuality,
+                                        const QPoint &centerOffset, int xLeft, int xRight,
+                                        ScanlineRowQueue *rowQueue ) = 0;
+
+ private:
+    void mapTexture( const ViewportParams *viewport );
+
+    /**
+     * Reuses the current canvas for a pan by scrolling it and mapping
+     * only the newly exposed strips.
+     */
+    void scrollTexture( const ViewportParams *viewport, const QPoint &centerOffset, TextureColorizer *texColorizer );
+
+    /**
+     * Maps the rows from @p yTop to @p yBottom between @p xLeft and @p xRight.
+     */
+    void mapRect( const ViewportParams *viewport, int xLeft, int xRight, int yTop, int yBottom );
+
+ private:
+    StackedTileLoader *const m_tileLoader;
+    int m_radius;
+    QImage m_canvasImage;
+    QImage m_colorizedImage;
+    int    m_oldYPaintedTop;
+    QPoint m_centerOffset;
+    QPoint m_scrolled;  // distance scrolled since the last full repaint
+    int m_tileZoomLevel;
+    MapQuality m_mapQuality;
+    QThreadPool m_threadPool;
+};
+
+}
+
+#endif
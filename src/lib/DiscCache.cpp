@@ -14,54 +14,144 @@
 
 // Qt
 #include <QtCore/QtGlobal>
-#include <QtCore/QFile>
+#include <QtCore/QDateTime>
 #include <QtCore/QDirIterator>
+#include <QtCore/QMap>
+#include <QtCore/QPair>
+#include <QtCore/QRunnable>
+#include <QtCore/QVector>
 
 using namespace Marble;
 
-static QString indexFileName( const QString &cacheDirectory )
+static const quint32 indexMagic = 0x4d444331;
+
+// The journal gets compacted once it has more records than this
+// and twice the number of entries.
+static const int minimumJournalRecords = 1024;
+
+// Cache hits are written to the journal once there are this many of them,
+// or along with the next other change.
+static const int maximumPendingTouches = 256;
+
+static QString legacyIndexFileName( const QString &cacheDirectory )
 {
     return cacheDirectory + "/cache_index.idx";
 }
 
+static QString indexFileName( const QString &cacheDirectory )
+{
+    return cacheDirectory + "/cache_index.lru";
+}
+
+static QString newIndexFileName( const QString &cacheDirectory )
+{
+    return cacheDirectory + "/cache_index.lru.new";
+}
+
+static QString journalFileName( const QString &cacheDirectory )
+{
+    return cacheDirectory + "/cache_index.journal";
+}
+
+static QString oldJournalFileName( const QString &cacheDirectory )
+{
+    return cacheDirectory + "/cache_index.journal.old";
+}
+
+// Replaces the index by the given snapshot and removes the old journal,
+// which is covered by the snapshot.
+static bool writeIndex( const QString &cacheDirectory, const QByteArray &data )
+{
+    QFile file( newIndexFileName( cacheDirectory ) );
+
+    if ( !file.open( QIODevice::WriteOnly ) || file.write( data ) != data.size() ) {
+        qWarning( "Unable to write cache index to %s", qPrintable( cacheDirectory ) );
+        return false;
+    }
+
+    file.close();
+
+    QFile::remove( indexFileName( cacheDirectory ) );
+    if ( !QFile::rename( newIndexFileName( cacheDirectory ), indexFileName( cacheDirectory ) ) )
+        return false;
+
+    QFile::remove( oldJournalFileName( cacheDirectory ) );
+
+    return true;
+}
+
+class DiscCacheCompactionJob : public QRunnable
+{
+public:
+    DiscCacheCompactionJob( const QString &cacheDirectory, const QByteArray &index )
+        : m_cacheDirectory( cacheDirectory ),
+          m_index( index )
+    {
+    }
+
+    virtual void run()
+    {
+        writeIndex( m_cacheDirectory, m_index );
+    }
+
+private:
+    const QString m_cacheDirectory;
+    const QByteArray m_index;
+};
+
 DiscCache::DiscCache( const QString &cacheDirectory )
     : m_CacheDirectory( cacheDirectory ),
       m_CacheLimit( 300 * 1024 * 1024 ),
-      m_CurrentCacheSize( 0 )
+      m_CurrentCacheSize( 0 ),
+      m_Oldest( 0 ),
+      m_Newest( 0 ),
+      m_Journal( journalFileName( cacheDirectory ) ),
+      m_JournalRecords( 0 ),
+      m_PendingTouches( 0 )
 {
     Q_ASSERT( !m_CacheDirectory.isEmpty() && "Passed empty cache directory!" );
 
-    QFile file( indexFileName( m_CacheDirectory ) );
+    m_CompactionPool.setMaxThreadCount( 1 );
+
+    // The new index is complete once the previous one has been removed in its favour.
+    bool needsIndex = false;
+    if ( !readIndex( indexFileName( m_CacheDirectory ) )
+         && !readIndex( newIndexFileName( m_CacheDirectory ) ) ) {
+        needsIndex = readLegacyIndex( legacyIndexFileName( m_CacheDirectory ) );
+    }
 
-    if ( file.exists() ) {
-        if ( file.open( QIODevice::ReadOnly ) ) {
-            QDataStream s( &file );
-            s.setVersion( 8 );
+    // A compaction didn't finish, so the old journal isn't covered by the index yet.
+    QFile oldJournal( oldJournalFileName( m_CacheDirectory ) );
+    if ( oldJournal.exists() ) {
+        replayJournal( oldJournal );
+        needsIndex = true;
+    }
 
-            s >> m_CacheLimit;
-            s >> m_CurrentCacheSize;
-            s >> m_Entries;
+    m_JournalRecords = replayJournal( m_Journal );
 
-        } else {
-            qWarning( "Unable to open cache directory %s", qPrintable( m_CacheDirectory ) );
-        }
+    if ( needsIndex && writeIndex( m_CacheDirectory, indexData() ) ) {
+        QFile::remove( journalFileName( m_CacheDirectory ) );
+        QFile::remove( legacyIndexFileName( m_CacheDirectory ) );
+        m_JournalRecords = 0;
     }
+
+    openJournal();
 }
 
 DiscCache::~DiscCache()
 {
-    QFile file( indexFileName( m_CacheDirectory ) );
+    m_CompactionPool.waitForDone();
 
-    if ( file.open( QIODevice::WriteOnly ) ) {
-        QDataStream s( &file );
-        s.setVersion( 8 );
+    if ( m_Journal.isOpen() )
+        writePendingTouches();
+    m_Journal.close();
 
-        s << m_CacheLimit;
-        s << m_CurrentCacheSize;
-        s << m_Entries;
+    // Leave a compact index behind, so the next start doesn't need to replay the journal
+    if ( writeIndex( m_CacheDirectory, indexData() ) ) {
+        QFile::remove( journalFileName( m_CacheDirectory ) );
     }
 
-    file.close();
+    qDeleteAll( m_Entries );
 }
 
 quint64 DiscCache::cacheLimit() const
@@ -71,23 +161,22 @@ quint64 DiscCache::cacheLimit() const
 
 void DiscCache::clear()
 {
-    QDirIterator it( m_CacheDirectory );
+    QDirIterator it( m_CacheDirectory, QDir::Files );
 
     // Remove all files from cache directory
     while ( it.hasNext() ) {
         it.next();
 
-        if ( it.fileName() == indexFileName( m_CacheDirectory ) ) // skip index file
+        if ( it.fileName().startsWith( "cache_index." ) ) // skip index files
             continue;
 
-        QFile::remove( it.fileName() );
+        QFile::remove( it.filePath() );
     }
 
     // Delete entries
-    m_Entries.clear();
+    clearEntries();
 
-    // Reset current cache size
-    m_CurrentCacheSize = 0;
+    writeJournal( ClearOperation );
 }
 
 bool DiscCache::exists( const QString &key ) const
@@ -98,15 +187,23 @@ bool DiscCache::exists( const QString &key ) const
 bool DiscCache::find( const QString &key, QByteArray &data )
 {
     // Return error if we don't know this key
-    if ( !m_Entries.contains( key ) )
+    Entry *const entry = m_Entries.value( key );
+    if ( !entry )
         return false;
 
-    // If we can open the file, load all data and update access timestamp
+    // If we can open the file, load all data and mark the entry as recently used
     QFile file( keyToFileName( key ) );
     if ( file.open( QIODevice::ReadOnly ) ) {
         data = file.readAll();
 
-        m_Entries[ key ].first = QDateTime::currentDateTime();
+        touchEntry( entry );
+
+        if ( !entry->touched && m_Journal.isOpen() ) {
+            entry->touched = true;
+            if ( ++m_PendingTouches >= maximumPendingTouches )
+                flushPendingTouches();
+        }
+
         return true;
     }
 
@@ -120,18 +217,12 @@ bool DiscCache::insert( const QString &key, const QByteArray &data )
     if ( !file.open( QIODevice::WriteOnly ) )
         return false;
 
-    // If we overwrite an existing entry, subtract the size first
-    if ( m_Entries.contains( key ) )
-        m_CurrentCacheSize -= m_Entries.value( key ).second;
-
     // Store the data on disc
     file.write( data );
 
     // Create/Overwrite with a new entry
-    m_Entries.insert( key, QPair<QDateTime, quint64>(QDateTime::currentDateTime(), data.length()) );
-
-    // Add the size of the new entry
-    m_CurrentCacheSize += data.length();
+    insertEntry( key, data.length() );
+    writeJournal( InsertOperation, key, data.length() );
 
     cleanup();
 
@@ -141,7 +232,8 @@ bool DiscCache::insert( const QString &key, const QByteArray &data )
 void DiscCache::remove( const QString &key )
 {
     // Do nothing if we don't know the key
-    if ( !m_Entries.contains( key ) )
+    Entry *const entry = m_Entries.value( key );
+    if ( !entry )
         return;
 
     // If we can't remove the file we don't remove
@@ -149,16 +241,14 @@ void DiscCache::remove( const QString &key )
     if ( !QFile::remove( keyToFileName( key ) ) )
         return;
 
-    // Subtract from current size
-    m_CurrentCacheSize -= m_Entries.value( key ).second;
-
-    // Finally remove entry
-    m_Entries.remove( key );
+    removeEntry( entry );
+    writeJournal( RemoveOperation, key );
 }
 
 void DiscCache::setCacheLimit( quint64 n )
 {
     m_CacheLimit = n;
+    writeJournal( CacheLimitOperation, QString(), n );
 
     cleanup();
 }
@@ -173,27 +263,332 @@ QString DiscCache::keyToFileName( const QString &key )
 
 void DiscCache::cleanup()
 {
-    // Calculate 5% of our current cache limit
-    quint64 fivePercent = quint64( m_CacheLimit * 0.05 );
+    if ( m_CurrentCacheSize <= m_CacheLimit )
+        return;
+
+    // Evict the least recently used entries until we are 5% below our limit,
+    // so that the following inserts don't need to evict anything.
+    const quint64 fivePercent = quint64( m_CacheLimit * 0.05 );
+
+    while ( m_Oldest && m_CurrentCacheSize > m_CacheLimit - fivePercent ) {
+        const QString key = m_Oldest->key;
+
+        QFile::remove( keyToFileName( key ) );
+        removeEntry( m_Oldest );
+        writeJournal( RemoveOperation, key );
+    }
+}
+
+void DiscCache::insertEntry( const QString &key, quint64 size )
+{
+    Entry *entry = m_Entries.value( key );
 
-    while ( m_CurrentCacheSize > (m_CacheLimit - fivePercent) ) {
-        QDateTime oldestDate( QDateTime::currentDateTime() );
-        QString oldestKey;
+    if ( entry ) {
+        // If we overwrite an existing entry, subtract the size first
+        m_CurrentCacheSize -= entry->size;
+        unlink( entry );
+    }
+    else {
+        entry = new Entry;
+        entry->key = key;
+        entry->touched = false;
+        m_Entries.insert( key, entry );
+    }
+
+    entry->size = size;
+    m_CurrentCacheSize += size;
+    append( entry );
+}
 
-        QMapIterator<QString, QPair<QDateTime, quint64> > it( m_Entries );
-        while ( it.hasNext() ) {
-            it.next();
+void DiscCache::touchEntry( Entry *entry )
+{
+    unlink( entry );
+    append( entry );
+}
+
+void DiscCache::removeEntry( Entry *entry )
+{
+    if ( entry->touched )
+        --m_PendingTouches;
+
+    unlink( entry );
+    m_CurrentCacheSize -= entry->size;
+    m_Entries.remove( entry->key );
+
+    delete entry;
+}
+
+void DiscCache::clearEntries()
+{
+    qDeleteAll( m_Entries );
+    m_Entries.clear();
+
+    m_Oldest = 0;
+    m_Newest = 0;
+    m_PendingTouches = 0;
+
+    // Reset current cache size
+    m_CurrentCacheSize = 0;
+}
+
+void DiscCache::unlink( Entry *entry )
+{
+    if ( entry->older )
+        entry->older->newer = entry->newer;
+    else
+        m_Oldest = entry->newer;
+
+    if ( entry->newer )
+        entry->newer->older = entry->older;
+    else
+        m_Newest = entry->older;
+}
+
+void DiscCache::append( Entry *entry )
+{
+    entry->older = m_Newest;
+    entry->newer = 0;
+
+    if ( m_Newest )
+        m_Newest->newer = entry;
+    else
+        m_Oldest = entry;
+
+    m_Newest = entry;
+}
 
-            if ( it.value().first < oldestDate ) {
-                oldestDate = it.value().first;
-                oldestKey = it.key();
-            }
+bool DiscCache::readIndex( const QString &fileName )
+{
+    QFile file( fileName );
+    if ( !file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    QDataStream s( &file );
+    s.setVersion( 8 );
+
+    quint32 magic = 0;
+    quint64 cacheLimit = 0;
+    quint32 count = 0;
+    s >> magic >> cacheLimit >> count;
+
+    if ( s.status() != QDataStream::Ok || magic != indexMagic )
+        return false;
+
+    // The entries are stored from the least to the most recently used one
+    for ( quint32 i = 0; i < count; ++i ) {
+        QString key;
+        quint64 size = 0;
+        s >> key >> size;
+
+        if ( s.status() != QDataStream::Ok ) {
+            qWarning( "Cache index %s is corrupt", qPrintable( fileName ) );
+            clearEntries();
+            return false;
         }
 
-        if ( !oldestKey.isEmpty() ) {
-            // We found the oldest key, so using remove() to
-            // remove it from cache
-            remove( oldestKey );
+        insertEntry( key, size );
+    }
+
+    m_CacheLimit = cacheLimit;
+
+    return true;
+}
+
+bool DiscCache::readLegacyIndex( const QString &fileName )
+{
+    QFile file( fileName );
+
+    if ( !file.exists() )
+        return false;
+
+    if ( !file.open( QIODevice::ReadOnly ) ) {
+        qWarning( "Unable to open cache directory %s", qPrintable( m_CacheDirectory ) );
+        return false;
+    }
+
+    QDataStream s( &file );
+    s.setVersion( 8 );
+
+    quint64 cacheLimit = 0;
+    quint64 cacheSize = 0;
+    QMap<QString, QPair<QDateTime, quint64> > entries;
+    s >> cacheLimit;
+    s >> cacheSize;
+    s >> entries;
+
+    if ( s.status() != QDataStream::Ok )
+        return false;
+
+    // Order the entries by their last access
+    QMultiMap<QDateTime, QString> keysByAccess;
+    QMap<QString, QPair<QDateTime, quint64> >::const_iterator it = entries.constBegin();
+    for (; it != entries.constEnd(); ++it )
+        keysByAccess.insert( it.value().first, it.key() );
+
+    QMultiMap<QDateTime, QString>::const_iterator key = keysByAccess.constBegin();
+    for (; key != keysByAccess.constEnd(); ++key )
+        insertEntry( key.value(), entries.value( key.value() ).second );
+
+    m_CacheLimit = cacheLimit;
+
+    return true;
+}
+
+int DiscCache::replayJournal( QFile &file )
+{
+    if ( !file.open( QIODevice::ReadWrite ) )
+        return 0;
+
+    QDataStream s( &file );
+    s.setVersion( 8 );
+
+    int records = 0;
+    qint64 validSize = 0;
+
+    while ( !s.atEnd() ) {
+        quint8 operation = 0;
+        QString key;
+        quint64 value = 0;
+        s >> operation >> key >> value;
+
+        if ( s.status() != QDataStream::Ok )
+            break;
+
+        validSize = file.pos();
+        ++records;
+
+        Entry *const entry = m_Entries.value( key );
+
+        switch ( operation ) {
+        case InsertOperation:
+            insertEntry( key, value );
+            break;
+        case TouchOperation:
+            if ( entry )
+                touchEntry( entry );
+            break;
+        case RemoveOperation:
+            if ( entry )
+                removeEntry( entry );
+            break;
+        case ClearOperation:
+            clearEntries();
+            break;
+        case CacheLimitOperation:
+            m_CacheLimit = value;
+            break;
         }
     }
+
+    // Drop a record that was torn by a crash, so that new records can be appended
+    if ( validSize < file.size() ) {
+        qWarning( "Dropping incomplete record from cache journal %s", qPrintable( file.fileName() ) );
+        file.resize( validSize );
+    }
+
+    file.close();
+
+    return records;
+}
+
+QByteArray DiscCache::indexData() const
+{
+    QByteArray data;
+    QDataStream s( &data, QIODevice::WriteOnly );
+    s.setVersion( 8 );
+
+    s << indexMagic << m_CacheLimit << quint32( m_Entries.size() );
+
+    for ( const Entry *entry = m_Oldest; entry; entry = entry->newer )
+        s << entry->key << entry->size;
+
+    return data;
+}
+
+void DiscCache::openJournal()
+{
+    if ( !m_Journal.open( QIODevice::WriteOnly | QIODevice::Append ) ) {
+        qWarning( "Unable to open cache journal %s", qPrintable( m_Journal.fileName() ) );
+        return;
+    }
+
+    m_JournalStream.setDevice( &m_Journal );
+    m_JournalStream.setVersion( 8 );
+}
+
+void DiscCache::writeJournal( JournalOperation operation, const QString &key, quint64 value )
+{
+    if ( !m_Journal.isOpen() )
+        return;
+
+    // The touches happened before this change, so they have to be replayed before it
+    writePendingTouches();
+
+    m_JournalStream << quint8( operation ) << key << value;
+    m_Journal.flush();
+
+    if ( ++m_JournalRecords > qMax( minimumJournalRecords, 2 * m_Entries.size() ) )
+        compact();
+}
+
+void DiscCache::writePendingTouches()
+{
+    if ( m_PendingTouches == 0 )
+        return;
+
+    // The touched entries are the most recently used ones, apart from entries
+    // inserted after them, so they are found by walking the list from its end.
+    QVector<const Entry *> touchedEntries;
+    touchedEntries.reserve( m_PendingTouches );
+    for ( Entry *entry = m_Newest; entry && touchedEntries.size() < m_PendingTouches; entry = entry->older ) {
+        if ( entry->touched ) {
+            entry->touched = false;
+            touchedEntries.append( entry );
+        }
+    }
+
+    m_PendingTouches = 0;
+
+    // Replaying the touches from the least to the most recently used entry restores the order
+    for ( int i = touchedEntries.size() - 1; i >= 0; --i )
+        m_JournalStream << quint8( TouchOperation ) << touchedEntries.at( i )->key << quint64( 0 );
+
+    m_JournalRecords += touchedEntries.size();
+}
+
+void DiscCache::flushPendingTouches()
+{
+    if ( !m_Journal.isOpen() || m_PendingTouches == 0 )
+        return;
+
+    writePendingTouches();
+    m_Journal.flush();
+
+    if ( m_JournalRecords > qMax( minimumJournalRecords, 2 * m_Entries.size() ) )
+        compact();
+}
+
+void DiscCache::compact()
+{
+    // The old journal of the previous compaction is needed until its snapshot is written
+    m_CompactionPool.waitForDone();
+
+    m_JournalRecords = 0;
+
+    if ( QFile::exists( oldJournalFileName( m_CacheDirectory ) ) ) {
+        // Writing the previous snapshot failed, so keep appending to the current journal
+        return;
+    }
+
+    m_Journal.close();
+
+    if ( !m_Journal.rename( oldJournalFileName( m_CacheDirectory ) ) ) {
+        openJournal();
+        return;
+    }
+
+    m_Journal.setFileName( journalFileName( m_CacheDirectory ) );
+    openJournal();
+
+    m_CompactionPool.start( new DiscCacheCompactionJob( m_CacheDirectory, indexData() ) );
 }
@@ -11,17 +11,33 @@
 #ifndef MARBLE_DISCCACHE_H
 #define MARBLE_DISCCACHE_H
 
-#include <QtCore/QDateTime>
-#include <QtCore/QMap>
-#include <QtCore/QPair>
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
 #include <QtCore/QString>
+#include <QtCore/QThreadPool>
+
+#include "marble_export.h"
 
 class QByteArray;
 
 namespace Marble
 {
 
-class DiscCache
+/**
+ * A size limited cache of files on disc with least recently used eviction.
+ *
+ * The entries are kept in a hash for lookup and in an intrusive list ordered
+ * by their last access for eviction, so all operations take constant time.
+ *
+ * The index is persisted as a snapshot of the list plus an append-only journal
+ * of all changes since the snapshot. Once the journal outgrows the number of
+ * entries, a new snapshot is written in the background and the journal starts
+ * over. This way the index survives crashes and loading it doesn't need any
+ * sorting. Cache hits are written to the journal in batches, as losing some of
+ * them in a crash only affects the order of eviction.
+ */
+class MARBLE_EXPORT DiscCache
 {
     public:
         explicit DiscCache( const QString &cacheDirectory );
@@ -36,15 +52,56 @@ class DiscCache
         void setCacheLimit( quint64 n );
 
     private:
+        struct Entry
+        {
+            QString key;
+            quint64 size;
+            Entry *older;
+            Entry *newer;
+            bool touched; // used since the last touch record was written
+        };
+
+        enum JournalOperation {
+            InsertOperation,
+            TouchOperation,
+            RemoveOperation,
+            ClearOperation,
+            CacheLimitOperation
+        };
+
         QString keyToFileName( const QString& );
         void cleanup();
 
+        void insertEntry( const QString &key, quint64 size );
+        void touchEntry( Entry *entry );
+        void removeEntry( Entry *entry );
+        void clearEntries();
+        void unlink( Entry *entry );
+        void append( Entry *entry );
+
+        bool readIndex( const QString &fileName );
+        bool readLegacyIndex( const QString &fileName );
+        int replayJournal( QFile &file );
+        QByteArray indexData() const;
+        void openJournal();
+        void writeJournal( JournalOperation operation, const QString &key = QString(), quint64 value = 0 );
+        void writePendingTouches();
+        void flushPendingTouches();
+        void compact();
+
         QString m_CacheDirectory;
         quint64 m_CacheLimit;
         quint64 m_CurrentCacheSize;
 
-        typedef QPair<QDateTime, quint64> Entry;
-        QMap<QString, Entry> m_Entries;
+        QHash<QString, Entry *> m_Entries;
+        Entry *m_Oldest;
+        Entry *m_Newest;
+
+        QFile m_Journal;
+        QDataStream m_JournalStream;
+        int m_JournalRecords;
+        int m_PendingTouches;
+        QThreadPool m_CompactionPool;
 };
 
 }
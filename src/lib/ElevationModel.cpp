@@ -21,6 +21,7 @@
 #include "MarbleDebug.h"
 #include "MapThemeManager.h"
 #include "TileId.h"
+#include "GeoDataLineString.h"
 
 #include <QtGui/QLabel>
 #include <QtCore/qmath.h>
@@ -31,12 +32,38 @@ namespace Marble
 class ElevationModelPrivate
 {
 public:
+    /**
+     * The heights of a tile in meters, row by row. Decoded once from the tile
+     * image, which takes twice the memory and is slow to read pixel by pixel.
+     */
+    typedef QVector<quint16> HeightTile;
+
+    /**
+     * The tiles used last by a query. Consecutive positions of a query mostly
+     * lie within the same tiles, which saves looking them up in the cache.
+     */
+    struct RecentTiles
+    {
+        enum { Size = 4 };
+
+        RecentTiles() : next( 0 ) {}
+
+        TileId ids[Size];
+        HeightTile heights[Size];
+        int next;
+    };
+
     ElevationModelPrivate( ElevationModel *_q, MarbleModel *const model )
         : q( _q ),
           m_tileLoader( model->downloadManager(), model->pluginManager() ),
-          m_textureLayer( 0 )
+          m_textureLayer( 0 ),
+          m_tileLevel( 0 ),
+          m_tileWidth( 0 ),
+          m_tileHeight( 0 ),
+          m_numTilesX( 0 ),
+          m_numTilesY( 0 )
     {
-        m_cache.setMaxCost( 10 ); //keep 10 tiles in memory (~17MB)
+        m_cache.setMaxCost( 20 ); //keep 20 tiles in memory (~17MB)
 
         const GeoSceneDocument *srtmTheme = model->mapThemeManager()->loadMapTheme( "earth/srtm2/srtm2.dgml" );
         if ( !srtmTheme ) {
@@ -55,94 +82,84 @@ public:
 
         m_textureLayer = dynamic_cast<GeoSceneTextureTile*>( sceneLayer->datasets().first() );
         Q_ASSERT( m_textureLayer );
+
+        // Finding the tile level may involve listing directories, so do it once
+        m_tileLevel = m_tileLoader.maximumTileLevel( *m_textureLayer );
+        Q_ASSERT( m_tileLevel == 9 );
+
+        m_tileWidth = m_textureLayer->tileSize().width();
+        m_tileHeight = m_textureLayer->tileSize().height();
+
+        m_numTilesX = TileLoaderHelper::levelToColumn( m_textureLayer->levelZeroColumns(), m_tileLevel );
+        m_numTilesY = TileLoaderHelper::levelToRow( m_textureLayer->levelZeroRows(), m_tileLevel );
+        Q_ASSERT( m_numTilesX > 0 );
+        Q_ASSERT( m_numTilesY > 0 );
     }
 
     void tileCompleted( const TileId & tileId, const QImage &image )
     {
-        m_cache.insert( tileId, new QImage( image ) );
+        m_cache.insert( tileId, new HeightTile( heightTile( image ) ) );
         emit q->updateAvailable();
     }
 
+    /**
+     * Returns the height at the given position in degrees, or invalidElevationData
+     */
+    qreal height( qreal lon, qreal lat, RecentTiles &recentTiles );
+
+    const HeightTile &tile( const TileId &id, RecentTiles &recentTiles );
+
+    HeightTile heightTile( const QImage &image ) const;
+
 public:
     ElevationModel *q;
 
     TileLoader m_tileLoader;
     const GeoSceneTextureTile *m_textureLayer;
-    QCache<TileId, const QImage> m_cache;
-};
-
-ElevationModel::ElevationModel( MarbleModel *const model )
-    : QObject( 0 ),
-      d( new ElevationModelPrivate( this, model ) )
-{
-    connect( &d->m_tileLoader, SIGNAL(tileCompleted(TileId,QImage)),
-             this, SLOT(tileCompleted(TileId,QImage)) );
-}
+    QCache<TileId, const HeightTile> m_cache;
 
+    int m_tileLevel;
+    int m_tileWidth;
+    int m_tileHeight;
+    int m_numTilesX;
+    int m_numTilesY;
+};
 
-qreal ElevationModel::height( qreal lon, qreal lat ) const
+qreal ElevationModelPrivate::height( qreal lon, qreal lat, RecentTiles &recentTiles )
 {
-    if ( !d->m_textureLayer ) {
-        return invalidElevationData;
-    }
+    const int width = m_numTilesX * m_tileWidth;
+    const int height = m_numTilesY * m_tileHeight;
 
-    const int tileZoomLevel = d->m_tileLoader.maximumTileLevel( *( d->m_textureLayer ) );
-    Q_ASSERT( tileZoomLevel == 9 );
+    const qreal textureX = ( 180 + lon ) * width / 360;
+    const qreal textureY = ( 90 - lat ) * height / 180;
 
-    const int width = d->m_textureLayer->tileSize().width();
-    const int height = d->m_textureLayer->tileSize().height();
+    const int x0 = static_cast<int>( textureX );
+    const int y0 = static_cast<int>( textureY );
+    const qreal dx = textureX - x0;
+    const qreal dy = textureY - y0;
+    Q_ASSERT( 0 <= dx && dx <= 1 );
+    Q_ASSERT( 0 <= dy && dy <= 1 );
 
-    const int numTilesX = TileLoaderHelper::levelToColumn( d->m_textureLayer->levelZeroColumns(), tileZoomLevel );
-    const int numTilesY = TileLoaderHelper::levelToRow( d->m_textureLayer->levelZeroRows(), tileZoomLevel );
-    Q_ASSERT( numTilesX > 0 );
-    Q_ASSERT( numTilesY > 0 );
-
-    qreal textureX = 180 + lon;
-    textureX *= numTilesX * width / 360;
-
-    qreal textureY = 90 - lat;
-    textureY *= numTilesY * height / 180;
+    // bilinear interpolation between the four surrounding pixels
+    const qreal weights[4] = { ( 1 - dx ) * ( 1 - dy ), dx * ( 1 - dy ), ( 1 - dx ) * dy, dx * dy };
 
     qreal ret = 0;
     bool hasHeight = false;
     qreal noData = 0;
 
     for ( int i = 0; i < 4; ++i ) {
-        const int x = static_cast<int>( textureX + ( i % 2 ) );
-        const int y = static_cast<int>( textureY + ( i / 2 ) );
+        const int x = ( x0 + ( i % 2 ) ) % width;
+        const int y = ( y0 + ( i / 2 ) ) % height;
 
-        //mDebug() << "x" << x << ( x / width );
-        //mDebug() << "y" << y << ( y / height );
+        const TileId id( 0, m_tileLevel, x / m_tileWidth, y / m_tileHeight );
+        const HeightTile &heights = tile( id, recentTiles );
 
-        const TileId id( 0, tileZoomLevel, ( x % ( numTilesX * width ) ) / width, ( y % ( numTilesY * height ) ) / height );
-        //mDebug() << "LAT" << lat << "LON" << lon << "tile" << ( x % ( numTilesX * width ) ) / width << ( y % ( numTilesY * height ) ) / height;
-
-        const QImage *image = d->m_cache[id];
-        if ( image == 0 ) {
-            image = new QImage( d->m_tileLoader.loadTileImage( d->m_textureLayer, id, DownloadBrowse ) );
-            d->m_cache.insert( id, image );
-        }
-        Q_ASSERT( image );
-        Q_ASSERT( !image->isNull() );
-        Q_ASSERT( width == image->width() );
-        Q_ASSERT( height == image->height() );
-
-        const qreal dx = ( textureX > ( qreal )x ) ? textureX - ( qreal )x : ( qreal )x - textureX;
-        const qreal dy = ( textureY > ( qreal )y ) ? textureY - ( qreal )y : ( qreal )y - textureY;
-
-        Q_ASSERT( 0 <= dx && dx <= 1 );
-        Q_ASSERT( 0 <= dy && dy <= 1 );
-        unsigned int pixel;
-        pixel = image->pixel( x % width, y % height );
-        pixel -= 0xFF000000; //fully opaque
-        //mDebug() << "(1-dx)" << (1-dx) << "(1-dy)" << (1-dy);
+        const unsigned int pixel = heights[( y % m_tileHeight ) * m_tileWidth + x % m_tileWidth];
         if ( pixel != invalidElevationData ) { //no data?
-            //mDebug() << "got at x" << x % width << "y" << y % height << "a height of" << pixel << "** RGB" << qRed(pixel) << qGreen(pixel) << qBlue(pixel);
-            ret += ( qreal )pixel * ( 1 - dx ) * ( 1 - dy );
+            ret += pixel * weights[i];
             hasHeight = true;
         } else {
-            //mDebug() << "no data at" <<  x % width << "y" << y % height;
-            noData += ( 1 - dx ) * ( 1 - dy );
+            noData += weights[i];
         }
     }
 
@@ -159,19 +176,99 @@ qreal ElevationModel::height( qreal lon, qreal lat ) const
     return ret;
 }
 
+const ElevationModelPrivate::HeightTile &ElevationModelPrivate::tile( const TileId &id, RecentTiles &recentTiles )
+{
+    for ( int i = 0; i < RecentTiles::Size; ++i ) {
+        if ( !recentTiles.heights[i].isEmpty() && recentTiles.ids[i] == id ) {
+            return recentTiles.heights[i];
+        }
+    }
+
+    const int slot = recentTiles.next;
+    recentTiles.next = ( slot + 1 ) % RecentTiles::Size;
+    recentTiles.ids[slot] = id;
+
+    // the tiles are implicitly shared, so they stay valid when the cache drops them
+    const HeightTile *cached = m_cache[id];
+    if ( cached ) {
+        recentTiles.heights[slot] = *cached;
+    } else {
+        recentTiles.heights[slot] = heightTile( m_tileLoader.loadTileImage( m_textureLayer, id, DownloadBrowse ) );
+        m_cache.insert( id, new HeightTile( recentTiles.heights[slot] ) );
+    }
+
+    return recentTiles.heights[slot];
+}
+
+ElevationModelPrivate::HeightTile ElevationModelPrivate::heightTile( const QImage &image ) const
+{
+    HeightTile result( m_tileWidth * m_tileHeight, invalidElevationData );
+    if ( image.width() != m_tileWidth || image.height() != m_tileHeight ) {
+        mDebug() << "Elevation tile has an unexpected size" << image.size();
+        return result;
+    }
+
+    const QImage rgbImage = image.format() == QImage::Format_RGB32 || image.format() == QImage::Format_ARGB32
+                          ? image : image.convertToFormat( QImage::Format_ARGB32 );
+
+    quint16 *heights = result.data();
+    for ( int y = 0; y < m_tileHeight; ++y ) {
+        const QRgb *line = reinterpret_cast<const QRgb *>( rgbImage.scanLine( y ) );
+        for ( int x = 0; x < m_tileWidth; ++x ) {
+            const unsigned int pixel = line[x] - 0xFF000000; //fully opaque
+            *heights++ = pixel < invalidElevationData ? pixel : invalidElevationData;
+        }
+    }
+
+    return result;
+}
+
+ElevationModel::ElevationModel( MarbleModel *const model )
+    : QObject( 0 ),
+      d( new ElevationModelPrivate( this, model ) )
+{
+    connect( &d->m_tileLoader, SIGNAL(tileCompleted(TileId,QImage)),
+             this, SLOT(tileCompleted(TileId,QImage)) );
+}
+
+
+qreal ElevationModel::height( qreal lon, qreal lat ) const
+{
+    if ( !d->m_textureLayer ) {
+        return invalidElevationData;
+    }
+
+    ElevationModelPrivate::RecentTiles recentTiles;
+    return d->height( lon, lat, recentTiles );
+}
+
+QVector<qreal> ElevationModel::heights( const GeoDataLineString &lineString ) const
+{
+    QVector<qreal> result( lineString.size(), invalidElevationData );
+    if ( !d->m_textureLayer ) {
+        return result;
+    }
+
+    ElevationModelPrivate::RecentTiles recentTiles;
+    for ( int i = 0; i < lineString.size(); ++i ) {
+        qreal lon, lat;
+        lineString.geoCoordinates( i, lon, lat );
+        result[i] = d->height( lon * RAD2DEG, lat * RAD2DEG, recentTiles );
+    }
+
+    return result;
+}
+
 QList<GeoDataCoordinates> ElevationModel::heightProfile( qreal fromLon, qreal fromLat, qreal toLon, qreal toLat ) const
 {
     if ( !d->m_textureLayer ) {
         return QList<GeoDataCoordinates>();
     }
 
-    const int tileZoomLevel = d->m_tileLoader.maximumTileLevel( *( d->m_textureLayer ) );
-    const int width = d->m_textureLayer->tileSize().width();
-    const int numTilesX = TileLoaderHelper::levelToColumn( d->m_textureLayer->levelZeroColumns(), tileZoomLevel );
-
-    qreal distPerPixel = ( qreal )360 / ( width * numTilesX );
+    qreal distPerPixel = ( qreal )360 / ( d->m_tileWidth * d->m_numTilesX );
     //mDebug() << "heightProfile" << fromLat << fromLon << toLat << toLon << "distPerPixel" << distPerPixel;
 
+    ElevationModelPrivate::RecentTiles recentTiles;
     qreal lat = fromLat;
     qreal lon = fromLon;
     char dirLat = fromLat < toLat ? 1 : -1;
@@ -183,7 +280,7 @@ QList<GeoDataCoordinates> ElevationModel::heightProfile( qreal fromLon, qreal fr
     QList<GeoDataCoordinates> ret;
     while ( lat*dirLat <= toLat*dirLat && lon*dirLon <= toLon * dirLon ) {
         //mDebug() << lat << lon;
-        qreal h = height( lon, lat );
+        qreal h = d->height( lon, lat, recentTiles );
         if ( h < 32000 ) {
             ret << GeoDataCoordinates( lon, lat, h, GeoDataCoordinates::Degree );
         }
@@ -27,6 +27,7 @@ namespace {
 }
 
 class TileId;
+class GeoDataLineString;
 class MarbleModel;
 class ElevationModelPrivate;
 
@@ -37,6 +38,13 @@ public:
     explicit ElevationModel( MarbleModel * const model );
 
     qreal height( qreal lon, qreal lat ) const;
+
+    /**
+     * Returns the height of each node of @p lineString, or invalidElevationData
+     * where there is none. Much faster than calling height() for each node.
+     **/
+    QVector<qreal> heights( const GeoDataLineString &lineString ) const;
+
     QList<GeoDataCoordinates> heightProfile( qreal fromLon, qreal fromLat, qreal toLon, qreal toLat ) const;
 
 Q_SIGNALS:
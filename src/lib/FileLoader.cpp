@@ -10,17 +10,22 @@
 
 #include "FileLoader.h"
 
+#include <QtCore/QAtomicInt>
+#include <QtCore/QBitArray>
 #include <QtCore/QBuffer>
 #include <QtCore/QDataStream>
 #include <QtCore/QDateTime>
 #include <QtCore/QFile>
+#include <QtCore/QRunnable>
 #include <QtCore/QThread>
+#include <QtCore/QThreadPool>
 
 #include "GeoDataParser.h"
 #include "GeoDataDocument.h"
 #include "GeoDataFolder.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataData.h"
+#include "GeoDataGeometry.h"
 #include "GeoDataExtendedData.h"
 #include "GeoDataStyleMap.h"
 #include "GeoDataPolyStyle.h"
@@ -49,7 +54,9 @@ public:
           m_documentRole ( role ),
           m_styleMap( new GeoDataStyleMap ),
           m_document( 0 ),
-          m_clock( model->clock() )
+          m_clock( model->clock() ),
+          m_nextBatch( 0 ),
+          m_cancelled( 0 )
     {
         if( m_style ) {
             m_styleMap->setStyleId("default-map");
@@ -65,24 +72,45 @@ public:
           m_contents ( contents ),
           m_documentRole ( role ),
           m_document( 0 ),
-          m_clock( model->clock() )
+          m_clock( model->clock() ),
+          m_nextBatch( 0 ),
+          m_cancelled( 0 )
     {
     }
 
     ~FileLoaderPrivate()
     {
+        m_cancelled = 1;
+        m_postProcessingPool.waitForDone();
+
+        for ( int i = m_nextBatch; i < m_batches.size(); ++i ) {
+            qDeleteAll( m_batches.at( i ).features );
+        }
     }
 
+    class PostProcessingJob;
+
+    struct FeatureBatch
+    {
+        GeoDataContainer *parent;
+        QVector<GeoDataFeature*> features;
+    };
+
     void saveFile(const QString& filename );
     void savePlacemarks(QDataStream &out, const GeoDataContainer *container);
 
     void createFilterProperties( GeoDataContainer *container );
+    void createFilterProperties( GeoDataPlacemark *placemark );
     int cityPopIdx( qint64 population ) const;
     int spacePopIdx( qint64 population ) const;
     int areaPopIdx( qreal area ) const;
 
     void documentParsed( GeoDataDocument *doc, const QString& error);
 
+    void startPostProcessing();
+    void postProcess( GeoDataFeature *feature );
+    void batchProcessed( int batch );
+
     FileLoader *q;
     MarbleRunnerManager m_runner;
     QString m_filepath;
@@ -96,8 +124,48 @@ public:
     QString m_error;
 
     const MarbleClock *m_clock;
+    QDateTime m_dateTime; // the clock's time, to be read from any thread
+
+    // Batches of features which get post-processed in parallel,
+    // in the order in which they have to be added to the document
+    QVector<FeatureBatch> m_batches;
+    QBitArray m_processedBatches;
+    int m_nextBatch;
+    QAtomicInt m_cancelled;
+    QThreadPool m_postProcessingPool;
 };
 
+class FileLoaderPrivate::PostProcessingJob : public QRunnable
+{
+public:
+    PostProcessingJob( FileLoaderPrivate *loader, int batch );
+
+    virtual void run();
+
+private:
+    FileLoaderPrivate *const m_loader;
+    const int m_batch;
+};
+
+FileLoaderPrivate::PostProcessingJob::PostProcessingJob( FileLoaderPrivate *loader, int batch )
+    : m_loader( loader ),
+      m_batch( batch )
+{
+}
+
+void FileLoaderPrivate::PostProcessingJob::run()
+{
+    if ( m_loader->m_cancelled ) {
+        return;
+    }
+
+    foreach ( GeoDataFeature *feature, m_loader->m_batches.at( m_batch ).features ) {
+        m_loader->postProcess( feature );
+    }
+
+    QMetaObject::invokeMethod( m_loader->q, "batchProcessed", Qt::QueuedConnection, Q_ARG( int, m_batch ) );
+}
+
 FileLoader::FileLoader( QObject* parent, MarbleModel *model,
                        const QString& file, const QString& property, GeoDataStyle* style = new GeoDataStyle(), DocumentRole role = UnknownDocument )
     : QThread( parent ),
@@ -219,6 +287,7 @@ void FileLoader::run()
         d->m_document = static_cast<GeoDataDocument*>( document );
         d->m_document->setProperty( d->m_property );
         d->m_document->setDocumentRole( d->m_documentRole );
+        d->m_dateTime = d->m_clock->dateTime();
         d->createFilterProperties( d->m_document );
         buffer.close();
 
@@ -302,15 +371,92 @@ void FileLoaderPrivate::documentParsed( GeoDataDocument* doc, const QString& err
             doc->addStyle( *m_style );
         }
 
-        createFilterProperties( doc );
-        emit q->newGeoDataDocumentAdded( m_document );
         if ( !m_nonExistentLocalCacheFile.isEmpty() ) {
             saveFile( m_nonExistentLocalCacheFile );
         }
+
+        m_dateTime = m_clock->dateTime();
+        startPostProcessing();
+        return;
     }
     emit q->loaderFinished( q );
 }
 
+void FileLoaderPrivate::startPostProcessing()
+{
+    // Each batch must only be appended once its parent has been added, so
+    // the containers are emptied and their children batched breadth first.
+    const int batchSize = 1000;
+
+    QList<GeoDataContainer*> containers;
+    containers << m_document;
+
+    while ( !containers.isEmpty() ) {
+        GeoDataContainer *const container = containers.takeFirst();
+        const QVector<GeoDataFeature*> features = container->featureList();
+
+        for ( int i = container->size() - 1; i >= 0; --i ) {
+            container->remove( i );
+        }
+
+        foreach ( GeoDataFeature *feature, features ) {
+            if ( feature->nodeType() == GeoDataTypes::GeoDataFolderType
+                 || feature->nodeType() == GeoDataTypes::GeoDataDocumentType ) {
+                containers << static_cast<GeoDataContainer*>( feature );
+            }
+        }
+
+        for ( int i = 0; i < features.size(); i += batchSize ) {
+            FeatureBatch batch;
+            batch.parent = container;
+            batch.features = features.mid( i, batchSize );
+            m_batches << batch;
+        }
+    }
+
+    m_processedBatches.resize( m_batches.size() );
+
+    if ( m_batches.isEmpty() ) {
+        emit q->newGeoDataDocumentAdded( m_document );
+        emit q->loaderFinished( q );
+        return;
+    }
+
+    for ( int i = 0; i < m_batches.size(); ++i ) {
+        m_postProcessingPool.start( new PostProcessingJob( this, i ) );
+    }
+}
+
+void FileLoaderPrivate::postProcess( GeoDataFeature *feature )
+{
+    if ( feature->nodeType() != GeoDataTypes::GeoDataPlacemarkType ) {
+        return;
+    }
+
+    GeoDataPlacemark *const placemark = static_cast<GeoDataPlacemark*>( feature );
+    createFilterProperties( placemark );
+
+    // Calculate the bounding box now, so it is cached
+    // before the geometry gets painted for the first time
+    placemark->geometry()->latLonAltBox();
+}
+
+void FileLoaderPrivate::batchProcessed( int batch )
+{
+    m_processedBatches.setBit( batch );
+
+    while ( m_nextBatch < m_batches.size() && m_processedBatches.testBit( m_nextBatch ) ) {
+        const FeatureBatch &next = m_batches.at( m_nextBatch );
+        ++m_nextBatch;
+        emit q->featuresLoaded( q, next.parent, next.features );
+    }
+
+    if ( m_nextBatch == m_batches.size() ) {
+        emit q->newGeoDataDocumentAdded( m_document );
+        emit q->loaderFinished( q );
+    }
+}
+
 void FileLoaderPrivate::createFilterProperties( GeoDataContainer *container )
 {
     QVector<GeoDataFeature*>::Iterator i = container->begin();
@@ -327,180 +473,184 @@ void FileLoaderPrivate::createFilterProperties( GeoDataContainer *container )
         } else if ( (*i)->nodeType() == GeoDataTypes::GeoDataPlacemarkType ) {
             Q_ASSERT( dynamic_cast<GeoDataPlacemark*>( *i ) );
 
-            GeoDataPlacemark* placemark = static_cast<GeoDataPlacemark*>( *i );
-            Q_ASSERT( placemark->geometry() );
+            createFilterProperties( static_cast<GeoDataPlacemark*>( *i ) );
+        } else {
+            qWarning() << Q_FUNC_INFO << "Unknown feature" << (*i)->nodeType() << ". Skipping.";
+        }
+    }
+}
 
-            bool hasPopularity = false;
+void FileLoaderPrivate::createFilterProperties( GeoDataPlacemark *placemark )
+{
+    Q_ASSERT( placemark->geometry() );
 
-            if ( placemark->geometry()->nodeType() != GeoDataTypes::GeoDataTrackType &&
-                placemark->geometry()->nodeType() != GeoDataTypes::GeoDataPointType
-                 && m_documentRole == MapDocument
-                 && m_style ) {
-                placemark->setStyleUrl( QString("#").append( m_styleMap->styleId() ) );
-            }
+    bool hasPopularity = false;
 
-            // Mountain (H), Volcano (V), Shipwreck (W)
-            if ( placemark->role() == "H" || placemark->role() == "V" || placemark->role() == "W" )
-            {
-                qreal altitude = placemark->coordinate( m_clock->dateTime() ).altitude();
-                if ( altitude != 0.0 )
-                {
-                    hasPopularity = true;
-                    placemark->setPopularity( (qint64)(altitude * 1000.0) );
-                    placemark->setZoomLevel( cityPopIdx( qAbs( (qint64)(altitude * 1000.0) ) ) );
-                }
-            }
-            // Continent (K), Ocean (O), Nation (S)
-            else if ( placemark->role() == "K" || placemark->role() == "O" || placemark->role() == "S" )
-            {
-                qreal area = placemark->area();
-                if ( area >= 0.0 )
-                {
-                    hasPopularity = true;
-                    //                mDebug() << placemark->name() << " " << (qint64)(area);
-                    placemark->setPopularity( (qint64)(area * 100) );
-                    placemark->setZoomLevel( areaPopIdx( area ) );
+    if ( placemark->geometry()->nodeType() != GeoDataTypes::GeoDataTrackType &&
+        placemark->geometry()->nodeType() != GeoDataTypes::GeoDataPointType
+         && m_documentRole == MapDocument
+         && m_style ) {
+        placemark->setStyleUrl( QString("#").append( m_styleMap->styleId() ) );
+    }
+
+    // Mountain (H), Volcano (V), Shipwreck (W)
+    if ( placemark->role() == "H" || placemark->role() == "V" || placemark->role() == "W" )
+    {
+        qreal altitude = placemark->coordinate( m_dateTime ).altitude();
+        if ( altitude != 0.0 )
+        {
+            hasPopularity = true;
+            placemark->setPopularity( (qint64)(altitude * 1000.0) );
+            placemark->setZoomLevel( cityPopIdx( qAbs( (qint64)(altitude * 1000.0) ) ) );
+        }
+    }
+    // Continent (K), Ocean (O), Nation (S)
+    else if ( placemark->role() == "K" || placemark->role() == "O" || placemark->role() == "S" )
+    {
+        qreal area = placemark->area();
+        if ( area >= 0.0 )
+        {
+            hasPopularity = true;
+            //                mDebug() << placemark->name() << " " << (qint64)(area);
+            placemark->setPopularity( (qint64)(area * 100) );
+            placemark->setZoomLevel( areaPopIdx( area ) );
+        }
+    }
+    // Pole (P)
+    else if ( placemark->role() == "P" )
+    {
+        placemark->setPopularity( 1000000000 );
+        placemark->setZoomLevel( 1 );
+    }
+    // Magnetic Pole (M)
+    else if ( placemark->role() == "M" )
+    {
+        placemark->setPopularity( 10000000 );
+        placemark->setZoomLevel( 3 );
+    }
+    // MannedLandingSite (h)
+    else if ( placemark->role() == "h" )
+    {
+        placemark->setPopularity( 1000000000 );
+        placemark->setZoomLevel( 1 );
+    }
+    // RoboticRover (r)
+    else if ( placemark->role() == "r" )
+    {
+        placemark->setPopularity( 10000000 );
+        placemark->setZoomLevel( 2 );
+    }
+    // UnmannedSoftLandingSite (u)
+    else if ( placemark->role() == "u" )
+    {
+        placemark->setPopularity( 1000000 );
+        placemark->setZoomLevel( 3 );
+    }
+    // UnmannedSoftLandingSite (i)
+    else if ( placemark->role() == "i" )
+    {
+        placemark->setPopularity( 1000000 );
+        placemark->setZoomLevel( 3 );
+    }
+    // Space Terrain: Craters, Maria, Montes, Valleys, etc.
+    else if (    placemark->role() == "m" || placemark->role() == "v"
+                 || placemark->role() == "o" || placemark->role() == "c"
+                 || placemark->role() == "a" )
+    {
+        qint64 diameter = placemark->population();
+        if ( diameter >= 0 )
+        {
+            hasPopularity = true;
+            placemark->setPopularity( diameter );
+            if ( placemark->role() == "c" ) {
+                placemark->setZoomLevel( spacePopIdx( diameter ) );
+                if ( placemark->name() == "Tycho" || placemark->name() == "Copernicus" ) {
+                    placemark->setZoomLevel( 1 );
                 }
             }
-            // Pole (P)
-            else if ( placemark->role() == "P" )
-            {
-                placemark->setPopularity( 1000000000 );
-                placemark->setZoomLevel( 1 );
-            }
-            // Magnetic Pole (M)
-            else if ( placemark->role() == "M" )
-            {
-                placemark->setPopularity( 10000000 );
-                placemark->setZoomLevel( 3 );
+            else {
+                placemark->setZoomLevel( spacePopIdx( diameter ) );
             }
-            // MannedLandingSite (h)
-            else if ( placemark->role() == "h" )
-            {
+
+            if ( placemark->role() == "a" && diameter == 0 ) {
                 placemark->setPopularity( 1000000000 );
                 placemark->setZoomLevel( 1 );
             }
-            // RoboticRover (r)
-            else if ( placemark->role() == "r" )
-            {
-                placemark->setPopularity( 10000000 );
-                placemark->setZoomLevel( 2 );
-            }
-            // UnmannedSoftLandingSite (u)
-            else if ( placemark->role() == "u" )
-            {
-                placemark->setPopularity( 1000000 );
-                placemark->setZoomLevel( 3 );
-            }
-            // UnmannedSoftLandingSite (i)
-            else if ( placemark->role() == "i" )
-            {
-                placemark->setPopularity( 1000000 );
-                placemark->setZoomLevel( 3 );
-            }
-            // Space Terrain: Craters, Maria, Montes, Valleys, etc.
-            else if (    placemark->role() == "m" || placemark->role() == "v"
-                         || placemark->role() == "o" || placemark->role() == "c"
-                         || placemark->role() == "a" )
-            {
-                qint64 diameter = placemark->population();
-                if ( diameter >= 0 )
-                {
-                    hasPopularity = true;
-                    placemark->setPopularity( diameter );
-                    if ( placemark->role() == "c" ) {
-                        placemark->setZoomLevel( spacePopIdx( diameter ) );
-                        if ( placemark->name() == "Tycho" || placemark->name() == "Copernicus" ) {
-                            placemark->setZoomLevel( 1 );
-                        }
-                    }
-                    else {
-                        placemark->setZoomLevel( spacePopIdx( diameter ) );
-                    }
-
-                    if ( placemark->role() == "a" && diameter == 0 ) {
-                        placemark->setPopularity( 1000000000 );
-                        placemark->setZoomLevel( 1 );
-                    }
-                }
-            }
-            else
-            {
-                qint64 population = placemark->population();
-                if ( population >= 0 )
-                {
-                    hasPopularity = true;
-                    placemark->setPopularity( population );
-                    placemark->setZoomLevel( cityPopIdx( population ) );
-                }
-            }
-
-            //  Then we set the visual category:
-
-            if ( placemark->role() == "H" )      placemark->setVisualCategory( GeoDataPlacemark::Mountain );
-            else if ( placemark->role() == "V" ) placemark->setVisualCategory( GeoDataPlacemark::Volcano );
-
-            else if ( placemark->role() == "m" ) placemark->setVisualCategory( GeoDataPlacemark::Mons );
-            else if ( placemark->role() == "v" ) placemark->setVisualCategory( GeoDataPlacemark::Valley );
-            else if ( placemark->role() == "o" ) placemark->setVisualCategory( GeoDataPlacemark::OtherTerrain );
-            else if ( placemark->role() == "c" ) placemark->setVisualCategory( GeoDataPlacemark::Crater );
-            else if ( placemark->role() == "a" ) placemark->setVisualCategory( GeoDataPlacemark::Mare );
-
-            else if ( placemark->role() == "P" ) placemark->setVisualCategory( GeoDataPlacemark::GeographicPole );
-            else if ( placemark->role() == "M" ) placemark->setVisualCategory( GeoDataPlacemark::MagneticPole );
-            else if ( placemark->role() == "W" ) placemark->setVisualCategory( GeoDataPlacemark::ShipWreck );
-            else if ( placemark->role() == "F" ) placemark->setVisualCategory( GeoDataPlacemark::AirPort );
-            else if ( placemark->role() == "A" ) placemark->setVisualCategory( GeoDataPlacemark::Observatory );
-            else if ( placemark->role() == "K" ) placemark->setVisualCategory( GeoDataPlacemark::Continent );
-            else if ( placemark->role() == "O" ) placemark->setVisualCategory( GeoDataPlacemark::Ocean );
-            else if ( placemark->role() == "S" ) placemark->setVisualCategory( GeoDataPlacemark::Nation );
-            else
-                if (  placemark->role()=="PPL"
-                   || placemark->role()=="PPLF"
-                   || placemark->role()=="PPLG"
-                   || placemark->role()=="PPLL"
-                   || placemark->role()=="PPLQ"
-                   || placemark->role()=="PPLR"
-                   || placemark->role()=="PPLS"
-                   || placemark->role()=="PPLW" ) placemark->setVisualCategory(
-                        ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallCity
-                                                                       + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
-            else if ( placemark->role() == "PPLA" ) placemark->setVisualCategory(
-                    ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallStateCapital
-                                                                   + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
-            else if ( placemark->role()=="PPLC" ) placemark->setVisualCategory(
-                    ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallNationCapital
-                                                                   + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
-            else if ( placemark->role()=="PPLA2" || placemark->role()=="PPLA3" ) placemark->setVisualCategory(
-                    ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallCountyCapital
-                                                                   + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
-            else if ( placemark->role()==" " && !hasPopularity && placemark->visualCategory() == GeoDataPlacemark::Unknown ) {
-                placemark->setVisualCategory( GeoDataPlacemark::Unknown ); // default location
-                placemark->setZoomLevel(0);
-            }
-            else if ( placemark->role() == "h" ) placemark->setVisualCategory( GeoDataPlacemark::MannedLandingSite );
-            else if ( placemark->role() == "r" ) placemark->setVisualCategory( GeoDataPlacemark::RoboticRover );
-            else if ( placemark->role() == "u" ) placemark->setVisualCategory( GeoDataPlacemark::UnmannedSoftLandingSite );
-            else if ( placemark->role() == "i" ) placemark->setVisualCategory( GeoDataPlacemark::UnmannedHardLandingSite );
-
-            if ( placemark->role() == "W" && placemark->zoomLevel() < 4 )
-                placemark->setZoomLevel( 4 );
-            if ( placemark->role() == "O" )
-                placemark->setZoomLevel( 2 );
-            if ( placemark->role() == "K" )
-                placemark->setZoomLevel( 0 );
-            if ( !placemark->isVisible() ) {
-                placemark->setZoomLevel( 18 );
-            }
-            // Workaround: Emulate missing "setVisible" serialization by allowing for population
-            // values smaller than -1 which are considered invisible.
-            if ( placemark->population() < -1 ) {
-                placemark->setZoomLevel( 18 );
-            }
-        } else {
-            qWarning() << Q_FUNC_INFO << "Unknown feature" << (*i)->nodeType() << ". Skipping.";
         }
     }
+    else
+    {
+        qint64 population = placemark->population();
+        if ( population >= 0 )
+        {
+            hasPopularity = true;
+            placemark->setPopularity( population );
+            placemark->setZoomLevel( cityPopIdx( population ) );
+        }
+    }
+
+    //  Then we set the visual category:
+
+    if ( placemark->role() == "H" )      placemark->setVisualCategory( GeoDataPlacemark::Mountain );
+    else if ( placemark->role() == "V" ) placemark->setVisualCategory( GeoDataPlacemark::Volcano );
+
+    else if ( placemark->role() == "m" ) placemark->setVisualCategory( GeoDataPlacemark::Mons );
+    else if ( placemark->role() == "v" ) placemark->setVisualCategory( GeoDataPlacemark::Valley );
+    else if ( placemark->role() == "o" ) placemark->setVisualCategory( GeoDataPlacemark::OtherTerrain );
+    else if ( placemark->role() == "c" ) placemark->setVisualCategory( GeoDataPlacemark::Crater );
+    else if ( placemark->role() == "a" ) placemark->setVisualCategory( GeoDataPlacemark::Mare );
+
+    else if ( placemark->role() == "P" ) placemark->setVisualCategory( GeoDataPlacemark::GeographicPole );
+    else if ( placemark->role() == "M" ) placemark->setVisualCategory( GeoDataPlacemark::MagneticPole );
+    else if ( placemark->role() == "W" ) placemark->setVisualCategory( GeoDataPlacemark::ShipWreck );
+    else if ( placemark->role() == "F" ) placemark->setVisualCategory( GeoDataPlacemark::AirPort );
+    else if ( placemark->role() == "A" ) placemark->setVisualCategory( GeoDataPlacemark::Observatory );
+    else if ( placemark->role() == "K" ) placemark->setVisualCategory( GeoDataPlacemark::Continent );
+    else if ( placemark->role() == "O" ) placemark->setVisualCategory( GeoDataPlacemark::Ocean );
+    else if ( placemark->role() == "S" ) placemark->setVisualCategory( GeoDataPlacemark::Nation );
+    else
+        if (  placemark->role()=="PPL"
+           || placemark->role()=="PPLF"
+           || placemark->role()=="PPLG"
+           || placemark->role()=="PPLL"
+           || placemark->role()=="PPLQ"
+           || placemark->role()=="PPLR"
+           || placemark->role()=="PPLS"
+           || placemark->role()=="PPLW" ) placemark->setVisualCategory(
+                ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallCity
+                                                               + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
+    else if ( placemark->role() == "PPLA" ) placemark->setVisualCategory(
+            ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallStateCapital
+                                                           + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
+    else if ( placemark->role()=="PPLC" ) placemark->setVisualCategory(
+            ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallNationCapital
+                                                           + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
+    else if ( placemark->role()=="PPLA2" || placemark->role()=="PPLA3" ) placemark->setVisualCategory(
+            ( GeoDataPlacemark::GeoDataVisualCategory )( GeoDataPlacemark::SmallCountyCapital
+                                                           + (( 20- ( 2*placemark->zoomLevel()) ) / 4 * 4 ) ) );
+    else if ( placemark->role()==" " && !hasPopularity && placemark->visualCategory() == GeoDataPlacemark::Unknown ) {
+        placemark->setVisualCategory( GeoDataPlacemark::Unknown ); // default location
+        placemark->setZoomLevel(0);
+    }
+    else if ( placemark->role() == "h" ) placemark->setVisualCategory( GeoDataPlacemark::MannedLandingSite );
+    else if ( placemark->role() == "r" ) placemark->setVisualCategory( GeoDataPlacemark::RoboticRover );
+    else if ( placemark->role() == "u" ) placemark->setVisualCategory( GeoDataPlacemark::UnmannedSoftLandingSite );
+    else if ( placemark->role() == "i" ) placemark->setVisualCategory( GeoDataPlacemark::UnmannedHardLandingSite );
+
+    if ( placemark->role() == "W" && placemark->zoomLevel() < 4 )
+        placemark->setZoomLevel( 4 );
+    if ( placemark->role() == "O" )
+        placemark->setZoomLevel( 2 );
+    if ( placemark->role() == "K" )
+        placemark->setZoomLevel( 0 );
+    if ( !placemark->isVisible() ) {
+        placemark->setZoomLevel( 18 );
+    }
+    // Workaround: Emulate missing "setVisible" serialization by allowing for population
+    // values smaller than -1 which are considered invisible.
+    if ( placemark->population() < -1 ) {
+        placemark->setZoomLevel( 18 );
+    }
 }
 
 int FileLoaderPrivate::cityPopIdx( qint64 population ) const
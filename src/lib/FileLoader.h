@@ -15,10 +15,12 @@
 
 #include <QtCore/QThread>
 #include <QtCore/QString>
+#include <QtCore/QVector>
 
 namespace Marble
 {
 class GeoDataContainer;
+class GeoDataFeature;
 class FileLoaderPrivate;
 class MarbleModel;
 
@@ -41,8 +43,22 @@ class FileLoader : public QThread
         void loaderFinished( FileLoader* );
         void newGeoDataDocumentAdded( GeoDataDocument* );
 
+        /**
+         * Documents parsed by runners are handed over in batches of features,
+         * so large files can be shown while they are still being processed.
+         * The first batch is always added to document(). Each batch has to be
+         * appended to @p parent, which is either document() or a container of
+         * a previous batch. The features are post-processed in the background,
+         * but the batches are emitted in order.
+         *
+         * Features which have not been handed over are deleted along with
+         * the loader.
+         */
+        void featuresLoaded( FileLoader *loader, GeoDataContainer *parent, const QVector<GeoDataFeature*> &features );
+
 private:
         Q_PRIVATE_SLOT ( d, void documentParsed( GeoDataDocument *, QString) )
+        Q_PRIVATE_SLOT ( d, void batchProcessed( int ) )
 
         friend class FileLoaderPrivate;
 
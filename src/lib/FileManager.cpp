@@ -51,6 +51,8 @@ public:
 
     void appendLoader( FileLoader *loader );
     void closeFile( const QString &key );
+    void addDocument( FileLoader *loader );
+    void addFeatures( FileLoader *loader, GeoDataContainer *parent, const QVector<GeoDataFeature*> &features );
     void cleanupLoader( FileLoader *loader );
 
     MarbleModel* const m_model;
@@ -109,6 +111,8 @@ void FileManager::addData( const QString &name, const QString &data, DocumentRol
 
 void FileManagerPrivate::appendLoader( FileLoader *loader )
 {
+    QObject::connect( loader, SIGNAL(featuresLoaded(FileLoader*,GeoDataContainer*,QVector<GeoDataFeature*>)),
+             q, SLOT(addFeatures(FileLoader*,GeoDataContainer*,QVector<GeoDataFeature*>)) );
     QObject::connect( loader, SIGNAL(loaderFinished(FileLoader*)),
              q, SLOT(cleanupLoader(FileLoader*)) );
 
@@ -123,7 +127,15 @@ void FileManager::removeFile( const QString& key )
             disconnect( loader, 0, this, 0 );
             loader->wait();
             d->m_loaderList.removeAll( loader );
-            delete loader->document();
+            GeoDataDocument *const document = loader->document();
+            // deletes the features the loader has not handed over yet
+            delete loader;
+            if ( d->m_fileItemHash.contains( key ) ) {
+                // the document has been added partially already
+                d->closeFile( key );
+            } else {
+                delete document;
+            }
             return;
         }
     }
@@ -177,19 +189,36 @@ GeoDataDocument * FileManager::at( const QString &key )
     return 0;
 }
 
+void FileManagerPrivate::addDocument( FileLoader *loader )
+{
+    GeoDataDocument *doc = loader->document();
+    if ( doc->name().isEmpty() && !doc->fileName().isEmpty() )
+    {
+        QFileInfo file( doc->fileName() );
+        doc->setName( file.baseName() );
+    }
+    m_model->treeModel()->addDocument( doc );
+    m_fileItemHash.insert( loader->path(), doc );
+}
+
+void FileManagerPrivate::addFeatures( FileLoader *loader, GeoDataContainer *parent, const QVector<GeoDataFeature*> &features )
+{
+    if ( !m_fileItemHash.contains( loader->path() ) ) {
+        addDocument( loader );
+    }
+
+    m_model->treeModel()->addFeatures( parent, features );
+}
+
 void FileManagerPrivate::cleanupLoader( FileLoader* loader )
 {
     GeoDataDocument *doc = loader->document();
     m_loaderList.removeAll( loader );
     if ( loader->isFinished() ) {
         if ( doc ) {
-            if ( doc->name().isEmpty() && !doc->fileName().isEmpty() )
-            {
-                QFileInfo file( doc->fileName() );
-                doc->setName( file.baseName() );
+            if ( !m_fileItemHash.contains( loader->path() ) ) {
+                addDocument( loader );
             }
-            m_model->treeModel()->addDocument( doc );
-            m_fileItemHash.insert( loader->path(), doc );
             emit q->fileAdded( loader->path() );
             if( m_recenter ) {
                 emit q->centeredDocument( doc->latLonAltBox() );
@@ -24,6 +24,8 @@ namespace Marble
 class MarbleModel;
 class FileManagerPrivate;
 class FileLoader;
+class GeoDataContainer;
+class GeoDataFeature;
 class GeoDataLatLonBox;
 
 /**
@@ -86,6 +88,7 @@ class FileManager : public QObject
 
  private:
 
+    Q_PRIVATE_SLOT( d, void addFeatures( FileLoader *loader, GeoDataContainer *parent, const QVector<GeoDataFeature*> &features ) )
     Q_PRIVATE_SLOT( d, void cleanupLoader( FileLoader *loader ) )
 
     Q_DISABLE_COPY( FileManager )
@@ -22,6 +22,7 @@
 #include "MarbleDebug.h"
 #include "MarbleGlobal.h"
 #include "MarbleDirs.h"
+#include "TileArchive.h"
 
 using namespace Marble;
 
@@ -42,12 +43,33 @@ FileStoragePolicy::~FileStoragePolicy()
 
 bool FileStoragePolicy::fileExists( const QString &fileName ) const
 {
+    QString archiveFileName;
+    int level, x, y;
+    if ( TileArchive::parseTileFileName( fileName, archiveFileName, level, x, y ) ) {
+        TileArchive const *const archive = TileArchive::archive( archiveFileName );
+        return archive && archive->contains( level, x, y );
+    }
+
     const QString fullName( m_dataDirectory + '/' + fileName );
     return QFile::exists( fullName );
 }
 
 bool FileStoragePolicy::updateFile( const QString &fileName, const QByteArray &data )
 {
+    QString archiveFileName;
+    int level, x, y;
+    if ( TileArchive::parseTileFileName( fileName, archiveFileName, level, x, y ) ) {
+        TileArchive *const archive = TileArchive::writableArchive( archiveFileName );
+        if ( !archive || !archive->insert( level, x, y, data ) ) {
+            m_errorMsg = QString( "%1: unable to store tile %2/%3/%4" ).arg( archiveFileName ).arg( level ).arg( x ).arg( y );
+            qCritical() << "TileArchive::insert" << m_errorMsg;
+            return false;
+        }
+
+        emit sizeChanged( data.size() );
+        return true;
+    }
+
     QFileInfo const dirInfo( fileName );
     QString const fullName = dirInfo.isAbsolute() ? fileName : m_dataDirectory + '/' + fileName;
 
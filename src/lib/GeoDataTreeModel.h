@@ -14,6 +14,7 @@
 #include "marble_export.h"
 
 #include <QtCore/QAbstractItemModel>
+#include <QtCore/QVector>
 
 class QItemSelectionModel;
 
@@ -88,6 +89,13 @@ public Q_SLOTS:
 
     int addFeature( GeoDataContainer *parent, GeoDataFeature *feature, int row = -1 );
 
+    /**
+      * Appends all of @p features to @p parent with a single insertion of rows,
+      * which is much cheaper than adding them one by one.
+      * @return the row of the first feature, or -1 if they could not be added
+      */
+    int addFeatures( GeoDataContainer *parent, const QVector<GeoDataFeature*> &features );
+
     bool removeFeature( GeoDataContainer *parent, int index );
 
     int removeFeature( const GeoDataFeature *feature );
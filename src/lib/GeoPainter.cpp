@@ -672,6 +672,33 @@ void GeoPainter::drawPolygon ( const GeoDataPolygon & polygon,
     QVector<QPolygonF*> outerPolygons;
     d->m_viewport->screenCoordinates( polygon.outerBoundary(), outerPolygons );
 
+    QVector<QPolygonF> outer;
+    foreach( QPolygonF* itOuterPolygon, outerPolygons ) {
+        outer << *itOuterPolygon;
+    }
+    qDeleteAll( outerPolygons );
+
+    QVector< QVector<QPolygonF> > inner;
+    QVector<GeoDataLinearRing> innerBoundaries = polygon.innerBoundaries();
+    foreach( const GeoDataLinearRing& itInnerBoundary, innerBoundaries ) {
+        QVector<QPolygonF*> innerPolygons;
+        d->m_viewport->screenCoordinates( itInnerBoundary, innerPolygons );
+
+        inner << QVector<QPolygonF>();
+        foreach( QPolygonF* itInnerPolygon, innerPolygons ) {
+            inner.last() << *itInnerPolygon;
+        }
+        qDeleteAll( innerPolygons );
+    }
+
+    drawPolygon( outer, inner, fillRule );
+}
+
+
+void GeoPainter::drawPolygon ( const QVector<QPolygonF> & outerPolygons,
+                               const QVector< QVector<QPolygonF> > & innerPolygons,
+                               Qt::FillRule fillRule )
+{
     // Now creating the "holes" by cutting away the inner boundaries:
 
     // In QPathClipper We Trust ...
@@ -683,36 +710,28 @@ void GeoPainter::drawPolygon ( const GeoDataPolygon & polygon,
     // separately to avoid connections between the outer and inner boundaries
     // To avoid performance penalties the separate painting is only done when
     // it's really needed. See review 105019 for details.
-    bool const needOutlineWorkaround = !polygon.innerBoundaries().isEmpty();
+    bool const needOutlineWorkaround = !innerPolygons.isEmpty();
     if ( needOutlineWorkaround ) {
-        foreach( QPolygonF* polygon, outerPolygons ) {
-            outline << *polygon;
-        }
+        outline << outerPolygons;
         setPen( QPen( Qt::NoPen ) );
     }
 
-
-    QVector<GeoDataLinearRing> innerBoundaries = polygon.innerBoundaries(); 
-    foreach( const GeoDataLinearRing& itInnerBoundary, innerBoundaries ) {
-        QVector<QPolygonF*> innerPolygons;
-        d->m_viewport->screenCoordinates( itInnerBoundary, innerPolygons );
-
+    // The polygons are implicitly shared, so cutting the holes leaves the given ones alone
+    QVector<QPolygonF> outer = outerPolygons;
+    foreach( const QVector<QPolygonF> &itInnerPolygons, innerPolygons ) {
         if ( needOutlineWorkaround ) {
-            foreach( QPolygonF* polygon, innerPolygons ) {
-                outline << *polygon;
-            }
+            outline << itInnerPolygons;
         }
 
-        foreach( QPolygonF* itOuterPolygon, outerPolygons ) {
-            foreach( QPolygonF* itInnerPolygon, innerPolygons ) {
-                *itOuterPolygon = itOuterPolygon->subtracted( *itInnerPolygon );
+        for ( int i = 0; i < outer.size(); ++i ) {
+            foreach( const QPolygonF &itInnerPolygon, itInnerPolygons ) {
+                outer[i] = outer[i].subtracted( itInnerPolygon );
             }
         }
-        qDeleteAll( innerPolygons );    
     }
 
-    foreach( QPolygonF* itOuterPolygon, outerPolygons ) {
-        ClipPainter::drawPolygon( *itOuterPolygon, fillRule );
+    foreach( const QPolygonF &itOuterPolygon, outer ) {
+        ClipPainter::drawPolygon( itOuterPolygon, fillRule );
     }
 
     if ( needOutlineWorkaround ) {
@@ -721,8 +740,6 @@ void GeoPainter::drawPolygon ( const GeoDataPolygon & polygon,
             ClipPainter::drawPolyline( polygon );
         }
     }
-
-    qDeleteAll( outerPolygons );    
 }
 
 
@@ -15,6 +15,7 @@
 #include "marble_export.h"
 
 #include <QtCore/QSize>
+#include <QtCore/QVector>
 #include <QtGui/QRegion>
 
 // Marble
@@ -373,6 +374,22 @@ class MARBLE_EXPORT GeoPainter : public ClipPainter
     void drawPolygon ( const GeoDataPolygon & polygon,
                        Qt::FillRule fillRule = Qt::OddEvenFill );
 
+
+/*!
+    \brief Draws a polygon (which may contain holes) given in screen coordinates.
+
+    Like drawPolygon( GeoDataPolygon ), except that the boundaries have been
+    converted to screen coordinates by ViewportParams::screenCoordinates()
+    already: \a outerPolygons for the outer boundary and one item of
+    \a innerPolygons for each inner boundary. This allows to keep the screen
+    coordinates of a polygon across frames.
+
+    \see ScreenPolygonCache
+*/
+    void drawPolygon ( const QVector<QPolygonF> & outerPolygons,
+                       const QVector< QVector<QPolygonF> > & innerPolygons,
+                       Qt::FillRule fillRule = Qt::OddEvenFill );
+
     
 /*!
     \brief Draws a rectangle at the given position.
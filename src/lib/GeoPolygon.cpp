@@ -27,6 +27,7 @@ using std::fabs;
 # include <sys/mman.h> /* mmap() is defined in this header */
 #endif
 
+#include "GeoDataLatLonBox.h"
 #include "MarbleDebug.h"
 #include "Quaternion.h"
 
@@ -35,6 +36,86 @@ using namespace Marble;
 const qreal ARCMINUTE = 10800; // distance of 180deg in arcminutes
 const qreal INT2RAD = M_PI / 10800.0;
 
+// The highest detail level of the nodes in PNT files
+const int MAX_DETAIL = 5;
+
+// The grid of the polygon index has cells of 5 x 5 degrees
+const int GRID_COLUMNS = 72;
+const int GRID_ROWS = 36;
+
+static int gridColumn( qreal lon )
+{
+    return qBound( 0, (int)( ( lon + M_PI ) / ( 2 * M_PI ) * GRID_COLUMNS ), GRID_COLUMNS - 1 );
+}
+
+static int gridRow( qreal lat )
+{
+    return qBound( 0, (int)( ( M_PI / 2 - lat ) / M_PI * GRID_ROWS ), GRID_ROWS - 1 );
+}
+
+// Calls insert( column, row ) for all grid cells touched by the given box,
+// which crosses the dateline if west > east.
+template<class Insert>
+static void forEachCell( qreal west, qreal north, qreal east, qreal south, Insert &insert )
+{
+    const int firstRow = gridRow( north );
+    const int lastRow = gridRow( south );
+
+    int firstColumn = gridColumn( west );
+    int lastColumn = gridColumn( east );
+    if ( west > east ) {
+        // wrap around at the dateline
+        lastColumn += GRID_COLUMNS;
+    }
+
+    for ( int row = firstRow; row <= lastRow; ++row ) {
+        for ( int column = firstColumn; column <= lastColumn; ++column ) {
+            insert( column % GRID_COLUMNS, row );
+        }
+    }
+}
+
+namespace
+{
+
+struct CellInserter
+{
+    CellInserter( QVector<QVector<int> > &cells, int index )
+        : m_cells( cells ), m_index( index )
+    {}
+
+    void operator()( int column, int row )
+    {
+        m_cells[ row * GRID_COLUMNS + column ].append( m_index );
+    }
+
+    QVector<QVector<int> > &m_cells;
+    const int m_index;
+};
+
+struct CellCollector
+{
+    CellCollector( const QVector<QVector<int> > &cells, QVector<bool> &found, QVector<int> &indices )
+        : m_cells( cells ), m_found( found ), m_indices( indices )
+    {}
+
+    void operator()( int column, int row )
+    {
+        foreach ( int index, m_cells[ row * GRID_COLUMNS + column ] ) {
+            if ( !m_found[ index ] ) {
+                m_found[ index ] = true;
+                m_indices.append( index );
+            }
+        }
+    }
+
+    const QVector<QVector<int> > &m_cells;
+    QVector<bool> &m_found;
+    QVector<int> &m_indices;
+};
+
+}
+
 GeoPolygon::GeoPolygon()
     : m_dateLineCrossing( false ),
       m_closed( false ),
@@ -74,6 +155,19 @@ void GeoPolygon::setBoundary( qreal lonLeft, qreal latTop, qreal lonRight, qreal
 
 }
 
+const GeoDataCoordinates::Vector &GeoPolygon::nodes( int detail ) const
+{
+    if ( detail <= 0 || detail > m_detailLevels.size() )
+        return *this;
+
+    return m_detailLevels[ detail - 1 ];
+}
+
+void GeoPolygon::setDetailLevels( const QVector<GeoDataCoordinates::Vector> &detailLevels )
+{
+    m_detailLevels = detailLevels;
+}
+
 void GeoPolygon::displayBoundary()
 {
     Quaternion  q;
@@ -117,6 +211,29 @@ PntMap::~PntMap()
     qDeleteAll( begin(), end() );
 }
 
+GeoPolygon::PtrVector PntMap::intersecting( const GeoDataLatLonBox &box ) const
+{
+    if ( m_cells.isEmpty() ) {
+        return *this;
+    }
+
+    QVector<bool> found( size(), false );
+    QVector<int> indices;
+    CellCollector collector( m_cells, found, indices );
+    forEachCell( box.west(), box.north(), box.east(), box.south(), collector );
+
+    // keep the painting order of the map
+    qSort( indices );
+
+    GeoPolygon::PtrVector polygons;
+    polygons.reserve( indices.size() );
+    foreach ( int index, indices ) {
+        polygons.append( at( index ) );
+    }
+
+    return polygons;
+}
+
 void PntMap::load(const QString &filename)
 {
     m_loader = new PntMapLoader( this, filename );
@@ -127,6 +244,13 @@ void PntMap::load(const QString &filename)
 
 void PntMap::setInitialized( bool isInitialized )
 {
+    m_cells = m_loader->cells();
+
+    const QVector<QVector<GeoDataCoordinates::Vector> > detailLevels = m_loader->detailLevels();
+    for ( int i = 0; i < detailLevels.size(); ++i ) {
+        at( i )->setDetailLevels( detailLevels[i] );
+    }
+
     if ( m_loader->isFinished() ) {
         delete m_loader;
         m_loader = 0;
@@ -384,9 +508,56 @@ void PntMapLoader::run()
         }
     }
 
+    // Index the polygons by their bounding boxes, so that painting
+    // only needs to look at the polygons around the visible area
+    m_cells = QVector<QVector<int> >( GRID_COLUMNS * GRID_ROWS );
+    for ( int i = 0; i < m_parent->size(); ++i ) {
+        const GeoDataCoordinates::PtrVector boundary = m_parent->at( i )->getBoundary();
+        qreal lonLeft, latTop, lonRight, latBottom;
+        boundary[1]->geoCoordinates( lonLeft, latTop );
+        boundary[2]->geoCoordinates( lonRight, latBottom );
+
+        if ( m_parent->at( i )->getDateLine() == GeoPolygon::Even && lonLeft <= lonRight ) {
+            // the box has to contain the dateline
+            lonLeft = -M_PI;
+            lonRight = M_PI;
+        }
+
+        CellInserter inserter( m_cells, i );
+        forEachCell( lonLeft, latTop, lonRight, latBottom, inserter );
+    }
+
+    // Split the nodes into detail levels, so that painting at a given
+    // detail level doesn't need to walk the nodes of the finer ones.
+    // The nodes are shared with the polygons.
+    m_detailLevels = QVector<QVector<GeoDataCoordinates::Vector> >( m_parent->size() );
+    for ( int i = 0; i < m_parent->size(); ++i ) {
+        QVector<GeoDataCoordinates::Vector> &levels = m_detailLevels[i];
+        levels.resize( MAX_DETAIL );
+
+        GeoDataCoordinates::Vector::ConstIterator itPoint = m_parent->at( i )->constBegin();
+        GeoDataCoordinates::Vector::ConstIterator const itEndPoint = m_parent->at( i )->constEnd();
+        for ( ; itPoint != itEndPoint; ++itPoint ) {
+            const int detail = qMin( itPoint->detail(), MAX_DETAIL );
+            for ( int level = 1; level <= detail; ++level ) {
+                levels[ level - 1 ].append( *itPoint );
+            }
+        }
+    }
+
     mDebug() << Q_FUNC_INFO << "Loaded" << m_filename << "in" << timer.elapsed() << "ms";
 
     emit pntMapLoaded( true );
 }
 
+QVector<QVector<int> > PntMapLoader::cells() const
+{
+    return m_cells;
+}
+
+QVector<QVector<GeoDataCoordinates::Vector> > PntMapLoader::detailLevels() const
+{
+    return m_detailLevels;
+}
+
 #include "GeoPolygon.moc"
@@ -69,6 +69,18 @@ class MARBLE_EXPORT GeoPolygon : public GeoDataCoordinates::Vector
 
     void displayBoundary();
 
+    /**
+     * Returns the nodes with a detail level of at least @p detail.
+     * Until the detail levels are set, these are all nodes.
+     */
+    const GeoDataCoordinates::Vector &nodes( int detail ) const;
+
+    /**
+     * Sets the nodes of the detail levels 1 and higher,
+     * so that nodes() doesn't need to filter them.
+     */
+    void setDetailLevels( const QVector<GeoDataCoordinates::Vector> &detailLevels );
+
     // Type definitions
     typedef QVector<GeoPolygon *> PtrVector;
 
@@ -81,6 +93,9 @@ class MARBLE_EXPORT GeoPolygon : public GeoDataCoordinates::Vector
     GeoDataCoordinates::PtrVector  m_boundary;
 
     int     m_index;
+
+    // the nodes of the detail levels 1 and higher
+    QVector<GeoDataCoordinates::Vector> m_detailLevels;
 };
 
 
@@ -91,6 +106,7 @@ class MARBLE_EXPORT GeoPolygon : public GeoDataCoordinates::Vector
  */
 
 class PntMapLoader;
+class GeoDataLatLonBox;
 
 class MARBLE_EXPORT PntMap : public QObject,
                               public GeoPolygon::PtrVector
@@ -104,6 +120,13 @@ class MARBLE_EXPORT PntMap : public QObject,
 
     void load( const QString & );
 
+    /**
+     * Returns the polygons whose bounding box intersects @p box, in the
+     * order of the map. As long as the map isn't initialized, all polygons
+     * are returned.
+     */
+    GeoPolygon::PtrVector intersecting( const GeoDataLatLonBox &box ) const;
+
  Q_SIGNALS:
     void initialized();
 
@@ -114,6 +137,10 @@ class MARBLE_EXPORT PntMap : public QObject,
     bool m_isInitialized;
     PntMapLoader* m_loader;
 
+    // The indices of the polygons whose bounding box touches the cells
+    // of a regular lat/lon grid, row by row starting in the north west.
+    QVector<QVector<int> > m_cells;
+
     Q_DISABLE_COPY( PntMap )
 };
 
@@ -124,12 +151,18 @@ class MARBLE_EXPORT PntMapLoader : public QThread
         PntMapLoader( PntMap* parent, const QString& filename );
 
         void run();
+
+        QVector<QVector<int> > cells() const;
+        QVector<QVector<GeoDataCoordinates::Vector> > detailLevels() const;
+
     Q_SIGNALS:
         void pntMapLoaded( bool );
 
     private:
         PntMap *m_parent;
         QString m_filename;
+        QVector<QVector<int> > m_cells;
+        QVector<QVector<GeoDataCoordinates::Vector> > m_detailLevels;
 };
 
 }
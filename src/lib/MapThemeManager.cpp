@@ -14,10 +14,14 @@
 #include "MapThemeManager.h"
 
 // Qt
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
 #include <QtCore/QFileInfo>
 #include <QtCore/QFileSystemWatcher>
+#include <QtCore/QHash>
+#include <QtCore/QSet>
 #include <QtCore/QString>
 #include <QtCore/QStringList>
 #include <QtCore/QTimer>
@@ -31,11 +35,13 @@
 #include "MarbleDebug.h"
 #include "MarbleDirs.h"
 #include "Planet.h"
+#include "VersionedCacheFile.h"
 
 namespace
 {
     static const QString mapDirName = "maps";
     static const int columnRelativePath = 1;
+    static const quint32 catalogueMagic = 0x4d544331;
 }
 
 namespace Marble
@@ -44,6 +50,35 @@ namespace Marble
 class MapThemeManager::Private
 {
 public:
+    /**
+     * The properties of a map theme shown in the map theme model. They are
+     * kept in a catalogue as long as the .dgml file has the same modification
+     * time and size, so that it doesn't need to be parsed again.
+     */
+    struct MapThemeInfo
+    {
+        QDateTime lastModified;
+        qint64 size;
+        bool visible;
+        QString target;
+        QString theme;
+        QString icon;
+        QString name;
+        QString description;
+
+        friend QDataStream &operator<<( QDataStream &s, const MapThemeInfo &info )
+        {
+            return s << info.lastModified << info.size << info.visible
+                     << info.target << info.theme << info.icon << info.name << info.description;
+        }
+
+        friend QDataStream &operator>>( QDataStream &s, MapThemeInfo &info )
+        {
+            return s >> info.lastModified >> info.size >> info.visible
+                     >> info.target >> info.theme >> info.icon >> info.name >> info.description;
+        }
+    };
+
     Private( MapThemeManager *parent );
     ~Private();
 
@@ -83,6 +118,16 @@ public:
      */
     QList<QStandardItem *> createMapThemeRow( const QString& mapThemeID );
 
+    /**
+     * @brief Looks up the properties of a map theme in the catalogue, parsing
+     *        the .dgml file only if it isn't known or has changed.
+     */
+    bool mapThemeInfo( const QString &dgmlPath, const QString &mapThemeId, MapThemeInfo &info );
+
+    static QString catalogueFileName();
+    void readCatalogue();
+    void writeCatalogue();
+
     /**
      * @brief Deletes any directory with its contents.
      * @param directory Path to directory
@@ -95,6 +140,9 @@ public:
     QStandardItemModel m_celestialList;
     QFileSystemWatcher m_fileSystemWatcher;
     bool m_isInitialized;
+    QHash<QString, MapThemeInfo> m_catalogue;
+    bool m_catalogueRead;
+    bool m_catalogueChanged;
 
 private:
     /**
@@ -109,7 +157,10 @@ MapThemeManager::Private::Private( MapThemeManager *parent )
       m_mapThemeModel( 0, 3 ),
       m_celestialList(),
       m_fileSystemWatcher(),
-      m_isInitialized( false )
+      m_isInitialized( false ),
+      m_catalogue(),
+      m_catalogueRead( false ),
+      m_catalogueChanged( false )
 {
 }
 
@@ -338,8 +389,9 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
 {
     QList<QStandardItem *> itemList;
 
-    GeoSceneDocument *mapTheme = loadMapThemeFile( mapThemeID );
-    if ( !mapTheme || !mapTheme->head()->visible() ) {
+    MapThemeInfo mapTheme;
+    if ( !mapThemeInfo( MarbleDirs::path( mapDirName + '/' + mapThemeID ), mapThemeID, mapTheme )
+         || !mapTheme.visible ) {
         return itemList;
     }
 
@@ -347,8 +399,8 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
     QString relativePath;
 
     relativePath = mapDirName + '/'
-        + mapTheme->head()->target() + '/' + mapTheme->head()->theme() + '/'
-        + mapTheme->head()->icon()->pixmap();
+        + mapTheme.target + '/' + mapTheme.theme + '/'
+        + mapTheme.icon;
     themeIconPixmap.load( MarbleDirs::path( relativePath ) );
 
     if ( themeIconPixmap.isNull() ) {
@@ -370,8 +422,8 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
 
     QIcon mapThemeIcon =  QIcon( themeIconPixmap );
 
-    QString name = mapTheme->head()->name();
-    QString description = mapTheme->head()->description();
+    QString name = mapTheme.name;
+    QString description = mapTheme.description;
 
     QStandardItem *item = new QStandardItem( name );
     item->setData( QObject::tr( name.toUtf8() ), Qt::DisplayRole );
@@ -383,9 +435,66 @@ QList<QStandardItem *> MapThemeManager::Private::createMapThemeRow( QString cons
 
     itemList << item;
 
+    return itemList;
+}
+
+bool MapThemeManager::Private::mapThemeInfo( const QString &dgmlPath, const QString &mapThemeId, MapThemeInfo &info )
+{
+    if ( !m_catalogueRead ) {
+        readCatalogue();
+        m_catalogueRead = true;
+    }
+
+    const QFileInfo fileInfo( dgmlPath );
+    QHash<QString, MapThemeInfo>::const_iterator const cached = m_catalogue.constFind( dgmlPath );
+    if ( cached != m_catalogue.constEnd()
+         && cached.value().lastModified == fileInfo.lastModified()
+         && cached.value().size == fileInfo.size() ) {
+        info = cached.value();
+        return true;
+    }
+
+    GeoSceneDocument *mapTheme = loadMapThemeFile( mapThemeId );
+    if ( !mapTheme ) {
+        m_catalogueChanged |= m_catalogue.remove( dgmlPath ) > 0;
+        return false;
+    }
+
+    info.lastModified = fileInfo.lastModified();
+    info.size = fileInfo.size();
+    info.visible = mapTheme->head()->visible();
+    info.target = mapTheme->head()->target();
+    info.theme = mapTheme->head()->theme();
+    info.icon = mapTheme->head()->icon()->pixmap();
+    info.name = mapTheme->head()->name();
+    info.description = mapTheme->head()->description();
+
     delete mapTheme;
 
-    return itemList;
+    m_catalogue.insert( dgmlPath, info );
+    m_catalogueChanged = true;
+
+    return true;
+}
+
+QString MapThemeManager::Private::catalogueFileName()
+{
+    return MarbleDirs::localPath() + "/mapthemes.cache";
+}
+
+void MapThemeManager::Private::readCatalogue()
+{
+    VersionedCacheFile( catalogueFileName(), catalogueMagic ).read( m_catalogue );
+}
+
+void MapThemeManager::Private::writeCatalogue()
+{
+    if ( !m_catalogueChanged )
+        return;
+
+    m_catalogueChanged = false;
+
+    VersionedCacheFile( catalogueFileName(), catalogueMagic ).write( m_catalogue );
 }
 
 void MapThemeManager::Private::updateMapThemeModel()
@@ -397,9 +506,11 @@ void MapThemeManager::Private::updateMapThemeModel()
 
     QStringList stringlist = findMapThemes();
     QStringListIterator it( stringlist );
+    QSet<QString> dgmlPaths;
 
     while ( it.hasNext() ) {
         QString mapThemeID = it.next();
+        dgmlPaths << MarbleDirs::path( mapDirName + '/' + mapThemeID );
 
     	QList<QStandardItem *> itemList = createMapThemeRow( mapThemeID );
         if ( !itemList.empty() ) {
@@ -407,6 +518,16 @@ void MapThemeManager::Private::updateMapThemeModel()
         }
     }
 
+    // forget about map themes which have been removed
+    foreach ( const QString &dgmlPath, m_catalogue.keys() ) {
+        if ( !dgmlPaths.contains( dgmlPath ) ) {
+            m_catalogue.remove( dgmlPath );
+            m_catalogueChanged = true;
+        }
+    }
+
+    writeCatalogue();
+
     for ( int i = 0; i < m_mapThemeModel.rowCount(); ++i ) {
         QString celestialBodyId = ( m_mapThemeModel.data( m_mapThemeModel.index( i, 0 ), Qt::UserRole + 1 ).toString() ).section( '/', 0, 0 );
         QString celestialBodyName = Planet::name( celestialBodyId );
@@ -479,6 +600,8 @@ void MapThemeManager::Private::fileChanged( const QString& path )
             m_mapThemeModel.insertRow( insertAtRow, newMapThemeRow );
         }
     }
+
+    writeCatalogue();
     
     emit q->themesChanged();
 }
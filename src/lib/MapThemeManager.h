@@ -32,7 +32,9 @@ class GeoSceneDocument;
  *
  * This class which is able to check for maps that are locally available.
  * After parsing the data it only stores the name, description and path
- * into a QStandardItemModel.
+ * into a QStandardItemModel. These properties are kept in a catalogue in
+ * the local Marble directory, so that only new or changed map themes get
+ * parsed.
  * 
  * The MapThemeManager is not owned by the MarbleWidget/Map itself. 
  * Instead it is owned by the widget or application that contains 
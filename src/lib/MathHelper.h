@@ -24,6 +24,8 @@
 
 #include <QtCore/qglobal.h>
 
+#include <cmath>
+
 #ifdef Q_CC_MSVC
 #include <math.h>
 
@@ -34,4 +36,59 @@ qreal msvc_atanh(qreal x);
 #define atanh msvc_atanh
 #endif
 
+/**
+ * Fast approximations of atan2() and asin() for per-pixel projection code.
+ *
+ * The argument of atan is reduced to [ -tan( pi / 8 ), tan( pi / 8 ) ] where
+ * atan( a ) / a is approximated by a polynomial in a * a. The absolute error
+ * of both functions stays below FAST_ATAN_MAX_ERROR radians, which is less
+ * than a tenth of a pixel even for the largest globe radii.
+ */
+const qreal FAST_ATAN_MAX_ERROR = 3e-10;
+
+const qreal FAST_ATAN_TAN_PI_8 = 0.41421356237309504880;
+const qreal FAST_ATAN_C0 =  0.999999999737347;
+const qreal FAST_ATAN_C1 = -0.3333331328424173;
+const qreal FAST_ATAN_C2 =  0.19998431419823492;
+const qreal FAST_ATAN_C3 = -0.14243194651048535;
+const qreal FAST_ATAN_C4 =  0.10592656512918924;
+const qreal FAST_ATAN_C5 = -0.06077074178315072;
+
+inline qreal fastAtan2( qreal y, qreal x )
+{
+    const qreal absX = x < 0.0 ? -x : x;
+    const qreal absY = y < 0.0 ? -y : y;
+    const qreal minXY = absX < absY ? absX : absY;
+    const qreal maxXY = absX < absY ? absY : absX;
+
+    if ( maxXY == 0.0 )
+        return 0.0;
+
+    // atan( a ) = pi / 4 + atan( ( a - 1 ) / ( a + 1 ) )
+    const bool reduce = minXY > FAST_ATAN_TAN_PI_8 * maxXY;
+    const qreal a = reduce ? ( minXY - maxXY ) / ( minXY + maxXY ) : minXY / maxXY;
+    const qreal a2 = a * a;
+
+    qreal result = a * ( FAST_ATAN_C0 + a2 * ( FAST_ATAN_C1 + a2 * ( FAST_ATAN_C2
+                       + a2 * ( FAST_ATAN_C3 + a2 * ( FAST_ATAN_C4 + a2 * FAST_ATAN_C5 ) ) ) ) );
+    if ( reduce )
+        result += 0.78539816339744830962;
+    if ( absY > absX )
+        result = 1.57079632679489661923 - result;
+    if ( x < 0.0 )
+        result = 3.14159265358979323846 - result;
+
+    return y < 0.0 ? -result : result;
+}
+
+inline qreal fastAsin( qreal y )
+{
+    if ( y > 1.0 )
+        y = 1.0;
+    else if ( y < -1.0 )
+        y = -1.0;
+
+    return fastAtan2( y, std::sqrt( ( 1.0 - y ) * ( 1.0 + y ) ) );
+}
+
 #endif  // MATHHELPER_H
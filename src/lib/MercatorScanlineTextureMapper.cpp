@@ -21,11 +21,9 @@
 #include <QtCore/QRunnable>
 
 // Marble
-#include "GeoPainter.h"
 #include "MarbleDebug.h"
 #include "ScanlineTextureMapperContext.h"
 #include "StackedTileLoader.h"
-#include "TextureColorizer.h"
 #include "ViewportParams.h"
 #include "MathHelper.h"
 
@@ -34,7 +32,8 @@ using namespace Marble;
 class MercatorScanlineTextureMapper::RenderJob : public QRunnable
 {
 public:
-    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int yTop, int yBottom );
+    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality,
+               const QPoint &centerOffset, int xLeft, int xRight, ScanlineRowQueue *rowQueue );
 
     virtual void run();
 
@@ -44,121 +43,54 @@ private:
     QImage *const m_canvasImage;
     const ViewportParams *const m_viewport;
     const MapQuality m_mapQuality;
-    const int m_yPaintedTop;
-    const int m_yPaintedBottom;
+    const QPoint m_centerOffset;
+    const int m_xLeft;
+    const int m_xRight;
+    ScanlineRowQueue *const m_rowQueue;
 };
 
-MercatorScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int yTop, int yBottom )
+MercatorScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality,
+                                                     const QPoint &centerOffset, int xLeft, int xRight, ScanlineRowQueue *rowQueue )
     : m_tileLoader( tileLoader ),
       m_tileLevel( tileLevel ),
       m_canvasImage( canvasImage ),
       m_viewport( viewport ),
       m_mapQuality( mapQuality ),
-      m_yPaintedTop( yTop ),
-      m_yPaintedBottom( yBottom )
+      m_centerOffset( centerOffset ),
+      m_xLeft( xLeft ),
+      m_xRight( xRight ),
+      m_rowQueue( rowQueue )
 {
 }
 
 MercatorScanlineTextureMapper::MercatorScanlineTextureMapper( StackedTileLoader *tileLoader )
-    : TextureMapperInterface(),
-      m_tileLoader( tileLoader ),
-      m_radius( 0 ),
-      m_oldYPaintedTop( 0 )
+    : CylindricalScanlineTextureMapper( tileLoader )
 {
 }
 
-void MercatorScanlineTextureMapper::mapTexture( GeoPainter *painter,
-                                                const ViewportParams *viewport,
-                                                int tileZoomLevel,
-                                                const QRect &dirtyRect,
-                                                TextureColorizer *texColorizer )
+QPoint MercatorScanlineTextureMapper::canvasCenterOffset( const ViewportParams *viewport ) const
 {
-    if ( m_canvasImage.size() != viewport->size() || m_radius != viewport->radius() ) {
-        const QImage::Format optimalFormat = ScanlineTextureMapperContext::optimalCanvasImageFormat( viewport );
+    // Calculate how many pixels are being represented per radian.
+    const qreal rad2Pixel = (qreal)( 2 * viewport->radius() ) / M_PI;
 
-        if ( m_canvasImage.size() != viewport->size() || m_canvasImage.format() != optimalFormat ) {
-            m_canvasImage = QImage( viewport->size(), optimalFormat );
-        }
-
-        if ( !viewport->mapCoversViewport() ) {
-            m_canvasImage.fill( 0 );
-        }
-
-        m_radius = viewport->radius();
-        m_repaintNeeded = true;
-    }
-
-    if ( m_repaintNeeded ) {
-        mapTexture( viewport, tileZoomLevel, painter->mapQuality() );
-
-        if ( texColorizer ) {
-            texColorizer->colorize( &m_canvasImage, viewport, painter->mapQuality() );
-        }
-
-        m_repaintNeeded = false;
-    }
-
-    painter->drawImage( dirtyRect, m_canvasImage, dirtyRect );
+    // Snap the center to whole pixels, so the canvas contents of two frames
+    // at the same zoom level differ by an integer translation.
+    return QPoint( (int)( viewport->centerLongitude() * rad2Pixel ),
+                   (int)( asinh( tan( viewport->centerLatitude() ) ) * rad2Pixel ) );
 }
 
-void MercatorScanlineTextureMapper::mapTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality )
+int MercatorScanlineTextureMapper::mapHeight( const ViewportParams *viewport ) const
 {
-    // Reset backend
-    m_tileLoader->resetTilehash();
-
-    // Initialize needed constants:
-
-    const int imageHeight = m_canvasImage.height();
-    const qint64  radius      = viewport->radius();
-    // Calculate how many degrees are being represented per pixel.
-    const float rad2Pixel = (float)( 2 * radius ) / M_PI;
-
-    //mDebug() << "m_maxGlobalX: " << m_maxGlobalX;
-    //mDebug() << "radius      : " << radius << endl;
-
-    // Calculate translation of center point
-    const qreal centerLat = viewport->centerLatitude();
-
-    const int yCenterOffset = (int)( asinh( tan( centerLat ) ) * rad2Pixel  );
-
-    // Calculate y-range the represented by the center point, yTop and
-    // what actually can be painted
-    const int yTop     = imageHeight / 2 - 2 * radius + yCenterOffset;
-    int yPaintedTop    = imageHeight / 2 - 2 * radius + yCenterOffset;
-    int yPaintedBottom = imageHeight / 2 + 2 * radius + yCenterOffset;
- 
-    if (yPaintedTop < 0)                yPaintedTop = 0;
-    if (yPaintedTop > imageHeight)    yPaintedTop = imageHeight;
-    if (yPaintedBottom < 0)             yPaintedBottom = 0;
-    if (yPaintedBottom > imageHeight) yPaintedBottom = imageHeight;
-
-    const int numThreads = m_threadPool.maxThreadCount();
-    const int yStep = ( yPaintedBottom - yPaintedTop ) / numThreads;
-    for ( int i = 0; i < numThreads; ++i ) {
-        const int yStart = yPaintedTop +  i      * yStep;
-        const int yEnd   = yPaintedTop + (i + 1) * yStep;
-        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, yStart, yEnd );
-        m_threadPool.start( job );
-    }
-
-    // Remove unused lines
-    const int clearStart = ( yPaintedTop - m_oldYPaintedTop <= 0 ) ? yPaintedBottom : 0;
-    const int clearStop  = ( yPaintedTop - m_oldYPaintedTop <= 0 ) ? imageHeight  : yTop;
-
-    QRgb * const itClearBegin = (QRgb*)( m_canvasImage.scanLine( clearStart ) );
-    QRgb * const itClearEnd   = (QRgb*)( m_canvasImage.scanLine( clearStop ) );
-
-    for ( QRgb * it = itClearBegin; it < itClearEnd; ++it ) {
-        *(it) = 0;
-    }
-
-    m_threadPool.waitForDone();
-
-    m_oldYPaintedTop = yPaintedTop;
-
-    m_tileLoader->cleanupTilehash();
+    return 4 * viewport->radius();
 }
 
+QRunnable *MercatorScanlineTextureMapper::createRenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage,
+                                                          const ViewportParams *viewport, MapQuality mapQuality,
+                                                          const QPoint &centerOffset, int xLeft, int xRight,
+                                                          ScanlineRowQueue *rowQueue )
+{
+    return new RenderJob( tileLoader, tileLevel, canvasImage, viewport, mapQuality, centerOffset, xLeft, xRight, rowQueue );
+}
 
 void MercatorScanlineTextureMapper::RenderJob::run()
 {
@@ -180,16 +112,13 @@ void MercatorScanlineTextureMapper::RenderJob::run()
     const int n = ScanlineTextureMapperContext::interpolationStep( m_viewport, m_mapQuality );
 
     // Calculate translation of center point
-    const qreal centerLon = m_viewport->centerLongitude();
-    const qreal centerLat = m_viewport->centerLatitude();
+    const int yCenterOffset = m_centerOffset.y();
 
-    const int yCenterOffset = (int)( asinh( tan( centerLat ) ) * rad2Pixel  );
-
-    qreal leftLon = + centerLon - ( imageWidth / 2 * pixel2Rad );
+    qreal leftLon = ( m_centerOffset.x() - imageWidth / 2 + m_xLeft ) * pixel2Rad;
     while ( leftLon < -M_PI ) leftLon += 2 * M_PI;
     while ( leftLon >  M_PI ) leftLon -= 2 * M_PI;
 
-    const int maxInterpolationPointX = n * (int)( imageWidth / n - 1 ) + 1;
+    const int maxInterpolationPointX = m_xLeft + n * (int)( ( m_xRight - m_xLeft ) / n - 1 ) + 1;
 
 
     // initialize needed variables that are modified during texture mapping:
@@ -199,58 +128,62 @@ void MercatorScanlineTextureMapper::RenderJob::run()
 
     // Scanline based algorithm to do texture mapping
 
-    for ( int y = m_yPaintedTop; y < m_yPaintedBottom; ++y ) {
-
-        QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) );
-
-        qreal lon = leftLon;
-        const qreal lat = atan( sinh( ( (imageHeight / 2 + yCenterOffset) - y )
-                    * pixel2Rad ) );
-
-        for ( int x = 0; x < imageWidth; ++x ) {
-            // Prepare for interpolation
-            bool interpolate = false;
-            if ( x > 0 && x <= maxInterpolationPointX ) {
-                x += n - 1;
-                lon += (n - 1) * pixel2Rad;
-                interpolate = !printQuality;
-            }
-            else {
-                interpolate = false;
+    int yStart = 0;
+    int yEnd = 0;
+    while ( m_rowQueue->nextChunk( yStart, yEnd ) ) {
+        for ( int y = yStart; y < yEnd; ++y ) {
+
+            QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) ) + m_xLeft;
+
+            qreal lon = leftLon;
+            const qreal lat = atan( sinh( ( (imageHeight / 2 + yCenterOffset) - y )
+                        * pixel2Rad ) );
+
+            for ( int x = m_xLeft; x < m_xRight; ++x ) {
+                // Prepare for interpolation
+                bool interpolate = false;
+                if ( x > m_xLeft && x <= maxInterpolationPointX ) {
+                    x += n - 1;
+                    lon += (n - 1) * pixel2Rad;
+                    interpolate = !printQuality;
+                }
+                else {
+                    interpolate = false;
+                }
+
+                if ( lon < -M_PI ) lon += 2 * M_PI;
+                if ( lon >  M_PI ) lon -= 2 * M_PI;
+
+                if ( interpolate ) {
+                    if (highQuality)
+                        context.pixelValueApproxF( lon, lat, scanLine, n );
+                    else
+                        context.pixelValueApprox( lon, lat, scanLine, n );
+
+                    scanLine += ( n - 1 );
+                }
+
+                if ( x < m_xRight ) {
+                    if ( highQuality )
+                        context.pixelValueF( lon, lat, scanLine );
+                    else
+                        context.pixelValue( lon, lat, scanLine );
+                }
+
+                ++scanLine;
+                lon += pixel2Rad;
             }
 
-            if ( lon < -M_PI ) lon += 2 * M_PI;
-            if ( lon >  M_PI ) lon -= 2 * M_PI;
+            // copy scanline to improve performance
+            if ( interlaced && y + 1 < yEnd ) { 
 
-            if ( interpolate ) {
-                if (highQuality)
-                    context.pixelValueApproxF( lon, lat, scanLine, n );
-                else
-                    context.pixelValueApprox( lon, lat, scanLine, n );
-
-                scanLine += ( n - 1 );
-            }
+                const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
 
-            if ( x < imageWidth ) {
-                if ( highQuality )
-                    context.pixelValueF( lon, lat, scanLine );
-                else
-                    context.pixelValue( lon, lat, scanLine );
+                memcpy( m_canvasImage->scanLine( y + 1 ) + m_xLeft * pixelByteSize,
+                        m_canvasImage->scanLine( y     ) + m_xLeft * pixelByteSize,
+                        ( m_xRight - m_xLeft ) * pixelByteSize );
+                ++y;
             }
-
-            ++scanLine;
-            lon += pixel2Rad;
-        }
-
-        // copy scanline to improve performance
-        if ( interlaced && y + 1 < m_yPaintedBottom ) { 
-
-            const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
-
-            memcpy( m_canvasImage->scanLine( y + 1 ),
-                    m_canvasImage->scanLine( y     ),
-                    imageWidth * pixelByteSize );
-            ++y;
         }
     }
 }
@@ -14,39 +14,29 @@
 #define MARBLE_MERCATORSCANLINETEXTUREMAPPER_H
 
 
-#include "TextureMapperInterface.h"
-
-#include "MarbleGlobal.h"
-
-#include <QtCore/QThreadPool>
-#include <QtGui/QImage>
+#include "CylindricalScanlineTextureMapper.h"
 
 
 namespace Marble
 {
 
-class MercatorScanlineTextureMapper : public TextureMapperInterface
+class MercatorScanlineTextureMapper : public CylindricalScanlineTextureMapper
 {
  public:
     explicit MercatorScanlineTextureMapper( StackedTileLoader *tileLoader );
 
-    virtual void mapTexture( GeoPainter *painter,
-                             const ViewportParams *viewport,
-                             int tileZoomLevel,
-                             const QRect &dirtyRect,
-                             TextureColorizer *texColorizer );
+ protected:
+    virtual QPoint canvasCenterOffset( const ViewportParams *viewport ) const;
 
- private:
-    void mapTexture( const ViewportParams *viewport, int tileZoomLevel, MapQuality mapQuality );
+    virtual int mapHeight( const ViewportParams *viewport ) const;
+
+    virtual QRunnable *createRenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage,
+                                        const ViewportParams *viewport, MapQuality mapQuality,
+                                        const QPoint &centerOffset, int xLeft, int xRight,
+                                        ScanlineRowQueue *rowQueue );
 
  private:
     class RenderJob;
-
-    StackedTileLoader *const m_tileLoader;
-    int m_radius;
-    QImage m_canvasImage;
-    int    m_oldYPaintedTop;
-    QThreadPool m_threadPool;
 };
 
 }
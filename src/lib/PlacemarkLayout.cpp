@@ -148,6 +148,9 @@ PlacemarkLayout::PlacemarkLayout( QAbstractItemModel  *placemarkModel,
       m_showLandingSites( false ),
       m_showCraters( false ),
       m_showMaria( false ),
+      m_gridColumns( 0 ),
+      m_gridRows( 0 ),
+      m_gridCellWidth( 0 ),
       m_maxLabelHeight( 0 ),
       m_styleResetRequested( true )
 {
@@ -382,9 +385,12 @@ QVector<VisiblePlacemark *> PlacemarkLayout::generateLayout( const ViewportParam
         return QVector<VisiblePlacemark *>();
     }
 
-    const int secnumber = viewport->height() / m_maxLabelHeight + 1;
-    m_rowsection.clear();
-    m_rowsection.resize(secnumber);
+    // Labels are usually several times wider than high
+    m_gridCellWidth = 4 * m_maxLabelHeight;
+    m_gridColumns = viewport->width() / m_gridCellWidth + 1;
+    m_gridRows = viewport->height() / m_maxLabelHeight + 1;
+    m_labelGrid.clear();
+    m_labelGrid.resize( m_gridColumns * m_gridRows );
 
     m_paintOrder.clear();
     m_labelArea = 0;
@@ -566,14 +572,13 @@ bool PlacemarkLayout::layoutPlacemark( const GeoDataPlacemark *placemark, qreal
                                      y - qRound( hotSpot.y() ) ) );
     mark->setLabelRect( labelRect );
 
-    // Add the current placemark to the matching row and its
-    // direct neighbors.
-    int idx = y / m_maxLabelHeight;
-    if ( idx - 1 >= 0 )
-        m_rowsection[ idx - 1 ].append( mark );
-    m_rowsection[ idx ].append( mark );
-    if ( idx + 1 < m_rowsection.size() )
-        m_rowsection[ idx + 1 ].append( mark );
+    // Add the current placemark to all grid cells its label covers.
+    const QRect cells = gridCells( labelRect );
+    for ( int row = cells.top(); row <= cells.bottom(); ++row ) {
+        for ( int column = cells.left(); column <= cells.right(); ++column ) {
+            m_labelGrid[ row * m_gridColumns + column ].append( mark );
+        }
+    }
 
     m_paintOrder.append( mark );
     m_labelArea += labelRect.width() * labelRect.height();
@@ -600,8 +605,6 @@ QRectF PlacemarkLayout::roomForLabel( const GeoDataStyle * style,
                                       const qreal x, const qreal y,
                                       const QString &labelText ) const
 {
-    bool  isRoom      = false;
-
     int symbolwidth = style->iconStyle().icon().width();
 
     QFont labelFont = style->labelStyle().font();
@@ -616,8 +619,6 @@ QRectF PlacemarkLayout::roomForLabel( const GeoDataStyle * style,
         textWidth = ( QFontMetrics( labelFont ).width( labelText ) );
     }
 
-    const QVector<VisiblePlacemark*> currentsec = m_rowsection.at( y / m_maxLabelHeight );
-
     if ( style->labelStyle().alignment() == GeoDataLabelStyle::Corner ) {
         qreal  xpos = x + symbolwidth / 2 + 1;
         qreal  ypos = y;
@@ -636,43 +637,21 @@ QRectF PlacemarkLayout::roomForLabel( const GeoDataStyle * style,
                 ypos = y;
             }
 
-            isRoom = true;
             labelRect.moveTo( xpos, ypos );
 
             // Check if there is another label or symbol that overlaps.
-            QVector<VisiblePlacemark*>::const_iterator beforeItEnd = m_paintOrder.constEnd();
-            for ( QVector<VisiblePlacemark*>::ConstIterator beforeIt = m_paintOrder.constBegin();
-                  beforeIt != beforeItEnd;
-                  ++beforeIt ) {
-                if ( labelRect.intersects( (*beforeIt)->labelRect()) ) {
-                    isRoom = false;
-                    break;
-                }
-            }
-
-            if ( isRoom ) {
+            if ( isRoom( labelRect ) ) {
                 // claim the place immediately if it hasn't been used yet
                 return labelRect;
             }
         }
     }
     else if ( style->labelStyle().alignment() == GeoDataLabelStyle::Center ) {
-        isRoom = true;
         QRectF  labelRect( x - textWidth / 2, y - textHeight / 2,
                           textWidth, textHeight );
 
         // Check if there is another label or symbol that overlaps.
-        QVector<VisiblePlacemark*>::const_iterator beforeItEnd = currentsec.constEnd();
-        for ( QVector<VisiblePlacemark*>::ConstIterator beforeIt = currentsec.constBegin();
-              beforeIt != beforeItEnd; ++beforeIt )
-        {
-            if ( labelRect.intersects( (*beforeIt)->labelRect() ) ) {
-                isRoom = false;
-                break;
-            }
-        }
-
-        if ( isRoom ) {
+        if ( isRoom( labelRect ) ) {
             // claim the place immediately if it hasn't been used yet 
             return labelRect;
         }
@@ -682,6 +661,36 @@ QRectF PlacemarkLayout::roomForLabel( const GeoDataStyle * style,
                      // for the rectangle anymore.
 }
 
+QRect PlacemarkLayout::gridCells( const QRectF &rect ) const
+{
+    // Labels partially outside of the screen are put into the border cells,
+    // which keeps overlapping labels in common cells.
+    const int left = qBound( 0, qFloor( rect.left() / m_gridCellWidth ), m_gridColumns - 1 );
+    const int right = qBound( 0, qFloor( rect.right() / m_gridCellWidth ), m_gridColumns - 1 );
+    const int top = qBound( 0, qFloor( rect.top() / m_maxLabelHeight ), m_gridRows - 1 );
+    const int bottom = qBound( 0, qFloor( rect.bottom() / m_maxLabelHeight ), m_gridRows - 1 );
+
+    return QRect( QPoint( left, top ), QPoint( right, bottom ) );
+}
+
+bool PlacemarkLayout::isRoom( const QRectF &labelRect ) const
+{
+    const QRect cells = gridCells( labelRect );
+    for ( int row = cells.top(); row <= cells.bottom(); ++row ) {
+        for ( int column = cells.left(); column <= cells.right(); ++column ) {
+            const QVector<VisiblePlacemark*> &cell = m_labelGrid.at( row * m_gridColumns + column );
+            QVector<VisiblePlacemark*>::ConstIterator const end = cell.constEnd();
+            for ( QVector<VisiblePlacemark*>::ConstIterator it = cell.constBegin(); it != end; ++it ) {
+                if ( labelRect.intersects( (*it)->labelRect() ) ) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 bool PlacemarkLayout::placemarksOnScreenLimit( const QSize &screenSize ) const
 {
     int ratio = ( m_labelArea * 100 ) / ( screenSize.width() * screenSize.height() );
@@ -127,6 +127,17 @@ class PlacemarkLayout : public QObject
                          const qreal x, const qreal y,
                          const QString &labelText ) const;
 
+    /**
+     * Returns the range of cells of m_labelGrid covered by @p rect,
+     * clamped to the grid.
+     */
+    QRect   gridCells( const QRectF &rect ) const;
+
+    /**
+     * Returns whether @p labelRect doesn't intersect any label placed so far.
+     */
+    bool    isRoom( const QRectF &labelRect ) const;
+
     bool    placemarksOnScreenLimit( const QSize &screenSize ) const;
 
  private:
@@ -139,7 +150,15 @@ class PlacemarkLayout : public QObject
     QString m_runtimeTrace;
     int m_labelArea;
     QHash<const GeoDataPlacemark*, VisiblePlacemark*> m_visiblePlacemarks;
-    QVector< QVector< VisiblePlacemark* > >  m_rowsection;
+
+    /**
+     * The labels placed so far in the screen cells they cover, row by row,
+     * so that collision tests only need to look at nearby labels.
+     */
+    QVector< QVector< VisiblePlacemark* > >  m_labelGrid;
+    int m_gridColumns;
+    int m_gridRows;
+    int m_gridCellWidth;
 
     /// map providing the list of placemark belonging in TileId as key
     QMap<TileId, QList<const GeoDataPlacemark*> > m_placemarkCache;
@@ -14,8 +14,14 @@
 #include "PluginManager.h"
 
 // Qt
+#include <QtCore/QDataStream>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QHash>
 #include <QtCore/QList>
 #include <QtCore/QPluginLoader>
+#include <QtCore/QSet>
 #include <QtCore/QTime>
 
 // Local dir
@@ -28,23 +34,65 @@
 #include "ReverseGeocodingRunnerPlugin.h"
 #include "RoutingRunnerPlugin.h"
 #include "SearchRunnerPlugin.h"
+#include "VersionedCacheFile.h"
 
 namespace Marble
 {
 
+static const quint32 pluginCacheMagic = 0x4d504331;
+
 class PluginManagerPrivate
 {
  public:
+    enum PluginType {
+        InvalidPlugin,
+        RenderPluginType,
+        PositionProviderPluginType,
+        SearchRunnerPluginType,
+        ReverseGeocodingRunnerPluginType,
+        RoutingRunnerPluginType,
+        ParseRunnerPluginType
+    };
+
+    /**
+     * What is known about a plugin file without loading it. The entry is valid
+     * as long as the file has the same modification time and size.
+     */
+    struct PluginInfo
+    {
+        QDateTime lastModified;
+        qint64 size;
+        quint32 type;
+
+        friend QDataStream &operator<<( QDataStream &s, const PluginInfo &info )
+        {
+            return s << info.lastModified << info.size << info.type;
+        }
+
+        friend QDataStream &operator>>( QDataStream &s, PluginInfo &info )
+        {
+            return s >> info.lastModified >> info.size >> info.type;
+        }
+    };
+
     PluginManagerPrivate()
-            : m_pluginsLoaded(false)
+            : m_pluginCacheRead(false)
     {
     }
 
     ~PluginManagerPrivate();
 
-    void loadPlugins();
+    void loadPlugins( PluginType type );
+    PluginType loadPlugin( const QString &path );
+
+    static QString pluginCacheFileName();
+    void readPluginCache();
+    void writePluginCache() const;
 
-    bool m_pluginsLoaded;
+    QSet<int> m_loadedTypes;
+    QSet<QString> m_loadedFiles;
+    bool m_pluginCacheRead;
+    QHash<QString, PluginInfo> m_pluginCache;
     QList<const RenderPlugin *> m_renderPluginTemplates;
     QList<const PositionProviderPlugin *> m_positionProviderPluginTemplates;
     QList<const SearchRunnerPlugin *> m_searchRunnerPlugins;
@@ -70,78 +118,78 @@ PluginManager::~PluginManager()
 
 QList<const RenderPlugin *> PluginManager::renderPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RenderPluginType );
     return d->m_renderPluginTemplates;
 }
 
 void PluginManager::addRenderPlugin( RenderPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RenderPluginType );
     d->m_renderPluginTemplates << plugin;
     emit renderPluginsChanged();
 }
 
 QList<const PositionProviderPlugin *> PluginManager::positionProviderPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::PositionProviderPluginType );
     return d->m_positionProviderPluginTemplates;
 }
 
 void PluginManager::addPositionProviderPlugin( PositionProviderPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::PositionProviderPluginType );
     d->m_positionProviderPluginTemplates << plugin;
     emit positionProviderPluginsChanged();
 }
 
 QList<const SearchRunnerPlugin *> PluginManager::searchRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::SearchRunnerPluginType );
     return d->m_searchRunnerPlugins;
 }
 
 void PluginManager::addSearchRunnerPlugin( SearchRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::SearchRunnerPluginType );
     d->m_searchRunnerPlugins << plugin;
     emit searchRunnerPluginsChanged();
 }
 
 QList<const ReverseGeocodingRunnerPlugin *> PluginManager::reverseGeocodingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ReverseGeocodingRunnerPluginType );
     return d->m_reverseGeocodingRunnerPlugins;
 }
 
 void PluginManager::addReverseGeocodingRunnerPlugin( ReverseGeocodingRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ReverseGeocodingRunnerPluginType );
     d->m_reverseGeocodingRunnerPlugins << plugin;
     emit reverseGeocodingRunnerPluginsChanged();
 }
 
 QList<RoutingRunnerPlugin *> PluginManager::routingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RoutingRunnerPluginType );
     return d->m_routingRunnerPlugins;
 }
 
 void PluginManager::addRoutingRunnerPlugin( RoutingRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::RoutingRunnerPluginType );
     d->m_routingRunnerPlugins << plugin;
     emit routingRunnerPluginsChanged();
 }
 
 QList<const ParseRunnerPlugin *> PluginManager::parsingRunnerPlugins() const
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ParseRunnerPluginType );
     return d->m_parsingRunnerPlugins;
 }
 
 void PluginManager::addParseRunnerPlugin( ParseRunnerPlugin *plugin )
 {
-    d->loadPlugins();
+    d->loadPlugins( PluginManagerPrivate::ParseRunnerPluginType );
     d->m_parsingRunnerPlugins << plugin;
     emit parseRunnerPluginsChanged();
 }
@@ -180,66 +228,141 @@ bool appendPlugin( QObject * obj, QPluginLoader* &loader, QList<const T*> &plugi
     return false;
 }
 
-void PluginManagerPrivate::loadPlugins()
+void PluginManagerPrivate::loadPlugins( PluginType type )
 {
-    if (m_pluginsLoaded)
+    if ( m_loadedTypes.contains( type ) )
     {
         return;
     }
 
     QTime t;
     t.start();
-    mDebug() << "Starting to load Plugins.";
+    mDebug() << "Starting to load Plugins of type" << type;
 
-    QStringList pluginFileNameList = MarbleDirs::pluginEntryList( "", QDir::Files );
+    if ( !m_pluginCacheRead ) {
+        readPluginCache();
+        m_pluginCacheRead = true;
+        MarbleDirs::debug();
+    }
 
-    MarbleDirs::debug();
+    QStringList pluginFileNameList = MarbleDirs::pluginEntryList( "", QDir::Files );
 
-    Q_ASSERT( m_renderPluginTemplates.isEmpty() );
-    Q_ASSERT( m_positionProviderPluginTemplates.isEmpty() );
-    Q_ASSERT( m_searchRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_reverseGeocodingRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_routingRunnerPlugins.isEmpty() );
-    Q_ASSERT( m_parsingRunnerPlugins.isEmpty() );
+    bool pluginCacheChanged = false;
+    QSet<QString> existingFiles;
 
     foreach( const QString &fileName, pluginFileNameList ) {
         // mDebug() << fileName << " - " << MarbleDirs::pluginPath( fileName );
         QString const path = MarbleDirs::pluginPath( fileName );
-        QPluginLoader* loader = new QPluginLoader( path );
-
-        QObject * obj = loader->instance();
-
-        if ( obj ) {
-            bool isPlugin = appendPlugin<RenderPlugin, RenderPluginInterface>
-                       ( obj, loader, m_renderPluginTemplates );
-            isPlugin = isPlugin || appendPlugin<PositionProviderPlugin, PositionProviderPluginInterface>
-                       ( obj, loader, m_positionProviderPluginTemplates );
-            isPlugin = isPlugin || appendPlugin<SearchRunnerPlugin, SearchRunnerPlugin>
-                       ( obj, loader, m_searchRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<ReverseGeocodingRunnerPlugin, ReverseGeocodingRunnerPlugin>
-                       ( obj, loader, m_reverseGeocodingRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<RoutingRunnerPlugin, RoutingRunnerPlugin>
-                       ( obj, loader, m_routingRunnerPlugins ); // intentionally T==U
-            isPlugin = isPlugin || appendPlugin<ParseRunnerPlugin, ParseRunnerPlugin>
-                       ( obj, loader, m_parsingRunnerPlugins ); // intentionally T==U
-            if ( !isPlugin ) {
-                qWarning() << "Ignoring the following plugin since it couldn't be loaded:" << path;
-                mDebug() << "Plugin failure:" << path << "is a plugin, but it does not implement the "
-                        << "right interfaces or it was compiled against an old version of Marble. Ignoring it.";
-                delete loader;
-            }
-        } else {
-            qWarning() << "Ignoring to load the following file since it doesn't look like a valid Marble plugin:" << path << endl
-                       << "Reason:" << loader->errorString();
-            delete loader;
+        existingFiles << path;
+
+        if ( m_loadedFiles.contains( path ) ) {
+            continue;
         }
+
+        // Plugins known to be of another type are only loaded when asked for
+        QFileInfo const fileInfo( path );
+        QHash<QString, PluginInfo>::const_iterator const cached = m_pluginCache.constFind( path );
+        if ( cached != m_pluginCache.constEnd()
+             && cached.value().lastModified == fileInfo.lastModified()
+             && cached.value().size == fileInfo.size()
+             && cached.value().type != quint32( type ) ) {
+            continue;
+        }
+
+        m_loadedFiles << path;
+        PluginType const loadedType = loadPlugin( path );
+
+        if ( loadedType == InvalidPlugin ) {
+            // not cached, so that it gets tried again once it can be loaded
+            pluginCacheChanged |= m_pluginCache.remove( path ) > 0;
+            continue;
+        }
+
+        PluginInfo info;
+        info.lastModified = fileInfo.lastModified();
+        info.size = fileInfo.size();
+        info.type = loadedType;
+        m_pluginCache.insert( path, info );
+        pluginCacheChanged = true;
+    }
+
+    // forget about plugins which have been removed
+    foreach( const QString &path, m_pluginCache.keys() ) {
+        if ( !existingFiles.contains( path ) && !QFile::exists( path ) ) {
+            m_pluginCache.remove( path );
+            pluginCacheChanged = true;
+        }
+    }
+
+    if ( pluginCacheChanged ) {
+        writePluginCache();
     }
 
-    m_pluginsLoaded = true;
+    m_loadedTypes << type;
 
     mDebug() << Q_FUNC_INFO << "Time elapsed:" << t.elapsed() << "ms";
 }
 
+PluginManagerPrivate::PluginType PluginManagerPrivate::loadPlugin( const QString &path )
+{
+    QPluginLoader* loader = new QPluginLoader( path );
+
+    QObject * obj = loader->instance();
+
+    if ( !obj ) {
+        qWarning() << "Ignoring to load the following file since it doesn't look like a valid Marble plugin:" << path << endl
+                   << "Reason:" << loader->errorString();
+        delete loader;
+        return InvalidPlugin;
+    }
+
+    if ( appendPlugin<RenderPlugin, RenderPluginInterface>
+         ( obj, loader, m_renderPluginTemplates ) ) {
+        return RenderPluginType;
+    }
+    if ( appendPlugin<PositionProviderPlugin, PositionProviderPluginInterface>
+         ( obj, loader, m_positionProviderPluginTemplates ) ) {
+        return PositionProviderPluginType;
+    }
+    if ( appendPlugin<SearchRunnerPlugin, SearchRunnerPlugin>
+         ( obj, loader, m_searchRunnerPlugins ) ) { // intentionally T==U
+        return SearchRunnerPluginType;
+    }
+    if ( appendPlugin<ReverseGeocodingRunnerPlugin, ReverseGeocodingRunnerPlugin>
+         ( obj, loader, m_reverseGeocodingRunnerPlugins ) ) { // intentionally T==U
+        return ReverseGeocodingRunnerPluginType;
+    }
+    if ( appendPlugin<RoutingRunnerPlugin, RoutingRunnerPlugin>
+         ( obj, loader, m_routingRunnerPlugins ) ) { // intentionally T==U
+        return RoutingRunnerPluginType;
+    }
+    if ( appendPlugin<ParseRunnerPlugin, ParseRunnerPlugin>
+         ( obj, loader, m_parsingRunnerPlugins ) ) { // intentionally T==U
+        return ParseRunnerPluginType;
+    }
+
+    qWarning() << "Ignoring the following plugin since it couldn't be loaded:" << path;
+    mDebug() << "Plugin failure:" << path << "is a plugin, but it does not implement the "
+            << "right interfaces or it was compiled against an old version of Marble. Ignoring it.";
+    delete loader;
+    return InvalidPlugin;
+}
+
+QString PluginManagerPrivate::pluginCacheFileName()
+{
+    return MarbleDirs::localPath() + "/plugins.cache";
+}
+
+void PluginManagerPrivate::readPluginCache()
+{
+    VersionedCacheFile( pluginCacheFileName(), pluginCacheMagic ).read( m_pluginCache );
+}
+
+void PluginManagerPrivate::writePluginCache() const
+{
+    VersionedCacheFile( pluginCacheFileName(), pluginCacheMagic ).write( m_pluginCache );
+}
+
 }
 
 #include "PluginManager.moc"
@@ -40,6 +40,10 @@ class ParseRunnerPlugin;
  * the objects, the PluginManager internally has a list of the plugins
  * which are owned by the PluginManager and destroyed by it.
  *
+ * Plugins are loaded the first time plugins of their type are asked for.
+ * The type of each plugin file is kept in a cache in the local Marble
+ * directory, so that plugins of other types aren't loaded to find out.
+ *
  */
 
 class MARBLE_EXPORT PluginManager : public QObject
@@ -117,11 +117,12 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
 
     polygons.append( new QPolygonF );
 
-    GeoDataLineString::ConstIterator itCoords = lineString.constBegin();
-    GeoDataLineString::ConstIterator itPreviousCoords = lineString.constBegin();
+    // The nodes are decoded one by one, so a compact line string stays compact
+    int index = 0;
+    GeoDataCoordinates currentCoords;
+    GeoDataCoordinates previousCoords;
 
-    GeoDataLineString::ConstIterator itBegin = lineString.constBegin();
-    GeoDataLineString::ConstIterator itEnd = lineString.constEnd();
+    const int size = lineString.size();
 
     bool processingLastNode = false;
 
@@ -137,24 +138,25 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
                               ( viewport->radius() >   50 ) ? 1 :
                                                               0;
 
-    while ( itCoords != itEnd )
+    while ( index < size )
     {
+        currentCoords = lineString.coordinates( index );
 
         // Optimization for line strings with a big amount of nodes
-        bool skipNode = itCoords != itBegin && isLong && !processingLastNode &&
-                ( (*itCoords).detail() > maximumDetail
-                  || viewport->resolves( *itPreviousCoords, *itCoords ) );
+        bool skipNode = index != 0 && isLong && !processingLastNode &&
+                ( currentCoords.detail() > maximumDetail
+                  || viewport->resolves( previousCoords, currentCoords ) );
 
         if ( !skipNode ) {
 
 
             Q_Q( const CylindricalProjection );
 
-            q->screenCoordinates( *itCoords, viewport, x, y );
+            q->screenCoordinates( currentCoords, viewport, x, y );
 
             // Initializing variables that store the values of the previous iteration
-            if ( !processingLastNode && itCoords == itBegin ) {
-                itPreviousCoords = itCoords;
+            if ( !processingLastNode && index == 0 ) {
+                previousCoords = currentCoords;
                 previousX = x;
                 previousY = y;
             }
@@ -165,8 +167,8 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
 
             if ( lineString.tessellate() ) {
 
-                mirrorCount = tessellateLineSegment( *itPreviousCoords, previousX, previousY,
-                                           *itCoords, x, y,
+                mirrorCount = tessellateLineSegment( previousCoords, previousX, previousY,
+                                           currentCoords, x, y,
                                            polygons, viewport,
                                            f, mirrorCount, distance );
             }
@@ -175,10 +177,10 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
                 // special case for polys which cross dateline but have no Tesselation Flag
                 // the expected rendering is a screen coordinates straight line between
                 // points, but in projections with repeatX things are not smooth
-                mirrorCount = crossDateLine( *itPreviousCoords, *itCoords, polygons, viewport, mirrorCount, distance );
+                mirrorCount = crossDateLine( previousCoords, currentCoords, polygons, viewport, mirrorCount, distance );
             }
 
-            itPreviousCoords = itCoords;
+            previousCoords = currentCoords;
             previousX = x;
             previousY = y;
         }
@@ -189,10 +191,10 @@ bool CylindricalProjectionPrivate::lineStringToPolygon( const GeoDataLineString
         if ( processingLastNode ) {
             break;
         }
-        ++itCoords;
+        ++index;
 
-        if ( itCoords == itEnd  && lineString.isClosed() ) {
-            itCoords = itBegin;
+        if ( index == size  && lineString.isClosed() ) {
+            index = 0;
             processingLastNode = true;
         }
     }
@@ -208,9 +208,9 @@ bool SphericalProjection::geoCoordinates( const int x, const int y,
 
     const qreal qz = sqrt( 1 - qx * qx - qy * qy );
 
-    Quaternion  qpos( 0.0, qx, qy, qz );
-    qpos.rotateAroundAxis( viewport->planetAxis() );
-    qpos.getSpherical( lon, lat );
+    matrix  planetAxisMatrix;
+    viewport->planetAxis().toMatrix( planetAxisMatrix );
+    Quaternion::rotateToSpherical( planetAxisMatrix, 1, &qx, &qy, &qz, &lon, &lat );
 
     if ( unit == GeoDataCoordinates::Degree ) {
         lon *= RAD2DEG;
@@ -364,8 +364,10 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
 
     polygons.append( new QPolygonF );
 
-    GeoDataLineString::ConstIterator itCoords = lineString.constBegin();
-    GeoDataLineString::ConstIterator itPreviousCoords = lineString.constBegin();
+    // The nodes are decoded one by one, so a compact line string stays compact
+    int index = 0;
+    GeoDataCoordinates currentCoords;
+    GeoDataCoordinates previousCoords;
 
     // Some projections display the earth in a way so that there is a
     // foreside and a backside.
@@ -388,8 +390,7 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
     bool horizonOrphan = false;
     GeoDataCoordinates horizonOrphanCoords;
 
-    GeoDataLineString::ConstIterator itBegin = lineString.constBegin();
-    GeoDataLineString::ConstIterator itEnd = lineString.constEnd();
+    const int size = lineString.size();
 
     bool processingLastNode = false;
 
@@ -405,22 +406,23 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
                               ( viewport->radius() >   50 ) ? 1 :
                                                               0;
 
-    while ( itCoords != itEnd )
+    while ( index < size )
     {
+        currentCoords = lineString.coordinates( index );
 
         // Optimization for line strings with a big amount of nodes
-        bool skipNode = itCoords != itBegin && isLong && !processingLastNode &&
-                ( (*itCoords).detail() > maximumDetail
-                  || viewport->resolves( *itPreviousCoords, *itCoords ) );
+        bool skipNode = index != 0 && isLong && !processingLastNode &&
+                ( currentCoords.detail() > maximumDetail
+                  || viewport->resolves( previousCoords, currentCoords ) );
 
         if ( !skipNode ) {
 
-            q->screenCoordinates( *itCoords, viewport, x, y, globeHidesPoint );
+            q->screenCoordinates( currentCoords, viewport, x, y, globeHidesPoint );
 
             // Initializing variables that store the values of the previous iteration
-            if ( !processingLastNode && itCoords == itBegin ) {
+            if ( !processingLastNode && index == 0 ) {
                 previousGlobeHidesPoint = globeHidesPoint;
-                itPreviousCoords = itCoords;
+                previousCoords = currentCoords;
                 previousX = x;
                 previousY = y;
             }
@@ -431,7 +433,7 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
      
             if ( isAtHorizon ) {
                 // Handle the "horizon case"
-                horizonCoords = findHorizon( *itPreviousCoords, *itCoords, viewport, f );
+                horizonCoords = findHorizon( previousCoords, currentCoords, viewport, f );
 
                 if ( lineString.isClosed() ) {
                     if ( horizonPair ) {
@@ -467,8 +469,8 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
 
                 if ( !isAtHorizon ) {
 
-                    tessellateLineSegment( *itPreviousCoords, previousX, previousY,
-                                           *itCoords, x, y,
+                    tessellateLineSegment( previousCoords, previousX, previousY,
+                                           currentCoords, x, y,
                                            polygons, viewport,
                                            f );
 
@@ -478,12 +480,12 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
                     // current or previous point in the line. 
                     if ( previousGlobeHidesPoint ) {
                         tessellateLineSegment( horizonCoords, horizonX, horizonY,
-                                               *itCoords, x, y,
+                                               currentCoords, x, y,
                                                polygons, viewport,
                                                f );
                     }
                     else {
-                        tessellateLineSegment( *itPreviousCoords, previousX, previousY,
+                        tessellateLineSegment( previousCoords, previousX, previousY,
                                                horizonCoords, horizonX, horizonY,
                                                polygons, viewport,
                                                f );
@@ -510,7 +512,7 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
             }
 
             previousGlobeHidesPoint = globeHidesPoint;
-            itPreviousCoords = itCoords;
+            previousCoords = currentCoords;
             previousX = x;
             previousY = y;
         }
@@ -521,10 +523,10 @@ bool SphericalProjectionPrivate::lineStringToPolygon( const GeoDataLineString &l
         if ( processingLastNode ) {
             break;
         }
-        ++itCoords;
+        ++index;
 
-        if ( itCoords == itEnd  && lineString.isClosed() ) {
-            itCoords = itBegin;
+        if ( index == size  && lineString.isClosed() ) {
+            index = 0;
             processingLastNode = true;
         }
     }
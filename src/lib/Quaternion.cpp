@@ -12,9 +12,15 @@
 
 #include "Quaternion.h"
 
+#include "MathHelper.h"
+
 #include <cmath>
 using namespace std;
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 #include <QtCore/QString>
 #include <QtCore/QDebug>
 
@@ -257,3 +263,85 @@ void Quaternion::rotateAroundAxis(const matrix &m)
     v[Q_Y] = y;
     v[Q_Z] = z;
 }
+
+#if defined( __SSE2__ ) && !defined( QT_COORD_TYPE )
+// SSE2 version of fastAtan2() that works on two values at once.
+static inline __m128d fastAtan2Sse2( __m128d y, __m128d x )
+{
+    const __m128d signMask = _mm_set1_pd( -0.0 );
+    const __m128d zero = _mm_setzero_pd();
+
+    const __m128d absX = _mm_andnot_pd( signMask, x );
+    const __m128d absY = _mm_andnot_pd( signMask, y );
+    const __m128d minXY = _mm_min_pd( absX, absY );
+    const __m128d maxXY = _mm_max_pd( absX, absY );
+
+    const __m128d reduce = _mm_cmpgt_pd( minXY, _mm_mul_pd( _mm_set1_pd( FAST_ATAN_TAN_PI_8 ), maxXY ) );
+    const __m128d a = _mm_div_pd( _mm_sub_pd( minXY, _mm_and_pd( reduce, maxXY ) ),
+                                  _mm_add_pd( maxXY, _mm_and_pd( reduce, minXY ) ) );
+    const __m128d a2 = _mm_mul_pd( a, a );
+
+    __m128d result = _mm_set1_pd( FAST_ATAN_C5 );
+    result = _mm_add_pd( _mm_mul_pd( result, a2 ), _mm_set1_pd( FAST_ATAN_C4 ) );
+    result = _mm_add_pd( _mm_mul_pd( result, a2 ), _mm_set1_pd( FAST_ATAN_C3 ) );
+    result = _mm_add_pd( _mm_mul_pd( result, a2 ), _mm_set1_pd( FAST_ATAN_C2 ) );
+    result = _mm_add_pd( _mm_mul_pd( result, a2 ), _mm_set1_pd( FAST_ATAN_C1 ) );
+    result = _mm_add_pd( _mm_mul_pd( result, a2 ), _mm_set1_pd( FAST_ATAN_C0 ) );
+    result = _mm_mul_pd( result, a );
+    result = _mm_add_pd( result, _mm_and_pd( reduce, _mm_set1_pd( 0.78539816339744830962 ) ) );
+
+    const __m128d swap = _mm_cmpgt_pd( absY, absX );
+    result = _mm_or_pd( _mm_and_pd( swap, _mm_sub_pd( _mm_set1_pd( 1.57079632679489661923 ), result ) ),
+                        _mm_andnot_pd( swap, result ) );
+    const __m128d negativeX = _mm_cmplt_pd( x, zero );
+    result = _mm_or_pd( _mm_and_pd( negativeX, _mm_sub_pd( _mm_set1_pd( 3.14159265358979323846 ), result ) ),
+                        _mm_andnot_pd( negativeX, result ) );
+    result = _mm_xor_pd( result, _mm_and_pd( _mm_cmplt_pd( y, zero ), signMask ) );
+
+    return _mm_andnot_pd( _mm_cmpeq_pd( maxXY, zero ), result );
+}
+#endif
+
+void Quaternion::rotateToSpherical( const matrix &m, int count,
+                                    const qreal *x, const qreal *y, const qreal *z,
+                                    qreal *lon, qreal *lat )
+{
+    int i = 0;
+
+#if defined( __SSE2__ ) && !defined( QT_COORD_TYPE )
+    const __m128d m00 = _mm_set1_pd( m[0][0] ), m10 = _mm_set1_pd( m[1][0] ), m20 = _mm_set1_pd( m[2][0] );
+    const __m128d m01 = _mm_set1_pd( m[0][1] ), m11 = _mm_set1_pd( m[1][1] ), m21 = _mm_set1_pd( m[2][1] );
+    const __m128d m02 = _mm_set1_pd( m[0][2] ), m12 = _mm_set1_pd( m[1][2] ), m22 = _mm_set1_pd( m[2][2] );
+    const __m128d one = _mm_set1_pd( 1.0 );
+    const __m128d minusOne = _mm_set1_pd( -1.0 );
+    const __m128d poleDistance = _mm_set1_pd( 0.00005 );
+
+    for ( ; i + 2 <= count; i += 2 ) {
+        const __m128d vx = _mm_loadu_pd( x + i );
+        const __m128d vy = _mm_loadu_pd( y + i );
+        const __m128d vz = _mm_loadu_pd( z + i );
+
+        const __m128d rx = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m00, vx ), _mm_mul_pd( m10, vy ) ), _mm_mul_pd( m20, vz ) );
+        const __m128d ry = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m01, vx ), _mm_mul_pd( m11, vy ) ), _mm_mul_pd( m21, vz ) );
+        const __m128d rz = _mm_add_pd( _mm_add_pd( _mm_mul_pd( m02, vx ), _mm_mul_pd( m12, vy ) ), _mm_mul_pd( m22, vz ) );
+
+        // lat = asin( y )
+        const __m128d clampedY = _mm_min_pd( _mm_max_pd( ry, minusOne ), one );
+        const __m128d cosLat = _mm_sqrt_pd( _mm_mul_pd( _mm_sub_pd( one, clampedY ), _mm_add_pd( one, clampedY ) ) );
+        _mm_storeu_pd( lat + i, fastAtan2Sse2( clampedY, cosLat ) );
+
+        // lon = atan2( x, z ), or zero close to the poles as in getSpherical()
+        const __m128d offPole = _mm_cmpgt_pd( _mm_add_pd( _mm_mul_pd( rx, rx ), _mm_mul_pd( rz, rz ) ), poleDistance );
+        _mm_storeu_pd( lon + i, _mm_and_pd( offPole, fastAtan2Sse2( rx, rz ) ) );
+    }
+#endif
+
+    for ( ; i < count; ++i ) {
+        const qreal rx = m[0][0] * x[i] + m[1][0] * y[i] + m[2][0] * z[i];
+        const qreal ry = m[0][1] * x[i] + m[1][1] * y[i] + m[2][1] * z[i];
+        const qreal rz = m[0][2] * x[i] + m[1][2] * y[i] + m[2][2] * z[i];
+
+        lat[i] = fastAsin( ry );
+        lon[i] = ( rx * rx + rz * rz > 0.00005 ) ? fastAtan2( rx, rz ) : 0.0;
+    }
+}
@@ -82,6 +82,23 @@ class MARBLE_EXPORT Quaternion
     void        toMatrix(matrix &m) const;
     void        rotateAroundAxis(const matrix &m);
 
+    /*!\brief rotates a row of vectors and converts them to spherical coordinates
+     *
+     * The vectors are passed as separate arrays of their x, y and z components.
+     * The result equals calling rotateAroundAxis(m) followed by getSpherical()
+     * for each of them, but atan2 and asin are replaced by the approximations
+     * of MathHelper.h and two vectors are processed at once where SSE2 is
+     * available.
+     *
+     * \param m the rotation matrix
+     * \param count the number of vectors
+     * \param x, y, z the components of the vectors
+     * \param lon, lat the resulting spherical coordinates
+     */
+    static void rotateToSpherical( const matrix &m, int count,
+                                   const qreal *x, const qreal *y, const qreal *z,
+                                   qreal *lon, qreal *lat );
+
     // TODO: Better add accessors...
     xmmfloat    v;
 };
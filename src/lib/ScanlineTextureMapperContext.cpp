@@ -11,6 +11,8 @@
 
 #include "ScanlineTextureMapperContext.h"
 
+#include <cstring>
+
 #include <QtGui/QImage>
 
 #include "MarbleDebug.h"
@@ -22,6 +24,28 @@
 
 using namespace Marble;
 
+ScanlineRowQueue::ScanlineRowQueue( int yTop, int yBottom, int threadCount )
+    : m_yTop( yTop ),
+      m_yBottom( yBottom ),
+      // Aim at about eight chunks per thread for load balancing,
+      // and use an even chunk size for interlaced rendering.
+      m_chunkSize( ( qMax( 2, ( yBottom - yTop ) / ( 8 * qMax( 1, threadCount ) ) ) + 1 ) & ~1 ),
+      m_nextChunk( 0 )
+{
+}
+
+bool ScanlineRowQueue::nextChunk( int &yStart, int &yEnd )
+{
+    const int chunk = m_nextChunk.fetchAndAddRelaxed( 1 );
+    yStart = m_yTop + chunk * m_chunkSize;
+    if ( yStart >= m_yBottom ) {
+        return false;
+    }
+
+    yEnd = qMin( yStart + m_chunkSize, m_yBottom );
+    return true;
+}
+
 ScanlineTextureMapperContext::ScanlineTextureMapperContext( StackedTileLoader * const tileLoader, int tileLevel )
     : m_tileLoader( tileLoader ),
       m_textureProjection( tileLoader->tileProjection() ),  // cache texture projection
@@ -168,7 +192,18 @@ void ScanlineTextureMapperContext::pixelValueApproxF( const qreal lon, const qre
 
         const bool alwaysCheckTileRange =
                 isOutOfTileRangeF( itLon, itLat, itStepLon, itStepLat, n );
-        
+
+        if ( !alwaysCheckTileRange ) {
+            // The whole span lies inside the tile: interpolate it in one go
+            // using 16.16 fixed point positions in the coordinates of m_tile.
+            const qreal scale = 65536.0 / ( 1 << m_deltaLevel );
+            m_tile->pixelsF( (int)( ( itLon + itStepLon + m_vTileStartX ) * scale ),
+                             (int)( ( itLat + itStepLat + m_vTileStartY ) * scale ),
+                             (int)( itStepLon * scale ), (int)( itStepLat * scale ),
+                             n - 1, scanLine );
+            return;
+        }
+
         for ( int j=1; j < n; ++j ) {
             qreal posX = itLon + itStepLon * j;
             qreal posY = itLat + itStepLat * j;
@@ -307,15 +342,12 @@ void ScanlineTextureMapperContext::pixelValueApprox( const qreal lon, const qrea
                 isOutOfTileRange( itLon, itLat, itStepLon, itStepLat, n );
                                   
         if ( !alwaysCheckTileRange ) {
-            int iPosXf = itLon;
-            int iPosYf = itLat;
-            for ( int j = 1; j < n; ++j ) {
-                iPosXf += itStepLon;
-                iPosYf += itStepLat;
-                *scanLine = m_tile->pixel( ( ( iPosXf >> 7 ) + m_vTileStartX ) >> m_deltaLevel,
-                                           ( ( iPosYf >> 7 ) + m_vTileStartY ) >> m_deltaLevel );
-                ++scanLine;
-            }
+            // All positions are non-negative here, so adding the virtual tile offset
+            // before shifting by 7 + m_deltaLevel gives the same pixels as shifting twice.
+            m_tile->pixels( itLon + itStepLon + ( m_vTileStartX << 7 ),
+                            itLat + itStepLat + ( m_vTileStartY << 7 ),
+                            itStepLon, itStepLat, 7 + m_deltaLevel, n - 1, scanLine );
+            scanLine += n - 1;
         }        
         else {
             for ( int j = 1; j < n; ++j ) {
@@ -438,6 +470,33 @@ QImage::Format ScanlineTextureMapperContext::optimalCanvasImageFormat( const Vie
 }
 
 
+void ScanlineTextureMapperContext::scrollImage( QImage *image, int dx, int dy )
+{
+    Q_ASSERT( image->depth() == 32 );
+
+    const int width = image->width();
+    const int height = image->height();
+
+    if ( qAbs( dx ) >= width || qAbs( dy ) >= height ) {
+        return;
+    }
+
+    const int rowCount = height - qAbs( dy );
+    const int pixelCount = width - qAbs( dx );
+
+    // Walk the rows in the direction that reads each source row
+    // before it gets overwritten.
+    for ( int i = 0; i < rowCount; ++i ) {
+        const int y = ( dy > 0 ) ? height - 1 - i : i;
+
+        QRgb *const target = (QRgb*)( image->scanLine( y ) );
+        const QRgb *const source = (QRgb*)( image->scanLine( y - dy ) );
+
+        memmove( target + qMax( 0, dx ), source + qMax( 0, -dx ), pixelCount * sizeof( QRgb ) );
+    }
+}
+
+
 void ScanlineTextureMapperContext::nextTile( int &posX, int &posY )
 {
     // Move from tile coordinates to global texture coordinates 
@@ -461,8 +520,10 @@ void ScanlineTextureMapperContext::nextTile( int &posX, int &posY )
     const int tileCol = lon / m_tileSize.width();
     const int tileRow = lat / m_tileSize.height();
 
-    m_deltaLevel = 0;
-    m_tile = m_tileLoader->loadTile( TileId( 0, m_tileLevel - m_deltaLevel, tileCol >> m_deltaLevel, tileRow >> m_deltaLevel ) );
+    // The tile loader may hand out a tile of a lower level while the requested
+    // one is still being loaded, so we have to address it via m_deltaLevel.
+    m_tile = m_tileLoader->loadTile( TileId( 0, m_tileLevel, tileCol, tileRow ) );
+    m_deltaLevel = m_tileLevel - m_tile->id().zoomLevel();
 
     // Update position variables:
     // m_tilePosX/Y stores the position of the tiles in 
@@ -503,8 +564,10 @@ void ScanlineTextureMapperContext::nextTile( qreal &posX, qreal &posY )
     const int tileCol = lon / m_tileSize.width();
     const int tileRow = lat / m_tileSize.height();
 
-    m_deltaLevel = 0;
-    m_tile = m_tileLoader->loadTile( TileId( 0, m_tileLevel - m_deltaLevel, tileCol >> m_deltaLevel, tileRow >> m_deltaLevel ) );
+    // The tile loader may hand out a tile of a lower level while the requested
+    // one is still being loaded, so we have to address it via m_deltaLevel.
+    m_tile = m_tileLoader->loadTile( TileId( 0, m_tileLevel, tileCol, tileRow ) );
+    m_deltaLevel = m_tileLevel - m_tile->id().zoomLevel();
 
     // Update position variables:
     // m_tilePosX/Y stores the position of the tiles in 
@@ -12,6 +12,7 @@
 #ifndef MARBLE_SCANLINETEXTUREMAPPERCONTEXT_H
 #define MARBLE_SCANLINETEXTUREMAPPERCONTEXT_H
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QSize>
 #include <QtGui/QImage>
 
@@ -27,6 +28,41 @@ class StackedTileLoader;
 class ViewportParams;
 
 
+/**
+ * Hands out chunks of scanlines to the render jobs of the scanline texture mappers.
+ *
+ * Instead of assigning a fixed band of the canvas to each thread, every render
+ * job keeps fetching the next chunk of rows until the queue is exhausted. This
+ * keeps all threads busy even if some rows are far more expensive than others,
+ * like the rows near the equator of the sphere.
+ */
+class ScanlineRowQueue
+{
+public:
+    /**
+     * @param yTop first row to be rendered
+     * @param yBottom row after the last row to be rendered
+     * @param threadCount number of render jobs that fetch rows from this queue
+     */
+    ScanlineRowQueue( int yTop, int yBottom, int threadCount );
+
+    /**
+     * Fetches the next chunk of rows [@p yStart, @p yEnd).
+     * Returns false if all rows have been handed out already.
+     *
+     * Chunks always start at an even offset from yTop, so interlaced
+     * rendering stays aligned.
+     */
+    bool nextChunk( int &yStart, int &yEnd );
+
+private:
+    const int m_yTop;
+    const int m_yBottom;
+    const int m_chunkSize;
+    QAtomicInt m_nextChunk;
+};
+
+
 class ScanlineTextureMapperContext
 {
 public:
@@ -46,6 +82,12 @@ public:
 
     static QImage::Format optimalCanvasImageFormat( const ViewportParams *viewport );
 
+    /**
+     * Moves the content of the 32 bit @p image by @p dx pixels to the right and by
+     * @p dy pixels to the bottom. The exposed pixels are left untouched.
+     */
+    static void scrollImage( QImage *image, int dx, int dy );
+
     int globalWidth() const;
     int globalHeight() const;
 
@@ -0,0 +1,139 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "ScreenPolygonCache.h"
+
+#include "GeoDataLineString.h"
+#include "ViewportParams.h"
+
+namespace Marble
+{
+
+ScreenPolygonCache::ScreenPolygonCache()
+    : m_lineString( 0 ),
+      m_revision( 0 ),
+      m_projectionGeneration( 0 ),
+      m_scaleGeneration( 0 ),
+      m_repeatsLeft( 0 ),
+      m_repeatsRight( 0 )
+{
+}
+
+const QVector<QPolygonF> &ScreenPolygonCache::polygons( const GeoDataLineString &lineString, const ViewportParams *viewport )
+{
+    if ( isValid( lineString, viewport ) && m_projectionGeneration == viewport->projectionGeneration() ) {
+        return m_polygons;
+    }
+
+    if ( isValid( lineString, viewport ) && isTranslatable( viewport ) ) {
+        const QPointF newOrigin = origin( viewport );
+        const QPointF offset = newOrigin - m_origin;
+        for ( int i = 0; i < m_polygons.size(); ++i ) {
+            m_polygons[i].translate( offset );
+        }
+
+        m_origin = newOrigin;
+        m_projectionGeneration = viewport->projectionGeneration();
+        return m_polygons;
+    }
+
+    QVector<QPolygonF*> polygons;
+    viewport->screenCoordinates( lineString, polygons );
+
+    m_polygons.clear();
+    m_polygons.reserve( polygons.size() );
+    foreach( QPolygonF* polygon, polygons ) {
+        m_polygons << *polygon;
+    }
+    qDeleteAll( polygons );
+
+    m_lineString = &lineString;
+    m_revision = lineString.revision();
+    m_latLonAltBox = lineString.latLonAltBox();
+    m_projectionGeneration = viewport->projectionGeneration();
+    m_scaleGeneration = viewport->scaleGeneration();
+    m_origin = origin( viewport );
+    repeats( viewport, m_repeatsLeft, m_repeatsRight );
+
+    return m_polygons;
+}
+
+void ScreenPolygonCache::clear()
+{
+    m_polygons.clear();
+    m_lineString = 0;
+    m_projectionGeneration = 0;
+    m_scaleGeneration = 0;
+}
+
+bool ScreenPolygonCache::isValid( const GeoDataLineString &lineString, const ViewportParams *viewport ) const
+{
+    return m_lineString == &lineString
+        && m_revision == lineString.revision()
+        && m_scaleGeneration == viewport->scaleGeneration();
+}
+
+bool ScreenPolygonCache::isTranslatable( const ViewportParams *viewport ) const
+{
+    // Moving the map of the globe rotates it
+    if ( viewport->projection() == Spherical ) {
+        return false;
+    }
+
+    // Line strings around a pole get extended to the top or bottom edge of the screen
+    if ( m_latLonAltBox.width() == 2 * M_PI ) {
+        return false;
+    }
+
+    // The polygons have been repeated to fill the screen. Moving them along is
+    // fine as long as the new center doesn't need additional repetitions.
+    int left = 0;
+    int right = 0;
+    repeats( viewport, left, right );
+
+    return left <= m_repeatsLeft && right <= m_repeatsRight;
+}
+
+void ScreenPolygonCache::repeats( const ViewportParams *viewport, int &left, int &right )
+{
+    left = 0;
+    right = 0;
+
+    if ( viewport->projection() == Spherical ) {
+        return;
+    }
+
+    const qreal centerLatitude = viewport->viewLatLonAltBox().center().latitude();
+    qreal xWest = 0;
+    qreal xEast = 0;
+    qreal y = 0;
+    viewport->screenCoordinates( GeoDataCoordinates( -M_PI, centerLatitude ), xWest, y );
+    viewport->screenCoordinates( GeoDataCoordinates( +M_PI, centerLatitude ), xEast, y );
+
+    if ( xWest <= 0 && xEast >= viewport->width() - 1 ) {
+        return;
+    }
+
+    const qreal repeatXInterval = xEast - xWest;
+    if ( xWest > 0 ) {
+        left = (int)( xWest / repeatXInterval ) + 1;
+    }
+    if ( xEast < viewport->width() ) {
+        right = (int)( ( viewport->width() - xEast ) / repeatXInterval ) + 1;
+    }
+}
+
+QPointF ScreenPolygonCache::origin( const ViewportParams *viewport )
+{
+    qreal x = 0;
+    qreal y = 0;
+    viewport->screenCoordinates( GeoDataCoordinates( 0.0, 0.0 ), x, y );
+    return QPointF( x, y );
+}
+
+}
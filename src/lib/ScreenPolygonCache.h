@@ -0,0 +1,82 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_SCREENPOLYGONCACHE_H
+#define MARBLE_SCREENPOLYGONCACHE_H
+
+#include <QtCore/QPointF>
+#include <QtCore/QVector>
+#include <QtGui/QPolygonF>
+
+#include "GeoDataLatLonAltBox.h"
+#include "marble_export.h"
+
+namespace Marble
+{
+
+class GeoDataLineString;
+class ViewportParams;
+
+/**
+ * @short The screen coordinates of a line string, kept across frames.
+ *
+ * Projecting a line string allocates a polygon for each of its visible parts.
+ * Graphics items keep the result for as long as the projection doesn't change,
+ * see ViewportParams::projectionGeneration(). If the map of a cylindrical
+ * projection only got moved, the polygons are moved along instead of
+ * projecting the line string again.
+ *
+ * Changes to a line string are noticed by its revision, see GeoDataLineString::revision().
+ */
+class MARBLE_EXPORT ScreenPolygonCache
+{
+ public:
+    ScreenPolygonCache();
+
+    /**
+     * Returns the screen polygons of @p lineString as computed by
+     * ViewportParams::screenCoordinates(), projecting it only if needed.
+     */
+    const QVector<QPolygonF> &polygons( const GeoDataLineString &lineString, const ViewportParams *viewport );
+
+    void clear();
+
+ private:
+    bool isValid( const GeoDataLineString &lineString, const ViewportParams *viewport ) const;
+
+    /**
+     * Returns whether the polygons can be moved to the current center of the viewport.
+     */
+    bool isTranslatable( const ViewportParams *viewport ) const;
+
+    /**
+     * Calculates how many copies of the map cylindrical projections paint left
+     * and right of the map, like CylindricalProjection does.
+     */
+    static void repeats( const ViewportParams *viewport, int &left, int &right );
+
+    static QPointF origin( const ViewportParams *viewport );
+
+    QVector<QPolygonF> m_polygons;
+
+    const GeoDataLineString *m_lineString;
+    int m_revision;
+    GeoDataLatLonAltBox m_latLonAltBox;
+
+    int m_projectionGeneration;
+    int m_scaleGeneration;
+
+    // screen position of a fixed point when the polygons were last moved
+    QPointF m_origin;
+    int m_repeatsLeft;
+    int m_repeatsRight;
+};
+
+}
+
+#endif
@@ -15,6 +15,7 @@
 #include <cmath>
 
 #include <QtCore/QRunnable>
+#include <QtCore/QVector>
 
 #include "MarbleGlobal.h"
 #include "GeoPainter.h"
@@ -35,7 +36,7 @@ using namespace Marble;
 class SphericalScanlineTextureMapper::RenderJob : public QRunnable
 {
 public:
-    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int yTop, int yBottom );
+    RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, ScanlineRowQueue *rowQueue );
 
     virtual void run();
 
@@ -45,18 +46,16 @@ private:
     QImage *const m_canvasImage;
     const ViewportParams *const m_viewport;
     const MapQuality m_mapQuality;
-    int const m_yTop;
-    int const m_yBottom;
+    ScanlineRowQueue *const m_rowQueue;
 };
 
-SphericalScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, int yTop, int yBottom )
+SphericalScanlineTextureMapper::RenderJob::RenderJob( StackedTileLoader *tileLoader, int tileLevel, QImage *canvasImage, const ViewportParams *viewport, MapQuality mapQuality, ScanlineRowQueue *rowQueue )
     : m_tileLoader( tileLoader ),
       m_tileLevel( tileLevel ),
       m_canvasImage( canvasImage ),
       m_viewport( viewport ),
       m_mapQuality( mapQuality ),
-      m_yTop( yTop ),
-      m_yBottom( yBottom )
+      m_rowQueue( rowQueue )
 {
 }
 
@@ -126,17 +125,16 @@ void SphericalScanlineTextureMapper::mapTexture( const ViewportParams *viewport,
                                       : yTop + radius + radius - skip;
 
     const int numThreads = m_threadPool.maxThreadCount();
-    const int yStep = ( yBottom - yTop ) / numThreads;
+    ScanlineRowQueue rowQueue( yTop, yBottom, numThreads );
     for ( int i = 0; i < numThreads; ++i ) {
-        const int yStart = yTop +  i      * yStep;
-        const int yEnd   = yTop + (i + 1) * yStep;
-        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, yStart, yEnd );
+        QRunnable *const job = new RenderJob( m_tileLoader, tileZoomLevel, &m_canvasImage, viewport, mapQuality, &rowQueue );
         m_threadPool.start( job );
     }
 
     m_threadPool.waitForDone();
 
     m_tileLoader->cleanupTilehash();
+    m_tileLoader->cleanupPendingTiles();
 }
 
 void SphericalScanlineTextureMapper::RenderJob::run()
@@ -167,133 +165,160 @@ void SphericalScanlineTextureMapper::RenderJob::run()
     // initialize needed variables that are modified during texture mapping:
 
     ScanlineTextureMapperContext context( m_tileLoader, m_tileLevel );
-    qreal  lon = 0.0;
-    qreal  lat = 0.0;
 
-    // Scanline based algorithm to texture map a sphere
-    for ( int y = m_yTop; y < m_yBottom ; ++y ) {
-
-        // Evaluate coordinates for the 3D position vector of the current pixel
-        const qreal qy = inverseRadius * (qreal)( imageHeight / 2 - y );
-        const qreal qr = 1.0 - qy * qy;
-
-        // rx is the radius component in x direction
-        const int rx = (int)sqrt( (qreal)( radius * radius
-                                      - ( ( y - imageHeight / 2 )
-                                          * ( y - imageHeight / 2 ) ) ) );
-
-        // Calculate the actual x-range of the map within the current scanline.
-        // 
-        // If the circular border of the earth disk is still visible then xLeft
-        // equals the scanline position of the most left pixel that gets covered
-        // by the earth disk. In terms of math this equals the half image width minus 
-        // the radius component on the current scanline in x direction ("rx").
-        //
-        // If the zoom factor is high enough then the whole screen gets covered
-        // by the earth and the border of the earth disk isn't visible anymore.
-        // In that situation xLeft equals zero.
-        // For xRight the situation is similar.
-
-        const int xLeft  = ( imageWidth / 2 - rx > 0 ) ? imageWidth / 2 - rx
-                                                       : 0;
-        const int xRight = ( imageWidth / 2 - rx > 0 ) ? xLeft + rx + rx
-                                                       : imageWidth;
-
-        QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) ) + xLeft;
-
-        const int xIpLeft  = ( imageWidth / 2 - rx > 0 ) ? n * (int)( xLeft / n + 1 )
-                                                         : 1;
-        const int xIpRight = ( imageWidth / 2 - rx > 0 ) ? n * (int)( xRight / n - 1 )
-                                                         : n * (int)( xRight / n - 1 ) + 1; 
-
-        // Decrease pole distortion due to linear approximation ( y-axis )
-        bool crossingPoleArea = false;
-        if ( northPole.v[Q_Z] > 0
-             && northPoleY - ( n * 0.75 ) <= y
-             && northPoleY + ( n * 0.75 ) >= y ) 
-        {
-            crossingPoleArea = true;
-        }
-
-        int ncount = 0;
-
-        for ( int x = xLeft; x < xRight; ++x ) {
-            // Prepare for interpolation
+    // The exactly evaluated pixels of a scanline, whose 3D position vectors
+    // get rotated and converted to geographic coordinates in one batch.
+    QVector<int>   sampleXBuffer( imageWidth + 1 );
+    QVector<bool>  sampleInterpolateBuffer( imageWidth + 1 );
+    QVector<qreal> sampleBuffer( 5 * ( imageWidth + 1 ) );
+    int  *const sampleX = sampleXBuffer.data();
+    bool *const sampleInterpolate = sampleInterpolateBuffer.data();
+    qreal *const sampleQx  = sampleBuffer.data();
+    qreal *const sampleQy  = sampleQx + imageWidth + 1;
+    qreal *const sampleQz  = sampleQy + imageWidth + 1;
+    qreal *const sampleLon = sampleQz + imageWidth + 1;
+    qreal *const sampleLat = sampleLon + imageWidth + 1;
 
-            const int leftInterval = xIpLeft + ncount * n;
-
-            bool interpolate = false;
-            if ( x >= xIpLeft && x <= xIpRight ) {
+    // Scanline based algorithm to texture map a sphere
+    int yStart = 0;
+    int yEnd = 0;
+    while ( m_rowQueue->nextChunk( yStart, yEnd ) ) {
+        for ( int y = yStart; y < yEnd; ++y ) {
+
+            // Evaluate coordinates for the 3D position vector of the current pixel
+            const qreal qy = inverseRadius * (qreal)( imageHeight / 2 - y );
+            const qreal qr = 1.0 - qy * qy;
+
+            // rx is the radius component in x direction
+            const int rx = (int)sqrt( (qreal)( radius * radius
+                                          - ( ( y - imageHeight / 2 )
+                                              * ( y - imageHeight / 2 ) ) ) );
+
+            // Calculate the actual x-range of the map within the current scanline.
+            // 
+            // If the circular border of the earth disk is still visible then xLeft
+            // equals the scanline position of the most left pixel that gets covered
+            // by the earth disk. In terms of math this equals the half image width minus 
+            // the radius component on the current scanline in x direction ("rx").
+            //
+            // If the zoom factor is high enough then the whole screen gets covered
+            // by the earth and the border of the earth disk isn't visible anymore.
+            // In that situation xLeft equals zero.
+            // For xRight the situation is similar.
+
+            const int xLeft  = ( imageWidth / 2 - rx > 0 ) ? imageWidth / 2 - rx
+                                                           : 0;
+            const int xRight = ( imageWidth / 2 - rx > 0 ) ? xLeft + rx + rx
+                                                           : imageWidth;
+
+            QRgb * scanLine = (QRgb*)( m_canvasImage->scanLine( y ) ) + xLeft;
+
+            const int xIpLeft  = ( imageWidth / 2 - rx > 0 ) ? n * (int)( xLeft / n + 1 )
+                                                             : 1;
+            const int xIpRight = ( imageWidth / 2 - rx > 0 ) ? n * (int)( xRight / n - 1 )
+                                                             : n * (int)( xRight / n - 1 ) + 1; 
+
+            // Decrease pole distortion due to linear approximation ( y-axis )
+            bool crossingPoleArea = false;
+            if ( northPole.v[Q_Z] > 0
+                 && northPoleY - ( n * 0.75 ) <= y
+                 && northPoleY + ( n * 0.75 ) >= y ) 
+            {
+                crossingPoleArea = true;
+            }
 
-                // Decrease pole distortion due to linear approximation ( x-axis )
-//                mDebug() << QString("NorthPole X: %1, LeftInterval: %2").arg( northPoleX ).arg( leftInterval );
-                if ( crossingPoleArea
-                     && northPoleX >= leftInterval + n
-                     && northPoleX < leftInterval + 2 * n
-                     && x < leftInterval + 3 * n )
-                {
-                    interpolate = false;
+            int ncount = 0;
+            int sampleCount = 0;
+
+            for ( int x = xLeft; x < xRight; ++x ) {
+                // Prepare for interpolation
+
+                const int leftInterval = xIpLeft + ncount * n;
+
+                bool interpolate = false;
+                if ( x >= xIpLeft && x <= xIpRight ) {
+
+                    // Decrease pole distortion due to linear approximation ( x-axis )
+    //                mDebug() << QString("NorthPole X: %1, LeftInterval: %2").arg( northPoleX ).arg( leftInterval );
+                    if ( crossingPoleArea
+                         && northPoleX >= leftInterval + n
+                         && northPoleX < leftInterval + 2 * n
+                         && x < leftInterval + 3 * n )
+                    {
+                        interpolate = false;
+                    }
+                    else {
+                        x += n - 1;
+                        interpolate = !printQuality;
+                        ++ncount;
+                    } 
                 }
-                else {
-                    x += n - 1;
-                    interpolate = !printQuality;
-                    ++ncount;
-                } 
-            }
-            else
-                interpolate = false;
-
-            // Evaluate more coordinates for the 3D position vector of
-            // the current pixel.
-            const qreal qx = (qreal)( x - imageWidth / 2 ) * inverseRadius;
-            const qreal qr2z = qr - qx * qx;
-            const qreal qz = ( qr2z > 0.0 ) ? sqrt( qr2z ) : 0.0;
-
-            // Create Quaternion from vector coordinates and rotate it
-            // around globe axis
-            Quaternion qpos( 0.0, qx, qy, qz );
-            qpos.rotateAroundAxis( planetAxisMatrix );
-
-            qpos.getSpherical( lon, lat );
-//            mDebug() << QString("lon: %1 lat: %2").arg(lon).arg(lat);
-            // Approx for n-1 out of n pixels within the boundary of
-            // xIpLeft to xIpRight
-
-            if ( interpolate ) {
-                if (highQuality)
-                    context.pixelValueApproxF( lon, lat, scanLine, n );
                 else
-                    context.pixelValueApprox( lon, lat, scanLine, n );
+                    interpolate = false;
 
-                scanLine += ( n - 1 );
+                // Evaluate more coordinates for the 3D position vector of
+                // the current pixel.
+                const qreal qx = (qreal)( x - imageWidth / 2 ) * inverseRadius;
+                const qreal qr2z = qr - qx * qx;
+                const qreal qz = ( qr2z > 0.0 ) ? sqrt( qr2z ) : 0.0;
+
+                sampleX[ sampleCount ] = x;
+                sampleInterpolate[ sampleCount ] = interpolate;
+                sampleQx[ sampleCount ] = qx;
+                sampleQy[ sampleCount ] = qy;
+                sampleQz[ sampleCount ] = qz;
+                ++sampleCount;
             }
 
-//          Comment out the pixelValue line and run Marble if you want
-//          to understand the interpolation:
+            // Rotate the vectors around the globe axis and convert them
+            // to geographic coordinates
+            Quaternion::rotateToSpherical( planetAxisMatrix, sampleCount,
+                                           sampleQx, sampleQy, sampleQz,
+                                           sampleLon, sampleLat );
+
+            for ( int i = 0; i < sampleCount; ++i ) {
+                const qreal lon = sampleLon[ i ];
+                const qreal lat = sampleLat[ i ];
+    //            mDebug() << QString("lon: %1 lat: %2").arg(lon).arg(lat);
+                // Approx for n-1 out of n pixels within the boundary of
+                // xIpLeft to xIpRight
+
+                if ( sampleInterpolate[ i ] ) {
+                    if (highQuality)
+                        context.pixelValueApproxF( lon, lat, scanLine, n );
+                    else
+                        context.pixelValueApprox( lon, lat, scanLine, n );
+
+                    scanLine += ( n - 1 );
+                }
 
-//          Uncomment the crossingPoleArea line to check precise 
-//          rendering around north pole:
+    //          Comment out the pixelValue line and run Marble if you want
+    //          to understand the interpolation:
 
-//            if ( !crossingPoleArea )
-            if ( x < imageWidth ) {
-                if ( highQuality )
-                    context.pixelValueF( lon, lat, scanLine );
-                else
-                    context.pixelValue( lon, lat, scanLine );
-            }
+    //          Uncomment the crossingPoleArea line to check precise 
+    //          rendering around north pole:
 
-            ++scanLine;
-        }
+    //            if ( !crossingPoleArea )
+                if ( sampleX[ i ] < imageWidth ) {
+                    if ( highQuality )
+                        context.pixelValueF( lon, lat, scanLine );
+                    else
+                        context.pixelValue( lon, lat, scanLine );
+                }
+
+                ++scanLine;
+            }
 
-        // copy scanline to improve performance
-        if ( interlaced && y + 1 < m_yBottom ) { 
+            // copy scanline to improve performance
+            if ( interlaced && y + 1 < yEnd ) { 
 
-            const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
+                const int pixelByteSize = m_canvasImage->bytesPerLine() / imageWidth;
 
-            memcpy( m_canvasImage->scanLine( y + 1 ) + xLeft * pixelByteSize, 
-                    m_canvasImage->scanLine( y ) + xLeft * pixelByteSize, 
-                    ( xRight - xLeft ) * pixelByteSize );
-            ++y;
+                memcpy( m_canvasImage->scanLine( y + 1 ) + xLeft * pixelByteSize, 
+                        m_canvasImage->scanLine( y ) + xLeft * pixelByteSize, 
+                        ( xRight - xLeft ) * pixelByteSize );
+                ++y;
+            }
         }
     }
 }
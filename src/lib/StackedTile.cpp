@@ -16,6 +16,10 @@
 #include "MarbleDebug.h"
 #include "TextureTile.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 using namespace Marble;
 
 static const uint **jumpTableFromQImage32( const QImage &img )
@@ -212,6 +216,149 @@ uint StackedTile::pixelF( qreal x, qreal y, const QRgb& topLeftValue ) const
     return topLeftValue;
 }
 
+// Blends the 8 bit channels of a and b with the weight f / 256 of b.
+static inline uint interpolate( uint a, uint b, uint f )
+{
+    const uint rb = ( ( a & 0xff00ff ) * ( 0x100 - f ) + ( b & 0xff00ff ) * f ) >> 8;
+    const uint ag = ( ( a >> 8 ) & 0xff00ff ) * ( 0x100 - f ) + ( ( b >> 8 ) & 0xff00ff ) * f;
+
+    return ( rb & 0xff00ff ) | ( ag & 0xff00ff00 );
+}
+
+// Splits a 16.16 fixed point position into the top left pixel and the 8 bit weights
+// of its right and bottom neighbours. Positions in the last column or row are moved
+// one pixel back with full weight on the neighbour, so that both neighbours exist.
+static inline void fixedPosition( int x, int y, int width, int height,
+                                  int &iX, int &iY, uint &fX, uint &fY )
+{
+    iX = x >> 16;
+    iY = y >> 16;
+    fX = ( x >> 8 ) & 0xff;
+    fY = ( y >> 8 ) & 0xff;
+
+    if ( iX >= width - 1 ) {
+        iX = width - 2;
+        fX = 0x100;
+    }
+    if ( iY >= height - 1 ) {
+        iY = height - 2;
+        fY = 0x100;
+    }
+}
+
+static void pixelsF32( const uint *const *jumpTable, int width, int height,
+                       int x, int y, int stepX, int stepY, int count, QRgb *scanLine )
+{
+    for ( int i = 0; i < count; ++i ) {
+        int iX, iY;
+        uint fX, fY;
+        fixedPosition( x, y, width, height, iX, iY, fX, fY );
+
+        const uint *top = jumpTable[ iY ] + iX;
+        const uint *bottom = jumpTable[ iY + 1 ] + iX;
+        scanLine[ i ] = interpolate( interpolate( top[0], bottom[0], fY ),
+                                     interpolate( top[1], bottom[1], fY ), fX );
+
+        x += stepX;
+        y += stepY;
+    }
+}
+
+#ifdef __SSE2__
+// Same as pixelsF32(), but blends two pixels at once with all channels unpacked
+// to 16 bit lanes. The results are identical to the ones of pixelsF32().
+static void pixelsF32Sse2( const uint *const *jumpTable, int width, int height,
+                           int x, int y, int stepX, int stepY, int count, QRgb *scanLine )
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi16( 0x100 );
+
+    int i = 0;
+    for ( ; i + 2 <= count; i += 2 ) {
+        int iX0, iY0, iX1, iY1;
+        uint fX0, fY0, fX1, fY1;
+        fixedPosition( x, y, width, height, iX0, iY0, fX0, fY0 );
+        fixedPosition( x + stepX, y + stepY, width, height, iX1, iY1, fX1, fY1 );
+        x += 2 * stepX;
+        y += 2 * stepY;
+
+        // left and right pixel of the top and bottom row of both samples
+        const __m128i top0 = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( jumpTable[ iY0 ] + iX0 ) ), zero );
+        const __m128i bottom0 = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( jumpTable[ iY0 + 1 ] + iX0 ) ), zero );
+        const __m128i top1 = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( jumpTable[ iY1 ] + iX1 ) ), zero );
+        const __m128i bottom1 = _mm_unpacklo_epi8( _mm_loadl_epi64( reinterpret_cast<const __m128i *>( jumpTable[ iY1 + 1 ] + iX1 ) ), zero );
+
+        // interpolation in y-direction
+        const __m128i fY0v = _mm_set1_epi16( fY0 );
+        const __m128i fY1v = _mm_set1_epi16( fY1 );
+        const __m128i middle0 = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( top0, _mm_sub_epi16( one, fY0v ) ),
+                                                               _mm_mullo_epi16( bottom0, fY0v ) ), 8 );
+        const __m128i middle1 = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( top1, _mm_sub_epi16( one, fY1v ) ),
+                                                               _mm_mullo_epi16( bottom1, fY1v ) ), 8 );
+
+        // interpolation in x-direction
+        const __m128i left = _mm_unpacklo_epi64( middle0, middle1 );
+        const __m128i right = _mm_unpackhi_epi64( middle0, middle1 );
+        const __m128i fXv = _mm_set_epi16( fX1, fX1, fX1, fX1, fX0, fX0, fX0, fX0 );
+        const __m128i result = _mm_srli_epi16( _mm_add_epi16( _mm_mullo_epi16( left, _mm_sub_epi16( one, fXv ) ),
+                                                              _mm_mullo_epi16( right, fXv ) ), 8 );
+
+        _mm_storel_epi64( reinterpret_cast<__m128i *>( scanLine + i ), _mm_packus_epi16( result, zero ) );
+    }
+
+    pixelsF32( jumpTable, width, height, x, y, stepX, stepY, count - i, scanLine + i );
+}
+#endif
+
+void StackedTile::pixels( int x, int y, int stepX, int stepY, int shift, int count, QRgb *scanLine ) const
+{
+    if ( m_depth == 32 ) {
+        if ( stepY == 0 ) {
+            // horizontal lines as in the equirectangular and mercator projections
+            const uint *const line = jumpTable32[ y >> shift ];
+            for ( int i = 0; i < count; ++i ) {
+                scanLine[ i ] = line[ x >> shift ];
+                x += stepX;
+            }
+        }
+        else {
+            for ( int i = 0; i < count; ++i ) {
+                scanLine[ i ] = jumpTable32[ y >> shift ][ x >> shift ];
+                x += stepX;
+                y += stepY;
+            }
+        }
+        return;
+    }
+
+    for ( int i = 0; i < count; ++i ) {
+        scanLine[ i ] = pixel( x >> shift, y >> shift );
+        x += stepX;
+        y += stepY;
+    }
+}
+
+void StackedTile::pixelsF( int x, int y, int stepX, int stepY, int count, QRgb *scanLine ) const
+{
+    const int width = m_resultImage.width();
+    const int height = m_resultImage.height();
+
+    if ( m_depth == 32 && width > 1 && height > 1 ) {
+#ifdef __SSE2__
+        pixelsF32Sse2( jumpTable32, width, height, x, y, stepX, stepY, count, scanLine );
+#else
+        pixelsF32( jumpTable32, width, height, x, y, stepX, stepY, count, scanLine );
+#endif
+        return;
+    }
+
+    for ( int i = 0; i < count; ++i ) {
+        scanLine[ i ] = pixelF( x / 65536.0, y / 65536.0 );
+        x += stepX;
+        y += stepY;
+    }
+}
+
 int StackedTile::calcByteCount( const QImage &resultImage, const QVector<QSharedPointer<TextureTile> > &tiles )
 {
     int byteCount = resultImage.numBytes();
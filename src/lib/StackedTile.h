@@ -99,6 +99,26 @@ class StackedTile : public Tile
     // This method passes the top left pixel (if known already) for better performance
     uint pixelF( qreal x, qreal y, const QRgb& pixel ) const; 
 
+/*!
+    \brief Writes the color values of @p count pixels along a line into @p scanLine.
+
+    The i-th pixel is taken from the integer position
+    ( ( x + i * stepX ) >> shift, ( y + i * stepY ) >> shift ), i.e. x, y and
+    the steps are fixed point values with @p shift fractional bits.
+    All positions need to be inside the tile.
+*/
+    void pixels( int x, int y, int stepX, int stepY, int shift, int count, QRgb *scanLine ) const;
+
+/*!
+    \brief Writes the bilinearly interpolated color values of @p count pixels
+    along a line into @p scanLine.
+
+    Same as pixels(), but x, y and the steps are 16.16 fixed point values.
+    For RGB(A) images the interpolation is done in integer arithmetic, using
+    SSE2 where available.
+*/
+    void pixelsF( int x, int y, int stepX, int stepY, int count, QRgb *scanLine ) const;
+
  private:
     Q_DISABLE_COPY( StackedTile )
 
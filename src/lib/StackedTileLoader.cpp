@@ -35,6 +35,8 @@
 #include <QtCore/QCache>
 #include <QtCore/QHash>
 #include <QtCore/QReadWriteLock>
+#include <QtCore/QRunnable>
+#include <QtCore/QThreadPool>
 #include <QtGui/QImage>
 
 
@@ -44,26 +46,125 @@ namespace Marble
 class StackedTileLoaderPrivate
 {
 public:
-    StackedTileLoaderPrivate( MergedLayerDecorator *mergedLayerDecorator )
-        : m_layerDecorator( mergedLayerDecorator )
+    StackedTileLoaderPrivate( MergedLayerDecorator *mergedLayerDecorator, StackedTileLoader *parent )
+        : q( parent ),
+          m_layerDecorator( mergedLayerDecorator ),
+          m_generation( 0 ),
+          m_frame( 0 )
     {
         m_tileCache.setMaxCost( 20000 * 1024 ); // Cache size measured in bytes
     }
 
+    /**
+     * Returns the tile with the highest zoom level below @p stackedTileId which
+     * covers it and which is already in memory, or 0 if there is none.
+     *
+     * Must be called with m_cacheLock locked for writing.
+     */
+    StackedTile *findAncestorTile( const TileId &stackedTileId );
+
+    void loadTileAsync( const TileId &stackedTileId, int generation );
+
+    StackedTileLoader *const q;
     MergedLayerDecorator *const m_layerDecorator;
     QHash <TileId, StackedTile*>  m_tilesOnDisplay;
     QCache <TileId, StackedTile>  m_tileCache;
+    // the tiles being loaded in the background, along with the frame they were last requested in
+    QHash <TileId, int>  m_pendingTiles;
+    int m_generation;
+    int m_frame;
     QReadWriteLock m_cacheLock;
+    QThreadPool m_threadPool;
+};
+
+class TileLoadJob : public QRunnable
+{
+public:
+    TileLoadJob( StackedTileLoaderPrivate *loader, const TileId &stackedTileId, int generation )
+        : m_loader( loader ),
+          m_stackedTileId( stackedTileId ),
+          m_generation( generation )
+    {
+    }
+
+    virtual void run()
+    {
+        m_loader->loadTileAsync( m_stackedTileId, m_generation );
+    }
+
+private:
+    StackedTileLoaderPrivate *const m_loader;
+    const TileId m_stackedTileId;
+    const int m_generation;
 };
 
+StackedTile *StackedTileLoaderPrivate::findAncestorTile( const TileId &stackedTileId )
+{
+    for ( int level = stackedTileId.zoomLevel() - 1; level >= 0; --level ) {
+        const int deltaLevel = stackedTileId.zoomLevel() - level;
+        const TileId ancestorId( 0, level, stackedTileId.x() >> deltaLevel, stackedTileId.y() >> deltaLevel );
+
+        StackedTile *ancestor = m_tilesOnDisplay.value( ancestorId, 0 );
+        if ( !ancestor ) {
+            ancestor = m_tileCache.take( ancestorId );
+            if ( !ancestor )
+                continue;
+            m_tilesOnDisplay[ ancestorId ] = ancestor;
+        }
+
+        ancestor->setUsed( true );
+        return ancestor;
+    }
+
+    return 0;
+}
+
+void StackedTileLoaderPrivate::loadTileAsync( const TileId &stackedTileId, int generation )
+{
+    m_cacheLock.lockForRead();
+    const bool outdated = ( generation != m_generation || !m_pendingTiles.contains( stackedTileId ) );
+    m_cacheLock.unlock();
+    if ( outdated ) {
+        return;
+    }
+
+    mDebug() << "load tile from disk:" << stackedTileId;
+
+    StackedTile *const stackedTile = m_layerDecorator->loadTile( stackedTileId );
+    Q_ASSERT( stackedTile );
+
+    m_cacheLock.lockForWrite();
+
+    // the tile hash might have been cleared or the tile might have been updated
+    // while we were loading, so our result may be out of date already
+    if ( generation != m_generation || !m_pendingTiles.remove( stackedTileId ) ) {
+        m_cacheLock.unlock();
+        delete stackedTile;
+        return;
+    }
+
+    // The tile is not marked as used as it might not be visible anymore.
+    // If it is, the next call to loadTile() will move it to m_tilesOnDisplay.
+    m_tileCache.insert( stackedTileId, stackedTile, stackedTile->numBytes() );
+    m_cacheLock.unlock();
+
+    emit q->tileLoaded( stackedTileId );
+}
+
 StackedTileLoader::StackedTileLoader( MergedLayerDecorator *mergedLayerDecorator, QObject *parent )
     : QObject( parent ),
-      d( new StackedTileLoaderPrivate( mergedLayerDecorator ) )
+      d( new StackedTileLoaderPrivate( mergedLayerDecorator, this ) )
 {
+    qRegisterMetaType<TileId>( "TileId" );
 }
 
 StackedTileLoader::~StackedTileLoader()
 {
+    d->m_cacheLock.lockForWrite();
+    ++d->m_generation;
+    d->m_cacheLock.unlock();
+    d->m_threadPool.waitForDone();
+
     qDeleteAll( d->m_tilesOnDisplay );
     delete d;
 }
@@ -90,6 +191,10 @@ QSize StackedTileLoader::tileSize() const
 
 void StackedTileLoader::resetTilehash()
 {
+    QWriteLocker locker( &d->m_cacheLock );
+
+    ++d->m_frame;
+
     QHash<TileId, StackedTile*>::const_iterator it = d->m_tilesOnDisplay.constBegin();
     QHash<TileId, StackedTile*>::const_iterator const end = d->m_tilesOnDisplay.constEnd();
     for (; it != end; ++it ) {
@@ -103,6 +208,8 @@ void StackedTileLoader::cleanupTilehash()
     // Make sure that tiles which haven't been used during the last
     // rendering of the map at all get removed from the tile hash.
 
+    QWriteLocker locker( &d->m_cacheLock );
+
     QHashIterator<TileId, StackedTile*> it( d->m_tilesOnDisplay );
     while ( it.hasNext() ) {
         it.next();
@@ -116,6 +223,20 @@ void StackedTileLoader::cleanupTilehash()
     }
 }
 
+void StackedTileLoader::cleanupPendingTiles()
+{
+    QWriteLocker locker( &d->m_cacheLock );
+
+    // The load jobs of the removed tiles stay queued, but return without loading anything
+    QMutableHashIterator<TileId, int> it( d->m_pendingTiles );
+    while ( it.hasNext() ) {
+        it.next();
+        if ( it.value() != d->m_frame ) {
+            it.remove();
+        }
+    }
+}
+
 const StackedTile* StackedTileLoader::loadTile( TileId const & stackedTileId )
 {
     // check if the tile is in the hash
@@ -149,10 +270,25 @@ const StackedTile* StackedTileLoader::loadTile( TileId const & stackedTileId )
     }
 
     // tile (valid) has not been found in hash or cache, so load it from disk
-    // and place it in the hash from where it will get transferred to the cache
+    // in the background and return the best tile of a lower level meanwhile.
+    // Once it has been loaded, it is placed in the cache and tileLoaded() is emitted.
+    StackedTile *const ancestorTile = d->findAncestorTile( stackedTileId );
+    if ( ancestorTile ) {
+        if ( !d->m_pendingTiles.contains( stackedTileId ) ) {
+            d->m_threadPool.start( new TileLoadJob( d, stackedTileId, d->m_generation ) );
+        }
+        d->m_pendingTiles.insert( stackedTileId, d->m_frame );
+        d->m_cacheLock.unlock();
+        return ancestorTile;
+    }
+
+    // there is no replacement tile in memory (e.g. for tiles of level zero),
+    // so load the tile synchronously and place it in the hash from where it will
+    // get transferred to the cache
 
     mDebug() << "load tile from disk:" << stackedTileId;
 
+    d->m_pendingTiles.remove( stackedTileId );
     stackedTile = d->m_layerDecorator->loadTile( stackedTileId );
     Q_ASSERT( stackedTile );
     stackedTile->setUsed( true );
@@ -172,17 +308,20 @@ quint64 StackedTileLoader::volatileCacheLimit() const
 
 QList<TileId> StackedTileLoader::visibleTiles() const
 {
+    QReadLocker locker( &d->m_cacheLock );
     return d->m_tilesOnDisplay.keys();
 }
 
 int StackedTileLoader::tileCount() const
 {
+    QReadLocker locker( &d->m_cacheLock );
     return d->m_tileCache.count() + d->m_tilesOnDisplay.count();
 }
 
 void StackedTileLoader::setVolatileCacheLimit( quint64 kiloBytes )
 {
     mDebug() << QString("Setting tile cache to %1 kilobytes.").arg( kiloBytes );
+    QWriteLocker locker( &d->m_cacheLock );
     d->m_tileCache.setMaxCost( kiloBytes * 1024 );
 }
 
@@ -190,6 +329,11 @@ void StackedTileLoader::updateTile( TileId const &tileId, QImage const &tileImag
 {
     const TileId stackedTileId( 0, tileId.zoomLevel(), tileId.x(), tileId.y() );
 
+    d->m_cacheLock.lockForWrite();
+
+    // a pending load would yield outdated tile data, so make sure it is discarded
+    d->m_pendingTiles.remove( stackedTileId );
+
     StackedTile * displayedTile = d->m_tilesOnDisplay.take( stackedTileId );
     if ( displayedTile ) {
         Q_ASSERT( !d->m_tileCache.contains( stackedTileId ) );
@@ -201,9 +345,12 @@ void StackedTileLoader::updateTile( TileId const &tileId, QImage const &tileImag
         delete displayedTile;
         displayedTile = 0;
 
+        d->m_cacheLock.unlock();
+
         emit tileLoaded( stackedTileId );
     } else {
         d->m_tileCache.remove( stackedTileId );
+        d->m_cacheLock.unlock();
     }
 }
 
@@ -211,10 +358,22 @@ void StackedTileLoader::clear()
 {
     mDebug() << Q_FUNC_INFO;
 
+    // Invalidate all pending loads and wait for the running ones, since they
+    // might still access the texture layers of the MergedLayerDecorator.
+    d->m_cacheLock.lockForWrite();
+    ++d->m_generation;
+    d->m_pendingTiles.clear();
+    d->m_cacheLock.unlock();
+    d->m_threadPool.waitForDone();
+
+    QWriteLocker locker( &d->m_cacheLock );
+
     qDeleteAll( d->m_tilesOnDisplay );
     d->m_tilesOnDisplay.clear();
     d->m_tileCache.clear(); // clear the tile cache in physical memory
 
+    locker.unlock();
+
     emit cleared();
 }
 
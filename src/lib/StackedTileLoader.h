@@ -81,6 +81,11 @@ class StackedTileLoader : public QObject
         /**
          * Loads a tile and returns it.
          *
+         * If the tile is not in memory yet, it is loaded in the background and
+         * the tile of the highest lower level covering it is returned meanwhile.
+         * Check the id() of the returned tile to find out which one was returned.
+         * tileLoaded() is emitted once the requested tile is available.
+         *
          * @param stackedTileId The Id of the requested tile, containing the x and y coordinate
          *                      and the zoom level.
          */
@@ -98,6 +103,16 @@ class StackedTileLoader : public QObject
          */
         void cleanupTilehash();
 
+        /**
+         * Discards the pending background loads of all tiles which haven't been
+         * requested since the last call to resetTilehash(), as they aren't
+         * visible anymore.
+         *
+         * Only call this after all visible tiles have been requested, i.e. not
+         * after a frame which only painted parts of the map.
+         */
+        void cleanupPendingTiles();
+
         /**
          * @brief  Returns the limit of the volatile (in RAM) cache.
          * @return the cache limit in kilobytes
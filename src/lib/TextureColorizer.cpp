@@ -15,6 +15,7 @@
 
 #include <QtCore/qmath.h>
 #include <QtCore/QFile>
+#include <QtCore/QRunnable>
 #include <QtCore/QSharedPointer>
 #include <QtCore/QString>
 #include <QtCore/QVector>
@@ -30,6 +31,7 @@
 #include "ViewParams.h"
 #include "ViewportParams.h"
 #include "MathHelper.h"
+#include "ScanlineTextureMapperContext.h"
 #include "GeoDataFeature.h"
 #include "GeoDataTypes.h"
 #include "GeoDataPlacemark.h"
@@ -67,11 +69,120 @@ private:
     uchar  x4;
 };
 
+// Blends the land and the water color of the palette by the red channel of
+// the coast pixel, which holds the amount of land. Two channels are blended
+// at a time without any branches; ( x + 1 + ( x >> 8 ) ) >> 8 equals x / 255
+// for all values of x that can occur here.
+static inline QRgb blendedPixel( const uint (*palette)[512], QRgb coast, int bump, uchar grey )
+{
+    const uint alpha = qRed( coast );
+    const uint land  = palette[bump][grey + 0x100];
+    const uint water = palette[bump][grey];
+
+    const uint rb =   ( land & 0x00ff00ff ) * alpha
+                    + ( water & 0x00ff00ff ) * ( 255 - alpha );
+    const uint ag =   ( ( land >> 8 ) & 0x00ff00ff ) * alpha
+                    + ( ( water >> 8 ) & 0x00ff00ff ) * ( 255 - alpha );
+
+    return   ( ( ( rb + 0x00010001 + ( ( rb >> 8 ) & 0x00ff00ff ) ) >> 8 ) & 0x00ff00ff )
+           | ( ( ag + 0x00010001 + ( ( ag >> 8 ) & 0x00ff00ff ) ) & 0xff00ff00 );
+}
+
+static void colorizeSpan( const uint (*palette)[512], const uchar *readData, const uchar *readDataEnd,
+                          const QRgb *coastData, QRgb *writeData )
+{
+    for ( ; readData < readDataEnd; readData += 4, ++writeData, ++coastData ) {
+        *writeData = blendedPixel( palette, *coastData, 8, *readData );
+    }
+}
+
+template<bool spherical>
+static void colorizeSpan( const uint (*palette)[512], const uchar *readData, const uchar *readDataEnd,
+                          const QRgb *coastData, QRgb *writeData, EmbossFifo &emboss )
+{
+    for ( ; readData < readDataEnd; readData += 4, ++writeData, ++coastData ) {
+        // Cheap Emboss / Bumpmapping
+        const uchar grey = *readData; // qBlue(*data);
+
+        emboss << grey;
+        const int bump = spherical ? ( emboss.head() + 16 - grey ) >> 1
+                                   : ( emboss.head() + 8 - grey );
+
+        *writeData = blendedPixel( palette, *coastData, qBound( 0, bump, 15 ), grey );
+    }
+}
+
+// The pixels of row y which are covered by the globe.
+static void sphericalRowSpan( int y, int imgrx, int imgry, int imgwidth, qint64 radius,
+                              const QRect &clipRect, int &xLeft, int &xRight )
+{
+    const int  dy = imgry - y;
+    const int  rx = (int)sqrt( (qreal)( radius * radius - dy * dy ) );
+    xLeft  = 0;
+    xRight = imgwidth;
+
+    if ( imgrx-rx > 0 ) {
+        xLeft  = imgrx - rx;
+        xRight = imgrx + rx;
+    }
+
+    xLeft  = qMax( xLeft, clipRect.left() );
+    xRight = qMin( xRight, clipRect.right() + 1 );
+}
+
+
+class TextureColorizer::ColorizeJob : public QRunnable
+{
+public:
+    ColorizeJob( const TextureColorizer *colorizer, const QImage *heightImage, QImage *targetImage,
+                 const QRect &clipRect, bool spherical, const EmbossFifo *embossSeeds, int yFirst,
+                 qint64 radius, ScanlineRowQueue *rowQueue );
+
+    virtual void run();
+
+private:
+    const TextureColorizer *const m_colorizer;
+    const QImage *const m_heightImage;
+    QImage *const m_targetImage;
+    const QRect m_clipRect;
+    const bool m_spherical;
+    const EmbossFifo *const m_embossSeeds;
+    const int m_yFirst;
+    const qint64 m_radius;
+    ScanlineRowQueue *const m_rowQueue;
+};
+
+TextureColorizer::ColorizeJob::ColorizeJob( const TextureColorizer *colorizer, const QImage *heightImage, QImage *targetImage,
+                                            const QRect &clipRect, bool spherical, const EmbossFifo *embossSeeds, int yFirst,
+                                            qint64 radius, ScanlineRowQueue *rowQueue )
+    : m_colorizer( colorizer ),
+      m_heightImage( heightImage ),
+      m_targetImage( targetImage ),
+      m_clipRect( clipRect ),
+      m_spherical( spherical ),
+      m_embossSeeds( embossSeeds ),
+      m_yFirst( yFirst ),
+      m_radius( radius ),
+      m_rowQueue( rowQueue )
+{
+}
+
+void TextureColorizer::ColorizeJob::run()
+{
+    int yStart, yEnd;
+    while ( m_rowQueue->nextChunk( yStart, yEnd ) ) {
+        m_colorizer->colorizeRows( m_heightImage, m_targetImage, m_clipRect,
+                                   m_spherical, m_embossSeeds, m_yFirst, yStart, yEnd, m_radius );
+    }
+}
+
 
 TextureColorizer::TextureColorizer( const QString &seafile,
                                     const QString &landfile,
                                     VectorComposer *veccomposer )
     : m_veccomposer( veccomposer ),
+      m_coastImageValid( false ),
+      m_threadPool(),
       m_landColor(qRgb( 255, 0, 0 ) ),
       m_seaColor( qRgb( 0, 255, 0 ) )
 {
@@ -155,11 +266,13 @@ TextureColorizer::TextureColorizer( const QString &seafile,
 void TextureColorizer::addSeaDocument( const GeoDataDocument *seaDocument )
 {
     m_seaDocuments.append( seaDocument );
+    invalidateCoastImage();
 }
 
 void TextureColorizer::addLandDocument( const GeoDataDocument *landDocument )
 {
     m_landDocuments.append( landDocument );
+    invalidateCoastImage();
 }
 
 void TextureColorizer::setShowRelief( bool show )
@@ -167,6 +280,11 @@ void TextureColorizer::setShowRelief( bool show )
     m_showRelief = show;
 }
 
+void TextureColorizer::invalidateCoastImage()
+{
+    m_coastImageValid = false;
+}
+
 // This function takes two images, both in viewParams:
 //  - The coast image, which has a number of colors where each color
 //    represents a sort of terrain (ex: land/sea)
@@ -232,130 +350,237 @@ void TextureColorizer::drawTextureMap( GeoPainter *painter )
 
 void TextureColorizer::colorize( QImage *origimg, const ViewportParams *viewport, MapQuality mapQuality )
 {
+    colorize( origimg, origimg, viewport, mapQuality, origimg->rect() );
+}
+
+void TextureColorizer::colorize( const QImage *heightImage, QImage *targetImage, const ViewportParams *viewport,
+                                 MapQuality mapQuality, const QRect &rect )
+{
+    Q_ASSERT( heightImage->size() == targetImage->size() );
+
+    updateCoastImage( viewport, mapQuality );
+
+    const qint64   radius   = viewport->radius();
+
+    const int  imgheight = heightImage->height();
+    const int  imgrx     = heightImage->width() / 2;
+    const int  imgry     = imgheight / 2;
+    const int  imgradius = imgrx * imgrx + imgry * imgry;
+
+    const QRect clipRect = rect.intersected( heightImage->rect() );
+
+    const bool spherical = !( radius * radius > imgradius
+                              || viewport->projection() == Equirectangular
+                              || viewport->projection() == Mercator );
+
+    int yTop = 0;
+    int yBottom = imgheight;
+
+    if ( spherical ) {
+        yTop    = ( imgry-radius < 0 ) ? 0 : imgry-radius;
+        yBottom = ( yTop == 0 ) ? imgheight : imgry + radius;
+    }
+    else if( viewport->projection() == Equirectangular
+             || viewport->projection() == Mercator )
+    {
+        // Calculate translation of center point
+        const qreal centerLat = viewport->centerLatitude();
+
+        const float rad2Pixel = (qreal)( 2 * radius ) / M_PI;
+        if ( viewport->projection() == Equirectangular ) {
+            int yCenterOffset = (int)( centerLat * rad2Pixel );
+            yTop = ( imgry - radius + yCenterOffset < 0)? 0 : imgry - radius + yCenterOffset;
+            yBottom = ( imgry + yCenterOffset + radius > imgheight )? imgheight : imgry + yCenterOffset + radius;
+        }
+        else if ( viewport->projection() == Mercator ) {
+            int yCenterOffset = (int)( asinh( tan( centerLat ) ) * rad2Pixel  );
+            yTop = ( imgry - 2 * radius + yCenterOffset < 0 ) ? 0 : imgry - 2 * radius + yCenterOffset;
+            yBottom = ( imgry + 2 * radius + yCenterOffset > imgheight )? imgheight : imgry + 2 * radius + yCenterOffset;
+        }
+    }
+
+    const int itBegin = qMax( yTop, clipRect.top() );
+    const int itEnd = qMin( yBottom, clipRect.bottom() + 1 );
+
+    // On the globe the emboss filter carries on from the end of the previous
+    // row. Record its state at the start of each row before any row gets
+    // colorized, so the rows can be processed in any order, even if the
+    // height image is colorized in place.
+    QVector<EmbossFifo> embossSeeds;
+
+    if ( spherical && m_showRelief && itBegin < itEnd ) {
+        embossSeeds.reserve( itEnd - itBegin );
+        EmbossFifo  emboss;
+
+        for ( int y = itBegin; y < itEnd; ++y ) {
+            embossSeeds.append( emboss );
+
+            int  xLeft, xRight;
+            sphericalRowSpan( y, imgrx, imgry, heightImage->width(), radius, clipRect, xLeft, xRight );
+
+            const uchar *scanLine = heightImage->scanLine( y );
+            for ( int x = qMax( xLeft, xRight - 4 ); x < xRight; ++x ) {
+                emboss << scanLine[x * 4];
+            }
+        }
+    }
+
+    const int numThreads = m_threadPool.maxThreadCount();
+    ScanlineRowQueue rowQueue( itBegin, itEnd, numThreads );
+    for ( int i = 0; i < numThreads; ++i ) {
+        QRunnable *const job = new ColorizeJob( this, heightImage, targetImage, clipRect, spherical,
+                                                embossSeeds.constData(), itBegin, radius, &rowQueue );
+        m_threadPool.start( job );
+    }
+
+    m_threadPool.waitForDone();
+}
+
+TextureColorizer::CoastImageKey TextureColorizer::coastImageKey( const ViewportParams *viewport,
+                                                                MapQuality mapQuality ) const
+{
+    CoastImageKey key;
+    key.projection = viewport->projection();
+    key.radius = viewport->radius();
+    key.size = viewport->size();
+    key.centerLongitude = viewport->centerLongitude();
+    key.centerLatitude = viewport->centerLatitude();
+    key.mapQuality = mapQuality;
+    key.showWaterBodies = m_veccomposer->showWaterBodies();
+    key.showLakes = m_veccomposer->showLakes();
+    key.showIce = m_veccomposer->showIce();
+    foreach( const GeoDataDocument *doc, m_seaDocuments ) {
+        key.seaDocumentsVisible.append( doc->isVisible() );
+    }
+
+    return key;
+}
+
+void TextureColorizer::updateCoastImage( const ViewportParams *viewport, MapQuality mapQuality )
+{
+    const CoastImageKey key = coastImageKey( viewport, mapQuality );
+
+    if ( m_coastImageValid && key == m_coastImageKey )
+        return;
+
     if ( m_coastImage.size() != viewport->size() )
         m_coastImage = QImage( viewport->size(), QImage::Format_RGB32 );
 
     // update coast image
     m_coastImage.fill( QColor( 0, 0, 255, 0).rgb() );
 
+    paintCoastImage( viewport, mapQuality, QRegion() );
+
+    m_coastImageKey = key;
+    m_coastImageValid = true;
+}
+
+void TextureColorizer::scrollCoastImage( const ViewportParams *viewport, MapQuality mapQuality,
+                                         int dx, int dy, const QVector<QRect> &exposedRects )
+{
+    const CoastImageKey key = coastImageKey( viewport, mapQuality );
+
+    CoastImageKey scrolledKey = m_coastImageKey;
+    scrolledKey.centerLongitude = key.centerLongitude;
+    scrolledKey.centerLatitude = key.centerLatitude;
+
+    if ( !m_coastImageValid || !( scrolledKey == key ) )
+        return;
+
+    ScanlineTextureMapperContext::scrollImage( &m_coastImage, dx, dy );
+
+    const QRgb sea = QColor( 0, 0, 255, 0).rgb();
+    QRegion exposedRegion;
+    foreach ( const QRect &rect, exposedRects ) {
+        for ( int y = rect.top(); y <= rect.bottom(); ++y ) {
+            QRgb *const itBegin = (QRgb*)( m_coastImage.scanLine( y ) ) + rect.left();
+            QRgb *const itEnd = itBegin + rect.width();
+            for ( QRgb *it = itBegin; it < itEnd; ++it ) {
+                *it = sea;
+            }
+        }
+        exposedRegion += rect;
+    }
+
+    if ( !exposedRegion.isEmpty() ) {
+        paintCoastImage( viewport, mapQuality, exposedRegion );
+    }
+
+    m_coastImageKey = key;
+}
+
+void TextureColorizer::paintCoastImage( const ViewportParams *viewport, MapQuality mapQuality, const QRegion &clipRegion )
+{
     const bool antialiased =    mapQuality == HighQuality
                              || mapQuality == PrintQuality;
 
     GeoPainter painter( &m_coastImage, viewport, mapQuality );
     painter.setRenderHint( QPainter::Antialiasing, antialiased );
+    if ( !clipRegion.isEmpty() ) {
+        painter.setClipRegion( clipRegion );
+    }
 
     if ( m_landDocuments.isEmpty() ) {
         m_veccomposer->drawTextureMap( &painter, viewport );
     } else {
         drawTextureMap( &painter );
     }
+}
 
-    const qint64   radius   = viewport->radius();
-
-    const int  imgheight = origimg->height();
-    const int  imgwidth  = origimg->width();
+void TextureColorizer::colorizeRows( const QImage *heightImage, QImage *targetImage, const QRect &clipRect,
+                                     bool spherical, const EmbossFifo *embossSeeds, int yFirst,
+                                     int yStart, int yEnd, qint64 radius ) const
+{
+    const int  imgwidth  = heightImage->width();
     const int  imgrx     = imgwidth / 2;
-    const int  imgry     = imgheight / 2;
-    // This variable is not used anywhere..
-    const int  imgradius = imgrx * imgrx + imgry * imgry;
+    const int  imgry     = heightImage->height() / 2;
 
-    int     bump = 8;
+    if ( !spherical ) {
+        // The emboss filter looks at the preceding pixels of the scanline,
+        // so start reading a few pixels left of the rectangle.
+        const int xPrime = qMax( 0, clipRect.left() - 4 );
 
-    if ( radius * radius > imgradius
-         || viewport->projection() == Equirectangular
-         || viewport->projection() == Mercator )
-    {
-        int yTop = 0;
-        int yBottom = imgheight;
-
-        if( viewport->projection() == Equirectangular
-            || viewport->projection() == Mercator )
-        {
-            // Calculate translation of center point
-            const qreal centerLat = viewport->centerLatitude();
-
-            const float rad2Pixel = (qreal)( 2 * radius ) / M_PI;
-            if ( viewport->projection() == Equirectangular ) {
-                int yCenterOffset = (int)( centerLat * rad2Pixel );
-                yTop = ( imgry - radius + yCenterOffset < 0)? 0 : imgry - radius + yCenterOffset;
-                yBottom = ( imgry + yCenterOffset + radius > imgheight )? imgheight : imgry + yCenterOffset + radius;
-            }
-            else if ( viewport->projection() == Mercator ) {
-                int yCenterOffset = (int)( asinh( tan( centerLat ) ) * rad2Pixel  );
-                yTop = ( imgry - 2 * radius + yCenterOffset < 0 ) ? 0 : imgry - 2 * radius + yCenterOffset;
-                yBottom = ( imgry + 2 * radius + yCenterOffset > imgheight )? imgheight : imgry + 2 * radius + yCenterOffset;
-            }
-        }
+        for ( int y = yStart; y < yEnd; ++y ) {
 
-        const int itEnd = yBottom;
+            QRgb  *writeData         = (QRgb*)( targetImage->scanLine( y ) ) + clipRect.left();
+            const QRgb  *coastData   = (QRgb*)( m_coastImage.scanLine( y ) ) + clipRect.left();
 
-        for (int y = yTop; y < itEnd; ++y) {
+            const uchar *readDataStart = heightImage->scanLine( y ) + clipRect.left() * 4;
+            const uchar *readDataEnd   = heightImage->scanLine( y ) + ( clipRect.right() + 1 ) * 4;
 
-            QRgb  *writeData         = (QRgb*)( origimg->scanLine( y ) );
-            const QRgb  *coastData   = (QRgb*)( m_coastImage.scanLine( y ) );
-
-            uchar *readDataStart     = origimg->scanLine( y );
-            const uchar *readDataEnd = readDataStart + imgwidth*4;
+            if ( !m_showRelief ) {
+                colorizeSpan( texturepalette, readDataStart, readDataEnd, coastData, writeData );
+                continue;
+            }
 
             EmbossFifo  emboss;
 
-            for ( uchar* readData = readDataStart; 
-                  readData < readDataEnd;
-                  readData += 4, ++writeData, ++coastData )
+            for ( const uchar* readData = heightImage->scanLine( y ) + xPrime * 4;
+                  readData < readDataStart;
+                  readData += 4 )
             {
-
-                // Cheap Emboss / Bumpmapping
-                uchar&  grey = *readData; // qBlue(*data);
-
-                if ( m_showRelief ) {
-                    emboss << grey;
-                    bump = ( emboss.head() + 8 - grey );
-                    if ( bump  < 0 )  bump = 0;
-                    if ( bump  > 15 ) bump = 15;
-                }
-                setPixel( coastData, writeData, bump, grey );
+                emboss << *readData;
             }
+
+            colorizeSpan<false>( texturepalette, readDataStart, readDataEnd, coastData, writeData, emboss );
         }
     }
     else {
-        int yTop    = ( imgry-radius < 0 ) ? 0 : imgry-radius;
-        const int yBottom = ( yTop == 0 ) ? imgheight : imgry + radius;
-
-        EmbossFifo  emboss;
-
-        for ( int y = yTop; y < yBottom; ++y ) {
-            const int  dy = imgry - y;
-            int  rx = (int)sqrt( (qreal)( radius * radius - dy * dy ) );
-            int  xLeft  = 0; 
-            int  xRight = imgwidth;
+        for ( int y = yStart; y < yEnd; ++y ) {
+            int  xLeft, xRight;
+            sphericalRowSpan( y, imgrx, imgry, imgwidth, radius, clipRect, xLeft, xRight );
 
-            if ( imgrx-rx > 0 ) {
-                xLeft  = imgrx - rx; 
-                xRight = imgrx + rx;
-            }
-
-            QRgb  *writeData         = (QRgb*)( origimg->scanLine( y ) )  + xLeft;
+            QRgb  *writeData         = (QRgb*)( targetImage->scanLine( y ) )  + xLeft;
             const QRgb *coastData    = (QRgb*)( m_coastImage.scanLine( y ) ) + xLeft;
 
-            uchar *readDataStart     = origimg->scanLine( y ) + xLeft * 4;
-            const uchar *readDataEnd = origimg->scanLine( y ) + xRight * 4;
-
- 
-            for ( uchar* readData = readDataStart;
-                  readData < readDataEnd;
-                  readData += 4, ++writeData, ++coastData )
-            {
-                // Cheap Emboss / Bumpmapping
-
-                uchar& grey = *readData; // qBlue(*data);
+            const uchar *readDataStart = heightImage->scanLine( y ) + xLeft * 4;
+            const uchar *readDataEnd   = heightImage->scanLine( y ) + xRight * 4;
 
-                if ( m_showRelief ) {
-                    emboss << grey;
-                    bump = ( emboss.head() + 16 - grey ) >> 1;
-                    if ( bump > 15 ) bump = 15;
-                    if ( bump < 0 )  bump = 0;
-                }
-                setPixel( coastData, writeData, bump, grey );
+            if ( m_showRelief ) {
+                EmbossFifo  emboss = embossSeeds[y - yFirst];
+                colorizeSpan<true>( texturepalette, readDataStart, readDataEnd, coastData, writeData, emboss );
+            } else {
+                colorizeSpan( texturepalette, readDataStart, readDataEnd, coastData, writeData );
             }
         }
     }
@@ -363,26 +588,21 @@ void TextureColorizer::colorize( QImage *origimg, const ViewportParams *viewport
 
 void TextureColorizer::setPixel( const QRgb *coastData, QRgb *writeData, int bump, uchar grey )
 {
-    int alpha = qRed( *coastData );
-    if ( alpha == 255 )
-        *writeData = texturepalette[bump][grey + 0x100];
-    else if( alpha == 0 ){
-        *writeData = texturepalette[bump][grey];
-    }
-    else {
-        qreal c = 1.0 / 255.0;
-
-        QRgb landcolor  = (QRgb)(texturepalette[bump][grey + 0x100]);
-        QRgb watercolor = (QRgb)(texturepalette[bump][grey]);
-
-        *writeData = qRgb(
-                    (int) ( c * ( alpha * qRed( landcolor )
-                                  + ( 255 - alpha ) * qRed( watercolor ) ) ),
-                    (int) ( c * ( alpha * qGreen( landcolor )
-                                  + ( 255 - alpha ) * qGreen( watercolor ) ) ),
-                    (int) ( c * ( alpha * qBlue( landcolor )
-                                  + ( 255 - alpha ) * qBlue( watercolor ) ) )
-                    );
-    }
+    *writeData = blendedPixel( texturepalette, *coastData, bump, grey );
 }
+
+bool TextureColorizer::CoastImageKey::operator==( const CoastImageKey &other ) const
+{
+    return projection == other.projection
+        && radius == other.radius
+        && size == other.size
+        && centerLongitude == other.centerLongitude
+        && centerLatitude == other.centerLatitude
+        && mapQuality == other.mapQuality
+        && showWaterBodies == other.showWaterBodies
+        && showLakes == other.showLakes
+        && showIce == other.showIce
+        && seaDocumentsVisible == other.seaDocumentsVisible;
+}
+
 }
@@ -21,13 +21,17 @@
 #include "GeoPainter.h"
 
 #include <QtCore/QString>
+#include <QtCore/QThreadPool>
+#include <QtCore/QVector>
 #include <QtGui/QImage>
+#include <QtGui/QRegion>
 #include <QtGui/QPen>
 #include <QtGui/QBrush>
 
 namespace Marble
 {
 
+class EmbossFifo;
 class VectorComposer;
 class ViewportParams;
 
@@ -46,21 +50,76 @@ class TextureColorizer
 
     void setShowRelief( bool show );
 
+    /**
+     * The coast image is only repainted if the viewport changes. Call this
+     * method if the land and sea polygons have changed in a different way,
+     * e.g. because the vector data has been loaded.
+     */
+    void invalidateCoastImage();
+
     void drawIndividualDocument( GeoPainter *painter, const GeoDataDocument *document );
 
     void drawTextureMap( GeoPainter *painter );
 
     void colorize( QImage *origimg, const ViewportParams *viewport, MapQuality mapQuality );
 
+    /**
+     * Colorizes the pixels of @p targetImage within @p rect, reading the height
+     * values from @p heightImage, which must be of the same size.
+     *
+     * This allows texture mappers to keep the uncolorized canvas around and
+     * to colorize only the parts of the map which have actually changed.
+     */
+    void colorize( const QImage *heightImage, QImage *targetImage, const ViewportParams *viewport,
+                   MapQuality mapQuality, const QRect &rect );
+
+    /**
+     * Moves the coast image along with a canvas which has been scrolled by
+     * @p dx and @p dy pixels to the new center of @p viewport, repainting only
+     * the @p exposedRects. Does nothing if anything but the center has changed;
+     * the next call of colorize() repaints the whole coast image then.
+     */
+    void scrollCoastImage( const ViewportParams *viewport, MapQuality mapQuality,
+                           int dx, int dy, const QVector<QRect> &exposedRects );
+
     void setPixel( const QRgb *coastData, QRgb *writeData, int bump, uchar grey );
 
  private:
+    class ColorizeJob;
+
+    void updateCoastImage( const ViewportParams *viewport, MapQuality mapQuality );
+    void paintCoastImage( const ViewportParams *viewport, MapQuality mapQuality, const QRegion &clipRegion );
+    void colorizeRows( const QImage *heightImage, QImage *targetImage, const QRect &clipRect,
+                       bool spherical, const EmbossFifo *embossSeeds, int yFirst,
+                       int yStart, int yEnd, qint64 radius ) const;
+
+    struct CoastImageKey
+    {
+        bool operator==( const CoastImageKey &other ) const;
+
+        Projection projection;
+        int radius;
+        QSize size;
+        qreal centerLongitude;
+        qreal centerLatitude;
+        MapQuality mapQuality;
+        bool showWaterBodies;
+        bool showLakes;
+        bool showIce;
+        QVector<bool> seaDocumentsVisible;
+    };
+
+    CoastImageKey coastImageKey( const ViewportParams *viewport, MapQuality mapQuality ) const;
+
     VectorComposer *const m_veccomposer;
     QString m_seafile;
     QString m_landfile;
     QList<const GeoDataDocument*> m_seaDocuments;
     QList<const GeoDataDocument*> m_landDocuments;
     QImage m_coastImage;
+    CoastImageKey m_coastImageKey;
+    bool m_coastImageValid;
+    QThreadPool m_threadPool;
     uint texturepalette[16][512];
     bool m_showRelief;
     QRgb      m_landColor;
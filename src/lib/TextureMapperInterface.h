@@ -38,6 +38,14 @@ public:
 
     void setRepaintNeeded();
 
+    /**
+     * Informs the texture mapper that the center of the map has moved.
+     *
+     * By default, this requires a repaint of the whole map. Texture mappers
+     * which are able to reuse their previous result on pans may override it.
+     */
+    virtual void setCenterChanged();
+
 protected:
     bool m_repaintNeeded;
 };
@@ -0,0 +1,528 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "TileArchive.h"
+
+#include <cstring>
+
+#include <QtCore/QDir>
+#include <QtCore/QFileInfo>
+#include <QtCore/QMutexLocker>
+#include <QtCore/QSet>
+#include <QtCore/QStringList>
+#include <QtCore/QtAlgorithms>
+#include <QtCore/QtEndian>
+
+#include "MarbleDebug.h"
+
+namespace Marble
+{
+
+// File layout:
+//
+// header:  char magic[8], quint32 version, quint32 tileCount, quint64 indexOffset, quint64 reserved
+// data:    the data of all tiles in the index
+// index:   tileCount entries of quint32 level, x, y, size, quint64 offset, quint32 modified, reserved
+// appended tiles: quint32 recordMagic, level, x, y, size, modified, followed by the data of the tile
+
+static const char archiveMagic[] = "MRBLTILE";
+static const quint32 archiveVersion = 1;
+static const quint32 recordMagic = 0x454c4954; // "TILE"
+
+static const int headerSize = 32;
+static const int indexEntrySize = 32;
+static const int recordHeaderSize = 24;
+
+// separates the archive file name from the tile in names passed to the storage policy
+static const QLatin1Char tileSeparator( '#' );
+
+namespace
+{
+
+class TileArchiveRegistry
+{
+public:
+    ~TileArchiveRegistry()
+    {
+        qDeleteAll( archives );
+    }
+
+    QMutex mutex;
+    QHash<QString, TileArchive *> archives;
+
+    // files which couldn't be opened for reading, so they aren't looked up again
+    QSet<QString> missingArchives;
+};
+
+}
+
+Q_GLOBAL_STATIC( TileArchiveRegistry, tileArchiveRegistry )
+
+static void writeHeader( uchar *header, quint32 tileCount, quint64 indexOffset )
+{
+    memcpy( header, archiveMagic, 8 );
+    qToLittleEndian<quint32>( archiveVersion, header + 8 );
+    qToLittleEndian<quint32>( tileCount, header + 12 );
+    qToLittleEndian<quint64>( indexOffset, header + 16 );
+    qToLittleEndian<quint64>( 0, header + 24 );
+}
+
+TileArchive::TileArchive( const QString &fileName )
+    : m_file( fileName ),
+      m_writeFile( fileName ),
+      m_map( 0 ),
+      m_mapSize( 0 ),
+      m_index( 0 ),
+      m_tileCount( 0 ),
+      m_end( 0 ),
+      m_maximumTileLevel( -1 )
+{
+}
+
+TileArchive::~TileArchive()
+{
+    if ( m_map ) {
+        m_file.unmap( m_map );
+    }
+}
+
+TileArchive *TileArchive::archive( const QString &fileName )
+{
+    return openArchive( fileName, false );
+}
+
+TileArchive *TileArchive::writableArchive( const QString &fileName )
+{
+    return openArchive( fileName, true );
+}
+
+TileArchive *TileArchive::openArchive( const QString &fileName, bool create )
+{
+    TileArchiveRegistry *const registry = tileArchiveRegistry();
+    QMutexLocker locker( &registry->mutex );
+
+    TileArchive *archive = registry->archives.value( fileName );
+    if ( archive ) {
+        if ( create && !archive->openForWriting() ) {
+            mDebug() << "Unable to open tile archive for writing" << fileName;
+            return 0;
+        }
+        return archive;
+    }
+
+    if ( !create ) {
+        // Missing archives are remembered until a tile gets stored in them,
+        // so looking up tiles doesn't stat the file again and again.
+        if ( registry->missingArchives.contains( fileName ) ) {
+            return 0;
+        }
+
+        if ( !QFile::exists( fileName ) ) {
+            registry->missingArchives.insert( fileName );
+            return 0;
+        }
+    }
+    else {
+        registry->missingArchives.remove( fileName );
+
+        if ( !QFile::exists( fileName ) && !createFile( fileName ) ) {
+            mDebug() << "Unable to create tile archive" << fileName;
+            return 0;
+        }
+    }
+
+    archive = new TileArchive( fileName );
+    if ( !archive->open() || ( create && !archive->openForWriting() ) ) {
+        mDebug() << "Unable to open tile archive" << fileName;
+        delete archive;
+        if ( !create ) {
+            registry->missingArchives.insert( fileName );
+        }
+        return 0;
+    }
+
+    registry->archives.insert( fileName, archive );
+
+    return archive;
+}
+
+QString TileArchive::tileFileName( const QString &archiveFileName, int level, int x, int y )
+{
+    return QString( "%1%2%3/%4/%5" ).arg( archiveFileName ).arg( tileSeparator ).arg( level ).arg( x ).arg( y );
+}
+
+bool TileArchive::parseTileFileName( const QString &fileName, QString &archiveFileName, int &level, int &x, int &y )
+{
+    const int separator = fileName.lastIndexOf( tileSeparator );
+    if ( separator < 0 )
+        return false;
+
+    const QStringList components = fileName.mid( separator + 1 ).split( '/' );
+    if ( components.size() != 3 )
+        return false;
+
+    bool levelOk = false;
+    bool xOk = false;
+    bool yOk = false;
+    level = components[0].toInt( &levelOk );
+    x = components[1].toInt( &xOk );
+    y = components[2].toInt( &yOk );
+    archiveFileName = fileName.left( separator );
+
+    return levelOk && xOk && yOk;
+}
+
+QString TileArchive::fileName() const
+{
+    return m_file.fileName();
+}
+
+bool TileArchive::contains( int level, int x, int y ) const
+{
+    Location location;
+    return find( level, x, y, location );
+}
+
+bool TileArchive::tileData( int level, int x, int y, QByteArray &data ) const
+{
+    Location location;
+    if ( !find( level, x, y, location ) )
+        return false;
+
+    if ( location.offset + location.size <= m_mapSize ) {
+        data = QByteArray( reinterpret_cast<const char *>( m_map + location.offset ), location.size );
+        return true;
+    }
+
+    // appended after the file was mapped, which only happens through insert()
+    QMutexLocker locker( &m_mutex );
+    if ( !m_writeFile.seek( location.offset ) )
+        return false;
+
+    data = m_writeFile.read( location.size );
+
+    return data.size() == int( location.size );
+}
+
+QDateTime TileArchive::lastModified( int level, int x, int y ) const
+{
+    Location location;
+    if ( !find( level, x, y, location ) )
+        return QDateTime();
+
+    return QDateTime::fromTime_t( location.modified );
+}
+
+int TileArchive::maximumTileLevel() const
+{
+    QMutexLocker locker( &m_mutex );
+    return m_maximumTileLevel;
+}
+
+bool TileArchive::insert( int level, int x, int y, const QByteArray &data )
+{
+    const quint32 modified = QDateTime::currentDateTime().toTime_t();
+
+    uchar header[ recordHeaderSize ];
+    qToLittleEndian<quint32>( recordMagic, header );
+    qToLittleEndian<quint32>( level, header + 4 );
+    qToLittleEndian<quint32>( x, header + 8 );
+    qToLittleEndian<quint32>( y, header + 12 );
+    qToLittleEndian<quint32>( data.size(), header + 16 );
+    qToLittleEndian<quint32>( modified, header + 20 );
+
+    QMutexLocker locker( &m_mutex );
+
+    if ( !m_writeFile.isOpen() )
+        return false;
+
+    if ( !m_writeFile.seek( m_end )
+         || m_writeFile.write( reinterpret_cast<const char *>( header ), recordHeaderSize ) != recordHeaderSize
+         || m_writeFile.write( data ) != data.size()
+         || !m_writeFile.flush() )
+    {
+        mDebug() << "Unable to append tile to archive" << m_writeFile.fileName() << m_writeFile.errorString();
+        return false;
+    }
+
+    Location location;
+    location.offset = m_end + recordHeaderSize;
+    location.size = data.size();
+    location.modified = modified;
+    m_appendedTiles.insert( key( level, x, y ), location );
+
+    m_end = location.offset + location.size;
+    m_maximumTileLevel = qMax( m_maximumTileLevel, level );
+
+    return true;
+}
+
+bool TileArchive::createFile( const QString &fileName )
+{
+    QDir::root().mkpath( QFileInfo( fileName ).absolutePath() );
+
+    QFile file( fileName );
+    if ( !file.open( QIODevice::WriteOnly ) )
+        return false;
+
+    uchar header[ headerSize ];
+    writeHeader( header, 0, headerSize );
+
+    return file.write( reinterpret_cast<const char *>( header ), headerSize ) == headerSize && file.flush();
+}
+
+bool TileArchive::open()
+{
+    // Readers never modify the file, as another process may be appending to it
+    if ( !m_file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    m_mapSize = m_file.size();
+    if ( m_mapSize < headerSize )
+        return false;
+
+    m_map = m_file.map( 0, m_mapSize );
+    if ( !m_map )
+        return false;
+
+    if ( memcmp( m_map, archiveMagic, 8 ) != 0
+         || qFromLittleEndian<quint32>( m_map + 8 ) != archiveVersion )
+    {
+        qWarning() << "Unknown tile archive format:" << m_file.fileName();
+        return false;
+    }
+
+    m_tileCount = qFromLittleEndian<quint32>( m_map + 12 );
+    const quint64 indexOffset = qFromLittleEndian<quint64>( m_map + 16 );
+    if ( indexOffset + quint64( m_tileCount ) * indexEntrySize > quint64( m_mapSize ) ) {
+        qWarning() << "Corrupt tile archive:" << m_file.fileName();
+        return false;
+    }
+
+    m_index = m_map + indexOffset;
+    m_end = indexOffset + quint64( m_tileCount ) * indexEntrySize;
+
+    // The index is sorted, so the last entry is on the highest level
+    if ( m_tileCount > 0 ) {
+        m_maximumTileLevel = qFromLittleEndian<quint32>( m_index + ( m_tileCount - 1 ) * indexEntrySize );
+    }
+
+    readAppendedTiles();
+
+    return true;
+}
+
+void TileArchive::readAppendedTiles()
+{
+    qint64 position = m_end;
+
+    while ( position + recordHeaderSize <= m_mapSize ) {
+        const uchar *const record = m_map + position;
+        if ( qFromLittleEndian<quint32>( record ) != recordMagic )
+            break;
+
+        const int level = qFromLittleEndian<quint32>( record + 4 );
+        const int x = qFromLittleEndian<quint32>( record + 8 );
+        const int y = qFromLittleEndian<quint32>( record + 12 );
+
+        Location location;
+        location.offset = position + recordHeaderSize;
+        location.size = qFromLittleEndian<quint32>( record + 16 );
+        location.modified = qFromLittleEndian<quint32>( record + 20 );
+
+        if ( location.offset + location.size > m_mapSize )
+            break;
+
+        m_appendedTiles.insert( key( level, x, y ), location );
+        m_maximumTileLevel = qMax( m_maximumTileLevel, level );
+
+        position = location.offset + location.size;
+    }
+
+    m_end = position;
+}
+
+bool TileArchive::openForWriting()
+{
+    QMutexLocker locker( &m_mutex );
+
+    if ( m_writeFile.isOpen() )
+        return true;
+
+    if ( !m_writeFile.open( QIODevice::ReadWrite ) )
+        return false;
+
+    // A tile torn by a crash gets dropped by appending the next tile right
+    // after the last complete one. The file isn't truncated, as it is mapped.
+    if ( m_end < m_mapSize ) {
+        qWarning() << "Dropping incomplete tile from archive" << m_writeFile.fileName();
+    }
+
+    return true;
+}
+
+bool TileArchive::find( int level, int x, int y, Location &location ) const
+{
+    const quint64 searchKey = key( level, x, y );
+
+    {
+        QMutexLocker locker( &m_mutex );
+
+        QHash<quint64, Location>::const_iterator const it = m_appendedTiles.constFind( searchKey );
+        if ( it != m_appendedTiles.constEnd() ) {
+            location = it.value();
+            return true;
+        }
+    }
+
+    // Binary search for the first entry not less than the searched one
+    quint32 first = 0;
+    quint32 last = m_tileCount;
+    while ( first < last ) {
+        const quint32 middle = first + ( last - first ) / 2;
+        const uchar *const entry = m_index + middle * indexEntrySize;
+        const quint64 entryKey = key( qFromLittleEndian<quint32>( entry ),
+                                      qFromLittleEndian<quint32>( entry + 4 ),
+                                      qFromLittleEndian<quint32>( entry + 8 ) );
+        if ( entryKey < searchKey )
+            first = middle + 1;
+        else
+            last = middle;
+    }
+
+    if ( first == m_tileCount )
+        return false;
+
+    const uchar *const entry = m_index + first * indexEntrySize;
+    if ( qFromLittleEndian<quint32>( entry ) != quint32( level )
+         || qFromLittleEndian<quint32>( entry + 4 ) != quint32( x )
+         || qFromLittleEndian<quint32>( entry + 8 ) != quint32( y ) )
+    {
+        return false;
+    }
+
+    location.size = qFromLittleEndian<quint32>( entry + 12 );
+    location.offset = qFromLittleEndian<quint64>( entry + 16 );
+    location.modified = qFromLittleEndian<quint32>( entry + 24 );
+
+    return true;
+}
+
+quint64 TileArchive::key( int level, int x, int y )
+{
+    // ordered like ( level, x, y ) for tile levels up to 29
+    return ( quint64( level ) << 58 ) | ( quint64( x ) << 29 ) | quint64( y );
+}
+
+
+TileArchiveWriter::TileArchiveWriter( const QString &fileName )
+    : m_fileName( fileName ),
+      m_file( fileName + ".new" )
+{
+    if ( m_file.open( QIODevice::WriteOnly ) ) {
+        // The header is written by finish(), once the index is known
+        m_file.write( QByteArray( headerSize, '\0' ) );
+    }
+}
+
+TileArchiveWriter::~TileArchiveWriter()
+{
+    // not finished, so don't leave an incomplete archive behind
+    if ( m_file.isOpen() ) {
+        m_file.close();
+        m_file.remove();
+    }
+}
+
+bool TileArchiveWriter::addTile( int level, int x, int y, const QByteArray &data, const QDateTime &lastModified )
+{
+    if ( !m_file.isOpen() )
+        return false;
+
+    IndexEntry entry;
+    entry.level = level;
+    entry.x = x;
+    entry.y = y;
+    entry.size = data.size();
+    entry.offset = m_file.pos();
+    entry.modified = lastModified.toTime_t();
+
+    if ( m_file.write( data ) != data.size() )
+        return false;
+
+    m_index.append( entry );
+
+    return true;
+}
+
+bool TileArchiveWriter::finish()
+{
+    if ( !m_file.isOpen() )
+        return false;
+
+    // Sort the index, keeping the last version of tiles added more than once
+    qStableSort( m_index.begin(), m_index.end() );
+
+    QVector<IndexEntry> index;
+    index.reserve( m_index.size() );
+    foreach ( const IndexEntry &entry, m_index ) {
+        if ( !index.isEmpty() && !( index.last() < entry ) )
+            index.last() = entry;
+        else
+            index.append( entry );
+    }
+
+    QByteArray indexData( index.size() * indexEntrySize, '\0' );
+    uchar *data = reinterpret_cast<uchar *>( indexData.data() );
+    foreach ( const IndexEntry &entry, index ) {
+        qToLittleEndian<quint32>( entry.level, data );
+        qToLittleEndian<quint32>( entry.x, data + 4 );
+        qToLittleEndian<quint32>( entry.y, data + 8 );
+        qToLittleEndian<quint32>( entry.size, data + 12 );
+        qToLittleEndian<quint64>( entry.offset, data + 16 );
+        qToLittleEndian<quint32>( entry.modified, data + 24 );
+        qToLittleEndian<quint32>( 0, data + 28 );
+        data += indexEntrySize;
+    }
+
+    const qint64 indexOffset = m_file.pos();
+
+    uchar header[ headerSize ];
+    writeHeader( header, index.size(), indexOffset );
+
+    if ( m_file.write( indexData ) != indexData.size()
+         || !m_file.seek( 0 )
+         || m_file.write( reinterpret_cast<const char *>( header ), headerSize ) != headerSize )
+    {
+        return false;
+    }
+
+    m_file.close();
+    if ( m_file.error() != QFile::NoError )
+        return false;
+
+    QFile::remove( m_fileName );
+
+    return QFile::rename( m_file.fileName(), m_fileName );
+}
+
+QString TileArchiveWriter::errorString() const
+{
+    return m_file.errorString();
+}
+
+bool TileArchiveWriter::IndexEntry::operator<( const IndexEntry &other ) const
+{
+    if ( level != other.level )
+        return level < other.level;
+    if ( x != other.x )
+        return x < other.x;
+    return y < other.y;
+}
+
+}
@@ -0,0 +1,186 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_TILEARCHIVE_H
+#define MARBLE_TILEARCHIVE_H
+
+#include <QtCore/QByteArray>
+#include <QtCore/QDateTime>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+#include "marble_export.h"
+
+namespace Marble
+{
+
+/**
+ * @short A single file holding all tiles of a texture layer.
+ *
+ * Storing one file per tile costs a directory lookup and an inode for every
+ * tile, which gets expensive for millions of tiles, especially on spinning
+ * disks and network file systems. An archive instead consists of a header,
+ * the data of all tiles and an index sorted by ( level, x, y ). The file gets
+ * memory mapped and tiles are looked up by binary search in the index, so
+ * loading a tile doesn't touch the file system.
+ *
+ * Tiles inserted later on, e.g. downloaded ones, are appended to the end of
+ * the file along with a small record header. Their locations are kept in a
+ * hash until the archive gets rewritten by TileArchiveWriter.
+ *
+ * All integers are stored in little endian byte order. An archive is meant
+ * to be written by a single process at a time.
+ */
+class MARBLE_EXPORT TileArchive
+{
+ public:
+    ~TileArchive();
+
+    /**
+     * Returns the archive stored in the file @p fileName. The archive is shared
+     * by all users within the process. Returns 0 if the file doesn't exist or
+     * can't be opened; that is remembered until writableArchive() is called
+     * for the file.
+     *
+     * This method is thread-safe, as are all other methods of TileArchive.
+     */
+    static TileArchive *archive( const QString &fileName );
+
+    /**
+     * Returns the archive stored in the file @p fileName for inserting tiles,
+     * creating the file if it doesn't exist yet. Returns 0 if the file can
+     * neither be opened for writing nor created.
+     */
+    static TileArchive *writableArchive( const QString &fileName );
+
+    /**
+     * Returns the name under which the tile ( @p level, @p x, @p y ) of the archive
+     * @p archiveFileName is passed to the storage policy when it gets downloaded.
+     */
+    static QString tileFileName( const QString &archiveFileName, int level, int x, int y );
+
+    /**
+     * Splits a name created by tileFileName() into its components.
+     * Returns false if @p fileName doesn't refer to a tile in an archive.
+     */
+    static bool parseTileFileName( const QString &fileName, QString &archiveFileName, int &level, int &x, int &y );
+
+    QString fileName() const;
+
+    bool contains( int level, int x, int y ) const;
+
+    /**
+     * Reads the data of the given tile into @p data.
+     * Returns false if the archive doesn't contain the tile.
+     */
+    bool tileData( int level, int x, int y, QByteArray &data ) const;
+
+    /**
+     * Returns when the given tile was stored in the archive,
+     * or an invalid QDateTime if the archive doesn't contain the tile.
+     */
+    QDateTime lastModified( int level, int x, int y ) const;
+
+    /**
+     * Returns the highest tile level contained in the archive, or -1 if it is empty.
+     */
+    int maximumTileLevel() const;
+
+    /**
+     * Appends the tile ( @p level, @p x, @p y ) to the archive,
+     * replacing a previous version of the tile. The archive
+     * must have been obtained by writableArchive().
+     */
+    bool insert( int level, int x, int y, const QByteArray &data );
+
+ private:
+    Q_DISABLE_COPY( TileArchive )
+
+    struct Location
+    {
+        qint64 offset;
+        quint32 size;
+        quint32 modified;
+    };
+
+    explicit TileArchive( const QString &fileName );
+
+    static TileArchive *openArchive( const QString &fileName, bool create );
+    static bool createFile( const QString &fileName );
+
+    bool open();
+    bool openForWriting();
+    void readAppendedTiles();
+    bool find( int level, int x, int y, Location &location ) const;
+
+    static quint64 key( int level, int x, int y );
+
+    // read-only, as it backs the memory map
+    QFile m_file;
+    uchar *m_map;
+    qint64 m_mapSize;
+
+    // the sorted index, pointing into m_map
+    const uchar *m_index;
+    quint32 m_tileCount;
+
+    // tiles appended after the index
+    mutable QMutex m_mutex;
+    mutable QFile m_writeFile;
+    QHash<quint64, Location> m_appendedTiles;
+    qint64 m_end;
+    int m_maximumTileLevel;
+};
+
+/**
+ * @short Writes a new TileArchive.
+ *
+ * The tiles can be added in any order. If a tile is added more than once,
+ * the last version is kept. The archive replaces @p fileName when finish()
+ * is called; an archive which is open already in the process keeps using
+ * the previous file.
+ */
+class MARBLE_EXPORT TileArchiveWriter
+{
+ public:
+    explicit TileArchiveWriter( const QString &fileName );
+    ~TileArchiveWriter();
+
+    bool addTile( int level, int x, int y, const QByteArray &data,
+                  const QDateTime &lastModified = QDateTime::currentDateTime() );
+
+    bool finish();
+
+    QString errorString() const;
+
+ private:
+    Q_DISABLE_COPY( TileArchiveWriter )
+
+    struct IndexEntry
+    {
+        quint32 level;
+        quint32 x;
+        quint32 y;
+        quint32 size;
+        qint64 offset;
+        quint32 modified;
+
+        bool operator<( const IndexEntry &other ) const;
+    };
+
+    const QString m_fileName;
+    QFile m_file;
+    QVector<IndexEntry> m_index;
+};
+
+}
+
+#endif
@@ -15,22 +15,32 @@
 #include <cmath>
 
 #include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtCore/QFuture>
+#include <QtCore/QList>
 #include <QtCore/QRect>
 #include <QtCore/QSize>
+#include <QtCore/QtConcurrentRun>
 #include <QtCore/QVector>
 #include <QtGui/QApplication>
 #include <QtGui/QImage>
+#include <QtGui/QImageIOHandler>
 #include <QtGui/QImageReader>
 #include <QtGui/QPainter>
 
 #include "MarbleGlobal.h"
 #include "MarbleDirs.h"
 #include "MarbleDebug.h"
+#include "TileArchive.h"
 #include "TileLoaderHelper.h"
 
 namespace Marble
 {
 
+// Images with more pixels than this are not loaded at once, but read in bands of tile rows
+static const qint64 maxLoadedPixels = qint64( 21600 ) * 10800;
+
 class TileCreatorPrivate
 {
  public:
@@ -42,20 +52,50 @@ class TileCreatorPrivate
          m_tileFormat( "jpg" ),
          m_resume( false ),
          m_verify( false ),
-         m_source( source )
+         m_source( source ),
+         m_createdTilesCount( 0 ),
+         m_writeFailed( false )
      {
         if ( m_dem == "true" ) {
             m_tileQuality = 70;
         } else {
             m_tileQuality = 85;
         }
+
+        for ( int cnt = 0; cnt <= 255; ++cnt ) {
+            m_grayScalePalette.insert(cnt, qRgb(cnt, cnt, cnt));
+        }
     }
 
     ~TileCreatorPrivate()
     {
+        waitForPendingTiles( 0 );
         delete m_source;
     }
 
+    QString tileFileName( int tileLevel, int n, int m ) const;
+
+    /**
+     * Passes a finished tile on to the next lower tile level, which is built
+     * in memory while the tiles of the higher levels get created. Once a row
+     * of tiles of the lower level is complete, it gets written as well.
+     */
+    void addTile( int tileLevel, int n, int m, const QImage &tile );
+
+    /**
+     * Encodes and writes the tile on a worker thread.
+     */
+    void writeTile( const QString &tileName, const QImage &tile );
+
+    /**
+     * Waits until at most @p maximum tiles are waiting to be written.
+     * Sets m_writeFailed if one of the finished tiles couldn't be written.
+     */
+    void waitForPendingTiles( int maximum );
+
+    static bool writeTileFile( const QImage &tile, const QString &tileName,
+                               const QByteArray &format, int quality, bool verify );
+
  public:
     QString  m_dem;
     QString  m_targetDir;
@@ -64,26 +104,51 @@ class TileCreatorPrivate
     int      m_tileQuality;
     bool     m_resume;
     bool     m_verify;
+    QString  m_tileArchive;
 
     TileCreatorSource  *m_source;
+
+    QVector<QRgb> m_grayScalePalette;
+
+    // for each tile level, the row of tiles being downsampled from the next higher level
+    QVector<QVector<QImage> > m_lowerLevelRows;
+    int m_createdTilesCount;
+    QList<QFuture<bool> > m_pendingTiles;
+    bool m_writeFailed;
 };
 
 class TileCreatorSourceImage : public TileCreatorSource
 {
 public:
     TileCreatorSourceImage( const QString &sourcePath )
-        : m_sourceImage( QImage( sourcePath ) ),
-          m_cachedRowNum( -1 )
+        : m_sourcePath( sourcePath ),
+          m_tooLarge( false ),
+          m_cachedRowNum( -1 ),
+          m_bandFirstRow( -1 ),
+          m_bandRowCount( 0 )
     {
+        QImageReader reader( sourcePath );
+        m_imageSize = reader.size();
+
+        // Images which fit into memory are loaded at once, as reading a part
+        // of an image decodes it down to the bottom of the part each time.
+        // Larger images are read in bands of several rows of tiles, if the
+        // image format supports that.
+        if ( !m_imageSize.isValid() || qint64( m_imageSize.width() ) * m_imageSize.height() <= maxLoadedPixels ) {
+            m_sourceImage = reader.read();
+            m_imageSize = m_sourceImage.size();
+        } else if ( !reader.supportsOption( QImageIOHandler::ClipRect ) ) {
+            m_tooLarge = true;
+        }
     }
 
     virtual QSize fullImageSize() const
     {
-        if ( m_sourceImage.size().width() > 21600 || m_sourceImage.height() > 10800 ) {
+        if ( m_tooLarge ) {
             qDebug("Install map too large!");
             return QSize();
         }
-        return m_sourceImage.size();
+        return m_imageSize;
     }
 
     virtual QImage tile(int n, int m, int maxTileLevel)
@@ -91,8 +156,8 @@ public:
         int  mmax = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, maxTileLevel );
         int  nmax = TileLoaderHelper::levelToRow( defaultLevelZeroRows, maxTileLevel );
 
-        int imageHeight = m_sourceImage.height();
-        int imageWidth = m_sourceImage.width();
+        int imageHeight = m_imageSize.height();
+        int imageWidth = m_imageSize.width();
 
         // If the image size of the image source does not match the expected
         // geometry we need to smooth-scale the image in advance to match
@@ -125,9 +190,17 @@ public:
                                 imageWidth,(int)( (qreal)( imageHeight ) / (qreal)( nmax ) ) );
 
 
-            row = m_sourceImage.copy( sourceRowRect );
+            if ( !m_sourceImage.isNull() ) {
+                row = m_sourceImage.copy( sourceRowRect );
+            } else {
+                if ( n < m_bandFirstRow || n >= m_bandFirstRow + m_bandRowCount ) {
+                    readBand( n, nmax );
+                }
+                const int bandTop = (int)( (qreal)( m_bandFirstRow * imageHeight ) / (qreal)( nmax ) );
+                row = m_band.copy( sourceRowRect.translated( 0, -bandTop ) );
+            }
 
-            if ( needsScaling ) {
+            if ( needsScaling && !row.isNull() ) {
                 // Pick the current row and smooth scale it
                 // to make it match the expected size
                 QSize destSize( stdImageWidth, c_defaultTileSize );
@@ -151,12 +224,168 @@ public:
     }
 
 private:
+    /**
+     * Reads the band of tile rows starting with row @p n, as many rows
+     * as fit into maxLoadedPixels.
+     */
+    void readBand( int n, int nmax )
+    {
+        const int imageHeight = m_imageSize.height();
+        const int rowHeight = qMax( 1, imageHeight / nmax );
+        const int rowsPerBand = (int)qMax<qint64>( 1, maxLoadedPixels / ( qint64( m_imageSize.width() ) * rowHeight ) );
+
+        m_bandFirstRow = n;
+        m_bandRowCount = qMin( rowsPerBand, nmax - n );
+
+        const int bandTop = (int)( (qreal)( n * imageHeight ) / (qreal)( nmax ) );
+        const int bandBottom = (int)( (qreal)( ( n + m_bandRowCount ) * imageHeight ) / (qreal)( nmax ) );
+
+        QImageReader reader( m_sourcePath );
+        reader.setClipRect( QRect( 0, bandTop, m_imageSize.width(), bandBottom - bandTop ) );
+        m_band = reader.read();
+    }
+
+    const QString m_sourcePath;
+    QSize m_imageSize;
+    bool m_tooLarge;
     QImage m_sourceImage;
 
+    QImage m_band;
+    int m_bandFirstRow;
+    int m_bandRowCount;
+
     QImage m_rowCache;
     int m_cachedRowNum;
 };
 
+QString TileCreatorPrivate::tileFileName( int tileLevel, int n, int m ) const
+{
+    return m_targetDir + ( QString("%1/%2/%2_%3.%4")
+                           .arg( tileLevel )
+                           .arg( n, tileDigits, 10, QChar('0') )
+                           .arg( m, tileDigits, 10, QChar('0') ) )
+                           .arg( m_tileFormat );
+}
+
+void TileCreatorPrivate::addTile( int tileLevel, int n, int m, const QImage &tile )
+{
+    ++m_createdTilesCount;
+
+    if ( tileLevel == 0 )
+        return;
+
+    QVector<QImage> &lowerLevelRow = m_lowerLevelRows[tileLevel - 1];
+    QImage &lowerLevelTile = lowerLevelRow[m / 2];
+
+    const bool dem = ( m_dem == "true" );
+    if ( lowerLevelTile.isNull() ) {
+        lowerLevelTile = QImage( c_defaultTileSize, c_defaultTileSize,
+                                 dem ? QImage::Format_Indexed8 : QImage::Format_ARGB32 );
+        if ( dem ) {
+            lowerLevelTile.setColorTable( m_grayScalePalette );
+        }
+    }
+
+    const QSize expectedSize( c_defaultTileSize, c_defaultTileSize );
+    QImage convertedTile = tile.size() == expectedSize ? tile : tile.scaled( expectedSize );
+    convertedTile = dem ? convertedTile.convertToFormat( QImage::Format_Indexed8, m_grayScalePalette, Qt::ThresholdDither )
+                        : convertedTile.convertToFormat( QImage::Format_ARGB32 );
+    const QImage source = convertedTile;
+
+    // Every other pixel of the tile goes into one quarter of the lower level tile
+    const uint half = c_defaultTileSize / 2;
+    const uint left = ( m % 2 ) ? half : 0;
+    const uint right = ( m % 2 ) ? c_defaultTileSize : half;
+    const uint top = ( n % 2 ) ? half : 0;
+    const uint bottom = ( n % 2 ) ? c_defaultTileSize : half;
+
+    for ( uint y = top; y < bottom; ++y ) {
+        if ( lowerLevelTile.depth() == 8 ) {
+            uchar* destLine = lowerLevelTile.scanLine( y );
+            const uchar* srcLine = source.scanLine( 2 * ( y - top ) );
+            for ( uint x = left; x < right; ++x )
+                destLine[x] = srcLine[ 2 * ( x - left ) ];
+        }
+        else {
+            QRgb* destLine = (QRgb*) lowerLevelTile.scanLine( y );
+            const QRgb* srcLine = (QRgb*) source.scanLine( 2 * ( y - top ) );
+            for ( uint x = left; x < right; ++x )
+                destLine[x] = srcLine[ 2 * ( x - left ) ];
+        }
+    }
+
+    // The last tile of an odd row completes a row of the lower level
+    if ( n % 2 == 1 && m == 2 * lowerLevelRow.size() - 1 ) {
+        for ( int j = 0; j < lowerLevelRow.size(); ++j ) {
+            const QImage completedTile = lowerLevelRow[j];
+            lowerLevelRow[j] = QImage();
+
+            const QString completedTileName = tileFileName( tileLevel - 1, n / 2, j );
+            if ( QFile::exists( completedTileName ) && m_resume ) {
+                //mDebug() << completedTileName << "exists already";
+            } else {
+                mDebug() << completedTileName;
+                writeTile( completedTileName, completedTile );
+            }
+
+            addTile( tileLevel - 1, n / 2, j, completedTile );
+        }
+        mDebug() << "row" << n / 2 << "of tileLevel" << tileLevel - 1 << "created.";
+    }
+}
+
+void TileCreatorPrivate::writeTile( const QString &tileName, const QImage &tile )
+{
+    waitForPendingTiles( 2 * QThread::idealThreadCount() );
+
+    // Tiles in lossy formats can't match the source pixel by pixel
+    const bool lossless = m_tileFormat != "jpg" && m_tileFormat != "jpeg";
+
+    m_pendingTiles << QtConcurrent::run( &TileCreatorPrivate::writeTileFile, tile, tileName,
+                                         m_tileFormat.toAscii(), m_tileQuality, m_verify && lossless );
+}
+
+void TileCreatorPrivate::waitForPendingTiles( int maximum )
+{
+    while ( m_pendingTiles.size() > qMax( 0, maximum ) ) {
+        if ( !m_pendingTiles.takeFirst().result() ) {
+            m_writeFailed = true;
+        }
+    }
+}
+
+bool TileCreatorPrivate::writeTileFile( const QImage &tile, const QString &tileName,
+                                        const QByteArray &format, int quality, bool verify )
+{
+    bool  ok = tile.save( tileName, format.data(), quality );
+    if ( !ok ) {
+        mDebug() << "Error while writing Tile: " << tileName;
+        return false;
+    }
+
+    if ( verify ) {
+        QImage writtenTile(tileName);
+        Q_ASSERT( writtenTile.size() == tile.size() );
+        for ( int i=0; i < writtenTile.size().width(); ++i) {
+            for ( int j=0; j < writtenTile.size().height(); ++j) {
+                if ( writtenTile.pixel( i, j ) != tile.pixel( i, j ) ) {
+                    unsigned int  pixel = tile.pixel( i, j);
+                    unsigned int  writtenPixel = writtenTile.pixel( i, j);
+                    qWarning() << "***** pixel" << i << j << "is off by" << (pixel - writtenPixel) << "pixel" << pixel << "writtenPixel" << writtenPixel;
+                    QByteArray baPixel((char*)&pixel, sizeof(unsigned int));
+                    qWarning() << "pixel" << baPixel.size() << "0x" << baPixel.toHex();
+                    QByteArray baWrittenPixel((char*)&writtenPixel, sizeof(unsigned int));
+                    qWarning() << "writtenPixel" << baWrittenPixel.size() << "0x" << baWrittenPixel.toHex();
+                    Q_ASSERT(false);
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
 
 TileCreator::TileCreator(const QString& sourceDir, const QString& installMap,
                          const QString& dem, const QString& targetDir)
@@ -222,11 +451,6 @@ void TileCreator::run()
 
     mDebug() << "Installing tiles to: " << d->m_targetDir;
 
-    QVector<QRgb> grayScalePalette;
-    for ( int cnt = 0; cnt <= 255; ++cnt ) {
-        grayScalePalette.insert(cnt, qRgb(cnt, cnt, cnt));
-    }
-
     QSize fullImageSize = d->m_source->fullImageSize();
     int  imageWidth  = fullImageSize.width();
     int  imageHeight = fullImageSize.height();
@@ -275,300 +499,140 @@ void TileCreator::run()
     int  mmax = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, maxTileLevel );
     int  nmax = TileLoaderHelper::levelToRow( defaultLevelZeroRows, maxTileLevel );
 
+    // Creating directory structure for all levels
+    for ( tileLevel = 0; tileLevel <= maxTileLevel; ++tileLevel ) {
+        int nmaxit = TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
+        for ( int n = 0; n < nmaxit; ++n ) {
+            QString dirName( d->m_targetDir
+                             + QString("%1/%2").arg(tileLevel).arg( n, tileDigits, 10, QChar('0') ) );
+            if ( !QDir( dirName ).exists() ) 
+                ( QDir::root() ).mkpath( dirName );
+        }
+    }
+
+    // The lower tile levels are built in memory from the tiles of the
+    // next higher level, so that the tiles only get written once.
+    d->m_lowerLevelRows.clear();
+    for ( tileLevel = 0; tileLevel < maxTileLevel; ++tileLevel ) {
+        d->m_lowerLevelRows << QVector<QImage>( TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel ) );
+    }
+    d->m_createdTilesCount = 0;
+    d->m_writeFailed = false;
+
     // Loading each row at highest spatial resolution and cropping tiles
     int      percentCompleted = 0;
-    int      createdTilesCount = 0;
     QString  tileName;
 
-    // Creating directory structure for the highest level
-    QString  dirName( d->m_targetDir
-                      + QString("%1").arg(maxTileLevel) );
-    if ( !QDir( dirName ).exists() ) 
-        ( QDir::root() ).mkpath( dirName );
-
-    for ( int n = 0; n < nmax; ++n ) {
-        QString dirName( d->m_targetDir
-                         + QString("%1/%2").arg(maxTileLevel).arg( n, tileDigits, 10, QChar('0') ) );
-        if ( !QDir( dirName ).exists() ) 
-            ( QDir::root() ).mkpath( dirName );
-    }
-
     for ( int n = 0; n < nmax; ++n ) {
 
         for ( int m = 0; m < mmax; ++m ) {
 
             mDebug() << "** tile" << m << "x" << n;
 
-            if ( d->m_cancelled ) 
+            if ( d->m_cancelled ) {
+                d->waitForPendingTiles( 0 );
                 return;
+            }
 
-            tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                       .arg( maxTileLevel )
-                                       .arg( n, tileDigits, 10, QChar('0') )
-                                       .arg( m, tileDigits, 10, QChar('0') ) )
-                                       .arg( d->m_tileFormat );
+            tileName = d->tileFileName( maxTileLevel, n, m );
+
+            QImage tile;
 
             if ( QFile::exists( tileName ) && d->m_resume ) {
 
                 //mDebug() << tileName << "exists already";
+                tile = QImage( tileName );
 
-            } else {
+            }
+
+            if ( tile.isNull() ) {
 
-                QImage tile = d->m_source->tile( n, m, maxTileLevel );
+                tile = d->m_source->tile( n, m, maxTileLevel );
 
                 if ( tile.isNull() ) {
                     mDebug() << "Read-Error! Null QImage!";
+                    d->waitForPendingTiles( 0 );
                     return;
                 }
 
                 if ( d->m_dem == "true" ) {
                     tile = tile.convertToFormat(QImage::Format_Indexed8,
-                                                grayScalePalette,
+                                                d->m_grayScalePalette,
                                                 Qt::ThresholdDither);
                 }
 
-                bool  ok = tile.save( tileName, d->m_tileFormat.toAscii().data(), d->m_tileFormat == "jpg" ? 100 : d->m_tileQuality );
-                if ( !ok )
-                    mDebug() << "Error while writing Tile: " << tileName;
-
-                mDebug() << tileName << "size" << QFile( tileName ).size();
-
-                if ( d->m_verify ) {
-                    QImage writtenTile(tileName);
-                    Q_ASSERT( writtenTile.size() == tile.size() );
-                    for ( int i=0; i < writtenTile.size().width(); ++i) {
-                        for ( int j=0; j < writtenTile.size().height(); ++j) {
-                            if ( writtenTile.pixel( i, j ) != tile.pixel( i, j ) ) {
-                                unsigned int  pixel = tile.pixel( i, j);
-                                unsigned int  writtenPixel = writtenTile.pixel( i, j);
-                                qWarning() << "***** pixel" << i << j << "is off by" << (pixel - writtenPixel) << "pixel" << pixel << "writtenPixel" << writtenPixel;
-                                QByteArray baPixel((char*)&pixel, sizeof(unsigned int));
-                                qWarning() << "pixel" << baPixel.size() << "0x" << baPixel.toHex();
-                                QByteArray baWrittenPixel((char*)&writtenPixel, sizeof(unsigned int));
-                                qWarning() << "writtenPixel" << baWrittenPixel.size() << "0x" << baWrittenPixel.toHex();
-                                Q_ASSERT(false);
-                            }
-                        }
-                    }
-                }
+                d->writeTile( tileName, tile );
+            }
+
+            d->addTile( maxTileLevel, n, m, tile );
 
+            if ( d->m_writeFailed ) {
+                mDebug() << "Tile write failure. Missing write permissions?";
+                d->waitForPendingTiles( 0 );
+                return;
             }
 
-            percentCompleted =  (int) ( 90 * (qreal)(createdTilesCount) 
-                                        / (qreal)(totalTileCount) );	
-            createdTilesCount++;
+            // Don't exceed 99% as this would cancel the thread unexpectedly
+            percentCompleted =  (int) ( 99 * (qreal)(d->m_createdTilesCount)
+                                        / (qreal)(totalTileCount) );
 
             mDebug() << "percentCompleted" << percentCompleted;
             emit progress( percentCompleted );
         }
     }
 
-    mDebug() << "tileLevel: " << maxTileLevel << " successfully created.";
-
-    tileLevel = maxTileLevel;
+    d->waitForPendingTiles( 0 );
 
-    // Now that we have the tiles at the highest resolution lets build
-    // them together four by four.
+    if ( d->m_writeFailed ) {
+        mDebug() << "Tile write failure. Missing write permissions?";
+        return;
+    }
 
-    while( tileLevel > 0 ) {
-        tileLevel--;
+    mDebug() << "Tile creation completed.";
 
-        int  nmaxit =  TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
+    if ( !d->m_tileArchive.isEmpty() ) {
 
-        for ( int n = 0; n < nmaxit; ++n ) {
-            QString  dirName( d->m_targetDir
-                              + ( QString("%1/%2")
-                                  .arg(tileLevel)
-                                  .arg( n, tileDigits, 10, QChar('0') ) ) );
+        // Packing all tiles into a single archive and removing the tile files
+        const QString archiveFileName = QFileInfo( d->m_tileArchive ).isAbsolute() ? d->m_tileArchive
+                                                                                   : d->m_targetDir + d->m_tileArchive;
+        mDebug() << "Packing tiles into" << archiveFileName;
 
-            // mDebug() << "dirName: " << dirName;
-            if ( !QDir( dirName ).exists() ) 
-                ( QDir::root() ).mkpath( dirName );
+        TileArchiveWriter archive( archiveFileName );
 
-            int   mmaxit = TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
-            for ( int m = 0; m < mmaxit; ++m ) {
+        for ( tileLevel = 0; tileLevel <= maxTileLevel; ++tileLevel ) {
+            int nmaxit =  TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
+            for ( int n = 0; n < nmaxit; ++n) {
+                int mmaxit =  TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
+                for ( int m = 0; m < mmaxit; ++m) {
 
-                if ( d->m_cancelled )
-                    return;
+                    if ( d->m_cancelled )
+                        return;
 
-                QString newTileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                           .arg( tileLevel )
-                                           .arg( n, tileDigits, 10, QChar('0') )
-                                           .arg( m, tileDigits, 10, QChar('0') ) )
-                                           .arg( d->m_tileFormat );
-
-                if ( QFile::exists( newTileName ) && d->m_resume ) {
-                    //mDebug() << newTileName << "exists already";
-                } else {
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_topleft( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m+1, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_topright( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n+1, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_bottomleft( tileName );
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel + 1 )
-                                            .arg( 2*n+1, tileDigits, 10, QChar('0') )
-                                            .arg( 2*m+1, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage  img_bottomright( tileName );
-
-                    QSize const expectedSize( c_defaultTileSize, c_defaultTileSize );
-                    if ( img_topleft.size() != expectedSize ||
-                         img_topright.size() != expectedSize ||
-                         img_bottomleft.size() != expectedSize ||
-                         img_bottomright.size() != expectedSize ) {
-                        mDebug() << "Tile write failure. Missing write permissions?";
-                        emit progress( 100 );
+                    tileName = d->tileFileName( tileLevel, n, m );
+                    QFile tile( tileName );
+                    if ( !tile.open( QIODevice::ReadOnly ) || !archive.addTile( tileLevel, m, n, tile.readAll() ) ) {
+                        mDebug() << "Error while packing Tile: " << tileName << archive.errorString();
                         return;
                     }
-                    QImage  tile = img_topleft;
-
-                    if ( d->m_dem == "true" ) {
-
-                        tile.setColorTable( grayScalePalette );
-                        uchar* destLine;
-
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_topleft.scanLine( 2 * y );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2*x ];
-                        }
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_topright.scanLine( 2 * y );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_bottomleft.scanLine( 2 * ( y - c_defaultTileSize / 2 ) );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[ x ] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = tile.scanLine( y );
-                            const uchar* srcLine = img_bottomright.scanLine( 2 * ( y - c_defaultTileSize/2 ) );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                    }
-                    else {
-
-                        // tile.depth() != 8
-
-                        img_topleft = img_topleft.convertToFormat( QImage::Format_ARGB32 );
-                        img_topright = img_topright.convertToFormat( QImage::Format_ARGB32 );
-                        img_bottomleft = img_bottomleft.convertToFormat( QImage::Format_ARGB32 );
-                        img_bottomright = img_bottomright.convertToFormat( QImage::Format_ARGB32 );
-                        tile = img_topleft;
-
-                        QRgb* destLine;
-
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_topleft.scanLine( 2 * y );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = 0; y < c_defaultTileSize / 2; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_topright.scanLine( 2 * y );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2 * ( x - c_defaultTileSize / 2 ) ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_bottomleft.scanLine( 2 * ( y-c_defaultTileSize/2 ) );
-                            for ( uint x = 0; x < c_defaultTileSize / 2; ++x )
-                                destLine[x] = srcLine[ 2 * x ];
-                        }
-                        for ( uint y = c_defaultTileSize / 2; y < c_defaultTileSize; ++y ) {
-                            destLine = (QRgb*) tile.scanLine( y );
-                            const QRgb* srcLine = (QRgb*) img_bottomright.scanLine( 2 * ( y-c_defaultTileSize / 2 ) );
-                            for ( uint x = c_defaultTileSize / 2; x < c_defaultTileSize; ++x )
-                                destLine[x] = srcLine[ 2*( x-c_defaultTileSize / 2 ) ];
-                        }
-                    }
-
-                    mDebug() << newTileName;
-
-                    // Saving at 100% JPEG quality to have a high-quality
-                    // version to create the remaining needed tiles from.
-                    bool  ok = tile.save( newTileName, d->m_tileFormat.toAscii().data(), d->m_tileFormat == "jpg" ? 100 : d->m_tileQuality );
-                    if ( ! ok )
-                        mDebug() << "Error while writing Tile: " << newTileName;
                 }
-
-                percentCompleted =  (int) ( 90 * (qreal)(createdTilesCount)
-                                            / (qreal)(totalTileCount) );	
-                createdTilesCount++;
-						
-                emit progress( percentCompleted );
-                mDebug() << "percentCompleted" << percentCompleted;
             }
         }
-        mDebug() << "tileLevel: " << tileLevel << " successfully created.";
-    }
-    mDebug() << "Tile creation completed.";
-
-    if ( d->m_tileFormat == "jpg" && d->m_tileQuality != 100 ) {
 
-        // Applying correct lower JPEG compression now that we created all tiles
-        int savedTilesCount = 0;
-
-        tileLevel = 0;
-        while ( tileLevel <= maxTileLevel ) {
-            int nmaxit =  TileLoaderHelper::levelToRow( defaultLevelZeroRows, tileLevel );
-            for ( int n = 0; n < nmaxit; ++n) {
-                int mmaxit =  TileLoaderHelper::levelToColumn( defaultLevelZeroColumns, tileLevel );
-                for ( int m = 0; m < mmaxit; ++m) {
-
-                    if ( d->m_cancelled )
-                        return;
+        if ( !archive.finish() ) {
+            mDebug() << "Error while writing tile archive: " << archiveFileName << archive.errorString();
+            return;
+        }
 
-                    savedTilesCount++;
-
-                    tileName = d->m_targetDir + ( QString("%1/%2/%2_%3.%4")
-                                            .arg( tileLevel )
-                                            .arg( n, tileDigits, 10, QChar('0') )
-                                            .arg( m, tileDigits, 10, QChar('0') ) )
-                                            .arg( d->m_tileFormat );
-                    QImage tile( tileName );
-
-                    bool ok;
-
-                    ok = tile.save( tileName, d->m_tileFormat.toAscii().data(), d->m_tileQuality );
-
-                    if ( !ok )
-                        mDebug() << "Error while writing Tile: " << tileName;
-                    // Don't exceed 99% as this would cancel the thread unexpectedly
-                    percentCompleted = 90 + (int)( 9 * (qreal)(savedTilesCount)
-                                                / (qreal)(totalTileCount) );
-                    emit progress( percentCompleted );
-                    mDebug() << "percentCompleted" << percentCompleted;
-                    //mDebug() << "Saving Tile #" << savedTilesCount
-                    //         << " of " << totalTileCount
-                    //         << " Percent: " << percentCompleted;
+        for ( tileLevel = 0; tileLevel <= maxTileLevel; ++tileLevel ) {
+            QDir levelDir( d->m_targetDir + QString::number( tileLevel ) );
+            foreach ( const QString &rowDirName, levelDir.entryList( QDir::Dirs | QDir::NoDotAndDotDot ) ) {
+                QDir rowDir( levelDir.filePath( rowDirName ) );
+                foreach ( const QString &fileName, rowDir.entryList( QDir::Files ) ) {
+                    rowDir.remove( fileName );
                 }
+                levelDir.rmdir( rowDirName );
             }
-            tileLevel++;
+            QDir( d->m_targetDir ).rmdir( QString::number( tileLevel ) );
         }
     }
 
@@ -608,6 +672,16 @@ bool TileCreator::resume() const
     return d->m_resume;
 }
 
+void TileCreator::setTileArchive(const QString& fileName)
+{
+    d->m_tileArchive = fileName;
+}
+
+QString TileCreator::tileArchive() const
+{
+    return d->m_tileArchive;
+}
+
 void TileCreator::setVerifyExactResult(bool verify)
 {
     d->m_verify = verify;
@@ -30,7 +30,11 @@ class TileCreatorPrivate;
  *
  * Implement this class to have more control over the tile creating process. This
  * is needed when creating with a high tileLevel where the whole source image can't
- * be loaded at once.
+ * be loaded at once, unless the image format supports reading parts of an image,
+ * like JPEG does. Then the standard image source reads bands of several rows of
+ * tiles at a time. As each read decodes the image from the top down to the band,
+ * the time this takes still grows quadratically with the height of the image, so
+ * a custom source with a streaming decoder is preferable for very large images.
  **/
 class MARBLE_EXPORT TileCreatorSource
 {
@@ -76,10 +80,18 @@ class MARBLE_EXPORT TileCreator : public QThread
     void setTileQuality( int quality );
     void setResume( bool resume );
     void setVerifyExactResult( bool verify );
+
+    /**
+     * Packs the created tiles into the TileArchive @p fileName instead of
+     * leaving one file per tile. A relative @p fileName is relative to the
+     * target directory.
+     */
+    void setTileArchive( const QString &fileName );
     QString tileFormat() const;
     int tileQuality() const;
     bool resume() const;
     bool verifyExactResult() const;
+    QString tileArchive() const;
 
  protected:
     virtual void run();
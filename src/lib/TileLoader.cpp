@@ -22,6 +22,7 @@
 
 #include <QtCore/QDateTime>
 #include <QtCore/QFileInfo>
+#include <QtCore/QList>
 #include <QtCore/QMetaType>
 #include <QtGui/QImage>
 
@@ -29,11 +30,13 @@
 
 #include "GeoSceneTextureTile.h"
 #include "GeoSceneTiled.h"
+#include "GeoSceneTypes.h"
 #include "GeoSceneVectorTile.h"
 #include "GeoDataContainer.h"
 #include "HttpDownloadManager.h"
 #include "MarbleDebug.h"
 #include "MarbleDirs.h"
+#include "TileArchive.h"
 #include "TileLoaderHelper.h"
 
 Q_DECLARE_METATYPE( Marble::DownloadUsage )
@@ -41,6 +44,46 @@ Q_DECLARE_METATYPE( Marble::DownloadUsage )
 namespace Marble
 {
 
+// Returns the file name of the archive holding the tiles of @p textureLayer, relative
+// to the data directories, or an empty string if each tile is stored in a file of its own.
+static QString tileArchiveName( GeoSceneTiled const *textureLayer )
+{
+    if ( textureLayer->nodeType() != GeoSceneTypes::GeoSceneTextureTileType )
+        return QString();
+
+    const QString archive = static_cast<GeoSceneTextureTile const *>( textureLayer )->archive();
+    if ( archive.isEmpty() || QFileInfo( archive ).isAbsolute() )
+        return archive;
+
+    return textureLayer->themeStr() + '/' + archive;
+}
+
+// Returns the file name of the archive downloaded tiles go to. Installed
+// archives may not be writable, so that is always the local one.
+static QString downloadTileArchiveFileName( const QString &archiveName )
+{
+    return QFileInfo( archiveName ).isAbsolute() ? archiveName : MarbleDirs::localPath() + '/' + archiveName;
+}
+
+// Returns the existing archives holding tiles of @p archiveName,
+// the one with the downloaded tiles first.
+static QList<TileArchive const *> tileArchives( const QString &archiveName )
+{
+    QList<TileArchive const *> archives;
+
+    TileArchive const *const downloadArchive = TileArchive::archive( downloadTileArchiveFileName( archiveName ) );
+    if ( downloadArchive )
+        archives << downloadArchive;
+
+    if ( !QFileInfo( archiveName ).isAbsolute() ) {
+        TileArchive const *const installedArchive = TileArchive::archive( MarbleDirs::systemPath() + '/' + archiveName );
+        if ( installedArchive && installedArchive != downloadArchive )
+            archives << installedArchive;
+    }
+
+    return archives;
+}
+
 TileLoader::TileLoader(HttpDownloadManager * const downloadManager, const PluginManager *pluginManager) :
       m_pluginManager( pluginManager )
 {
@@ -56,8 +99,6 @@ TileLoader::TileLoader(HttpDownloadManager * const downloadManager, const Plugin
 //     - if expired: create TextureTile, state is set to Expired by default, trigger dl,
 QImage TileLoader::loadTileImage( GeoSceneTextureTile const *textureLayer, TileId const & tileId, DownloadUsage const usage )
 {
-    QString const fileName = tileFileName( textureLayer, tileId );
-
     TileStatus status = tileStatus( textureLayer, tileId );
     if ( status != Missing ) {
         // check if an update should be triggered
@@ -70,7 +111,7 @@ QImage TileLoader::loadTileImage( GeoSceneTextureTile const *textureLayer, TileI
             triggerDownload( textureLayer, tileId, usage );
         }
 
-        QImage const image( fileName );
+        QImage const image = tileImage( textureLayer, tileId );
         if ( !image.isNull() ) {
             // file is there, so create and return a tile object in any case
             return image;
@@ -145,6 +186,15 @@ int TileLoader::maximumTileLevel( GeoSceneTiled const & texture )
     }
 
     int maximumTileLevel = -1;
+
+    const QString archiveName = tileArchiveName( &texture );
+    if ( !archiveName.isEmpty() ) {
+        foreach ( TileArchive const *archive, tileArchives( archiveName ) ) {
+            maximumTileLevel = qMax( maximumTileLevel, archive->maximumTileLevel() );
+        }
+        return maximumTileLevel + 1;
+    }
+
     const QFileInfo themeStr( texture.themeStr() );
     const QString tilepath = themeStr.isAbsolute() ? themeStr.absoluteFilePath() : MarbleDirs::path( texture.themeStr() );
     //    mDebug() << "StackedTileLoader::maxPartialTileLevel tilepath" << tilepath;
@@ -171,6 +221,10 @@ bool TileLoader::baseTilesAvailable( GeoSceneTiled const & texture )
     const int  levelZeroColumns = texture.levelZeroColumns();
     const int  levelZeroRows    = texture.levelZeroRows();
 
+    const QString archiveName = tileArchiveName( &texture );
+    const QList<TileArchive const *> archives = archiveName.isEmpty() ? QList<TileArchive const *>()
+                                                                      : tileArchives( archiveName );
+
     bool result = true;
 
     // Check whether the tiles from the lowest texture level are available
@@ -178,8 +232,16 @@ bool TileLoader::baseTilesAvailable( GeoSceneTiled const & texture )
     for ( int column = 0; result && column < levelZeroColumns; ++column ) {
         for ( int row = 0; result && row < levelZeroRows; ++row ) {
             const TileId id( 0, 0, column, row );
-            const QString tilepath = tileFileName( &texture, id );
-            result &= QFile::exists( tilepath );
+            if ( !archiveName.isEmpty() ) {
+                bool contained = false;
+                foreach ( TileArchive const *archive, archives ) {
+                    contained |= archive->contains( id.zoomLevel(), id.x(), id.y() );
+                }
+                result &= contained;
+            } else {
+                const QString tilepath = tileFileName( &texture, id );
+                result &= QFile::exists( tilepath );
+            }
             if (!result) {
                 mDebug() << "Base tile " << texture.relativeTileFileName( id ) << " is missing for source dir " << texture.sourceDir();
             }
@@ -191,13 +253,28 @@ bool TileLoader::baseTilesAvailable( GeoSceneTiled const & texture )
 
 TileLoader::TileStatus TileLoader::tileStatus( GeoSceneTiled const *textureLayer, const TileId &tileId )
 {
-    QString const fileName = tileFileName( textureLayer, tileId );
-    QFileInfo fileInfo( fileName );
-    if ( !fileInfo.exists() ) {
-        return Missing;
+    QDateTime lastModified;
+
+    const QString archiveName = tileArchiveName( textureLayer );
+    if ( !archiveName.isEmpty() ) {
+        foreach ( TileArchive const *archive, tileArchives( archiveName ) ) {
+            lastModified = archive->lastModified( tileId.zoomLevel(), tileId.x(), tileId.y() );
+            if ( lastModified.isValid() )
+                break;
+        }
+        if ( !lastModified.isValid() ) {
+            return Missing;
+        }
+    } else {
+        QString const fileName = tileFileName( textureLayer, tileId );
+        QFileInfo fileInfo( fileName );
+        if ( !fileInfo.exists() ) {
+            return Missing;
+        }
+
+        lastModified = fileInfo.lastModified();
     }
 
-    const QDateTime lastModified = fileInfo.lastModified();
     const int expireSecs = textureLayer->expire();
     const bool isExpired = lastModified.secsTo( QDateTime::currentDateTime() ) >= expireSecs;
     return isExpired ? Expired : Available;
@@ -229,10 +306,30 @@ QString TileLoader::tileFileName( GeoSceneTiled const * textureLayer, TileId con
     return dirInfo.isAbsolute() ? fileName : MarbleDirs::path( fileName );
 }
 
+QImage TileLoader::tileImage( GeoSceneTextureTile const * textureLayer, TileId const & tileId )
+{
+    const QString archiveName = tileArchiveName( textureLayer );
+    if ( archiveName.isEmpty() ) {
+        return QImage( tileFileName( textureLayer, tileId ) );
+    }
+
+    QByteArray data;
+    foreach ( TileArchive const *archive, tileArchives( archiveName ) ) {
+        if ( archive->tileData( tileId.zoomLevel(), tileId.x(), tileId.y(), data ) ) {
+            return QImage::fromData( data );
+        }
+    }
+
+    return QImage();
+}
+
 void TileLoader::triggerDownload( GeoSceneTiled const *textureLayer, TileId const &id, DownloadUsage const usage )
 {
     QUrl const sourceUrl = textureLayer->downloadUrl( id );
-    QString const destFileName = textureLayer->relativeTileFileName( id );
+    QString const archiveName = tileArchiveName( textureLayer );
+    QString const destFileName = archiveName.isEmpty() ? textureLayer->relativeTileFileName( id )
+                                                       : TileArchive::tileFileName( downloadTileArchiveFileName( archiveName ),
+                                                                                    id.zoomLevel(), id.x(), id.y() );
     QString const idStr = QString( "%1:%2:%3:%4" ).arg( textureLayer->sourceDir() ).arg( id.zoomLevel() ).arg( id.x() ).arg( id.y() );
     emit downloadTile( sourceUrl, destFileName, idStr, usage );
 }
@@ -245,9 +342,8 @@ QImage TileLoader::scaledLowerLevelTile( const GeoSceneTextureTile * textureLaye
         int const deltaLevel = id.zoomLevel() - level;
         TileId const replacementTileId( id.mapThemeIdHash(), level,
                                         id.x() >> deltaLevel, id.y() >> deltaLevel );
-        QString const fileName = tileFileName( textureLayer, replacementTileId );
-        mDebug() << "TileLoader::scaledLowerLevelTile" << "trying" << fileName;
-        QImage toScale( fileName );
+        mDebug() << "TileLoader::scaledLowerLevelTile" << "trying" << replacementTileId;
+        QImage toScale = tileImage( textureLayer, replacementTileId );
 
         if ( level == 0 && toScale.isNull() ) {
             mDebug() << "No level zero tile installed in map theme dir. Falling back to a transparent image for now.";
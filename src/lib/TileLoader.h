@@ -87,6 +87,7 @@ class TileLoader: public QObject
 
  private:
     static QString tileFileName( GeoSceneTiled const * textureLayer, TileId const & );
+    static QImage tileImage( GeoSceneTextureTile const * textureLayer, TileId const & );
     void triggerDownload( GeoSceneTiled const *textureLayer, TileId const &, DownloadUsage const );
     QImage scaledLowerLevelTile( GeoSceneTextureTile const * textureLayer, TileId const & ) const;
 
@@ -196,6 +196,7 @@ void TileScalingTextureMapper::mapTexture( GeoPainter *painter, const ViewportPa
     }
 
     m_tileLoader->cleanupTilehash();
+    m_tileLoader->cleanupPendingTiles();
 }
 
 void TileScalingTextureMapper::removePixmap( const TileId &tileId )
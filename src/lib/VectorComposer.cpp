@@ -176,6 +176,21 @@ void VectorComposer::setShowBorders( bool show )
     m_showBorders = show;
 }
 
+bool VectorComposer::showWaterBodies() const
+{
+    return m_showWaterBodies;
+}
+
+bool VectorComposer::showLakes() const
+{
+    return m_showLakes;
+}
+
+bool VectorComposer::showIce() const
+{
+    return m_showIce;
+}
+
 void VectorComposer::drawTextureMap( GeoPainter *painter, const ViewportParams *viewport )
 {
     loadCoastlines();
@@ -55,6 +55,10 @@ class VectorComposer : public QObject
     void setShowRivers( bool show );
     void setShowBorders( bool show );
 
+    bool showWaterBodies() const;
+    bool showLakes() const;
+    bool showIce() const;
+
     /**
      * @brief  Set color of the oceans
      * @param  color  ocean color
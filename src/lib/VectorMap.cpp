@@ -21,6 +21,7 @@
 #include "MarbleDebug.h"
 #include "MarbleGlobal.h"
 #include "AbstractProjection.h"
+#include "GeoDataLatLonAltBox.h"
 #include "GeoPainter.h"
 #include "GeoPolygon.h"
 #include "ViewportParams.h"
@@ -85,8 +86,10 @@ void VectorMap::sphericalCreateFromPntMap( const PntMap* pntmap,
                       || m_zPointLimit < 0.0 )
                      ? zlimit : m_zPointLimit;
 
-    GeoPolygon::PtrVector::ConstIterator  itPolyLine = pntmap->constBegin();
-    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = pntmap->constEnd();
+    // Only look at the polygons around the visible area
+    const GeoPolygon::PtrVector polygons = pntmap->intersecting( viewport->viewLatLonAltBox() );
+    GeoPolygon::PtrVector::ConstIterator  itPolyLine = polygons.constBegin();
+    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = polygons.constEnd();
 
     //	const int detail = 0;
     const int  detail = getDetailLevel( viewport->radius() );
@@ -127,8 +130,9 @@ void VectorMap::rectangularCreateFromPntMap( const PntMap* pntmap,
 
     const qreal rad2Pixel = (float)( 2 * radius ) / M_PI;
 
-    GeoPolygon::PtrVector::ConstIterator  itPolyLine = pntmap->constBegin();
-    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = pntmap->constEnd();
+    const GeoPolygon::PtrVector polygons = pntmap->intersecting( viewport->viewLatLonAltBox() );
+    GeoPolygon::PtrVector::ConstIterator  itPolyLine = polygons.constBegin();
+    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = polygons.constEnd();
 
     const QRectF visibleArea ( 0, 0, viewport->width(), viewport->height() );
     const int      detail = getDetailLevel( radius );
@@ -223,8 +227,9 @@ void VectorMap::mercatorCreateFromPntMap( const PntMap* pntmap,
 
     const qreal rad2Pixel = (float)( 2 * radius ) / M_PI;
 
-    GeoPolygon::PtrVector::ConstIterator  itPolyLine = pntmap->constBegin();
-    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = pntmap->constEnd();
+    const GeoPolygon::PtrVector polygons = pntmap->intersecting( viewport->viewLatLonAltBox() );
+    GeoPolygon::PtrVector::ConstIterator  itPolyLine = polygons.constBegin();
+    GeoPolygon::PtrVector::ConstIterator  itEndPolyLine = polygons.constEnd();
 
     const QRectF visibleArea ( 0, 0, viewport->width(), viewport->height() );
     const int      detail = getDetailLevel( radius );
@@ -318,12 +323,15 @@ void VectorMap::sphericalCreatePolyLine( const GeoPolygon *geoPolygon,
     const int rLimit = (int)( ( radius * radius )
                       * (1.0 - m_zPointLimit * m_zPointLimit ) );
 
+    // Only walk the nodes of the active detail level
+    const GeoDataCoordinates::Vector &nodes = geoPolygon->nodes( detail );
+
     ScreenPolygon polygon;
-    polygon.reserve( geoPolygon->size() );
+    polygon.reserve( nodes.size() );
     polygon.setClosed( geoPolygon->getClosed() );
 
-    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = geoPolygon->constBegin();
-    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = geoPolygon->constEnd();
+    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = nodes.constBegin();
+    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = nodes.constEnd();
 
     QPointF lastPoint;
     bool firsthorizon = false;
@@ -432,15 +440,17 @@ void VectorMap::rectangularCreatePolyLine(
     // Other convenience variables
     const qreal  rad2Pixel = (float)( 2 * viewport->radius() ) / M_PI;
 
+    const GeoDataCoordinates::Vector &nodes = geoPolygon->nodes( detail );
+
     ScreenPolygon polygon;
-    polygon.reserve( geoPolygon->size() );
+    polygon.reserve( nodes.size() );
     polygon.setClosed( geoPolygon->getClosed() );
 
     ScreenPolygon otherPolygon;
     otherPolygon.setClosed ( geoPolygon->getClosed() );
 
-    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = geoPolygon->constBegin();
-    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = geoPolygon->constEnd();
+    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = nodes.constBegin();
+    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = nodes.constEnd();
 
     bool CrossedDateline = false;
     bool firstPoint = true;
@@ -548,15 +558,17 @@ void VectorMap::mercatorCreatePolyLine( const GeoPolygon *geoPolygon,
     // Other convenience variables
     const qreal  rad2Pixel = (qreal)( 2 * viewport->radius() ) / M_PI;
 
+    const GeoDataCoordinates::Vector &nodes = geoPolygon->nodes( detail );
+
     ScreenPolygon polygon;
-    polygon.reserve( geoPolygon->size() );
+    polygon.reserve( nodes.size() );
     polygon.setClosed( geoPolygon->getClosed() );
 
     ScreenPolygon  otherPolygon;
     otherPolygon.setClosed ( geoPolygon->getClosed() );
 
-    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = geoPolygon->constBegin();
-    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = geoPolygon->constEnd();
+    GeoDataCoordinates::Vector::ConstIterator const &itStartPoint = nodes.constBegin();
+    GeoDataCoordinates::Vector::ConstIterator const &itEndPoint = nodes.constEnd();
 
     bool    CrossedDateline = false;
     bool    firstPoint      = true;
@@ -0,0 +1,60 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "VersionedCacheFile.h"
+
+#include "MarbleDebug.h"
+#include "MarbleGlobal.h"
+
+namespace Marble
+{
+
+VersionedCacheFile::VersionedCacheFile( const QString &fileName, quint32 magic )
+    : m_file( fileName ),
+      m_magic( magic )
+{
+    m_stream.setDevice( &m_file );
+    m_stream.setVersion( 8 );
+}
+
+bool VersionedCacheFile::openForReading()
+{
+    if ( !m_file.open( QIODevice::ReadOnly ) )
+        return false;
+
+    quint32 magic = 0;
+    QString version;
+    m_stream >> magic >> version;
+
+    // The entries may change with every version of Marble
+    return m_stream.status() == QDataStream::Ok && magic == m_magic && version == MARBLE_VERSION_STRING;
+}
+
+bool VersionedCacheFile::openForWriting()
+{
+    if ( !m_file.open( QIODevice::WriteOnly | QIODevice::Truncate ) ) {
+        mDebug() << "Unable to write the cache file" << m_file.fileName();
+        return false;
+    }
+
+    m_stream << m_magic << QString( MARBLE_VERSION_STRING );
+
+    return true;
+}
+
+bool VersionedCacheFile::checkStatus()
+{
+    if ( m_stream.status() != QDataStream::Ok ) {
+        qWarning( "Cache file %s is corrupt", qPrintable( m_file.fileName() ) );
+        return false;
+    }
+
+    return true;
+}
+
+}
@@ -0,0 +1,80 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_VERSIONEDCACHEFILE_H
+#define MARBLE_VERSIONEDCACHEFILE_H
+
+#include <QtCore/QDataStream>
+#include <QtCore/QFile>
+#include <QtCore/QHash>
+#include <QtCore/QString>
+
+namespace Marble
+{
+
+/**
+ * A file caching what was found out about other files, keyed by their path.
+ *
+ * The entries follow a magic number and the version of Marble that wrote them,
+ * so the file is ignored after an update of Marble. The entry type needs to
+ * provide the QDataStream operators.
+ */
+class VersionedCacheFile
+{
+ public:
+    VersionedCacheFile( const QString &fileName, quint32 magic );
+
+    /**
+     * Reads the entries, which are left empty if the file is missing,
+     * was written by another version of Marble or is corrupt.
+     */
+    template<typename T>
+    void read( QHash<QString, T> &entries );
+
+    /**
+     * Replaces the file by the given entries.
+     */
+    template<typename T>
+    void write( const QHash<QString, T> &entries );
+
+ private:
+    bool openForReading();
+    bool openForWriting();
+    bool checkStatus();
+
+    QFile m_file;
+    const quint32 m_magic;
+    QDataStream m_stream;
+};
+
+template<typename T>
+void VersionedCacheFile::read( QHash<QString, T> &entries )
+{
+    entries.clear();
+
+    if ( !openForReading() )
+        return;
+
+    m_stream >> entries;
+
+    if ( !checkStatus() )
+        entries.clear();
+}
+
+template<typename T>
+void VersionedCacheFile::write( const QHash<QString, T> &entries )
+{
+    if ( !openForWriting() )
+        return;
+
+    m_stream << entries;
+}
+
+}
+
+#endif
@@ -38,6 +38,11 @@ public:
 
     static const AbstractProjection *abstractProjection( Projection projection );
 
+    /**
+     * Changes the projection generation, and the scale generation as well if @p scaleChanged.
+     */
+    void newGeneration( bool scaleChanged );
+
     // These two go together.  m_currentProjection points to one of
     // the static Projection classes at the bottom.
     Projection           m_projection;
@@ -62,11 +67,18 @@ public:
     static const MercatorProjection   s_mercatorProjection;
 
     GeoDataCoordinates   m_focusPoint;
+
+    int                  m_projectionGeneration;
+    int                  m_scaleGeneration;
+
+    // shared by all viewports, so that generations are unique
+    static QAtomicInt    s_generation;
 };
 
 const SphericalProjection  ViewportParamsPrivate::s_sphericalProjection;
 const EquirectProjection   ViewportParamsPrivate::s_equirectProjection;
 const MercatorProjection   ViewportParamsPrivate::s_mercatorProjection;
+QAtomicInt                 ViewportParamsPrivate::s_generation;
 
 ViewportParamsPrivate::ViewportParamsPrivate( Projection projection,
                                               qreal centerLongitude, qreal centerLatitude,
@@ -82,8 +94,19 @@ ViewportParamsPrivate::ViewportParamsPrivate( Projection projection,
       m_angularResolution( 0.25 * M_PI / fabs( (qreal)( m_radius ) ) ),
       m_size( size ),
       m_dirtyBox( true ),
-      m_viewLatLonAltBox()
+      m_viewLatLonAltBox(),
+      m_projectionGeneration( 0 ),
+      m_scaleGeneration( 0 )
 {
+    newGeneration( true );
+}
+
+void ViewportParamsPrivate::newGeneration( bool scaleChanged )
+{
+    m_projectionGeneration = s_generation.fetchAndAddRelaxed( 1 ) + 1;
+    if ( scaleChanged ) {
+        m_scaleGeneration = m_projectionGeneration;
+    }
 }
 
 const AbstractProjection *ViewportParamsPrivate::abstractProjection(Projection projection)
@@ -140,6 +163,7 @@ void ViewportParams::setProjection(Projection newProjection)
 {
     d->m_projection = newProjection;
     d->m_currentProjection = ViewportParamsPrivate::abstractProjection( newProjection );
+    d->newGeneration( true );
 
     // We now need to reset the planetAxis to make sure
     // that it's a valid axis orientation!
@@ -204,6 +228,7 @@ void ViewportParams::setRadius(int newRadius)
 
         d->m_radius = newRadius;
         d->m_angularResolution = 0.25 * M_PI / fabs( (qreal)(d->m_radius) );
+        d->newGeneration( true );
     }
 }
 
@@ -235,6 +260,7 @@ void ViewportParams::centerOn( qreal lon, qreal lat )
 
     d->m_dirtyBox = true;
     d->m_planetAxis.inverse().toMatrix( d->m_planetAxisMatrix );
+    d->newGeneration( false );
 }
 
 Quaternion ViewportParams::planetAxis() const
@@ -281,11 +307,22 @@ void ViewportParams::setSize(QSize newSize)
     d->m_dirtyBox = true;
 
     d->m_size = newSize;
+    d->newGeneration( true );
 }
 
 // ================================================================
 //                        Other functions
 
+int ViewportParams::projectionGeneration() const
+{
+    return d->m_projectionGeneration;
+}
+
+int ViewportParams::scaleGeneration() const
+{
+    return d->m_scaleGeneration;
+}
+
 qreal ViewportParams::centerLongitude() const
 {
     return d->m_centerLongitude;
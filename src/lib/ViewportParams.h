@@ -108,6 +108,18 @@ class MARBLE_EXPORT ViewportParams
     void setHeight(int newHeight);
     void setSize(QSize newSize);
 
+    /**
+     * @brief Returns a number identifying the current mapping of geographical to screen coordinates.
+     * It changes whenever the projection, the radius, the size or the center changes, and is
+     * unique among all viewports. This allows to keep screen coordinates across frames.
+     */
+    int projectionGeneration() const;
+
+    /**
+     * @brief Like projectionGeneration(), except that it doesn't change when only the center moves.
+     */
+    int scaleGeneration() const;
+
     qreal centerLongitude() const;
     qreal centerLatitude() const;
     MARBLE_DEPRECATED( void centerCoordinates( qreal &centerLon, qreal &centerLat ) const );
@@ -19,12 +19,28 @@
 
 #include <cmath>
 
+#include <QtCore/QMutexLocker>
 #include <QtGui/QImage>
 #include <QtGui/QPainter>
 
 namespace Marble
 {
 
+// Same as QImage::pixel() does for premultiplied images
+static inline QRgb unpremultiplied( QRgb const pixel )
+{
+    int const alpha = qAlpha( pixel );
+    if ( alpha == 255 )
+        return pixel;
+    if ( alpha == 0 )
+        return 0;
+
+    return qRgba( 255 * qRed( pixel ) / alpha,
+                  255 * qGreen( pixel ) / alpha,
+                  255 * qBlue( pixel ) / alpha,
+                  alpha );
+}
+
 void OverpaintBlending::blend( QImage * const bottom, TextureTile const * const top ) const
 {
     Q_ASSERT( bottom );
@@ -52,11 +68,11 @@ void GrayscaleBlending::blend( QImage * const bottom, TextureTile const * const
     int const height = bottom->height();
 
     for ( int y = 0; y < height; ++y ) {
+        QRgb const * const topLine = reinterpret_cast<QRgb const *>( topImagePremult.scanLine( y ) );
+        QRgb * const bottomLine = reinterpret_cast<QRgb *>( bottom->scanLine( y ) );
         for ( int x = 0; x < width; ++x ) {
-            QRgb const topPixel = topImagePremult.pixel( x, y );
-            int const gray = qGray( topPixel );
-            QRgb const grayPixel = qRgb( gray, gray, gray );
-            bottom->setPixel( x, y,grayPixel );
+            int const gray = qGray( unpremultiplied( topLine[x] ) );
+            bottomLine[x] = qRgb( gray, gray, gray );
         }
     }
 
@@ -73,22 +89,32 @@ void IndependentChannelBlending::blend( QImage * const bottom,
     Q_ASSERT( bottom->size() == topImage->size() );
     Q_ASSERT( bottom->format() == QImage::Format_ARGB32_Premultiplied );
 
+    QMutexLocker locker( &m_channelTableMutex );
+    if ( m_channelTable.isEmpty() ) {
+        m_channelTable.resize( 256 * 256 );
+        for ( int bottomIntensity = 0; bottomIntensity < 256; ++bottomIntensity ) {
+            for ( int topIntensity = 0; topIntensity < 256; ++topIntensity ) {
+                qreal const result = blendChannel( bottomIntensity / 255.0, topIntensity / 255.0 );
+                m_channelTable[bottomIntensity * 256 + topIntensity] = uchar( int( result * 255.0 ) );
+            }
+        }
+    }
+    QVector<uchar> const channelTable = m_channelTable;
+    locker.unlock();
+
+    uchar const * const table = channelTable.constData();
     int const width = bottom->width();
     int const height = bottom->height();
     QImage const topImagePremult = topImage->convertToFormat( QImage::Format_ARGB32_Premultiplied );
     for ( int y = 0; y < height; ++y ) {
+        QRgb const * const topLine = reinterpret_cast<QRgb const *>( topImagePremult.scanLine( y ) );
+        QRgb * const bottomLine = reinterpret_cast<QRgb *>( bottom->scanLine( y ) );
         for ( int x = 0; x < width; ++x ) {
-            QRgb const bottomPixel = bottom->pixel( x, y );
-            QRgb const topPixel = topImagePremult.pixel( x, y );
-            qreal const resultRed = blendChannel( qRed( bottomPixel ) / 255.0,
-                                                  qRed( topPixel ) / 255.0 );
-            qreal const resultGreen = blendChannel( qGreen( bottomPixel ) / 255.0,
-                                                    qGreen( topPixel ) / 255.0 );
-            qreal const resultBlue = blendChannel( qBlue( bottomPixel ) / 255.0,
-                                                   qBlue( topPixel ) / 255.0 );
-            bottom->setPixel( x, y, qRgb( resultRed * 255.0,
-                                          resultGreen * 255.0,
-                                          resultBlue * 255.0 ));
+            QRgb const bottomPixel = unpremultiplied( bottomLine[x] );
+            QRgb const topPixel = unpremultiplied( topLine[x] );
+            bottomLine[x] = qRgb( table[qRed( bottomPixel ) * 256 + qRed( topPixel )],
+                                  table[qGreen( bottomPixel ) * 256 + qGreen( topPixel )],
+                                  table[qBlue( bottomPixel ) * 256 + qBlue( topPixel )] );
         }
     }
 }
@@ -325,18 +351,22 @@ void CloudsBlending::blend( QImage * const bottom, TextureTile const * const top
     QImage const * const topImage = top->image();
     Q_ASSERT( topImage );
     Q_ASSERT( bottom->size() == topImage->size() );
+    Q_ASSERT( bottom->format() == QImage::Format_ARGB32_Premultiplied );
+    QImage const topImageArgb = topImage->convertToFormat( QImage::Format_ARGB32 );
     int const width = bottom->width();
     int const height = bottom->height();
     for ( int y = 0; y < height; ++y ) {
+        QRgb const * const topLine = reinterpret_cast<QRgb const *>( topImageArgb.scanLine( y ) );
+        QRgb * const bottomLine = reinterpret_cast<QRgb *>( bottom->scanLine( y ) );
         for ( int x = 0; x < width; ++x ) {
-            qreal const c = qRed( topImage->pixel( x, y )) / 255.0;
-            QRgb const bottomPixel = bottom->pixel( x, y );
+            qreal const c = qRed( topLine[x] ) / 255.0;
+            QRgb const bottomPixel = unpremultiplied( bottomLine[x] );
             int const bottomRed = qRed( bottomPixel );
             int const bottomGreen = qGreen( bottomPixel );
             int const bottomBlue = qBlue( bottomPixel );
-            bottom->setPixel( x, y, qRgb(( int )( bottomRed + ( 255 - bottomRed ) * c ),
-                                         ( int )( bottomGreen + ( 255 - bottomGreen ) * c ),
-                                         ( int )( bottomBlue + ( 255 - bottomBlue ) * c )));
+            bottomLine[x] = qRgb(( int )( bottomRed + ( 255 - bottomRed ) * c ),
+                                 ( int )( bottomGreen + ( 255 - bottomGreen ) * c ),
+                                 ( int )( bottomBlue + ( 255 - bottomBlue ) * c ));
         }
     }
 }
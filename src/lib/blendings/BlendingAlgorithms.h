@@ -16,7 +16,9 @@
 #ifndef MARBLE_BLENDING_ALGORITHMS_H
 #define MARBLE_BLENDING_ALGORITHMS_H
 
+#include <QtCore/QMutex>
 #include <QtCore/QtGlobal>
+#include <QtCore/QVector>
 
 #include "Blending.h"
 
@@ -40,6 +42,11 @@ class IndependentChannelBlending: public Blending
     // all color intensity values are in the range 0..1
     virtual qreal blendChannel( qreal const bottomColorIntensity,
                                 qreal const topColorIntensity ) const = 0;
+
+    // The results of blendChannel() for all pairs of 8 bit intensities, indexed
+    // by bottom * 256 + top. Filled on first use, as blend() may run in several threads.
+    mutable QMutex m_channelTableMutex;
+    mutable QVector<uchar> m_channelTable;
 };
 
 
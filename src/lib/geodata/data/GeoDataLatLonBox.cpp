@@ -564,7 +564,7 @@ GeoDataLatLonBox GeoDataLatLonBox::fromLineString(  const GeoDataLineString& lin
     }
 
     qreal lon, lat;
-    lineString.first().geoCoordinates( lon, lat );
+    lineString.geoCoordinates( 0, lon, lat );
     GeoDataCoordinates::normalizeLonLat( lon, lat );
 
     qreal north = lat;
@@ -599,14 +599,15 @@ GeoDataLatLonBox GeoDataLatLonBox::fromLineString(  const GeoDataLineString& lin
     int currentSign = ( lon < 0 ) ? -1 : +1;
     int previousSign = currentSign;
 
-    QVector<GeoDataCoordinates>::ConstIterator it( lineString.constBegin() );
-    QVector<GeoDataCoordinates>::ConstIterator itEnd( lineString.constEnd() );
+    // Accessing the nodes by index keeps compact line strings compact
+    int i = 0;
+    const int size = lineString.size();
 
     bool processingLastNode = false;
 
-    while( it != itEnd ) {
+    while( i != size ) {
         // Get coordinates and normalize them to the desired range.
-        (it)->geoCoordinates( lon, lat );
+        lineString.geoCoordinates( i, lon, lat );
         GeoDataCoordinates::normalizeLonLat( lon, lat );
 
         // Determining the maximum and minimum latitude
@@ -664,10 +665,10 @@ GeoDataLatLonBox GeoDataLatLonBox::fromLineString(  const GeoDataLineString& lin
         if ( processingLastNode ) {
             break;
         }
-        ++it;
+        ++i;
 
-        if( lineString.isClosed() && it == itEnd ) {
-                it = lineString.constBegin();
+        if( lineString.isClosed() && i == size ) {
+                i = 0;
                 processingLastNode = true;
         }
     }
@@ -18,6 +18,8 @@
 #include "Quaternion.h"
 #include "MarbleDebug.h"
 
+#include <QtCore/QAtomicInt>
+
 
 namespace Marble
 {
@@ -51,6 +53,158 @@ GeoDataLineStringPrivate* GeoDataLineString::p() const
     return static_cast<GeoDataLineStringPrivate*>(d);
 }
 
+// Compact nodes store longitude and latitude in fixed point, covering
+// slightly less than [-2 * M_PI, 2 * M_PI] with a resolution of about 2 cm.
+static const qreal compactScale = 1073741824.0 / M_PI; // 2^30 / M_PI
+static const qreal compactRange = 6.28;
+
+// the last revision handed out to a line string
+static QAtomicInt lastRevision;
+
+int GeoDataLineStringPrivate::nextRevision()
+{
+    return lastRevision.fetchAndAddOrdered( 1 ) + 1;
+}
+
+void GeoDataLineStringPrivate::markModified()
+{
+    m_revision = nextRevision();
+}
+
+bool GeoDataLineStringPrivate::toCompactNode( const GeoDataCoordinates &coordinates, CompactNode &node )
+{
+    // compact nodes don't have any detail level
+    if ( coordinates.detail() != 0 )
+        return false;
+
+    return toCompactNode( coordinates.longitude(), coordinates.latitude(), node );
+}
+
+bool GeoDataLineStringPrivate::toCompactNode( qreal lon, qreal lat, CompactNode &node )
+{
+    if ( !( fabs( lon ) < compactRange && fabs( lat ) < compactRange ) )
+        return false;
+
+    node.lon = qRound( lon * compactScale );
+    node.lat = qRound( lat * compactScale );
+
+    return true;
+}
+
+GeoDataCoordinates GeoDataLineStringPrivate::fromCompactNode( const CompactNode &node, qreal altitude )
+{
+    return GeoDataCoordinates( node.lon / compactScale, node.lat / compactScale, altitude );
+}
+
+void GeoDataLineStringPrivate::append( const GeoDataCoordinates &coordinates )
+{
+    if ( m_compact ) {
+        CompactNode node;
+        if ( toCompactNode( coordinates, node ) ) {
+            appendCompactNode( node, coordinates.altitude() );
+            return;
+        }
+
+        expand();
+    }
+
+    m_vector.append( coordinates );
+}
+
+void GeoDataLineStringPrivate::append( qreal lon, qreal lat, qreal altitude )
+{
+    if ( m_compact ) {
+        CompactNode node;
+        if ( toCompactNode( lon, lat, node ) ) {
+            appendCompactNode( node, altitude );
+            return;
+        }
+    }
+
+    append( GeoDataCoordinates( lon, lat, altitude ) );
+}
+
+void GeoDataLineStringPrivate::appendCompactNode( const CompactNode &node, qreal altitude )
+{
+    if ( altitude != 0.0 && m_compactAltitudes.isEmpty() ) {
+        m_compactAltitudes.fill( 0.0, m_compactNodes.size() );
+    }
+    if ( altitude != 0.0 || !m_compactAltitudes.isEmpty() ) {
+        m_compactAltitudes.append( altitude );
+    }
+    m_compactNodes.append( node );
+    m_expandedNodes.clear();
+}
+
+bool GeoDataLineStringPrivate::compact()
+{
+    if ( m_compact )
+        return true;
+
+    QVector<CompactNode> nodes( m_vector.size() );
+    QVector<float> altitudes;
+    for ( int i = 0; i < m_vector.size(); ++i ) {
+        if ( !toCompactNode( m_vector.at( i ), nodes[i] ) )
+            return false;
+
+        const qreal altitude = m_vector.at( i ).altitude();
+        if ( altitude != 0.0 && altitudes.isEmpty() ) {
+            altitudes.fill( 0.0, m_vector.size() );
+        }
+        if ( !altitudes.isEmpty() ) {
+            altitudes[i] = altitude;
+        }
+    }
+
+    m_compactNodes = nodes;
+    m_compactAltitudes = altitudes;
+    m_expandedNodes.clear();
+    m_vector.clear();
+    m_compact = true;
+
+    return true;
+}
+
+void GeoDataLineStringPrivate::expand()
+{
+    if ( !m_compact )
+        return;
+
+    m_vector = nodes();
+
+    m_compactNodes.clear();
+    m_compactAltitudes.clear();
+    m_expandedNodes.clear();
+    m_compact = false;
+}
+
+const QVector<GeoDataCoordinates> &GeoDataLineStringPrivate::nodes()
+{
+    if ( !m_compact )
+        return m_vector;
+
+    QMutexLocker locker( &m_expandedNodesMutex );
+    if ( m_expandedNodes.size() != m_compactNodes.size() ) {
+        QVector<GeoDataCoordinates> expandedNodes;
+        expandedNodes.reserve( m_compactNodes.size() );
+        for ( int i = 0; i < m_compactNodes.size(); ++i ) {
+            expandedNodes.append( node( i ) );
+        }
+        m_expandedNodes = expandedNodes;
+    }
+
+    return m_expandedNodes;
+}
+
+GeoDataCoordinates GeoDataLineStringPrivate::node( int pos ) const
+{
+    if ( !m_compact )
+        return m_vector.at( pos );
+
+    return fromCompactNode( m_compactNodes.at( pos ),
+                            m_compactAltitudes.isEmpty() ? 0.0 : m_compactAltitudes.at( pos ) );
+}
+
 void GeoDataLineStringPrivate::interpolateDateLine( const GeoDataCoordinates & previousCoords,
                                                     const GeoDataCoordinates & currentCoords,
                                                     GeoDataCoordinates & previousAtDateLine,
@@ -128,123 +282,224 @@ GeoDataCoordinates GeoDataLineStringPrivate::findDateLine( const GeoDataCoordina
 
 bool GeoDataLineString::isEmpty() const
 {
-    return p()->m_vector.isEmpty();
+    return size() == 0;
 }
 
 int GeoDataLineString::size() const
 {
-    return p()->m_vector.size();
+    return p()->m_compact ? p()->m_compactNodes.size() : p()->m_vector.size();
+}
+
+void GeoDataLineString::geoCoordinates( int pos, qreal &lon, qreal &lat ) const
+{
+    GeoDataLineStringPrivate const *const d = p();
+    if ( d->m_compact ) {
+        const GeoDataLineStringPrivate::CompactNode &node = d->m_compactNodes.at( pos );
+        lon = node.lon / compactScale;
+        lat = node.lat / compactScale;
+    } else {
+        d->m_vector.at( pos ).geoCoordinates( lon, lat );
+    }
+}
+
+GeoDataCoordinates GeoDataLineString::coordinates( int pos ) const
+{
+    return p()->node( pos );
+}
+
+int GeoDataLineString::revision() const
+{
+    return p()->m_revision;
+}
+
+qreal GeoDataLineString::altitude( int pos ) const
+{
+    GeoDataLineStringPrivate const *const d = p();
+    if ( d->m_compact ) {
+        return d->m_compactAltitudes.isEmpty() ? 0.0 : d->m_compactAltitudes.at( pos );
+    }
+
+    return d->m_vector.at( pos ).altitude();
+}
+
+bool GeoDataLineString::isCompact() const
+{
+    return p()->m_compact;
+}
+
+void GeoDataLineString::setCompact( bool compact )
+{
+    GeoDataGeometry::detach();
+    p()->markModified();
+    if ( compact ) {
+        p()->compact();
+    } else {
+        p()->expand();
+    }
 }
 
 GeoDataCoordinates& GeoDataLineString::at( int pos )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
+    p()->expand();
     return p()->m_vector[ pos ];
 }
 
 const GeoDataCoordinates& GeoDataLineString::at( int pos ) const
 {
-    return p()->m_vector.at( pos );
+    return p()->nodes().at( pos );
 }
 
 GeoDataCoordinates& GeoDataLineString::operator[]( int pos )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
+    p()->expand();
     return p()->m_vector[ pos ];
 }
 
 const GeoDataCoordinates& GeoDataLineString::operator[]( int pos ) const
 {
-    return p()->m_vector[ pos ];
+    return p()->nodes()[ pos ];
 }
 
 GeoDataCoordinates& GeoDataLineString::last()
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     p()->m_dirtyRange = true;
     p()->m_dirtyBox = true;
+    p()->expand();
     return p()->m_vector.last();
 }
 
 GeoDataCoordinates& GeoDataLineString::first()
 {
     GeoDataGeometry::detach();
+    p()->markModified();
+    p()->expand();
     return p()->m_vector.first();
 }
 
 const GeoDataCoordinates& GeoDataLineString::last() const
 {
-    return p()->m_vector.last();
+    return p()->nodes().last();
 }
 
 const GeoDataCoordinates& GeoDataLineString::first() const
 {
-    return p()->m_vector.first();
+    return p()->nodes().first();
 }
 
 QVector<GeoDataCoordinates>::Iterator GeoDataLineString::begin()
 {
     GeoDataGeometry::detach();
+    p()->markModified();
+    p()->expand();
     return p()->m_vector.begin();
 }
 
 QVector<GeoDataCoordinates>::Iterator GeoDataLineString::end()
 {
     GeoDataGeometry::detach();
+    p()->markModified();
+    p()->expand();
     return p()->m_vector.end();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::constBegin() const
 {
-    return p()->m_vector.constBegin();
+    return p()->nodes().constBegin();
 }
 
 QVector<GeoDataCoordinates>::ConstIterator GeoDataLineString::constEnd() const
 {
-    return p()->m_vector.constEnd();
+    return p()->nodes().constEnd();
 }
 
 void GeoDataLineString::append ( const GeoDataCoordinates& value )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
-    d->m_vector.append( value );
+    d->append( value );
+}
+
+void GeoDataLineString::append( qreal lon, qreal lat, qreal altitude )
+{
+    GeoDataGeometry::detach();
+    p()->markModified();
+    GeoDataLineStringPrivate* d = p();
+    delete d->m_rangeCorrected;
+    d->m_rangeCorrected = 0;
+    d->m_dirtyRange = true;
+    d->m_dirtyBox = true;
+    d->append( lon, lat, altitude );
+}
+
+void GeoDataLineString::reserve( int size )
+{
+    GeoDataGeometry::detach();
+    p()->markModified();
+    GeoDataLineStringPrivate* d = p();
+    if ( d->m_compact ) {
+        d->m_compactNodes.reserve( size );
+    } else {
+        d->m_vector.reserve( size );
+    }
 }
 
 GeoDataLineString& GeoDataLineString::operator << ( const GeoDataCoordinates& value )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
-    d->m_vector.append( value );
+    d->append( value );
     return *this;
 }
 
 GeoDataLineString& GeoDataLineString::operator << ( const GeoDataLineString& value )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
 
-    QVector<GeoDataCoordinates>::const_iterator itCoords = value.constBegin();
-    QVector<GeoDataCoordinates>::const_iterator itEnd = value.constEnd();
+    GeoDataLineStringPrivate const *const other = value.p();
+    if ( d->m_compact && other->m_compact ) {
+        if ( d->m_compactAltitudes.isEmpty() != other->m_compactAltitudes.isEmpty() ) {
+            if ( d->m_compactAltitudes.isEmpty() )
+                d->m_compactAltitudes.fill( 0.0, d->m_compactNodes.size() );
+            else
+                d->m_compactAltitudes += QVector<float>( other->m_compactNodes.size(), 0.0 );
+        }
+        d->m_compactNodes += other->m_compactNodes;
+        if ( !other->m_compactAltitudes.isEmpty() )
+            d->m_compactAltitudes += other->m_compactAltitudes;
+        d->m_expandedNodes.clear();
+
+        return *this;
+    }
 
-    for( ; itCoords != itEnd; ++itCoords ) {
-        d->m_vector.append( *itCoords );
+    const int size = value.size();
+    for ( int i = 0; i < size; ++i ) {
+        d->append( other->node( i ) );
     }
 
     return *this;
@@ -253,6 +508,7 @@ GeoDataLineString& GeoDataLineString::operator << ( const GeoDataLineString& val
 void GeoDataLineString::clear()
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
@@ -260,6 +516,9 @@ void GeoDataLineString::clear()
     d->m_dirtyBox = true;
 
     d->m_vector.clear();
+    d->m_compactNodes.clear();
+    d->m_compactAltitudes.clear();
+    d->m_expandedNodes.clear();
 }
 
 bool GeoDataLineString::isClosed() const
@@ -275,6 +534,7 @@ bool GeoDataLineString::tessellate() const
 void GeoDataLineString::setTessellate( bool tessellate )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     // According to the KML reference the tesselation of line strings in Google Earth
     // is generally done along great circles. However for subsequent points that share
     // the same latitude the latitude circles are followed. Our Tesselate and RespectLatitude
@@ -287,6 +547,7 @@ void GeoDataLineString::setTessellate( bool tessellate )
         p()->m_tessellationFlags ^= Tessellate;
         p()->m_tessellationFlags ^= RespectLatitudeCircle;
     }
+    p()->m_dirtyRange = true;
 }
 
 TessellationFlags GeoDataLineString::tessellationFlags() const
@@ -296,7 +557,10 @@ TessellationFlags GeoDataLineString::tessellationFlags() const
 
 void GeoDataLineString::setTessellationFlags( TessellationFlags f )
 {
+    GeoDataGeometry::detach();
+    p()->markModified();
     p()->m_tessellationFlags = f;
+    p()->m_dirtyRange = true;
 }
 
 GeoDataLineString GeoDataLineString::toNormalized() const
@@ -310,17 +574,13 @@ GeoDataLineString GeoDataLineString::toNormalized() const
 
     // FIXME: Think about how we can avoid unnecessary copies
     //        if the linestring stays the same.
-    QVector<GeoDataCoordinates>::const_iterator end = p()->m_vector.constEnd();
-    for( QVector<GeoDataCoordinates>::const_iterator itCoords
-          = p()->m_vector.constBegin();
-         itCoords != end;
-         ++itCoords ) {
+    for ( int i = 0; i < size(); ++i ) {
+        GeoDataCoordinates normalizedCoords = p()->node( i );
 
-        itCoords->geoCoordinates( lon, lat );
-        qreal alt = itCoords->altitude();
+        normalizedCoords.geoCoordinates( lon, lat );
+        qreal alt = normalizedCoords.altitude();
         GeoDataCoordinates::normalizeLonLat( lon, lat );
 
-        GeoDataCoordinates normalizedCoords( *itCoords );
         normalizedCoords.set( lon, lat, alt );
         normalizedLineString << normalizedCoords;
     }
@@ -367,28 +627,31 @@ GeoDataLineString GeoDataLineString::toPoleCorrected() const
 void GeoDataLineStringPrivate::toPoleCorrected( const GeoDataLineString& q, GeoDataLineString& poleCorrected )
 {
     poleCorrected.setTessellationFlags( q.tessellationFlags() );
+    // the corrected copy is kept by toRangeCorrected(), so keep it as small as the original
+    poleCorrected.setCompact( q.isCompact() );
 
     GeoDataCoordinates previousCoords;
     GeoDataCoordinates currentCoords;
 
-    if ( q.isClosed() ) {
-        if ( !( m_vector.first().isPole() ) &&
-              ( m_vector.last().isPole() ) ) {
-                qreal firstLongitude = ( m_vector.first() ).longitude();
-                GeoDataCoordinates modifiedCoords( m_vector.last() );
+    const int size = q.size();
+
+    if ( q.isClosed() && size > 0 ) {
+        const GeoDataCoordinates firstCoords = node( 0 );
+        const GeoDataCoordinates lastCoords = node( size - 1 );
+        if ( !( firstCoords.isPole() ) &&
+              ( lastCoords.isPole() ) ) {
+                qreal firstLongitude = firstCoords.longitude();
+                GeoDataCoordinates modifiedCoords( lastCoords );
                 modifiedCoords.setLongitude( firstLongitude );
                 poleCorrected << modifiedCoords;
         }
     }
 
-    QVector<GeoDataCoordinates>::const_iterator itCoords = m_vector.constBegin();
-    QVector<GeoDataCoordinates>::const_iterator itEnd = m_vector.constEnd();
-
-    for( ; itCoords != itEnd; ++itCoords ) {
+    for ( int i = 0; i < size; ++i ) {
 
-        currentCoords  = *itCoords;
+        currentCoords  = node( i );
 
-        if ( itCoords == m_vector.constBegin() ) {
+        if ( i == 0 ) {
             previousCoords = currentCoords;
         }
 
@@ -419,11 +682,13 @@ void GeoDataLineStringPrivate::toPoleCorrected( const GeoDataLineString& q, GeoD
         previousCoords = currentCoords;
     }
 
-    if ( q.isClosed() ) {
-        if (  ( m_vector.first().isPole() ) &&
-             !( m_vector.last().isPole() ) ) {
-                qreal lastLongitude = ( m_vector.last() ).longitude();
-                GeoDataCoordinates modifiedCoords( m_vector.first() );
+    if ( q.isClosed() && size > 0 ) {
+        const GeoDataCoordinates firstCoords = node( 0 );
+        const GeoDataCoordinates lastCoords = node( size - 1 );
+        if (  ( firstCoords.isPole() ) &&
+             !( lastCoords.isPole() ) ) {
+                qreal lastLongitude = lastCoords.longitude();
+                GeoDataCoordinates modifiedCoords( firstCoords );
                 modifiedCoords.setLongitude( lastLongitude );
                 poleCorrected << modifiedCoords;
         }
@@ -437,10 +702,10 @@ void GeoDataLineStringPrivate::toDateLineCorrected(
 {
     const bool isClosed = q.isClosed();
 
-    const QVector<GeoDataCoordinates>::const_iterator itStartPoint = q.constBegin();
-    const QVector<GeoDataCoordinates>::const_iterator itEndPoint = q.constEnd();
-    QVector<GeoDataCoordinates>::const_iterator itPoint = itStartPoint;
-    QVector<GeoDataCoordinates>::const_iterator itPreviousPoint = itPoint;
+    // The nodes are decoded one by one, so a compact line string stays compact
+    const int size = q.size();
+    GeoDataCoordinates point;
+    GeoDataCoordinates previousPoint;
 
     TessellationFlags f = q.tessellationFlags();
 
@@ -455,12 +720,13 @@ void GeoDataLineStringPrivate::toDateLineCorrected(
 
     bool unfinished = false;
 
-    for (; itPoint != itEndPoint; ++itPoint ) {
-        currentLon = itPoint->longitude();
+    for ( int i = 0; i < size; ++i ) {
+        point = node( i );
+        currentLon = point.longitude();
 
         int currentSign = ( currentLon < 0.0 ) ? -1 : +1 ;
 
-        if( itPoint == q.constBegin() ) {
+        if( i == 0 ) {
             previousSign = currentSign;
             previousLon  = currentLon;
         }
@@ -473,7 +739,7 @@ void GeoDataLineStringPrivate::toDateLineCorrected(
             GeoDataCoordinates previousTemp;
             GeoDataCoordinates currentTemp;
 
-            interpolateDateLine( *itPreviousPoint, *itPoint,
+            interpolateDateLine( previousPoint, point,
                                  previousTemp, currentTemp, q.tessellationFlags() );
 
             *dateLineCorrected << previousTemp;
@@ -507,16 +773,16 @@ void GeoDataLineStringPrivate::toDateLineCorrected(
             }
 
             *dateLineCorrected << currentTemp;
-            *dateLineCorrected << *itPoint;
+            *dateLineCorrected << point;
 
         }
         else {
-            *dateLineCorrected << *itPoint;
+            *dateLineCorrected << point;
         }
 
         previousSign = currentSign;
         previousLon  = currentLon;
-        itPreviousPoint = itPoint;
+        previousPoint = point;
     }
 
     // If the line string doesn't cross the dateline an even number of times
@@ -550,12 +816,17 @@ qreal GeoDataLineString::length( qreal planetRadius, int offset ) const
     }
 
     qreal length = 0.0;
-    QVector<GeoDataCoordinates> const & vector = p()->m_vector;
     int const start = qMax(offset+1, 1);
-    int const end = p()->m_vector.size();
+    int const end = size();
+    qreal previousLon, previousLat;
+    geoCoordinates( start - 1, previousLon, previousLat );
     for( int i=start; i<end; ++i )
     {
-        length += distanceSphere( vector[i-1], vector[i] );
+        qreal lon, lat;
+        geoCoordinates( i, lon, lat );
+        length += distanceSphere( previousLon, previousLat, lon, lat );
+        previousLon = lon;
+        previousLat = lat;
     }
 
     return planetRadius * length;
@@ -564,11 +835,13 @@ qreal GeoDataLineString::length( qreal planetRadius, int offset ) const
 QVector<GeoDataCoordinates>::Iterator GeoDataLineString::erase ( QVector<GeoDataCoordinates>::Iterator pos )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->expand();
     return d->m_vector.erase( pos );
 }
 
@@ -576,20 +849,24 @@ QVector<GeoDataCoordinates>::Iterator GeoDataLineString::erase ( QVector<GeoData
                                                                  QVector<GeoDataCoordinates>::Iterator end )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     delete d->m_rangeCorrected;
     d->m_rangeCorrected = 0;
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->expand();
     return d->m_vector.erase( begin, end );
 }
 
 void GeoDataLineString::remove ( int i )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataLineStringPrivate* d = p();
     d->m_dirtyRange = true;
     d->m_dirtyBox = true;
+    d->expand();
     d->m_vector.remove( i );
 }
 
@@ -600,6 +877,16 @@ void GeoDataLineString::pack( QDataStream& stream ) const
     stream << size();
     stream << (qint32)(p()->m_tessellationFlags);
 
+    if ( p()->m_compact ) {
+        // same layout as GeoDataCoordinates::pack()
+        for( int i = 0; i < size(); ++i ) {
+            qreal lon, lat;
+            geoCoordinates( i, lon, lat );
+            stream << lon << lat << altitude( i );
+        }
+        return;
+    }
+
     for( QVector<GeoDataCoordinates>::const_iterator iterator
           = p()->m_vector.constBegin();
          iterator != p()->m_vector.constEnd();
@@ -614,6 +901,7 @@ void GeoDataLineString::pack( QDataStream& stream ) const
 void GeoDataLineString::unpack( QDataStream& stream )
 {
     GeoDataGeometry::detach();
+    p()->markModified();
     GeoDataGeometry::unpack( stream );
     qint32 size;
     qint32 tessellationFlags;
@@ -626,7 +914,7 @@ void GeoDataLineString::unpack( QDataStream& stream )
     for(qint32 i = 0; i < size; i++ ) {
         GeoDataCoordinates coord;
         coord.unpack( stream );
-        p()->m_vector.append( coord );
+        p()->append( coord );
     }
 }
 
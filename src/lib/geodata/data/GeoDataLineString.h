@@ -217,6 +217,65 @@ class GEODATA_EXPORT GeoDataLineString : public GeoDataGeometry
     int size() const;
 
 
+/*!
+    \brief Returns the longitude and latitude of a node in radian.
+    Unlike at(), this method doesn't decode the nodes of a compact LineString.
+*/
+    void geoCoordinates( int pos, qreal &lon, qreal &lat ) const;
+
+
+/*!
+    \brief Returns the node at position \a pos.
+    Unlike at(), this method decodes a node of a compact LineString on the
+    fly, without keeping a decoded copy of all nodes around.
+*/
+    GeoDataCoordinates coordinates( int pos ) const;
+
+
+/*!
+    \brief Returns a number identifying the current nodes and tessellation flags.
+    The revision changes whenever the LineString gets accessed for modification,
+    and it is unique among all LineStrings, so it can be used to recognize the
+    LineString data that cached results have been computed from.
+*/
+    int revision() const;
+
+
+/*!
+    \brief Returns the altitude of a node in meters.
+    Unlike at(), this method doesn't decode the nodes of a compact LineString.
+*/
+    qreal altitude( int pos ) const;
+
+
+/*!
+    \brief Returns whether the nodes are stored compactly.
+    \see setCompact()
+*/
+    bool isCompact() const;
+
+
+/*!
+    \brief Sets whether the nodes are stored compactly.
+
+    A compact LineString stores longitude and latitude of its nodes as fixed
+    point numbers with a resolution of about 2 cm, and the altitude as a float
+    if any node has one. That takes less than a tenth of the memory of
+    GeoDataCoordinates objects and avoids one allocation per node, which pays
+    off for large amounts of geometry like OpenStreetMap data.
+
+    Nodes with a detail level can't be stored compactly. Appending such a node,
+    or accessing the nodes through non-const methods returning references or
+    iterators, turns the nodes into GeoDataCoordinates again. The const
+    accessors returning references keep the LineString compact, but decode
+    the nodes into a separate copy which is kept until the nodes change.
+    size(), latLonAltBox(), length(), geoCoordinates(), coordinates(),
+    altitude(), appending and the projection onto the screen work on the
+    compact nodes directly.
+*/
+    void setCompact( bool compact );
+
+
 /*!
     \brief Returns a reference to the coordinates of a node at a given position.
     This method detaches the returned coordinate object from the line string.
@@ -279,6 +338,22 @@ class GEODATA_EXPORT GeoDataLineString : public GeoDataGeometry
     void append ( const GeoDataCoordinates& position );
 
 
+/*!
+    \brief Appends a new node at \a lon, \a lat (in radian) and \a altitude (in meters).
+    Unlike append( const GeoDataCoordinates& ), this method doesn't create
+    GeoDataCoordinates for the nodes of a compact LineString.
+*/
+    void append ( qreal lon, qreal lat, qreal altitude = 0.0 );
+
+
+/*!
+    \brief Attempts to allocate memory for at least \a size nodes.
+    Use this method before appending a large number of nodes whose amount
+    is known in advance, to avoid repeated reallocations.
+*/
+    void reserve( int size );
+
+
 /*!
     \brief Appends a given geodesic position as a new node to the LineString.
 */
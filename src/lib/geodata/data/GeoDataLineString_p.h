@@ -11,6 +11,8 @@
 #ifndef MARBLE_GEODATALINESTRINGPRIVATE_H
 #define MARBLE_GEODATALINESTRINGPRIVATE_H
 
+#include <QtCore/QMutex>
+
 #include "GeoDataGeometry_p.h"
 
 #include "GeoDataTypes.h"
@@ -25,14 +27,18 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
         :  m_rangeCorrected( 0 ),
            m_dirtyRange( true ),
            m_dirtyBox( true ),
-           m_tessellationFlags( f )
+           m_tessellationFlags( f ),
+           m_compact( false ),
+           m_revision( nextRevision() )
     {
     }
 
     GeoDataLineStringPrivate()
          : m_rangeCorrected( 0 ),
            m_dirtyRange( true ),
-           m_dirtyBox( true )
+           m_dirtyBox( true ),
+           m_compact( false ),
+           m_revision( nextRevision() )
     {
     }
 
@@ -50,6 +56,11 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
         m_latLonAltBox = other.m_latLonAltBox;
         m_dirtyBox = other.m_dirtyBox;
         m_tessellationFlags = other.m_tessellationFlags;
+        m_compact = other.m_compact;
+        m_compactNodes = other.m_compactNodes;
+        m_compactAltitudes = other.m_compactAltitudes;
+        m_expandedNodes.clear();
+        m_revision = other.m_revision;
     }
 
 
@@ -85,6 +96,64 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
                        const GeoDataCoordinates & currentCoords,
                        int recursionCounter );
 
+    /**
+     * Returns a new revision number, unique among all line strings.
+     */
+    static int nextRevision();
+
+    /**
+     * Assigns a new revision, to be called whenever the nodes or flags change.
+     */
+    void markModified();
+
+    struct CompactNode
+    {
+        qint32 lon;
+        qint32 lat;
+    };
+
+    /**
+     * Appends @p coordinates to the nodes, as a compact node if possible.
+     */
+    void append( const GeoDataCoordinates &coordinates );
+
+    /**
+     * Appends the node at @p lon, @p lat (in radian) and @p altitude,
+     * without creating GeoDataCoordinates if it can be stored compactly.
+     */
+    void append( qreal lon, qreal lat, qreal altitude );
+
+    void appendCompactNode( const CompactNode &node, qreal altitude );
+
+    /**
+     * Moves the nodes from m_vector to m_compactNodes.
+     * Returns false if some node can't be stored compactly.
+     */
+    bool compact();
+
+    /**
+     * Turns the compact nodes into GeoDataCoordinates again.
+     */
+    void expand();
+
+    /**
+     * Returns the nodes as GeoDataCoordinates for read-only access.
+     * Compact nodes are decoded into m_expandedNodes once and stay compact,
+     * so data shared between copies is never modified.
+     */
+    const QVector<GeoDataCoordinates> &nodes();
+
+    /**
+     * Returns the node at @p pos, decoding it if it is stored compactly.
+     */
+    GeoDataCoordinates node( int pos ) const;
+
+    static bool toCompactNode( const GeoDataCoordinates &coordinates, CompactNode &node );
+
+    static bool toCompactNode( qreal lon, qreal lat, CompactNode &node );
+
+    static GeoDataCoordinates fromCompactNode( const CompactNode &node, qreal altitude );
+
     QVector<GeoDataCoordinates> m_vector;
 
     GeoDataLineString*          m_rangeCorrected;
@@ -94,8 +163,19 @@ class GeoDataLineStringPrivate : public GeoDataGeometryPrivate
                                             // GeoDataPoints since the LatLonAltBox has 
                                             // been calculated. Saves performance. 
     TessellationFlags           m_tessellationFlags;
+
+    bool                        m_compact; // whether the nodes are stored in m_compactNodes
+                                           // instead of m_vector
+    QVector<CompactNode>        m_compactNodes;
+    QVector<float>              m_compactAltitudes; // empty as long as all altitudes are 0
+    QVector<GeoDataCoordinates> m_expandedNodes; // decoded copy of m_compactNodes for const access
+    QMutex                      m_expandedNodesMutex;
+
+    int                         m_revision; // see GeoDataLineString::revision()
 };
 
 } // namespace Marble
 
+Q_DECLARE_TYPEINFO( Marble::GeoDataLineStringPrivate::CompactNode, Q_PRIMITIVE_TYPE );
+
 #endif
@@ -68,6 +68,7 @@ GeoDataPoint::~GeoDataPoint()
 
 void GeoDataPoint::setCoordinates( const GeoDataCoordinates &coordinates )
 {
+    detach();
     p()->m_coordinates = coordinates;
     p()->m_latLonAltBox = GeoDataLatLonAltBox( p()->m_coordinates );
 }
@@ -27,6 +27,9 @@ GeoLineStringGraphicsItem::GeoLineStringGraphicsItem( const GeoDataFeature *feat
 
 void GeoLineStringGraphicsItem::setLineString( const GeoDataLineString* lineString )
 {
+    if ( lineString != m_lineString ) {
+        m_screenPolygons.clear();
+    }
     m_lineString = lineString;
 }
 
@@ -84,7 +87,13 @@ void GeoLineStringGraphicsItem::paint( GeoPainter* painter, const ViewportParams
         }
     }
 
-    painter->drawPolyline( *m_lineString );
+    // Like GeoPainter::drawPolyline( GeoDataLineString ), keeping the screen coordinates
+    const GeoDataLatLonAltBox &latLonAltBox = m_lineString->latLonAltBox();
+    if ( viewport->viewLatLonAltBox().intersects( latLonAltBox ) && viewport->resolves( latLonAltBox ) ) {
+        foreach( const QPolygonF &polygon, m_screenPolygons.polygons( *m_lineString, viewport ) ) {
+            painter->drawPolyline( polygon );
+        }
+    }
 
     painter->restore();
 }
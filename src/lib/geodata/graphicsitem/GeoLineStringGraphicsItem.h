@@ -13,6 +13,7 @@
 
 #include "GeoGraphicsItem.h"
 #include "marble_export.h"
+#include "ScreenPolygonCache.h"
 
 namespace Marble
 {
@@ -33,6 +34,9 @@ public:
 
 protected:
     const GeoDataLineString *m_lineString;
+
+private:
+    ScreenPolygonCache m_screenPolygons;
 };
 
 }
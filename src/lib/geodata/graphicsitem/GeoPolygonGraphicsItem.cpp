@@ -46,8 +46,6 @@ const GeoDataLatLonAltBox& GeoPolygonGraphicsItem::latLonAltBox() const
 
 void GeoPolygonGraphicsItem::paint( GeoPainter* painter, const ViewportParams* viewport )
 {
-    Q_UNUSED( viewport );
-
     painter->save();
 
     if ( !style() ) {
@@ -94,10 +92,27 @@ void GeoPolygonGraphicsItem::paint( GeoPainter* painter, const ViewportParams* v
         }
     }
 
+    // Like GeoPainter::drawPolygon(), keeping the screen coordinates
     if ( m_polygon ) {
-        painter->drawPolygon( *m_polygon );
+        const GeoDataLatLonAltBox &latLonAltBox = m_polygon->outerBoundary().latLonAltBox();
+        if ( viewport->viewLatLonAltBox().intersects( latLonAltBox ) && viewport->resolves( latLonAltBox ) ) {
+            const QVector<GeoDataLinearRing> &innerBoundaries = m_polygon->innerBoundaries();
+            m_innerPolygons.resize( innerBoundaries.size() );
+            QVector< QVector<QPolygonF> > innerPolygons;
+            for ( int i = 0; i < innerBoundaries.size(); ++i ) {
+                innerPolygons << m_innerPolygons[i].polygons( innerBoundaries[i], viewport );
+            }
+
+            painter->drawPolygon( m_outerPolygons.polygons( m_polygon->outerBoundary(), viewport ), innerPolygons );
+        }
     } else if ( m_ring ) {
-        painter->drawPolygon( *m_ring );
+        // The outline of rings crossing the date line is drawn separately, leave that to the painter
+        const GeoDataLatLonAltBox &latLonAltBox = m_ring->latLonAltBox();
+        if ( latLonAltBox.crossesDateLine() ) {
+            painter->drawPolygon( *m_ring );
+        } else if ( viewport->viewLatLonAltBox().intersects( latLonAltBox ) && viewport->resolves( latLonAltBox ) ) {
+            painter->drawPolygon( m_outerPolygons.polygons( *m_ring, viewport ), QVector< QVector<QPolygonF> >() );
+        }
     }
 
     painter->restore();
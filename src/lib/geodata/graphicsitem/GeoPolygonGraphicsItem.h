@@ -13,6 +13,9 @@
 
 #include "GeoGraphicsItem.h"
 #include "marble_export.h"
+#include "ScreenPolygonCache.h"
+
+#include <QtCore/QVector>
 
 namespace Marble
 {
@@ -33,6 +36,10 @@ public:
 protected:
     const GeoDataPolygon *const m_polygon;
     const GeoDataLinearRing *const m_ring;
+
+private:
+    ScreenPolygonCache m_outerPolygons;
+    QVector<ScreenPolygonCache> m_innerPolygons;
 };
 
 }
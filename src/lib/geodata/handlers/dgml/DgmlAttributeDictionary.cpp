@@ -31,6 +31,7 @@ namespace dgml
 
 const char* dgmlAttr_nameSpace20 = "http://edu.kde.org/marble/dgml/2.0";
 
+const char* dgmlAttr_archive          = "archive";
 const char* dgmlAttr_attribution      = "attribution";
 const char* dgmlAttr_backend          = "backend";
 const char* dgmlAttr_bgcolor          = "bgcolor";
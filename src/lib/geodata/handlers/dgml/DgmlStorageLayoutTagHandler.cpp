@@ -26,7 +26,7 @@
 #include "DgmlAttributeDictionary.h"
 #include "DgmlElementDictionary.h"
 #include "GeoParser.h"
-#include "GeoSceneTiled.h"
+#include "GeoSceneTextureTile.h"
 #include "ServerLayout.h"
 
 namespace Marble
@@ -96,6 +96,12 @@ GeoNode* DgmlStorageLayoutTagHandler::parse(GeoParser& parser) const
         texture->setMaximumTileLevel( maximumTileLevel );
         texture->setStorageLayout( storageLayout );
         texture->setServerLayout( serverLayout );
+
+        // Attribute archive
+        if ( parentItem.represents(dgmlTag_Texture) ) {
+            GeoSceneTextureTile *textureTile = parentItem.nodeAs<GeoSceneTextureTile>();
+            textureTile->setArchive( parser.attribute(dgmlAttr_archive).trimmed() );
+        }
     }
 
     return 0;
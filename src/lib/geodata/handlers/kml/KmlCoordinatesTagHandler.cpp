@@ -21,6 +21,7 @@
 
 #include "KmlCoordinatesTagHandler.h"
 
+#include <QtCore/QByteArray>
 #include <QtCore/QStringList>
 #include <QtCore/QRegExp>
 
@@ -51,6 +52,371 @@ static const bool kmlStrictSpecs = false;
 static GeoTagHandlerRegistrar s_handlercoordkmlTag_nameSpaceGx22(GeoParser::QualifiedName(kmlTag_coord, kmlTag_nameSpaceGx22 ),
                                                                  new KmlcoordinatesTagHandler());
 
+/**
+ * Reads the tuples of a coordinates element and passes them on to the parent
+ * element as they are encountered.
+ *
+ * The text is processed in a single pass while it is read from the XML stream,
+ * without any intermediate strings. Tuples are separated by whitespace, the
+ * numbers within a tuple by commas. Whitespace around commas is tolerated.
+ */
+class CoordinatesParser
+{
+public:
+    explicit CoordinatesParser( const GeoStackItem &parentItem );
+
+    void read( GeoParser &parser );
+
+private:
+    enum Target {
+        PlacemarkTarget,
+        LineStringTarget,
+        MultiGeometryTarget,
+        ModelTarget,
+        PointTarget,
+        LatLonQuadTarget,
+        NoTarget
+    };
+
+    void feed( const QChar *data, int size );
+    void endNumber();
+    void endTuple();
+    void addCoordinates( const qreal *values, int count );
+    void reserve( const QChar *data, int size );
+
+    static bool parseNumber( const char *data, int size, qreal &value );
+
+    // Longer numbers are considered invalid, which yields 0 like QString::toDouble()
+    static const int maxNumberLength = 64;
+
+    const GeoStackItem m_parentItem;
+    Target m_target;
+    GeoDataLineString *m_lineString;
+    int m_coordinatesIndex;
+
+    char m_number[maxNumberLength];
+    int m_numberLength;
+    bool m_numberValid;
+
+    qreal m_values[3];
+    int m_valueCount;
+
+    bool m_inTuple;
+    bool m_afterComma;
+    bool m_afterSpace;
+    bool m_reserved;
+};
+
+static inline bool isSpace( const QChar &c )
+{
+    const ushort u = c.unicode();
+    return u == ' ' || ( u >= '\t' && u <= '\r' ) || ( u > 127 && c.isSpace() );
+}
+
+CoordinatesParser::CoordinatesParser( const GeoStackItem &parentItem )
+    : m_parentItem( parentItem ),
+      m_target( NoTarget ),
+      m_lineString( 0 ),
+      m_coordinatesIndex( 0 ),
+      m_numberLength( 0 ),
+      m_numberValid( true ),
+      m_valueCount( 0 ),
+      m_inTuple( false ),
+      m_afterComma( false ),
+      m_afterSpace( false ),
+      m_reserved( false )
+{
+    if ( parentItem.represents( kmlTag_Point ) && parentItem.is<GeoDataFeature>() ) {
+        m_target = PlacemarkTarget;
+    } else if ( parentItem.represents( kmlTag_LineString ) ) {
+        m_target = LineStringTarget;
+        m_lineString = parentItem.nodeAs<GeoDataLineString>();
+    } else if ( parentItem.represents( kmlTag_LinearRing ) ) {
+        m_target = LineStringTarget;
+        m_lineString = parentItem.nodeAs<GeoDataLinearRing>();
+    } else if ( parentItem.represents( kmlTag_MultiGeometry ) ) {
+        m_target = MultiGeometryTarget;
+    } else if ( parentItem.represents( kmlTag_Model ) ) {
+        m_target = ModelTarget;
+    } else if ( parentItem.represents( kmlTag_Point ) ) {
+        // photo overlay
+        m_target = PointTarget;
+    } else if ( parentItem.represents( kmlTag_LatLonQuad ) ) {
+        m_target = LatLonQuadTarget;
+    }
+}
+
+void CoordinatesParser::read( GeoParser &parser )
+{
+    // Like QXmlStreamReader::readElementText(), but handing over
+    // each piece of text as soon as it has been read.
+    while ( !parser.atEnd() ) {
+        parser.readNext();
+
+        if ( parser.isCharacters() || parser.isEntityReference() ) {
+            const QStringRef text = parser.text();
+            reserve( text.unicode(), text.size() );
+            feed( text.unicode(), text.size() );
+        } else if ( parser.isEndElement() ) {
+            break;
+        } else if ( parser.isStartElement() ) {
+            parser.raiseError( QString( "Expected character data." ) );
+            break;
+        }
+    }
+
+    if ( m_inTuple ) {
+        endTuple();
+    }
+}
+
+void CoordinatesParser::feed( const QChar *data, int size )
+{
+    const QChar *const end = data + size;
+
+    for ( ; data != end; ++data ) {
+        const ushort c = data->unicode();
+
+        if ( isSpace( *data ) ) {
+            // Whitespace following a comma still belongs to the tuple
+            if ( m_inTuple && !m_afterComma ) {
+                m_afterSpace = true;
+            }
+        } else if ( c == ',' ) {
+            m_inTuple = true;
+            m_afterSpace = false;
+            m_afterComma = true;
+            endNumber();
+        } else {
+            if ( m_afterSpace ) {
+                endTuple();
+            }
+
+            m_inTuple = true;
+            m_afterComma = false;
+
+            if ( c < 128 && m_numberLength < maxNumberLength ) {
+                m_number[m_numberLength++] = c;
+            } else {
+                m_numberValid = false;
+            }
+        }
+    }
+}
+
+void CoordinatesParser::endNumber()
+{
+    qreal value = 0.0;
+    if ( m_numberValid && !parseNumber( m_number, m_numberLength, value ) ) {
+        value = QByteArray( m_number, m_numberLength ).toDouble();
+    }
+
+    if ( m_valueCount < 3 ) {
+        m_values[m_valueCount] = value;
+    }
+    ++m_valueCount;
+
+    m_numberLength = 0;
+    m_numberValid = true;
+}
+
+void CoordinatesParser::endTuple()
+{
+    endNumber();
+    addCoordinates( m_values, m_valueCount );
+
+    m_valueCount = 0;
+    m_inTuple = false;
+    m_afterComma = false;
+    m_afterSpace = false;
+}
+
+void CoordinatesParser::addCoordinates( const qreal *values, int count )
+{
+    if ( m_target == PlacemarkTarget ) {
+        GeoDataCoordinates coord;
+        if ( count == 2 ) {
+            coord.set( values[0], values[1], 0.0, GeoDataCoordinates::Degree );
+        } else if( count == 3 ) {
+            coord.set( values[0], values[1], values[2], GeoDataCoordinates::Degree );
+        }
+        m_parentItem.nodeAs<GeoDataPlacemark>()->setCoordinate( coord );
+    } else {
+        GeoDataCoordinates coord;
+        if ( count == 2 ) {
+            coord.set( DEG2RAD * values[0], DEG2RAD * values[1] );
+        } else if( count == 3 ) {
+            coord.set( DEG2RAD * values[0], DEG2RAD * values[1], values[2] );
+        }
+
+        switch ( m_target ) {
+        case LineStringTarget:
+            m_lineString->append( coord );
+            break;
+        case MultiGeometryTarget:
+            m_parentItem.nodeAs<GeoDataMultiGeometry>()->append( new GeoDataPoint( coord ) );
+            break;
+        case ModelTarget:
+            m_parentItem.nodeAs<GeoDataModel>()->setCoordinates( coord );
+            break;
+        case PointTarget:
+            m_parentItem.nodeAs<GeoDataPoint>()->setCoordinates( coord );
+            break;
+        case LatLonQuadTarget:
+            switch ( m_coordinatesIndex ) {
+            case 0:
+                m_parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomLeft( coord );
+                break;
+            case 1:
+                m_parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomRight( coord );
+                break;
+            case 2:
+                m_parentItem.nodeAs<GeoDataLatLonQuad>()->setTopRight( coord );
+                break;
+            case 3:
+                m_parentItem.nodeAs<GeoDataLatLonQuad>()->setTopLeft( coord );
+                break;
+            case 4:
+                mDebug() << "Ignoring excessive coordinates in LatLonQuad (must not have more than 4 pairs)";
+                break;
+            default:
+                // Silently ignore any more coordinates
+                break;
+            }
+            break;
+        default:
+            // raise warning as coordinates out of valid parents found
+            break;
+        }
+    }
+
+    ++m_coordinatesIndex;
+}
+
+void CoordinatesParser::reserve( const QChar *data, int size )
+{
+    // The text usually arrives in one piece. Reserving again for further
+    // pieces could reallocate the nodes for every single one of them.
+    if ( !m_lineString || m_reserved ) {
+        return;
+    }
+
+    m_reserved = true;
+
+    // Count the tuples the same way as feed() does, without parsing them
+    int count = 0;
+    bool inTuple = m_inTuple;
+    bool afterComma = m_afterComma;
+    bool afterSpace = m_afterSpace;
+
+    const QChar *const end = data + size;
+    for ( ; data != end; ++data ) {
+        if ( isSpace( *data ) ) {
+            afterSpace = afterSpace || ( inTuple && !afterComma );
+        } else if ( *data == QLatin1Char( ',' ) ) {
+            if ( !inTuple ) {
+                ++count;
+            }
+            inTuple = true;
+            afterSpace = false;
+            afterComma = true;
+        } else {
+            if ( !inTuple || afterSpace ) {
+                ++count;
+            }
+            inTuple = true;
+            afterSpace = false;
+            afterComma = false;
+        }
+    }
+
+    m_lineString->reserve( m_lineString->size() + count );
+}
+
+bool CoordinatesParser::parseNumber( const char *data, int size, qreal &value )
+{
+    // Decimal numbers with up to 15 significant digits and a small exponent
+    // are exactly representable before the final multiplication or division,
+    // which therefore yields the correctly rounded result. Anything else is
+    // left to QByteArray::toDouble().
+    static const double powersOfTen[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+
+    const char *const end = data + size;
+
+    bool negative = false;
+    if ( data != end && ( *data == '-' || *data == '+' ) ) {
+        negative = *data == '-';
+        ++data;
+    }
+
+    quint64 mantissa = 0;
+    int digits = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+
+    for ( ; data != end && *data >= '0' && *data <= '9'; ++data, ++digits ) {
+        if ( mantissa || *data != '0' ) {
+            mantissa = 10 * mantissa + ( *data - '0' );
+            ++significantDigits;
+        }
+    }
+
+    if ( data != end && *data == '.' ) {
+        ++data;
+        for ( ; data != end && *data >= '0' && *data <= '9'; ++data, ++digits ) {
+            if ( mantissa || *data != '0' ) {
+                mantissa = 10 * mantissa + ( *data - '0' );
+                ++significantDigits;
+            }
+            --exponent;
+        }
+    }
+
+    if ( digits == 0 || significantDigits > 15 ) {
+        return false;
+    }
+
+    if ( data != end && ( *data == 'e' || *data == 'E' ) ) {
+        ++data;
+        bool negativeExponent = false;
+        if ( data != end && ( *data == '-' || *data == '+' ) ) {
+            negativeExponent = *data == '-';
+            ++data;
+        }
+
+        if ( data == end ) {
+            return false;
+        }
+
+        int explicitExponent = 0;
+        for ( ; data != end && *data >= '0' && *data <= '9'; ++data ) {
+            if ( explicitExponent > 1000 ) {
+                return false;
+            }
+            explicitExponent = 10 * explicitExponent + ( *data - '0' );
+        }
+
+        exponent += negativeExponent ? -explicitExponent : explicitExponent;
+    }
+
+    if ( data != end || exponent < -22 || exponent > 22 ) {
+        return false;
+    }
+
+    double result = mantissa;
+    if ( exponent < 0 ) {
+        result /= powersOfTen[-exponent];
+    } else {
+        result *= powersOfTen[exponent];
+    }
+
+    value = negative ? -result : result;
+    return true;
+}
+
 GeoNode* KmlcoordinatesTagHandler::parse( GeoParser& parser ) const
 {
     Q_ASSERT( parser.isStartElement()
@@ -64,112 +430,8 @@ GeoNode* KmlcoordinatesTagHandler::parse( GeoParser& parser ) const
      || parentItem.represents( kmlTag_MultiGeometry )
      || parentItem.represents( kmlTag_LinearRing )
      || parentItem.represents( kmlTag_LatLonQuad ) ) {
-        QStringList  coordinatesLines;// = parser.readElementText().trimmed().split( QRegExp("\\s"), QString::SkipEmptyParts );
-        // Splitting using the "\\s" regexp is slow, split manually instead.
-        QString text = parser.readElementText().trimmed();
-
-        if ( !kmlStrictSpecs ) {
-            // Removing spaces before and after commas
-            for ( int i = 1; i < text.size() - 1; ++i ) {
-                if ( text[i] == ',' ) {
-                    // Before
-                    int l = i - 1;
-                    while ( l > 0 && text[l].isSpace() ) {
-                        --l;
-                    }
-
-                    // After
-                    int r = i + 1;
-                    while ( r < text.size() && text[r].isSpace() ) {
-                        ++r;
-                    }
-
-                    text.remove( l + 1, r - l - 1 ).insert( l + 1, ',' );
-                }
-            }
-        }
-
-        int index = 0;
-        bool inside = true;
-        int const size = text.size();
-        for ( int i=0; i<size; ++i ) {
-            if ( text[i].isSpace() ) {
-                if ( inside ) {
-                    coordinatesLines.append( text.mid( index, i-index ) );
-                    inside = false;
-                }
-                index = i+1;
-            } else {
-                inside = true;
-            }
-        }
-        coordinatesLines.append( text.mid( index ) );
-        int coordinatesIndex = 0;
-        Q_FOREACH( const QString& line, coordinatesLines ) {
-            QStringList coordinates = line.trimmed().split( ',' );
-            if ( parentItem.represents( kmlTag_Point ) && parentItem.is<GeoDataFeature>() ) {
-                GeoDataCoordinates coord;
-                if ( coordinates.size() == 2 ) {
-                    coord.set( coordinates.at( 0 ).toDouble(),
-                              coordinates.at( 1 ).toDouble(), 0.0, GeoDataCoordinates::Degree );
-                } else if( coordinates.size() == 3 ) {
-                    coord.set( coordinates.at( 0 ).toDouble(),
-                               coordinates.at( 1 ).toDouble(),
-                               coordinates.at( 2 ).toDouble(),
-                               GeoDataCoordinates::Degree );
-                }
-                parentItem.nodeAs<GeoDataPlacemark>()->setCoordinate( coord );
-            } else {
-                GeoDataCoordinates coord;
-                if ( coordinates.size() == 2 ) {
-                    coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                              DEG2RAD * coordinates.at( 1 ).toDouble() );
-                } else if( coordinates.size() == 3 ) {
-                    coord.set( DEG2RAD * coordinates.at( 0 ).toDouble(),
-                              DEG2RAD * coordinates.at( 1 ).toDouble(),
-                              coordinates.at( 2 ).toDouble() );
-                }
-
-                if ( parentItem.represents( kmlTag_LineString ) ) {
-                    parentItem.nodeAs<GeoDataLineString>()->append( coord );
-                } else if ( parentItem.represents( kmlTag_LinearRing ) ) {
-                    parentItem.nodeAs<GeoDataLinearRing>()->append( coord );
-                } else if ( parentItem.represents( kmlTag_MultiGeometry ) ) {
-                    GeoDataPoint *point = new GeoDataPoint( coord );
-                    parentItem.nodeAs<GeoDataMultiGeometry>()->append( point );
-                } else if ( parentItem.represents( kmlTag_Model) ) {
-                    parentItem.nodeAs<GeoDataModel>()->setCoordinates( coord);
-                } else if ( parentItem.represents( kmlTag_Point ) ) {
-                    // photo overlay
-                    parentItem.nodeAs<GeoDataPoint>()->setCoordinates( coord );
-                } else if ( parentItem.represents( kmlTag_LatLonQuad ) ) {
-                    switch ( coordinatesIndex ) {
-                    case 0:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomLeft( coord );
-                        break;
-                    case 1:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setBottomRight( coord );
-                        break;
-                    case 2:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setTopRight( coord );
-                        break;
-                    case 3:
-                        parentItem.nodeAs<GeoDataLatLonQuad>()->setTopLeft( coord );
-                        break;
-                    case 4:
-                        mDebug() << "Ignoring excessive coordinates in LatLonQuad (must not have more than 4 pairs)";
-                        break;
-                    default:
-                        // Silently ignore any more coordinates
-                        break;
-                    }
-                } else {
-                    // raise warning as coordinates out of valid parents found
-                }
-            }
-
-            ++coordinatesIndex;
-        }
+        CoordinatesParser coordinatesParser( parentItem );
+        coordinatesParser.read( parser );
     }
 
     if( parentItem.represents( kmlTag_Track ) ) {
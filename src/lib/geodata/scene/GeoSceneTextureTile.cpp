@@ -28,4 +28,14 @@ const char* GeoSceneTextureTile::nodeType() const
     return GeoSceneTypes::GeoSceneTextureTileType;
 }
 
+QString GeoSceneTextureTile::archive() const
+{
+    return m_archive;
+}
+
+void GeoSceneTextureTile::setArchive( const QString &archive )
+{
+    m_archive = archive;
+}
+
 }
@@ -27,6 +27,16 @@ class GeoSceneTextureTile : public GeoSceneTiled
     explicit GeoSceneTextureTile( const QString& name );
 
     virtual const char* nodeType() const;
+
+    /**
+     * The file of the TileArchive holding the tiles, relative to the data
+     * directories. If empty, each tile is stored in a file of its own.
+     */
+    QString archive() const;
+    void setArchive( const QString &archive );
+
+ private:
+    QString m_archive;
 };
 
 }
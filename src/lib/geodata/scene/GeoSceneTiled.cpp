@@ -38,7 +38,7 @@ GeoSceneTiled::GeoSceneTiled( const QString& name )
       m_projection( Equirectangular ),
       m_blending(),
       m_downloadUrls(),
-      m_nextUrl( m_downloadUrls.constEnd() )
+      m_nextUrl( 0 )
 {
 }
 
@@ -184,21 +184,14 @@ QUrl GeoSceneTiled::downloadUrl( const TileId &id ) const
     if ( m_downloadUrls.empty() )
         return m_serverLayout->downloadUrl( QUrl( "http://files.kde.org/marble/" ), id );
 
-    if ( m_nextUrl == m_downloadUrls.constEnd() )
-        m_nextUrl = m_downloadUrls.constBegin();
-
-    const QUrl url = m_serverLayout->downloadUrl( *m_nextUrl, id );
-
-    ++m_nextUrl;
-
-    return url;
+    // the counter may wrap around, hence the unsigned modulo
+    const uint next = uint( m_nextUrl.fetchAndAddOrdered( 1 ) );
+    return m_serverLayout->downloadUrl( m_downloadUrls.at( next % uint( m_downloadUrls.size() ) ), id );
 }
 
 void GeoSceneTiled::addDownloadUrl( const QUrl & url )
 {
     m_downloadUrls.append( url );
-    // FIXME: this could be done only once
-    m_nextUrl = m_downloadUrls.constBegin();
 }
 
 QString GeoSceneTiled::relativeTileFileName( const TileId &id ) const
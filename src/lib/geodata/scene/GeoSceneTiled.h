@@ -15,6 +15,7 @@
 #ifndef MARBLE_GEOSCENETILED_H
 #define MARBLE_GEOSCENETILED_H
 
+#include <QtCore/QAtomicInt>
 #include <QtCore/QList>
 #include <QtCore/QStringList>
 #include <QtCore/QUrl>
@@ -88,6 +89,7 @@ class GEODATA_EXPORT GeoSceneTiled : public GeoSceneAbstractDataset
      *
      * It implements the round robin for the tile servers.
      * On each invocation the next url is returned.
+     * This method is thread-safe, tiles are loaded from several threads.
      */
     QUrl downloadUrl( const TileId & ) const;
     void addDownloadUrl( const QUrl & );
@@ -117,8 +119,8 @@ class GEODATA_EXPORT GeoSceneTiled : public GeoSceneAbstractDataset
     /// List of Urls which are used in a round robin fashion
     QVector<QUrl> m_downloadUrls;
 
-    /// Points to next Url for the round robin algorithm
-    mutable QVector<QUrl>::const_iterator m_nextUrl;
+    /// Counts the download requests for the round robin algorithm
+    mutable QAtomicInt m_nextUrl;
     QList<const DownloadPolicy *> m_downloadPolicies;
 };
 
@@ -12,7 +12,7 @@
 
 #include "GeoSceneTypes.h"
 #include "GeoWriter.h"
-#include "GeoSceneTiled.h"
+#include "GeoSceneTextureTile.h"
 #include "DownloadPolicy.h"
 #include "DgmlElementDictionary.h"
 #include "ServerLayout.h"
@@ -47,6 +47,12 @@ bool DgmlTextureTagWriter::write(const GeoNode *node, GeoWriter& writer) const
         writer.writeAttribute( "levelZeroRows", QString::number( texture->levelZeroRows() ) );
         writer.writeAttribute( "mode", texture->serverLayout()->name() );
     }
+    if ( texture->nodeType() == GeoSceneTypes::GeoSceneTextureTileType ) {
+        const GeoSceneTextureTile *textureTile = static_cast<const GeoSceneTextureTile*>( texture );
+        if ( !textureTile->archive().isEmpty() ) {
+            writer.writeAttribute( "archive", textureTile->archive() );
+        }
+    }
     writer.writeEndElement();
     
     if ( texture->downloadUrls().size() > 0 )
@@ -36,7 +36,9 @@
 namespace Marble
 {
 
-const int REPAINT_SCHEDULING_INTERVAL = 1000;
+// Tiles loaded in the background get shown after this many milliseconds,
+// along with all other tiles loaded meanwhile.
+const int REPAINT_SCHEDULING_INTERVAL = 50;
 
 class TextureLayer::Private
 {
@@ -48,8 +50,12 @@ public:
              TextureLayer *parent );
 
     void requestDelayedRepaint();
+    void updateVectorData();
     void updateTextureLayers();
     void updateTile( const TileId &tileId, const QImage &tileImage );
+    void updateSunShadingConnection();
+    void paintSunShading( GeoPainter *painter, const ViewportParams *viewport );
+    qreal sunShading( const ViewportParams *viewport, int x, int y ) const;
 
 public:
     TextureLayer  *const m_parent;
@@ -65,6 +71,11 @@ public:
     QVector<const GeoSceneTextureTile *> m_textures;
     const GeoSceneGroup *m_textureLayerSettings;
     QString m_runtimeTrace;
+    // The sun shading drawn over the map, kept until the viewport or the sun moves
+    QImage m_shadingImage;
+    int m_shadingGeneration;
+    qreal m_shadingSunLon;
+    qreal m_shadingSunLat;
     // For scheduling repaints
     QTimer           m_repaintTimer;
 
@@ -86,6 +97,10 @@ TextureLayer::Private::Private( HttpDownloadManager *downloadManager,
     , m_texmapper( 0 )
     , m_texcolorizer( 0 )
     , m_textureLayerSettings( 0 )
+    , m_shadingImage()
+    , m_shadingGeneration( 0 )
+    , m_shadingSunLon( 0.0 )
+    , m_shadingSunLat( 0.0 )
     , m_repaintTimer()
 {
 }
@@ -101,6 +116,15 @@ void TextureLayer::Private::requestDelayedRepaint()
     }
 }
 
+void TextureLayer::Private::updateVectorData()
+{
+    if ( m_texcolorizer ) {
+        m_texcolorizer->invalidateCoastImage();
+    }
+
+    requestDelayedRepaint();
+}
+
 void TextureLayer::Private::updateTextureLayers()
 {
     QVector<GeoSceneTextureTile const *> result;
@@ -119,8 +143,9 @@ void TextureLayer::Private::updateTextureLayers()
         }
     }
 
-    m_layerDecorator.setTextureLayers( result );
+    // clear first, so no tile is being loaded while the texture layers change
     m_tileLoader.clear();
+    m_layerDecorator.setTextureLayers( result );
 
     m_parent->setNeedsUpdate();
 }
@@ -135,6 +160,113 @@ void TextureLayer::Private::updateTile( const TileId &tileId, const QImage &tile
     requestDelayedRepaint();
 }
 
+void TextureLayer::Private::updateSunShadingConnection()
+{
+    QObject::disconnect( m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
+                         m_parent, SLOT(reset()) );
+    QObject::disconnect( m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
+                         m_parent, SIGNAL(repaintNeeded()) );
+
+    if ( !m_layerDecorator.showSunShading() ) {
+        return;
+    }
+
+    if ( m_layerDecorator.showCityLights() ) {
+        // the city lights get blended into the tiles, which need to be created again
+        QObject::connect( m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
+                          m_parent, SLOT(reset()) );
+    } else {
+        // the shading is painted over the mapped texture, so the tiles stay valid
+        QObject::connect( m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
+                          m_parent, SIGNAL(repaintNeeded()) );
+    }
+}
+
+void TextureLayer::Private::paintSunShading( GeoPainter *painter, const ViewportParams *viewport )
+{
+    const qreal sunLon = m_sunLocator->getLon();
+    const qreal sunLat = m_sunLocator->getLat();
+
+    if ( m_shadingImage.size() != viewport->size()
+         || m_shadingGeneration != viewport->projectionGeneration()
+         || m_shadingSunLon != sunLon
+         || m_shadingSunLat != sunLat ) {
+
+        if ( m_shadingImage.size() != viewport->size() ) {
+            m_shadingImage = QImage( viewport->size(), QImage::Format_ARGB32_Premultiplied );
+        }
+
+        // The shading is computed at supporting points every n pixels and
+        // interpolated in between. Spans touching the horizon of the globe
+        // get computed for every pixel.
+        const int n = 8;
+        const int width = m_shadingImage.width();
+        const int height = m_shadingImage.height();
+
+        for ( int y = 0; y < height; ++y ) {
+            QRgb *scanline = (QRgb*)m_shadingImage.scanLine( y );
+
+            qreal left = sunShading( viewport, 0, y );
+            for ( int x0 = 0; x0 < width - 1; x0 += n ) {
+                const int x1 = qMin( x0 + n, width - 1 );
+                const qreal right = sunShading( viewport, x1, y );
+
+                if ( left == 1.0 && right == 1.0 ) {
+                    for ( int x = x0; x < x1; ++x ) {
+                        scanline[x] = 0;
+                    }
+                }
+                else if ( left >= 0.0 && right >= 0.0 ) {
+                    const qreal step = ( right - left ) / ( x1 - x0 );
+                    qreal shade = left;
+                    for ( int x = x0; x < x1; ++x ) {
+                        scanline[x] = qRgba( 0, 0, 0, int( 255 * 0.65 * ( 1.0 - shade ) ) );
+                        shade += step;
+                    }
+                }
+                else {
+                    for ( int x = x0; x < x1; ++x ) {
+                        const qreal shade = x == x0 ? left : sunShading( viewport, x, y );
+                        scanline[x] = shade < 0.0 ? 0 : qRgba( 0, 0, 0, int( 255 * 0.65 * ( 1.0 - shade ) ) );
+                    }
+                }
+
+                left = right;
+            }
+            if ( width > 0 ) {
+                scanline[width - 1] = left < 0.0 ? 0 : qRgba( 0, 0, 0, int( 255 * 0.65 * ( 1.0 - left ) ) );
+            }
+        }
+
+        m_shadingGeneration = viewport->projectionGeneration();
+        m_shadingSunLon = sunLon;
+        m_shadingSunLat = sunLat;
+    }
+
+    // Darkening with a black image of opacity 0.65 * ( 1 - brightness ) equals
+    // SunLocator::shadePixel(), which scales the colors by 0.35 + 0.65 * brightness.
+    painter->drawImage( QPoint( 0, 0 ), m_shadingImage );
+}
+
+qreal TextureLayer::Private::sunShading( const ViewportParams *viewport, int x, int y ) const
+{
+    qreal lon;
+    qreal lat;
+    if ( !viewport->geoCoordinates( x, y, lon, lat, GeoDataCoordinates::Radian ) ) {
+        return -1.0;
+    }
+
+    // SunLocator expects the coordinates of the texture, which start
+    // at the top left corner of the map
+    lon += M_PI;
+    lat -= M_PI;
+
+    const qreal a = sin( ( lat + DEG2RAD * m_sunLocator->getLat() ) / 2.0 );
+    const qreal c = cos( lat ) * cos( -DEG2RAD * m_sunLocator->getLat() );
+
+    return m_sunLocator->shading( lon, a, c );
+}
+
 
 
 TextureLayer::TextureLayer( HttpDownloadManager *downloadManager,
@@ -146,6 +278,8 @@ TextureLayer::TextureLayer( HttpDownloadManager *downloadManager,
 {
     connect( &d->m_loader, SIGNAL(tileCompleted(TileId,QImage)),
              this, SLOT(updateTile(TileId,QImage)) );
+    connect( &d->m_tileLoader, SIGNAL(tileLoaded(TileId)),
+             this, SLOT(requestDelayedRepaint()) );
 
     // Repaint timer
     d->m_repaintTimer.setSingleShot( true );
@@ -154,7 +288,7 @@ TextureLayer::TextureLayer( HttpDownloadManager *downloadManager,
              this, SIGNAL(repaintNeeded()) );
 
     connect( d->m_veccomposer, SIGNAL(datasetLoaded()),
-             this, SLOT(requestDelayedRepaint()) );
+             this, SLOT(updateVectorData()) );
 }
 
 TextureLayer::~TextureLayer()
@@ -217,7 +351,7 @@ bool TextureLayer::render( GeoPainter *painter, ViewportParams *viewport,
          d->m_centerCoordinates.latitude() != viewport->centerLatitude() ) {
         d->m_centerCoordinates.setLongitude( viewport->centerLongitude() );
         d->m_centerCoordinates.setLatitude( viewport->centerLatitude() );
-        d->m_texmapper->setRepaintNeeded();
+        d->m_texmapper->setCenterChanged();
     }
 
     // choose the smaller dimension for selecting the tile level, leading to higher-resolution results
@@ -243,6 +377,11 @@ bool TextureLayer::render( GeoPainter *painter, ViewportParams *viewport,
 
     const QRect dirtyRect = QRect( QPoint( 0, 0), viewport->size() );
     d->m_texmapper->mapTexture( painter, viewport, d->m_tileZoomLevel, dirtyRect, d->m_texcolorizer );
+
+    if ( d->m_layerDecorator.showSunShading() && !d->m_layerDecorator.showCityLights() ) {
+        d->paintSunShading( painter, viewport );
+    }
+
     d->m_runtimeTrace = QString("Cache: %1 ").arg(d->m_tileLoader.tileCount());
     return true;
 }
@@ -261,22 +400,17 @@ void TextureLayer::setShowRelief( bool show )
 
 void TextureLayer::setShowSunShading( bool show )
 {
-    disconnect( d->m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
-                this, SLOT(reset()) );
-
-    if ( show ) {
-        connect( d->m_sunLocator, SIGNAL(positionChanged(qreal,qreal)),
-                 this,       SLOT(reset()) );
-    }
-
     d->m_layerDecorator.setShowSunShading( show );
+    d->updateSunShadingConnection();
 
-    reset();
+    // the tiles don't contain the shading, so they can be kept
+    emit repaintNeeded();
 }
 
 void TextureLayer::setShowCityLights( bool show )
 {
     d->m_layerDecorator.setShowCityLights( show );
+    d->updateSunShadingConnection();
 
     reset();
 }
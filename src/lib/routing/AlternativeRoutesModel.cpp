@@ -17,11 +17,65 @@
 #include "MarbleMath.h"
 #include "RoutingModel.h"
 
+#include <QtCore/QFutureWatcher>
+#include <QtCore/QHash>
 #include <QtCore/QTimer>
-#include <QtGui/QPainter>
+#include <QtCore/QtConcurrentRun>
+#include <QtCore/qmath.h>
 
 namespace Marble {
 
+namespace {
+
+// Parts of two routes closer than this (in meters) are considered to be shared
+const qreal similarityTolerance = 50.0;
+
+// Routes sharing more than this are considered equal
+const qreal similarityThreshold = 0.8;
+
+}
+
+/** A node of a route in meters, as a point on the earth's surface in three dimensions */
+struct RoutePoint
+{
+    qreal x;
+    qreal y;
+    qreal z;
+};
+
+typedef QVector<RoutePoint> RouteShape;
+
+/**
+  * Grid of the edges of a route, for finding whether a point is within
+  * similarityTolerance of the route. Edges are split into pieces no longer
+  * than the grid cells, so each piece covers only a few cells.
+  */
+class RouteShapeIndex
+{
+public:
+    explicit RouteShapeIndex( const RouteShape &shape );
+
+    bool contains( const RoutePoint &point ) const;
+
+    static RoutePoint interpolate( const RoutePoint &a, const RoutePoint &b, qreal t );
+
+    static qreal distance( const RoutePoint &a, const RoutePoint &b );
+
+private:
+    void addPiece( const RoutePoint &start, const RoutePoint &end );
+
+    static qreal squaredDistance( const RoutePoint &point, const RoutePoint &start, const RoutePoint &end );
+
+    static int cell( qreal coordinate );
+
+    static quint64 cellKey( int x, int y, int z );
+
+    /** Start and end of each piece */
+    QVector<RoutePoint> m_pieces;
+
+    QHash<quint64, QVector<int> > m_cells;
+};
+
 class AlternativeRoutesModelPrivate
 {
 public:
@@ -36,21 +90,46 @@ public:
 
     int m_currentIndex;
 
-    AlternativeRoutesModelPrivate();
+    /** The shapes of the routes in m_routes */
+    QVector<RouteShape> m_routeShapes;
 
-    /**
-      * Returns true if there exists a route with high similarity to the given one
-      */
-    bool filter( const GeoDataDocument* document ) const;
+    /** Routes waiting to be compared to the shown ones */
+    QList<GeoDataDocument*> m_pendingRoutes;
+
+    /** The route being compared to the shown ones, or 0 */
+    GeoDataDocument* m_comparedRoute;
+
+    /** Whether a comparison is running or its result hasn't been handled yet */
+    bool m_comparing;
+
+    /** Whether m_comparedRoute is to be deleted once its comparison finished */
+    bool m_comparedRouteDiscarded;
+
+    RouteShape m_comparedShape;
+
+    QFutureWatcher<int> m_similarityWatcher;
+
+    AlternativeRoutesModelPrivate();
 
     /**
       * Returns a similarity measure in the range of [0..1]. Two routes with a similarity of 0 can
       * be treated as totally different (e.g. different route requests), two routes with a similarity
       * of 1 are considered equal. Otherwise the routes overlap to an extent indicated by the
       * similarity value -- the higher, the more they do overlap.
-      * @note: The direction of routes is important; reversed routes are not considered equal
       */
-    static qreal similarity( const GeoDataDocument* routeA, const GeoDataDocument* routeB );
+    static qreal similarity( const RouteShape &routeA, const RouteShapeIndex &indexA,
+                             const RouteShape &routeB, const RouteShapeIndex &indexB );
+
+    /**
+      * Returns the index of the first of the given routes with a similarity above
+      * similarityThreshold to the candidate, or -1 if there is none.
+      * Called in a worker thread.
+      */
+    static int findSimilarRoute( const RouteShape &candidate, const QVector<RouteShape> &routes );
+
+    static RouteShape shape( const GeoDataDocument* document );
+
+    static qreal length( const RouteShape &shape );
 
     /**
       * Returns the distance between the given polygon and the given point
@@ -75,10 +154,11 @@ public:
     static GeoDataCoordinates coordinates( const GeoDataCoordinates &start, qreal distance, qreal bearing );
 
     /**
-      * Returns the similarity between routeA and routeB. This method is not symmetric, i.e. in
+      * Returns the length of routeA divided by the length of the union of both routes, i.e. 1
+      * if routeB runs along routeA. This method is not symmetric, i.e. in
       * general unidirectionalSimilarity(a,b) != unidirectionalSimilarity(b,a)
       */
-    static qreal unidirectionalSimilarity( const GeoDataDocument* routeA, const GeoDataDocument* routeB );
+    static qreal unidirectionalSimilarity( const RouteShape &routeA, const RouteShapeIndex &indexA, const RouteShape &routeB );
 
     /**
       * (Primitive) scoring for routes
@@ -91,59 +171,164 @@ public:
     static qreal instructionScore( const GeoDataDocument* document );
 
     static GeoDataLineString* waypoints( const GeoDataDocument* document );
+};
 
-    static int nonZero( const QImage &image );
+RouteShapeIndex::RouteShapeIndex( const RouteShape &shape )
+{
+    if ( shape.size() == 1 ) {
+        addPiece( shape.first(), shape.first() );
+    }
 
-    static QPolygonF polygon( const GeoDataLineString* lineString, qreal x, qreal y, qreal sx, qreal sy );
-};
+    for ( int i=1; i<shape.size(); ++i ) {
+        int const pieces = qMax( 1, qCeil( distance( shape[i-1], shape[i] ) / similarityTolerance ) );
+        RoutePoint start = shape[i-1];
+        for ( int j=1; j<=pieces; ++j ) {
+            RoutePoint const end = interpolate( shape[i-1], shape[i], qreal( j ) / pieces );
+            addPiece( start, end );
+            start = end;
+        }
+    }
+}
+
+void RouteShapeIndex::addPiece( const RoutePoint &start, const RoutePoint &end )
+{
+    int const piece = m_pieces.size() / 2;
+    m_pieces << start << end;
+
+    for ( int x = cell( qMin( start.x, end.x ) ); x <= cell( qMax( start.x, end.x ) ); ++x ) {
+        for ( int y = cell( qMin( start.y, end.y ) ); y <= cell( qMax( start.y, end.y ) ); ++y ) {
+            for ( int z = cell( qMin( start.z, end.z ) ); z <= cell( qMax( start.z, end.z ) ); ++z ) {
+                m_cells[cellKey( x, y, z )].push_back( piece );
+            }
+        }
+    }
+}
+
+bool RouteShapeIndex::contains( const RoutePoint &point ) const
+{
+    // A piece within similarityTolerance passes through the cell of the point or a neighbor
+    int const x = cell( point.x );
+    int const y = cell( point.y );
+    int const z = cell( point.z );
+    qreal const maximum = similarityTolerance * similarityTolerance;
+    for ( int dx = -1; dx <= 1; ++dx ) {
+        for ( int dy = -1; dy <= 1; ++dy ) {
+            for ( int dz = -1; dz <= 1; ++dz ) {
+                QHash<quint64, QVector<int> >::const_iterator iter = m_cells.constFind( cellKey( x + dx, y + dy, z + dz ) );
+                if ( iter == m_cells.constEnd() ) {
+                    continue;
+                }
+                foreach( int piece, iter.value() ) {
+                    if ( squaredDistance( point, m_pieces[2*piece], m_pieces[2*piece+1] ) <= maximum ) {
+                        return true;
+                    }
+                }
+            }
+        }
+    }
+
+    return false;
+}
+
+RoutePoint RouteShapeIndex::interpolate( const RoutePoint &a, const RoutePoint &b, qreal t )
+{
+    RoutePoint const result = { a.x + t * ( b.x - a.x ), a.y + t * ( b.y - a.y ), a.z + t * ( b.z - a.z ) };
+    return result;
+}
+
+qreal RouteShapeIndex::distance( const RoutePoint &a, const RoutePoint &b )
+{
+    return sqrt( ( b.x - a.x ) * ( b.x - a.x ) + ( b.y - a.y ) * ( b.y - a.y ) + ( b.z - a.z ) * ( b.z - a.z ) );
+}
+
+qreal RouteShapeIndex::squaredDistance( const RoutePoint &point, const RoutePoint &start, const RoutePoint &end )
+{
+    qreal const dx = end.x - start.x;
+    qreal const dy = end.y - start.y;
+    qreal const dz = end.z - start.z;
+    qreal const length = dx * dx + dy * dy + dz * dz;
+    qreal t = 0.0;
+    if ( length > 0.0 ) {
+        t = ( ( point.x - start.x ) * dx + ( point.y - start.y ) * dy + ( point.z - start.z ) * dz ) / length;
+        t = qBound<qreal>( 0.0, t, 1.0 );
+    }
+
+    qreal const x = start.x + t * dx - point.x;
+    qreal const y = start.y + t * dy - point.y;
+    qreal const z = start.z + t * dz - point.z;
+    return x * x + y * y + z * z;
+}
+
+int RouteShapeIndex::cell( qreal coordinate )
+{
+    return qFloor( coordinate / similarityTolerance );
+}
 
+quint64 RouteShapeIndex::cellKey( int x, int y, int z )
+{
+    // EARTH_RADIUS / similarityTolerance fits into 20 bits
+    quint64 const offset = 1 << 20;
+    return ( ( x + offset ) << 42 ) | ( ( y + offset ) << 21 ) | ( z + offset );
+}
 
 AlternativeRoutesModelPrivate::AlternativeRoutesModelPrivate() :
-        m_currentIndex( -1 )
+        m_currentIndex( -1 ),
+        m_comparedRoute( 0 ),
+        m_comparing( false ),
+        m_comparedRouteDiscarded( false )
 {
     // nothing to do
 }
 
-int AlternativeRoutesModelPrivate::nonZero( const QImage &image )
+qreal AlternativeRoutesModelPrivate::similarity( const RouteShape &routeA, const RouteShapeIndex &indexA,
+                                                const RouteShape &routeB, const RouteShapeIndex &indexB )
 {
-  QRgb* destLine = 0;
-  QRgb const black = qRgb( 0, 0, 0 );
-  int count = 0;
-  for ( int y = 0; y < image.height(); ++y ) {
-      destLine = (QRgb*) image.scanLine( y );
-      for ( int x = 0; x < image.width(); ++x ) {
-          count += destLine[x] == black ? 0 : 1;
-      }
-  }
-  return count;
+    return qMax<qreal>( unidirectionalSimilarity( routeA, indexA, routeB ),
+                        unidirectionalSimilarity( routeB, indexB, routeA ) );
 }
 
-QPolygonF AlternativeRoutesModelPrivate::polygon( const GeoDataLineString* lineString, qreal x, qreal y, qreal sx, qreal sy )
+int AlternativeRoutesModelPrivate::findSimilarRoute( const RouteShape &candidate, const QVector<RouteShape> &routes )
 {
-    QPolygonF poly;
-    for ( int i=0; i<lineString->size(); ++i ) {
-        poly << QPointF( qAbs( ( *lineString)[i].longitude() - x ) * sx,
-                         qAbs( ( *lineString)[i].latitude()  - y ) * sy );
+    RouteShapeIndex const candidateIndex( candidate );
+    for ( int i=0; i<routes.size(); ++i ) {
+        RouteShapeIndex const routeIndex( routes[i] );
+        if ( similarity( candidate, candidateIndex, routes[i], routeIndex ) > similarityThreshold ) {
+            return i;
+        }
     }
-    return poly;
+
+    return -1;
 }
 
-bool AlternativeRoutesModelPrivate::filter( const GeoDataDocument* document ) const
+RouteShape AlternativeRoutesModelPrivate::shape( const GeoDataDocument* document )
 {
-    for ( int i=0; i<m_routes.size(); ++i ) {
-        qreal similarity = AlternativeRoutesModelPrivate::similarity( document, m_routes.at( i ) );
-        if ( similarity > 0.8 ) {
-            return true;
-        }
+    RouteShape result;
+    GeoDataLineString* lineString = waypoints( document );
+    if ( !lineString ) {
+        return result;
     }
 
-    return false;
+    result.reserve( lineString->size() );
+    for ( int i=0; i<lineString->size(); ++i ) {
+        qreal lon, lat;
+        lineString->geoCoordinates( i, lon, lat );
+        RoutePoint const point = { EARTH_RADIUS * cos( lat ) * cos( lon ),
+                                   EARTH_RADIUS * cos( lat ) * sin( lon ),
+                                   EARTH_RADIUS * sin( lat ) };
+        result.push_back( point );
+    }
+
+    return result;
 }
 
-qreal AlternativeRoutesModelPrivate::similarity( const GeoDataDocument* routeA, const GeoDataDocument* routeB )
+qreal AlternativeRoutesModelPrivate::length( const RouteShape &shape )
 {
-    return qMax<qreal>( unidirectionalSimilarity( routeA, routeB ),
-                        unidirectionalSimilarity( routeB, routeA ) );
+    qreal result = 0.0;
+    for ( int i=1; i<shape.size(); ++i ) {
+        result += RouteShapeIndex::distance( shape[i-1], shape[i] );
+    }
+
+    return result;
 }
 
 qreal AlternativeRoutesModelPrivate::distance( GeoDataLineString* wayPoints, const GeoDataCoordinates &position )
@@ -197,36 +382,24 @@ qreal AlternativeRoutesModelPrivate::distance( const GeoDataCoordinates &satelli
     }
 }
 
-qreal AlternativeRoutesModelPrivate::unidirectionalSimilarity( const GeoDataDocument* routeA, const GeoDataDocument* routeB )
+qreal AlternativeRoutesModelPrivate::unidirectionalSimilarity( const RouteShape &routeA, const RouteShapeIndex &indexA, const RouteShape &routeB )
 {
-    GeoDataLineString* waypointsA = waypoints( routeA );
-    GeoDataLineString* waypointsB = waypoints( routeB );
-    if ( !waypointsA || !waypointsB )
-    {
-        return 0.0;
-    }
-
-    QImage image( 64, 64, QImage::Format_ARGB32_Premultiplied );
-    image.fill( qRgb( 0, 0, 0 ) );
-    GeoDataLatLonBox box = GeoDataLatLonBox::fromLineString( *waypointsA );
-    box = box.united( GeoDataLatLonBox::fromLineString( *waypointsB ) );
-    if ( !box.width() || !box.height() ) {
-      return 0.0;
+    // Sum up the parts of routeB which are not close to routeA, sampling
+    // each edge in steps of half the tolerance
+    qreal unshared = 0.0;
+    for ( int i=1; i<routeB.size(); ++i ) {
+        qreal const edgeLength = RouteShapeIndex::distance( routeB[i-1], routeB[i] );
+        int const steps = qMax( 1, qCeil( 2 * edgeLength / similarityTolerance ) );
+        for ( int j=0; j<steps; ++j ) {
+            RoutePoint const sample = RouteShapeIndex::interpolate( routeB[i-1], routeB[i], ( j + 0.5 ) / steps );
+            if ( !indexA.contains( sample ) ) {
+                unshared += edgeLength / steps;
+            }
+        }
     }
 
-    qreal const sw = image.width() / box.width();
-    qreal const sh = image.height() / box.height();
-
-    QPainter painter( &image );
-    painter.setPen( QColor( Qt::white ) );
-
-    painter.drawPoints( AlternativeRoutesModelPrivate::polygon( waypointsA, box.west(), box.north(), sw, sh ) );
-    int const countA = AlternativeRoutesModelPrivate::nonZero( image );
-
-    painter.drawPoints( AlternativeRoutesModelPrivate::polygon( waypointsB, box.west(), box.north(), sw, sh ) );
-    int const countB = AlternativeRoutesModelPrivate::nonZero( image );
-    Q_ASSERT( countA <= countB );
-    return countB ? 1.0 - qreal( countB - countA ) / countB : 0;
+    qreal const shared = length( routeA );
+    return shared + unshared > 0.0 ? shared / ( shared + unshared ) : 0.0;
 }
 
 bool AlternativeRoutesModelPrivate::higherScore( const GeoDataDocument* one, const GeoDataDocument* two )
@@ -299,11 +472,14 @@ AlternativeRoutesModel::AlternativeRoutesModel( QObject *parent ) :
         QAbstractListModel( parent ),
         d( new AlternativeRoutesModelPrivate() )
 {
-    // nothing to do
+    connect( &d->m_similarityWatcher, SIGNAL(finished()), this, SLOT(addComparedRoute()) );
 }
 
 AlternativeRoutesModel::~AlternativeRoutesModel()
 {
+    d->m_similarityWatcher.waitForFinished();
+    delete d->m_comparedRoute;
+    qDeleteAll( d->m_pendingRoutes );
     delete d;
 }
 
@@ -346,31 +522,29 @@ void AlternativeRoutesModel::newRequest( RouteRequest * )
 
 void AlternativeRoutesModel::addRestrainedRoutes()
 {
+    if ( d->m_restrainedRoutes.isEmpty() ) {
+        return;
+    }
+
     Q_ASSERT( d->m_routes.isEmpty() );
     qSort( d->m_restrainedRoutes.begin(), d->m_restrainedRoutes.end(), AlternativeRoutesModelPrivate::higherScore );
 
-    foreach( GeoDataDocument* route, d->m_restrainedRoutes ) {
-        if ( !d->filter( route ) ) {
-            int affected = d->m_routes.size();
-            beginInsertRows( QModelIndex(), affected, affected );
-//            GeoDataDocument* base = d->m_routes.isEmpty() ? 0 : d->m_routes.first();
-            d->m_routes.push_back( route );
-            endInsertRows();
-        }
+    // Show the best route right away, compare the others to it in the background
+    GeoDataDocument* best = d->m_restrainedRoutes.first();
+    appendRoute( best );
+    for ( int i=1; i<d->m_restrainedRoutes.size(); ++i ) {
+        d->m_pendingRoutes.push_back( d->m_restrainedRoutes[i] );
     }
 
     d->m_restrainedRoutes.clear();
-    Q_ASSERT( !d->m_routes.isEmpty() );
     setCurrentRoute( 0 );
+    compareNextRoute();
 }
 
 void AlternativeRoutesModel::addRoute( GeoDataDocument* document, WritePolicy policy )
 {
     if ( policy == Instant ) {
-        int affected = d->m_routes.size();
-        beginInsertRows( QModelIndex(), affected, affected );
-        d->m_routes.push_back( document );
-        endInsertRows();
+        appendRoute( document );
         return;
     }
 
@@ -384,25 +558,59 @@ void AlternativeRoutesModel::addRoute( GeoDataDocument* document, WritePolicy po
     } else if ( d->m_routes.isEmpty() && !d->m_restrainedRoutes.isEmpty() ) {
         d->m_restrainedRoutes.push_back( document );
     } else {
-        for ( int i=0; i<d->m_routes.size(); ++i ) {
-            qreal similarity = AlternativeRoutesModelPrivate::similarity( document, d->m_routes.at( i ) );
-            if ( similarity > 0.8 ) {
-                if ( AlternativeRoutesModelPrivate::higherScore( document, d->m_routes.at( i ) ) ) {
-                    d->m_routes[i] = document;
-                    QModelIndex changed = index( i );
-                    emit dataChanged( changed, changed );
-                }
+        d->m_pendingRoutes.push_back( document );
+        compareNextRoute();
+    }
+}
 
-                return;
-            }
-        }
+void AlternativeRoutesModel::appendRoute( GeoDataDocument* document )
+{
+    int affected = d->m_routes.size();
+    beginInsertRows( QModelIndex(), affected, affected );
+    d->m_routes.push_back( document );
+    d->m_routeShapes.push_back( AlternativeRoutesModelPrivate::shape( document ) );
+    endInsertRows();
+}
 
-        Q_ASSERT( !d->m_routes.isEmpty() );
-        int affected = d->m_routes.size();
-        beginInsertRows( QModelIndex(), affected, affected );
-        d->m_routes.push_back( document );
-        endInsertRows();
+void AlternativeRoutesModel::compareNextRoute()
+{
+    if ( d->m_comparing || d->m_pendingRoutes.isEmpty() ) {
+        return;
     }
+
+    // Comparing long routes takes a while, keep the user interface responsive meanwhile.
+    // The routes are compared one after another as each comparison can change m_routes
+    d->m_comparing = true;
+    d->m_comparedRoute = d->m_pendingRoutes.takeFirst();
+    d->m_comparedShape = AlternativeRoutesModelPrivate::shape( d->m_comparedRoute );
+    d->m_similarityWatcher.setFuture( QtConcurrent::run( &AlternativeRoutesModelPrivate::findSimilarRoute,
+                                                         d->m_comparedShape, d->m_routeShapes ) );
+}
+
+void AlternativeRoutesModel::addComparedRoute()
+{
+    GeoDataDocument* document = d->m_comparedRoute;
+    d->m_comparedRoute = 0;
+    d->m_comparing = false;
+
+    if ( d->m_comparedRouteDiscarded ) {
+        // the model got cleared in the meantime
+        d->m_comparedRouteDiscarded = false;
+        delete document;
+    } else if ( document ) {
+        int const similar = d->m_similarityWatcher.result();
+        if ( similar < 0 ) {
+            Q_ASSERT( !d->m_routes.isEmpty() );
+            appendRoute( document );
+        } else if ( AlternativeRoutesModelPrivate::higherScore( document, d->m_routes.at( similar ) ) ) {
+            d->m_routes[similar] = document;
+            d->m_routeShapes[similar] = d->m_comparedShape;
+            QModelIndex changed = index( similar );
+            emit dataChanged( changed, changed );
+        }
+    }
+
+    compareNextRoute();
 }
 
 qreal AlternativeRoutesModel::distance( const GeoDataCoordinates &satellite, const GeoDataCoordinates &lineA, const GeoDataCoordinates &lineB )
@@ -459,6 +667,11 @@ void AlternativeRoutesModel::clear()
     QVector<GeoDataDocument*> routes = d->m_routes;
     d->m_currentIndex = -1;
     d->m_routes.clear();
+    d->m_routeShapes.clear();
+    qDeleteAll( d->m_pendingRoutes );
+    d->m_pendingRoutes.clear();
+    // The route being compared is deleted once its comparison finished
+    d->m_comparedRouteDiscarded = d->m_comparing;
     reset();
     qDeleteAll(routes);
 }
@@ -98,7 +98,14 @@ private Q_SLOTS:
 
     void update( GeoDataDocument* route );
 
+    void addComparedRoute();
+
 private:
+    void appendRoute( GeoDataDocument* document );
+
+    /** Compares the next pending route to the shown ones in a worker thread */
+    void compareNextRoute();
+
     AlternativeRoutesModelPrivate *const d;
 };
 
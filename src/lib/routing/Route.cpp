@@ -10,14 +10,29 @@
 
 #include "Route.h"
 
+#include "MarbleMath.h"
+
 namespace Marble
 {
 
+namespace
+{
+
+// Number of edges in the leaves of the bounding box hierarchy
+const int edgesPerLeaf = 8;
+
+// Number of edges checked first, starting at the last closest one
+const int forwardSearchEdges = 16;
+
+}
+
 Route::Route() :
     m_distance( 0.0 ),
     m_travelTime( 0 ),
     m_positionDirty( true ),
-    m_closestSegmentIndex( -1 )
+    m_closestSegmentIndex( -1 ),
+    m_indexDirty( true ),
+    m_closestEdge( -1 )
 {
     // nothing to do
 }
@@ -36,6 +51,7 @@ void Route::addRouteSegment( const RouteSegment &segment )
         }
         m_segments.push_back( segment );
         m_positionDirty = true;
+        m_indexDirty = true;
 
         for ( int i=1; i<m_segments.size(); ++i ) {
             m_segments[i-1].setNextRouteSegment(&m_segments[i]);
@@ -96,33 +112,152 @@ GeoDataCoordinates Route::position() const
 
 void Route::updatePosition() const
 {
-    if ( !m_segments.isEmpty() ) {
-        if ( m_closestSegmentIndex < 0 || m_closestSegmentIndex >= m_segments.size() ) {
-            m_closestSegmentIndex = 0;
+    if ( m_indexDirty ) {
+        buildIndex();
+    }
+
+    if ( !m_edges.isEmpty() ) {
+        if ( m_closestEdge < 0 || m_closestEdge >= m_edges.size() ) {
+            m_closestEdge = 0;
         }
 
-        qreal distance = m_segments[m_closestSegmentIndex].distanceTo( m_position, m_currentWaypoint, m_positionOnRoute );
-        QList<int> candidates;
+        // When following the route, the closest edge is the previous one or one shortly after it.
+        // That gives a close upper bound, so the search below only descends into few nodes.
+        qreal distance = -1.0;
+        int closestEdge = m_closestEdge;
+        int const end = qMin( m_closestEdge + forwardSearchEdges, m_edges.size() );
+        for ( int i=m_closestEdge; i<end; ++i ) {
+            qreal const dist = distanceToEdge( i );
+            if ( distance < 0.0 || dist < distance ) {
+                distance = dist;
+                closestEdge = i;
+            }
+        }
+
+        findClosestEdge( 0, distance, closestEdge );
+
+        m_closestEdge = closestEdge;
+        Edge const & edge = m_edges[closestEdge];
+        m_closestSegmentIndex = edge.segment;
+        m_segments[edge.segment].projectToEdge( m_position, edge.index, m_currentWaypoint, m_positionOnRoute );
+    }
 
-        for ( int i=0; i<m_segments.size(); ++i ) {
-            if ( i != m_closestSegmentIndex && m_segments[i].minimalDistanceTo( m_position ) <= distance ) {
-                candidates << i;
+    m_positionDirty = false;
+}
+
+void Route::buildIndex() const
+{
+    m_edges.clear();
+    m_indexNodes.clear();
+    m_closestEdge = -1;
+
+    for ( int i=0; i<m_segments.size(); ++i ) {
+        int const size = m_segments[i].path().size();
+        for ( int j = size == 1 ? 0 : 1; j<size; ++j ) {
+            Edge const edge = { i, j };
+            m_edges.push_back( edge );
+        }
+    }
+
+    if ( !m_edges.isEmpty() ) {
+        m_indexNodes.reserve( 2 * ( m_edges.size() / edgesPerLeaf + 1 ) );
+        buildIndex( 0, m_edges.size() );
+    }
+
+    m_indexDirty = false;
+}
+
+int Route::buildIndex( int first, int last ) const
+{
+    int const index = m_indexNodes.size();
+    IndexNode const leaf = { 0.0, 0.0, 0.0, 0.0, first, last, -1, -1 };
+    m_indexNodes.push_back( leaf );
+
+    if ( last - first > edgesPerLeaf ) {
+        int const middle = first + ( last - first ) / 2;
+        int const left = buildIndex( first, middle );
+        int const right = buildIndex( middle, last );
+
+        IndexNode &node = m_indexNodes[index];
+        node.left = left;
+        node.right = right;
+        node.west = qMin( m_indexNodes[left].west, m_indexNodes[right].west );
+        node.east = qMax( m_indexNodes[left].east, m_indexNodes[right].east );
+        node.south = qMin( m_indexNodes[left].south, m_indexNodes[right].south );
+        node.north = qMax( m_indexNodes[left].north, m_indexNodes[right].north );
+    } else {
+        IndexNode &node = m_indexNodes[index];
+        bool empty = true;
+        for ( int i=first; i<last; ++i ) {
+            GeoDataLineString const & path = m_segments[m_edges[i].segment].path();
+            int const end = m_edges[i].index;
+            for ( int j = qMax( 0, end - 1 ); j<=end; ++j ) {
+                qreal lon, lat;
+                path.geoCoordinates( j, lon, lat );
+                if ( empty ) {
+                    node.west = node.east = lon;
+                    node.south = node.north = lat;
+                    empty = false;
+                } else {
+                    node.west = qMin( node.west, lon );
+                    node.east = qMax( node.east, lon );
+                    node.south = qMin( node.south, lat );
+                    node.north = qMax( node.north, lat );
+                }
             }
         }
+    }
 
-        GeoDataCoordinates closest, interpolated;
-        foreach( int i, candidates ) {
-            qreal const dist = m_segments[i].distanceTo( m_position, closest, interpolated );
-            if ( distance < 0.0 || dist < distance ) {
+    return index;
+}
+
+qreal Route::distanceToEdge( int edge ) const
+{
+    return m_segments[m_edges[edge].segment].distanceToEdge( m_position, m_edges[edge].index );
+}
+
+void Route::findClosestEdge( int node, qreal &distance, int &closestEdge ) const
+{
+    IndexNode const & current = m_indexNodes[node];
+
+    if ( current.left < 0 ) {
+        for ( int i=current.first; i<current.last; ++i ) {
+            qreal const dist = distanceToEdge( i );
+            // On ties prefer the earlier edge, like RouteSegment::distanceTo() does
+            if ( distance < 0.0 || dist < distance || ( dist == distance && i < closestEdge ) ) {
                 distance = dist;
-                m_closestSegmentIndex = i;
-                m_positionOnRoute = interpolated;
-                m_currentWaypoint = closest;
+                closestEdge = i;
             }
         }
+        return;
     }
 
-    m_positionDirty = false;
+    // Lower bounds for the distance of the position to the edges within the boxes
+    // of the children. Edge distances are measured on the sphere near the edge ends
+    // and in the plane of longitude and latitude elsewhere, both are at least the
+    // latitude difference and the distance to the closest meridian of the box.
+    qreal const lon = m_position.longitude();
+    qreal const lat = m_position.latitude();
+    qreal const cosLat = cos( lat );
+    qreal bounds[2];
+    int const children[2] = { current.left, current.right };
+    for ( int i=0; i<2; ++i ) {
+        IndexNode const & child = m_indexNodes[children[i]];
+        qreal const deltaLat = qMax( qMax( child.south - lat, lat - child.north ), 0.0 );
+        qreal deltaLon = qMax( qMax( child.west - lon, lon - child.east ), 0.0 );
+        deltaLon = qMin( deltaLon, qMax( qMax( child.west - ( lon + 2 * M_PI ), lon + 2 * M_PI - child.east ), 0.0 ) );
+        deltaLon = qMin( deltaLon, qMax( qMax( child.west - ( lon - 2 * M_PI ), lon - 2 * M_PI - child.east ), 0.0 ) );
+        qreal const meridianDistance = asin( cosLat * sin( qMin( deltaLon, M_PI / 2 ) ) );
+        bounds[i] = EARTH_RADIUS * qMax( deltaLat, meridianDistance );
+    }
+
+    int const nearer = bounds[1] < bounds[0] ? 1 : 0;
+    for ( int i=0; i<2; ++i ) {
+        int const child = i == 0 ? nearer : 1 - nearer;
+        if ( distance < 0.0 || bounds[child] <= distance ) {
+            findClosestEdge( children[child], distance, closestEdge );
+        }
+    }
 }
 
 const RouteSegment & Route::currentSegment() const
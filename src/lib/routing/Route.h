@@ -51,8 +51,40 @@ public:
     GeoDataCoordinates positionOnRoute() const;
 
 private:
+    /** An edge of the path of a segment, see RouteSegment::distanceToEdge() */
+    struct Edge
+    {
+        int segment;
+        int index;
+    };
+
+    /**
+     * A node of the bounding box hierarchy over the edges. The edges are
+     * kept in route order, so nearby edges share nodes. Each node covers
+     * the edges [first, last), leaves have no children (left = right = -1).
+     */
+    struct IndexNode
+    {
+        qreal west;
+        qreal east;
+        qreal south;
+        qreal north;
+        int first;
+        int last;
+        int left;
+        int right;
+    };
+
     void updatePosition() const;
 
+    void buildIndex() const;
+
+    int buildIndex( int first, int last ) const;
+
+    qreal distanceToEdge( int edge ) const;
+
+    void findClosestEdge( int node, qreal &distance, int &closestEdge ) const;
+
     GeoDataLatLonBox m_bounds;
 
     qreal m_distance;
@@ -71,6 +103,14 @@ private:
 
     mutable int m_closestSegmentIndex;
 
+    mutable bool m_indexDirty;
+
+    mutable QVector<Edge> m_edges;
+
+    mutable QVector<IndexNode> m_indexNodes;
+
+    mutable int m_closestEdge;
+
     mutable GeoDataCoordinates m_positionOnRoute;
 
     mutable GeoDataCoordinates m_currentWaypoint;
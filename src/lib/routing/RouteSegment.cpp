@@ -107,6 +107,9 @@ qreal RouteSegment::distancePointToLine(const GeoDataCoordinates &p, const GeoDa
     qreal const y21 = x2 - x1;
     qreal const x21 = y2 - y1;
     qreal const len =(x1-x2)*(x1-x2)+(y1-y2)*(y1-y2);
+    if ( len == 0.0 ) {
+        return EARTH_RADIUS * distanceSphere(p, a);
+    }
     qreal const t = (x01*x21 + y01*y21) / len;
     if ( t<0.0 ) {
         return EARTH_RADIUS * distanceSphere(p, a);
@@ -132,6 +135,9 @@ GeoDataCoordinates RouteSegment::projected(const GeoDataCoordinates &p, const Ge
     qreal const y21 = x2 - x1;
     qreal const x21 = y2 - y1;
     qreal const len =(x1-x2)*(x1-x2)+(y1-y2)*(y1-y2);
+    if ( len == 0.0 ) {
+        return a;
+    }
     qreal const t = (x01*x21 + y01*y21) / len;
     if ( t<0.0 ) {
         return a;
@@ -194,6 +200,25 @@ qreal RouteSegment::minimalDistanceTo( const GeoDataCoordinates &point ) const
     return qMin( qMin( distNorth, distEast ), qMin( distWest, distSouth ) );
 }
 
+qreal RouteSegment::distanceToEdge( const GeoDataCoordinates &point, int index ) const
+{
+    if ( index == 0 ) {
+        return EARTH_RADIUS * distanceSphere( m_path.first(), point );
+    }
+
+    return distancePointToLine( point, m_path[index-1], m_path[index] );
+}
+
+void RouteSegment::projectToEdge( const GeoDataCoordinates &point, int index, GeoDataCoordinates &closest, GeoDataCoordinates &interpolated ) const
+{
+    closest = m_path[index];
+    if ( index == 0 ) {
+        interpolated = closest;
+    } else {
+        interpolated = projected( point, m_path[index-1], m_path[index] );
+    }
+}
+
 bool RouteSegment::operator ==(const RouteSegment &other) const
 {
     return  m_valid == other.m_valid &&
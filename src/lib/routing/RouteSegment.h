@@ -51,6 +51,19 @@ public:
 
     qreal minimalDistanceTo( const GeoDataCoordinates &point ) const;
 
+    /**
+     * Distance of @p point to the edge of path() which ends in node @p index,
+     * or to the first node if @p index is 0. distanceTo() is the minimum of
+     * this over all edges.
+     */
+    qreal distanceToEdge( const GeoDataCoordinates &point, int index ) const;
+
+    /**
+     * The @p closest and @p interpolated points distanceTo() returns for
+     * the edge ending in node @p index.
+     */
+    void projectToEdge( const GeoDataCoordinates &point, int index, GeoDataCoordinates &closest, GeoDataCoordinates &interpolated ) const;
+
     bool operator==( const RouteSegment &other ) const;
 
     bool operator!=( const RouteSegment &other ) const;
@@ -21,8 +21,11 @@
 
 #include <QtCore/QFile>
 #include <QtCore/QDataStream>
+#include <QtCore/QHash>
 #include <QtCore/QStringList>
 #include <QtCore/QRegExp>
+#include <QtCore/QThread>
+#include <QtCore/QThreadStorage>
 #include <QtCore/QVariant>
 #include <QtCore/QTime>
 
@@ -30,45 +33,136 @@
 #include <QtSql/QSqlQuery>
 #include <QtSql/QSqlError>
 
+#include <algorithm>
+
 namespace Marble {
 
+/**
+ * An open database along with its prepared statements. Qt requires
+ * a connection to be used only in the thread which created it, so each
+ * thread keeps its own connections (see OsmDatabase::connection()).
+ */
+class OsmDatabaseConnection
+{
+public:
+    OsmDatabaseConnection( const QString &connectionName, const QString &databaseFile );
+    ~OsmDatabaseConnection();
+
+    /** Returns the prepared statement for @p queryString, or 0 if it can't be prepared */
+    QSqlQuery *statement( const QString &queryString );
+
+    QSqlDatabase m_database;
+    bool m_isOpen;
+
+    /** Full text index of names.name, created by osm-addresses */
+    bool m_hasNameIndex;
+
+    /** R-tree index of the positions of the placemarks, created by osm-addresses */
+    bool m_hasPositionIndex;
+
+private:
+    bool hasTable( const QString &table ) const;
+
+    QHash<QString, QSqlQuery> m_statements;
+};
+
 namespace {
 
-class PlacemarkSmallerDistance
+const int resultLimit = 50;
+
+// Queries with region restrictions differ in text, so don't keep an unbounded amount of them
+const int statementCacheSize = 32;
+
+class OsmDatabaseConnections
 {
 public:
-    PlacemarkSmallerDistance( const GeoDataCoordinates &currentPosition ) :
-        m_currentPosition( currentPosition )
-    {}
-
-    bool operator()( const OsmPlacemark &a, const OsmPlacemark &b ) const
+    ~OsmDatabaseConnections()
     {
-        return distanceSphere( a.longitude() * DEG2RAD, a.latitude() * DEG2RAD,
-                               m_currentPosition.longitude(), m_currentPosition.latitude() )
-             < distanceSphere( b.longitude() * DEG2RAD, b.latitude() * DEG2RAD,
-                               m_currentPosition.longitude(), m_currentPosition.latitude() );
+        qDeleteAll( m_connections );
     }
 
-private:
-    GeoDataCoordinates m_currentPosition;
+    QHash<QString, OsmDatabaseConnection*> m_connections;
 };
 
-class PlacemarkHigherScore
+QThreadStorage<OsmDatabaseConnections*> threadConnections;
+
+struct RankedPlacemark
 {
-public:
-    PlacemarkHigherScore( const DatabaseQuery *currentQuery ) :
-        m_currentQuery( currentQuery )
-    {}
+    qreal rank;
+    int index;
 
-    bool operator()( const OsmPlacemark &a, const OsmPlacemark &b ) const
+    bool operator<( const RankedPlacemark &other ) const
     {
-        return a.matchScore( m_currentQuery ) > b.matchScore( m_currentQuery );
+        return rank < other.rank || ( rank == other.rank && index < other.index );
     }
-
-private:
-    const DatabaseQuery *const m_currentQuery;
 };
 
+bool isTokenCharacter( const QChar &c )
+{
+    // Matches the "simple" tokenizer of SQLite's full text search
+    const ushort code = c.unicode();
+    return code >= 128 || ( code >= '0' && code <= '9' ) || ( code >= 'a' && code <= 'z' ) || ( code >= 'A' && code <= 'Z' );
+}
+
+bool isWildcard( const QChar &c )
+{
+    return c == '*' || c == '%' || c == '_';
+}
+
+}
+
+OsmDatabaseConnection::OsmDatabaseConnection( const QString &connectionName, const QString &databaseFile ) :
+    m_database( QSqlDatabase::addDatabase( "QSQLITE", connectionName ) ),
+    m_isOpen( false ),
+    m_hasNameIndex( false ),
+    m_hasPositionIndex( false )
+{
+    m_database.setDatabaseName( databaseFile );
+    m_isOpen = m_database.open();
+    if ( m_isOpen ) {
+        m_hasNameIndex = hasTable( "namesFts" );
+        m_hasPositionIndex = hasTable( "placemarksRtree" );
+    }
+}
+
+OsmDatabaseConnection::~OsmDatabaseConnection()
+{
+    m_statements.clear();
+    const QString connectionName = m_database.connectionName();
+    m_database.close();
+    m_database = QSqlDatabase();
+    QSqlDatabase::removeDatabase( connectionName );
+}
+
+QSqlQuery *OsmDatabaseConnection::statement( const QString &queryString )
+{
+    QHash<QString, QSqlQuery>::iterator iter = m_statements.find( queryString );
+    if ( iter == m_statements.end() ) {
+        if ( m_statements.size() >= statementCacheSize ) {
+            m_statements.clear();
+        }
+
+        QSqlQuery query( m_database );
+        query.setForwardOnly( true );
+        if ( !query.prepare( queryString ) ) {
+            qWarning() << query.lastError() << "in" << m_database.databaseName() << "with query" << queryString;
+            return 0;
+        }
+        iter = m_statements.insert( queryString, query );
+    }
+
+    return &iter.value();
+}
+
+bool OsmDatabaseConnection::hasTable( const QString &table ) const
+{
+    if ( !m_database.tables().contains( table ) ) {
+        return false;
+    }
+
+    // Virtual tables are listed even if the SQLite library lacks their module
+    QSqlQuery query( "SELECT * FROM " + table + " LIMIT 0", m_database );
+    return !query.lastError().isValid();
 }
 
 OsmDatabase::OsmDatabase( const QStringList &databaseFiles ) :
@@ -82,151 +176,282 @@ QVector<OsmPlacemark> OsmDatabase::find( const DatabaseQuery &userQuery )
         return QVector<OsmPlacemark>();
     }
 
-    QSqlDatabase database = QSqlDatabase::addDatabase( "QSQLITE", QString( "marble/local-osm-search-%1" ).arg( reinterpret_cast<size_t>( this ) ) );
-
     QVector<OsmPlacemark> result;
     QTime timer;
     timer.start();
     foreach( const QString &databaseFile, m_databaseFiles ) {
-        database.setDatabaseName( databaseFile );
-        if ( !database.open() ) {
+        OsmDatabaseConnection *databaseConnection = connection( databaseFile );
+        if ( !databaseConnection ) {
             qWarning() << "Failed to connect to database" << databaseFile;
+            continue;
         }
 
-        QString regionRestriction;
-        if ( !userQuery.region().isEmpty() ) {
-            QTime regionTimer;
-            regionTimer.start();
-            // Nested set model to support region hierarchies, see http://en.wikipedia.org/wiki/Nested_set_model
-            const QString regionsQueryString = "SELECT lft, rgt FROM regions WHERE name LIKE '%" + userQuery.region() + "%';";
-            QSqlQuery regionsQuery( regionsQueryString, database );
-            if ( regionsQuery.lastError().isValid() ) {
-                qWarning() << regionsQuery.lastError() << "in" << databaseFile << "with query" << regionsQuery.lastQuery();
-            }
-            regionRestriction = " AND (";
-            int regionCount = 0;
-            while ( regionsQuery.next() ) {
-                if ( regionCount > 0 ) {
-                    regionRestriction += " OR ";
-                }
-                regionRestriction += " (regions.lft >= " + regionsQuery.value( 0 ).toString();
-                regionRestriction += " AND regions.lft <= " + regionsQuery.value( 1 ).toString() + ')';
-                regionCount++;
-            }
-            regionRestriction += ')';
+        find( databaseConnection, userQuery, result );
+    }
 
-            mDebug() << Q_FUNC_INFO << "region query in" << databaseFile << "with query" << regionsQueryString
-                     << "took" << regionTimer.elapsed() << "ms for" << regionCount << "results";
+    mDebug() << "Offline OSM search query took" << timer.elapsed() << "ms for" << result.count() << "results.";
 
-            if ( regionCount == 0 ) {
-                continue;
+    qSort( result.begin(), result.end() );
+    unique( result );
+    selectBest( result, userQuery );
+
+    return result;
+}
+
+OsmDatabaseConnection *OsmDatabase::connection( const QString &databaseFile )
+{
+    if ( !threadConnections.hasLocalData() ) {
+        threadConnections.setLocalData( new OsmDatabaseConnections );
+    }
+
+    QHash<QString, OsmDatabaseConnection*> &connections = threadConnections.localData()->m_connections;
+    OsmDatabaseConnection *result = connections.value( databaseFile );
+    if ( !result ) {
+        const QString connectionName = QString( "marble/local-osm-search-%1-%2" )
+                .arg( reinterpret_cast<quintptr>( QThread::currentThreadId() ) ).arg( databaseFile );
+        result = new OsmDatabaseConnection( connectionName, databaseFile );
+        connections.insert( databaseFile, result );
+    }
+
+    return result->m_isOpen ? result : 0;
+}
+
+void OsmDatabase::find( OsmDatabaseConnection *connection, const DatabaseQuery &userQuery, QVector<OsmPlacemark> &result ) const
+{
+    const QString databaseFile = connection->m_database.databaseName();
+
+    QString regionRestriction;
+    if ( !userQuery.region().isEmpty() ) {
+        QTime regionTimer;
+        regionTimer.start();
+        // Nested set model to support region hierarchies, see http://en.wikipedia.org/wiki/Nested_set_model
+        const QString regionsQueryString = "SELECT lft, rgt FROM regions WHERE name LIKE ?;";
+        QSqlQuery *regionsQuery = connection->statement( regionsQueryString );
+        if ( !regionsQuery ) {
+            return;
+        }
+        regionsQuery->bindValue( 0, '%' + userQuery.region() + '%' );
+        if ( !regionsQuery->exec() ) {
+            qWarning() << regionsQuery->lastError() << "in" << databaseFile << "with query" << regionsQueryString;
+            return;
+        }
+        regionRestriction = " AND (";
+        int regionCount = 0;
+        while ( regionsQuery->next() ) {
+            if ( regionCount > 0 ) {
+                regionRestriction += " OR ";
             }
+            regionRestriction += " (regions.lft >= " + regionsQuery->value( 0 ).toString();
+            regionRestriction += " AND regions.lft <= " + regionsQuery->value( 1 ).toString() + ')';
+            regionCount++;
         }
+        regionsQuery->finish();
+        regionRestriction += ')';
 
-        QString queryString;
-
-        queryString = " SELECT regions.name,"
-                " places.name, places.number,"
-                " places.category, places.lon, places.lat"
-                " FROM regions, places";
-
-        if ( userQuery.queryType() == DatabaseQuery::CategorySearch ) {
-            queryString += " WHERE regions.id = places.region";
-            if( userQuery.category() == OsmPlacemark::UnknownCategory ) {
-                // search for all pois which are not street nor address
-                queryString += " AND places.category <> 0 AND places.category <> 6";
-            } else {
-                // search for specific category
-                queryString += " AND places.category = %1";
-                queryString = queryString.arg( (qint32) userQuery.category() );
-            }
-            if ( userQuery.position().isValid() && userQuery.region().isEmpty() ) {
-                // sort by distance
-                queryString += " ORDER BY ((places.lat-%1)*(places.lat-%1)+(places.lon-%2)*(places.lon-%2))";
-                GeoDataCoordinates position = userQuery.position();
-                queryString = queryString.arg( position.latitude( GeoDataCoordinates::Degree ), 0, 'f', 8 )
-                        .arg( position.longitude( GeoDataCoordinates::Degree ), 0, 'f', 8 );
-            } else {
-                queryString += regionRestriction;
-            }
-        } else if ( userQuery.queryType() == DatabaseQuery::BroadSearch ) {
-            queryString += " WHERE regions.id = places.region"
-                    " AND places.name " + wildcardQuery( userQuery.searchTerm() );
+        mDebug() << Q_FUNC_INFO << "region query in" << databaseFile << "with query" << regionsQueryString
+                 << "took" << regionTimer.elapsed() << "ms for" << regionCount << "results";
+
+        if ( regionCount == 0 ) {
+            return;
+        }
+    }
+
+    QString queryString;
+    QVariantList bindValues;
+
+    queryString = " SELECT regions.name,"
+            " places.name, places.number,"
+            " places.category, places.lon, places.lat"
+            " FROM regions, places";
+
+    if ( userQuery.queryType() == DatabaseQuery::CategorySearch ) {
+        queryString += " WHERE regions.id = places.region";
+        if( userQuery.category() == OsmPlacemark::UnknownCategory ) {
+            // search for all pois which are not street nor address
+            queryString += " AND places.category <> 0 AND places.category <> 6";
         } else {
-            queryString += " WHERE regions.id = places.region"
-                    "   AND places.name " + wildcardQuery( userQuery.street() );
-            if ( !userQuery.houseNumber().isEmpty() ) {
-                queryString += " AND places.number " + wildcardQuery( userQuery.houseNumber() );
-            } else {
-                queryString += " AND places.number IS NULL";
+            // search for specific category
+            queryString += " AND places.category = ?";
+            bindValues << (qint32) userQuery.category();
+        }
+        if ( userQuery.position().isValid() && userQuery.region().isEmpty() ) {
+            if ( connection->m_hasPositionIndex ) {
+                findNearest( connection, userQuery, queryString, bindValues, result );
+                return;
             }
+
+            // sort by distance
+            queryString += " ORDER BY ((places.lat-?)*(places.lat-?)+(places.lon-?)*(places.lon-?))";
+            const qreal lat = userQuery.position().latitude( GeoDataCoordinates::Degree );
+            const qreal lon = userQuery.position().longitude( GeoDataCoordinates::Degree );
+            bindValues << lat << lat << lon << lon;
+        } else {
             queryString += regionRestriction;
         }
+    } else if ( userQuery.queryType() == DatabaseQuery::BroadSearch ) {
+        queryString += " WHERE regions.id = places.region"
+                " AND " + wildcardQuery( "places.name", userQuery.searchTerm(), connection->m_hasNameIndex, bindValues );
+    } else {
+        queryString += " WHERE regions.id = places.region"
+                "   AND " + wildcardQuery( "places.name", userQuery.street(), connection->m_hasNameIndex, bindValues );
+        if ( !userQuery.houseNumber().isEmpty() ) {
+            queryString += " AND " + wildcardQuery( "places.number", userQuery.houseNumber(), false, bindValues );
+        } else {
+            queryString += " AND places.number IS NULL";
+        }
+        queryString += regionRestriction;
+    }
 
-        queryString += " LIMIT 50;";
+    queryString += QString( " LIMIT %1;" ).arg( resultLimit );
 
-        /** @todo: sort/filter results from several databases */
+    exec( connection, queryString, bindValues, userQuery, result );
+}
 
-        QSqlQuery query( database );
-        query.setForwardOnly( true );
-        QTime queryTimer;
-        queryTimer.start();
-        if ( !query.exec( queryString ) ) {
-            qWarning() << query.lastError() << "in" << databaseFile << "with query" << query.lastQuery();
-            continue;
+bool OsmDatabase::findNearest( OsmDatabaseConnection *connection, const DatabaseQuery &userQuery,
+                               const QString &queryString, const QVariantList &bindValues, QVector<OsmPlacemark> &result ) const
+{
+    const qreal lat = userQuery.position().latitude( GeoDataCoordinates::Degree );
+    const qreal lon = userQuery.position().longitude( GeoDataCoordinates::Degree );
+    const QString orderBy = QString( " ORDER BY ((places.lat-?)*(places.lat-?)+(places.lon-?)*(places.lon-?)) LIMIT %1;" ).arg( resultLimit );
+
+    // Search growing boxes around the position. The result is final once
+    // the box yields resultLimit places which are all closer to the position
+    // than any place outside of the box can be.
+    for ( qreal radius = 0.01; ; radius *= 4 ) {
+        const bool isGlobal = radius > 360.0;
+
+        QString boxQueryString = queryString;
+        QVariantList boxBindValues = bindValues;
+        if ( !isGlobal ) {
+            boxQueryString += " AND places.id IN (SELECT id FROM placemarksRtree"
+                              " WHERE maxLon >= ? AND minLon <= ? AND maxLat >= ? AND minLat <= ?)";
+            boxBindValues << lon - radius << lon + radius << lat - radius << lat + radius;
+        }
+        boxQueryString += orderBy;
+        boxBindValues << lat << lat << lon << lon;
+
+        QVector<OsmPlacemark> boxResult;
+        if ( !exec( connection, boxQueryString, boxBindValues, userQuery, boxResult ) ) {
+            return false;
         }
 
-        int resultCount = 0;
-        while ( query.next() ) {
-            OsmPlacemark placemark;
-            if ( userQuery.resultFormat() == DatabaseQuery::DistanceFormat ) {
-                GeoDataCoordinates coordinates( query.value(4).toFloat(), query.value(5).toFloat(), 0.0, GeoDataCoordinates::Degree );
-                placemark.setAdditionalInformation( formatDistance( coordinates, userQuery.position() ) );
-            } else {
-                placemark.setAdditionalInformation( query.value( 0 ).toString() );
+        if ( !isGlobal ) {
+            if ( boxResult.size() < resultLimit ) {
+                continue;
+            }
+            const qreal deltaLat = boxResult.last().latitude() - lat;
+            const qreal deltaLon = boxResult.last().longitude() - lon;
+            if ( deltaLat * deltaLat + deltaLon * deltaLon > radius * radius ) {
+                continue;
             }
-            placemark.setName( query.value(1).toString() );
-            placemark.setHouseNumber( query.value(2).toString() );
-            placemark.setCategory( (OsmPlacemark::OsmCategory) query.value(3).toInt() );
-            placemark.setLongitude( query.value(4).toFloat() );
-            placemark.setLatitude( query.value(5).toFloat() );
-
-            result.push_back( placemark );
-            resultCount++;
         }
 
-        mDebug() << Q_FUNC_INFO << "query in" << databaseFile << "with query" << queryString
-                 << "took" << queryTimer.elapsed() << "ms for" << resultCount << "results";
+        result += boxResult;
+        return true;
     }
+}
 
-    mDebug() << "Offline OSM search query took" << timer.elapsed() << "ms for" << result.count() << "results.";
+bool OsmDatabase::exec( OsmDatabaseConnection *connection, const QString &queryString, const QVariantList &bindValues,
+                        const DatabaseQuery &userQuery, QVector<OsmPlacemark> &result ) const
+{
+    const QString databaseFile = connection->m_database.databaseName();
 
-    qSort( result.begin(), result.end() );
-    unique( result );
+    QSqlQuery *query = connection->statement( queryString );
+    if ( !query ) {
+        return false;
+    }
 
-    if ( userQuery.position().isValid() ) {
-        const PlacemarkSmallerDistance placemarkSmallerDistance( userQuery.position() );
-        qSort( result.begin(), result.end(), placemarkSmallerDistance );
-    } else {
-        const PlacemarkHigherScore placemarkHigherScore( &userQuery );
-        qSort( result.begin(), result.end(), placemarkHigherScore );
+    for ( int i = 0; i < bindValues.size(); ++i ) {
+        query->bindValue( i, bindValues.at( i ) );
     }
 
-    if ( result.size() > 50 ) {
-        result.remove( 50, result.size()-50 );
+    QTime queryTimer;
+    queryTimer.start();
+    if ( !query->exec() ) {
+        qWarning() << query->lastError() << "in" << databaseFile << "with query" << queryString;
+        return false;
     }
 
-    return result;
+    int resultCount = 0;
+    while ( query->next() ) {
+        OsmPlacemark placemark;
+        if ( userQuery.resultFormat() == DatabaseQuery::DistanceFormat ) {
+            GeoDataCoordinates coordinates( query->value(4).toFloat(), query->value(5).toFloat(), 0.0, GeoDataCoordinates::Degree );
+            placemark.setAdditionalInformation( formatDistance( coordinates, userQuery.position() ) );
+        } else {
+            placemark.setAdditionalInformation( query->value( 0 ).toString() );
+        }
+        placemark.setName( query->value(1).toString() );
+        placemark.setHouseNumber( query->value(2).toString() );
+        placemark.setCategory( (OsmPlacemark::OsmCategory) query->value(3).toInt() );
+        placemark.setLongitude( query->value(4).toFloat() );
+        placemark.setLatitude( query->value(5).toFloat() );
+
+        result.push_back( placemark );
+        resultCount++;
+    }
+    query->finish();
+
+    mDebug() << Q_FUNC_INFO << "query in" << databaseFile << "with query" << queryString
+             << "took" << queryTimer.elapsed() << "ms for" << resultCount << "results";
+
+    return true;
 }
 
 void OsmDatabase::unique( QVector<OsmPlacemark> &placemarks ) const
 {
+    if ( placemarks.isEmpty() ) {
+        return;
+    }
+
+    int last = 0;
     for ( int i=1; i<placemarks.size(); ++i ) {
-        if ( placemarks[i-1] == placemarks[i] ) {
-            placemarks.remove( i );
-            --i;
+        if ( !( placemarks[last] == placemarks[i] ) ) {
+            ++last;
+            if ( last != i ) {
+                placemarks[last] = placemarks[i];
+            }
+        }
+    }
+    placemarks.resize( last + 1 );
+}
+
+void OsmDatabase::selectBest( QVector<OsmPlacemark> &placemarks, const DatabaseQuery &userQuery ) const
+{
+    const GeoDataCoordinates position = userQuery.position();
+    const bool sortByDistance = position.isValid();
+
+    // A bounded max-heap whose top is the worst of the best placemarks found so far
+    QVector<RankedPlacemark> heap;
+    heap.reserve( resultLimit );
+    for ( int i = 0; i < placemarks.size(); ++i ) {
+        const OsmPlacemark &placemark = placemarks.at( i );
+        RankedPlacemark ranked;
+        ranked.index = i;
+        if ( sortByDistance ) {
+            ranked.rank = distanceSphere( placemark.longitude() * DEG2RAD, placemark.latitude() * DEG2RAD,
+                                          position.longitude(), position.latitude() );
+        } else {
+            ranked.rank = -placemark.matchScore( &userQuery );
+        }
+
+        if ( heap.size() < resultLimit ) {
+            heap.push_back( ranked );
+            std::push_heap( heap.begin(), heap.end() );
+        } else if ( ranked < heap.front() ) {
+            std::pop_heap( heap.begin(), heap.end() );
+            heap.back() = ranked;
+            std::push_heap( heap.begin(), heap.end() );
         }
     }
+    std::sort_heap( heap.begin(), heap.end() );
+
+    QVector<OsmPlacemark> best;
+    best.reserve( heap.size() );
+    foreach( const RankedPlacemark &ranked, heap ) {
+        best.push_back( placemarks.at( ranked.index ) );
+    }
+    placemarks = best;
 }
 
 QString OsmDatabase::formatDistance( const GeoDataCoordinates &a, const GeoDataCoordinates &b ) const
@@ -290,14 +515,62 @@ qreal OsmDatabase::bearing( const GeoDataCoordinates &a, const GeoDataCoordinate
                        cos( lat1 ) * sin( lat2 ) - sin( lat1 ) * cos( lat2 ) * cos ( delta ) ), 2 * M_PI );
 }
 
-QString OsmDatabase::wildcardQuery( const QString &term ) const
+QString OsmDatabase::wildcardQuery( const QString &column, const QString &term, bool useNameIndex, QVariantList &bindValues ) const
 {
     QString result = term;
-    if ( term.contains( '*' ) ) {
-        return " LIKE '" + result.replace( '*', '%' ) + '\'';
-    } else {
-        return " = '" + result + '\'';
+    if ( !term.contains( '*' ) ) {
+        bindValues << result;
+        return column + " = ?";
+    }
+
+    // LIKE can't use an index, so let the full text index find candidates first
+    const QString nameQuery = useNameIndex ? nameIndexQuery( term ) : QString();
+    QString condition;
+    if ( !nameQuery.isEmpty() ) {
+        condition = column + " IN (SELECT name FROM namesFts WHERE namesFts MATCH ?) AND ";
+        bindValues << nameQuery;
     }
+
+    bindValues << result.replace( '*', '%' );
+    return condition + column + " LIKE ?";
+}
+
+QString OsmDatabase::nameIndexQuery( const QString &term )
+{
+    // Every name matched by the LIKE pattern must match the full text query.
+    // Words next to a wildcard on the left may be the end of a longer word,
+    // so they are skipped; words next to one on the right become prefixes.
+    QStringList words;
+    int i = 0;
+    while ( i < term.size() ) {
+        if ( !isTokenCharacter( term.at( i ) ) ) {
+            ++i;
+            continue;
+        }
+
+        const int start = i;
+        while ( i < term.size() && isTokenCharacter( term.at( i ) ) ) {
+            ++i;
+        }
+
+        if ( start > 0 && isWildcard( term.at( start - 1 ) ) ) {
+            continue;
+        }
+
+        QString word = term.mid( start, i - start );
+        for ( int j = 0; j < word.size(); ++j ) {
+            // The tokenizer folds the case of ASCII letters only, as LIKE does
+            if ( word.at( j ).unicode() < 128 ) {
+                word[j] = word.at( j ).toLower();
+            }
+        }
+        if ( i < term.size() && isWildcard( term.at( i ) ) ) {
+            word += '*';
+        }
+        words << word;
+    }
+
+    return words.join( " " );
 }
 
 }
@@ -16,11 +16,15 @@
 
 #include <QtCore/QString>
 #include <QtCore/QStringList>
+#include <QtCore/QVariant>
+
+class QSqlQuery;
 
 namespace Marble {
 
 class DatabaseQuery;
 class GeoDataCoordinates;
+class OsmDatabaseConnection;
 
 class OsmDatabase
 {
@@ -33,10 +37,30 @@ public:
     QVector<OsmPlacemark> find( const DatabaseQuery &userQuery );
 
 private:
-    QString wildcardQuery( const QString &term ) const;
+    /**
+     * Returns the open connection to @p databaseFile for the calling thread,
+     * or 0 if it can't be opened. Connections stay open until the thread exits.
+     */
+    static OsmDatabaseConnection *connection( const QString &databaseFile );
+
+    /** Runs the query for one database and appends up to resultLimit matches to @p result */
+    void find( OsmDatabaseConnection *connection, const DatabaseQuery &userQuery, QVector<OsmPlacemark> &result ) const;
+
+    /** Runs the position sorted category search using the R-tree index of @p connection */
+    bool findNearest( OsmDatabaseConnection *connection, const DatabaseQuery &userQuery,
+                      const QString &queryString, const QVariantList &bindValues, QVector<OsmPlacemark> &result ) const;
+
+    bool exec( OsmDatabaseConnection *connection, const QString &queryString, const QVariantList &bindValues,
+               const DatabaseQuery &userQuery, QVector<OsmPlacemark> &result ) const;
+
+    QString wildcardQuery( const QString &column, const QString &term, bool useNameIndex, QVariantList &bindValues ) const;
+
+    static QString nameIndexQuery( const QString &term );
 
     void unique( QVector<OsmPlacemark> &placemarks ) const;
 
+    void selectBest( QVector<OsmPlacemark> &placemarks, const DatabaseQuery &userQuery ) const;
+
     QStringList m_databaseFiles;
 
     QString formatDistance( const GeoDataCoordinates &a, const GeoDataCoordinates &b ) const;
@@ -10,11 +10,7 @@
 #include "OsmParser.h"
 #include "OsmElementDictionary.h"
 #include "GeoDataDocument.h"
-
-#include "OsmNodeFactory.h"
-#include "OsmWayFactory.h"
-#include "OsmRelationFactory.h"
-#include "OsmGlobals.h"
+#include "GeoDataPlacemark.h"
 
 namespace Marble {
 
@@ -25,10 +21,36 @@ OsmParser::OsmParser()
 
 OsmParser::~OsmParser()
 {
-    osm::OsmRelationFactory::clear();
-    osm::OsmWayFactory::clear();
-    osm::OsmNodeFactory::clear();
-    osm::OsmGlobals::cleanUpDummyPlacemarks();
+    qDeleteAll( m_dummyPlacemarks );
+}
+
+osm::OsmNodeStore &OsmParser::nodes()
+{
+    return m_nodes;
+}
+
+osm::OsmWayFactory &OsmParser::ways()
+{
+    return m_ways;
+}
+
+osm::OsmRelationFactory &OsmParser::relations()
+{
+    return m_relations;
+}
+
+GeoDataPoint *OsmParser::nodePoint( const GeoDataCoordinates &coordinates )
+{
+    // A POI created from the previous node shares the data of the point,
+    // setCoordinates() detaches it in that case
+    m_nodePoint.setCoordinates( coordinates );
+    m_nodePoint.setParent( 0 );
+    return &m_nodePoint;
+}
+
+void OsmParser::addDummyPlacemark( GeoDataPlacemark *placemark )
+{
+    m_dummyPlacemarks << placemark;
 }
 
 bool OsmParser::isValidRootElement()
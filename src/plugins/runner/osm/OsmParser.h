@@ -11,21 +11,56 @@
 #define OSMPARSER_H
 
 #include "GeoParser.h"
+#include "GeoDataPoint.h"
+
+#include "OsmNodeStore.h"
+#include "OsmWayFactory.h"
+#include "OsmRelationFactory.h"
+
+#include <QtCore/QList>
 
 namespace Marble {
 
+class GeoDataPlacemark;
+
+/**
+ * All state collected while reading a file lives in the parser,
+ * so several files can be parsed concurrently.
+ */
 class OsmParser : public GeoParser
 {
 public:
     OsmParser();
     virtual ~OsmParser();
 
+    osm::OsmNodeStore &nodes();
+    osm::OsmWayFactory &ways();
+    osm::OsmRelationFactory &relations();
+
+    /**
+     * Returns the point representing the node element being parsed.
+     * Nodes without tags are only needed as positions in nodes(),
+     * so a single point gets reused instead of allocating one per node.
+     */
+    GeoDataPoint *nodePoint( const GeoDataCoordinates &coordinates );
+
+    /**
+     * Takes ownership of a placemark that got replaced while parsing,
+     * but whose geometry is still referenced by ways() or relations().
+     */
+    void addDummyPlacemark( GeoDataPlacemark *placemark );
+
 private:
     virtual bool isValidElement(const QString& tagName) const;
     virtual bool isValidRootElement();
 
     virtual GeoDocument* createDocument() const;
 
+    osm::OsmNodeStore m_nodes;
+    osm::OsmWayFactory m_ways;
+    osm::OsmRelationFactory m_relations;
+    GeoDataPoint m_nodePoint;
+    QList<GeoDataPlacemark*> m_dummyPlacemarks;
 };
 
 }
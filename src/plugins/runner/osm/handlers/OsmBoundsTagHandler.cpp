@@ -11,7 +11,6 @@
 #include "OsmBoundsTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmNodeFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataParser.h"
 #include "GeoDataLatLonAltBox.h"
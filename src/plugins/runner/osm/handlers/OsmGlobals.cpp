@@ -20,69 +20,55 @@ namespace Marble
 {
 namespace osm
 {
-QList<QString> OsmGlobals::m_areaTags;
+const QList<QString> OsmGlobals::m_areaTags = OsmGlobals::createAreaTags();
 
 QColor OsmGlobals::backgroundColor( 0xF1, 0xEE, 0xE8 );
-QList<GeoDataPlacemark*> OsmGlobals::dummyPlacemarks;
 
 bool OsmGlobals::tagNeedArea(const QString& keyValue)
 {
-    if ( m_areaTags.count() < 1 )
-        setupAreaTags();
-    
     return qBinaryFind( m_areaTags.constBegin(), m_areaTags.constEnd(), keyValue ) != m_areaTags.constEnd();
 }
 
-void OsmGlobals::setupAreaTags()
+QList<QString> OsmGlobals::createAreaTags()
 {
+    QList<QString> areaTags;
+
     // All these tags can be found updated at
     // http://wiki.openstreetmap.org/wiki/Map_Features#Landuse
 
-    m_areaTags.append( "landuse=forest" );
-    m_areaTags.append( "natural=wood" );
-    m_areaTags.append( "area=yes" );
-    m_areaTags.append( "waterway=riverbank" );
-    m_areaTags.append( "building=yes" );
-    m_areaTags.append( "amenity=parking" );
-    m_areaTags.append( "leisure=park" );
+    areaTags.append( "landuse=forest" );
+    areaTags.append( "natural=wood" );
+    areaTags.append( "area=yes" );
+    areaTags.append( "waterway=riverbank" );
+    areaTags.append( "building=yes" );
+    areaTags.append( "amenity=parking" );
+    areaTags.append( "leisure=park" );
     
-    m_areaTags.append( "landuse=allotments" );
-    m_areaTags.append( "landuse=basin" );
-    m_areaTags.append( "landuse=brownfield" );
-    m_areaTags.append( "landuse=cemetery" );
-    m_areaTags.append( "landuse=commercial" );
-    m_areaTags.append( "landuse=construction" );
-    m_areaTags.append( "landuse=farm" );
-    m_areaTags.append( "landuse=farmland" );
-    m_areaTags.append( "landuse=farmyard" );
-    m_areaTags.append( "landuse=garages" );
-    m_areaTags.append( "landuse=greenfield" );
-    m_areaTags.append( "landuse=industrial" );
-    m_areaTags.append( "landuse=landfill" );
-    m_areaTags.append( "landuse=meadow" );
-    m_areaTags.append( "landuse=military" );
-    m_areaTags.append( "landuse=orchard" );
-    m_areaTags.append( "landuse=quarry" );
-    m_areaTags.append( "landuse=railway" );
-    m_areaTags.append( "landuse=reservoir" );
-    m_areaTags.append( "landuse=residential" );
-    m_areaTags.append( "landuse=retail" );
+    areaTags.append( "landuse=allotments" );
+    areaTags.append( "landuse=basin" );
+    areaTags.append( "landuse=brownfield" );
+    areaTags.append( "landuse=cemetery" );
+    areaTags.append( "landuse=commercial" );
+    areaTags.append( "landuse=construction" );
+    areaTags.append( "landuse=farm" );
+    areaTags.append( "landuse=farmland" );
+    areaTags.append( "landuse=farmyard" );
+    areaTags.append( "landuse=garages" );
+    areaTags.append( "landuse=greenfield" );
+    areaTags.append( "landuse=industrial" );
+    areaTags.append( "landuse=landfill" );
+    areaTags.append( "landuse=meadow" );
+    areaTags.append( "landuse=military" );
+    areaTags.append( "landuse=orchard" );
+    areaTags.append( "landuse=quarry" );
+    areaTags.append( "landuse=railway" );
+    areaTags.append( "landuse=reservoir" );
+    areaTags.append( "landuse=residential" );
+    areaTags.append( "landuse=retail" );
     
-    qSort( m_areaTags.begin(), m_areaTags.end() );
-}
+    qSort( areaTags.begin(), areaTags.end() );
 
-void OsmGlobals::addDummyPlacemark( GeoDataPlacemark* placemark )
-{
-    dummyPlacemarks << placemark;
-}
-
-void OsmGlobals::cleanUpDummyPlacemarks()
-{
-    foreach( GeoDataFeature* placemark, dummyPlacemarks )
-    {
-        delete placemark;
-    }
-    dummyPlacemarks.clear();
+    return areaTags;
 }
 
 }
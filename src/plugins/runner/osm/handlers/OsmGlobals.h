@@ -29,18 +29,16 @@ class OsmGlobals
 {
 public:
     static bool tagNeedArea( const QString& keyValue );
-    static void addDummyPlacemark( GeoDataPlacemark *placemark );
-    static void cleanUpDummyPlacemarks();
 
     static QColor buildingColor;
     static QColor backgroundColor;
 
 private:
     static void setupCategories();
-    static void setupAreaTags();
-    
-    static QList<QString> m_areaTags;
-    static QList<GeoDataPlacemark*> dummyPlacemarks;
+    static QList<QString> createAreaTags();
+
+    // Built on library load so that concurrent parsers only ever read it
+    static const QList<QString> m_areaTags;
 };
 
 }
@@ -13,13 +13,12 @@
 #include "OsmMemberTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmWayFactory.h"
-#include "OsmRelationFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
 #include "GeoDataPolygon.h"
 #include "OsmElementDictionary.h"
+#include "OsmParser.h"
 #include "MarbleDebug.h"
 
 namespace Marble
@@ -39,8 +38,9 @@ GeoNode* OsmMemberTagHandler::parse( GeoParser& parser ) const
     Q_ASSERT( parser.isStartElement() );
 
     GeoStackItem parentItem = parser.parentElement();
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
 
-    if ( parentItem.represents( osmTag_relation ) )
+    if ( osmParser && parentItem.represents( osmTag_relation ) )
     {
         // Never heard of a type different from "way" but
         // maybe it should be checked
@@ -56,7 +56,7 @@ GeoNode* OsmMemberTagHandler::parse( GeoParser& parser ) const
                 quint64 id = parser.attribute( "ref" ).toULongLong();
 
                 // With the id we get the way geometry
-                if ( GeoDataLineString *line =  osm::OsmWayFactory::line( id )  )
+                if ( GeoDataLineString *line =  osmParser->ways().line( id )  )
                 {
                     // Some of the ways that build the relation
                     // might be in opposite directions
@@ -145,7 +145,7 @@ GeoNode* OsmMemberTagHandler::parse( GeoParser& parser ) const
                 quint64 id = parser.attribute( "ref" ).toULongLong();
 
                 // With the id we get the way geometry
-                if ( GeoDataLineString *line = osm::OsmWayFactory::line( id ) )
+                if ( GeoDataLineString *line = osmParser->ways().line( id ) )
                 {
                     polygon->appendInnerBoundary( GeoDataLinearRing( *line ) );
                 }
@@ -171,7 +171,7 @@ GeoNode* OsmMemberTagHandler::parse( GeoParser& parser ) const
                 quint64 id = parser.attribute( "ref" ).toULongLong();
 
                 // With the id we get the relation geometry
-                if ( GeoDataPolygon *p =  osm::OsmRelationFactory::polygon( id ) )
+                if ( GeoDataPolygon *p =  osmParser->relations().polygon( id ) )
                 {
                     polygon->appendInnerBoundary( p->outerBoundary() );
                 }
@@ -11,13 +11,13 @@
 #include "OsmNdTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmNodeFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
 #include "GeoDataLineString.h"
 #include "MarbleDebug.h"
 #include "OsmElementDictionary.h"
+#include "OsmParser.h"
 
 namespace Marble
 {
@@ -33,15 +33,17 @@ GeoNode* OsmNdTagHandler::parse( GeoParser& parser ) const
     Q_ASSERT( parser.isStartElement() );
 
     GeoStackItem parentItem = parser.parentElement();
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
 
-    if ( parentItem.represents( osmTag_way ) )
+    if ( osmParser && parentItem.represents( osmTag_way ) )
     {
         GeoDataLineString *s = parentItem.nodeAs<GeoDataLineString>();
         Q_ASSERT( s );
         quint64 id = parser.attribute( "ref" ).toULongLong();
-        if ( GeoDataPoint *p = osm::OsmNodeFactory::getPoint( id ) )
+        qreal lon, lat;
+        if ( osmParser->nodes().coordinates( id, lon, lat ) )
         {
-            s->append( GeoDataCoordinates( p->coordinates().longitude(), p->coordinates().latitude() ) );
+            s->append( lon, lat );
         }
 
         return 0;
@@ -0,0 +1,157 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include "OsmNodeStore.h"
+
+#include "MarbleGlobal.h"
+
+#include <QtCore/QtAlgorithms>
+
+namespace Marble
+{
+namespace osm
+{
+
+// OSM stores positions with seven decimal places
+static const qreal fixedPointScale = 1e7;
+static const qreal fixedPointToRad = DEG2RAD / fixedPointScale;
+
+static inline int slotHash( quint64 id, int mask )
+{
+    return int( ( id * Q_UINT64_C( 0x9E3779B97F4A7C15 ) ) >> 32 ) & mask;
+}
+
+OsmNodeStore::OsmNodeStore()
+{
+}
+
+void OsmNodeStore::append( quint64 id, qreal lon, qreal lat )
+{
+    Position position;
+    position.lon = qRound( lon * fixedPointScale );
+    position.lat = qRound( lat * fixedPointScale );
+
+    if ( m_sortedIds.isEmpty() || id > m_sortedIds.last() ) {
+        m_sortedIds.append( id );
+        m_sortedPositions.append( position );
+        return;
+    }
+
+    int index;
+    if ( findSorted( id, index ) ) {
+        m_sortedPositions[index] = position;
+        return;
+    }
+
+    insertUnsorted( id, position );
+}
+
+bool OsmNodeStore::coordinates( quint64 id, qreal &lon, qreal &lat ) const
+{
+    Position position;
+    int index;
+    if ( findSorted( id, index ) ) {
+        position = m_sortedPositions.at( index );
+    }
+    else {
+        index = findUnsorted( id );
+        if ( index < 0 ) {
+            return false;
+        }
+        position = m_unsortedPositions.at( index );
+    }
+
+    lon = position.lon * fixedPointToRad;
+    lat = position.lat * fixedPointToRad;
+    return true;
+}
+
+int OsmNodeStore::size() const
+{
+    return m_sortedIds.size() + m_unsortedIds.size();
+}
+
+void OsmNodeStore::clear()
+{
+    m_sortedIds.clear();
+    m_sortedPositions.clear();
+    m_slots.clear();
+    m_unsortedIds.clear();
+    m_unsortedPositions.clear();
+}
+
+bool OsmNodeStore::findSorted( quint64 id, int &index ) const
+{
+    QVector<quint64>::const_iterator it = qLowerBound( m_sortedIds.constBegin(), m_sortedIds.constEnd(), id );
+    if ( it == m_sortedIds.constEnd() || *it != id ) {
+        return false;
+    }
+
+    index = it - m_sortedIds.constBegin();
+    return true;
+}
+
+int OsmNodeStore::findUnsorted( quint64 id ) const
+{
+    if ( m_slots.isEmpty() ) {
+        return -1;
+    }
+
+    const int mask = m_slots.size() - 1;
+    for ( int slot = slotHash( id, mask ); ; slot = ( slot + 1 ) & mask ) {
+        const int index = m_slots.at( slot );
+        if ( index < 0 ) {
+            return -1;
+        }
+        if ( m_unsortedIds.at( index ) == id ) {
+            return index;
+        }
+    }
+}
+
+void OsmNodeStore::insertUnsorted( quint64 id, const Position &position )
+{
+    const int existing = findUnsorted( id );
+    if ( existing >= 0 ) {
+        m_unsortedPositions[existing] = position;
+        return;
+    }
+
+    // Keep the load factor at or below one half so probe sequences stay short
+    if ( 2 * ( m_unsortedIds.size() + 1 ) > m_slots.size() ) {
+        rehash( qMax( 64, 2 * m_slots.size() ) );
+    }
+
+    const int index = m_unsortedIds.size();
+    m_unsortedIds.append( id );
+    m_unsortedPositions.append( position );
+
+    const int mask = m_slots.size() - 1;
+    int slot = slotHash( id, mask );
+    while ( m_slots.at( slot ) >= 0 ) {
+        slot = ( slot + 1 ) & mask;
+    }
+    m_slots[slot] = index;
+}
+
+void OsmNodeStore::rehash( int capacity )
+{
+    m_slots.fill( -1, capacity );
+
+    const int mask = capacity - 1;
+    for ( int index = 0; index < m_unsortedIds.size(); ++index ) {
+        int slot = slotHash( m_unsortedIds.at( index ), mask );
+        while ( m_slots.at( slot ) >= 0 ) {
+            slot = ( slot + 1 ) & mask;
+        }
+        m_slots[slot] = index;
+    }
+}
+
+}
+}
@@ -0,0 +1,71 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#ifndef MARBLE_OSMNODESTORE_H
+#define MARBLE_OSMNODESTORE_H
+
+#include <QtCore/QVector>
+
+namespace Marble
+{
+
+namespace osm
+{
+
+// This is a class for keeping the positions of all nodes
+// accessible for when needed by ways. Ways have only the ids
+// of nodes so with that id the coordinates are returned.
+//
+// Positions are stored with the fixed point resolution OSM
+// uses itself (1e-7 degree). Nodes usually appear with
+// ascending ids, these are kept in sorted arrays and looked
+// up by binary search. Nodes out of order go to an open
+// addressing hash table.
+
+class OsmNodeStore
+{
+public:
+    OsmNodeStore();
+
+    void append( quint64 id, qreal lon, qreal lat );
+
+    /**
+     * @brief Looks up the position of a node, in radian
+     * Returns false if no node with the given id was appended.
+     */
+    bool coordinates( quint64 id, qreal &lon, qreal &lat ) const;
+
+    int size() const;
+
+    void clear();
+
+private:
+    struct Position
+    {
+        qint32 lon;
+        qint32 lat;
+    };
+
+    bool findSorted( quint64 id, int &index ) const;
+    int findUnsorted( quint64 id ) const;
+    void insertUnsorted( quint64 id, const Position &position );
+    void rehash( int capacity );
+
+    QVector<quint64> m_sortedIds;
+    QVector<Position> m_sortedPositions;
+
+    // slots hold indices into m_unsortedIds / m_unsortedPositions, -1 if empty
+    QVector<int> m_slots;
+    QVector<quint64> m_unsortedIds;
+    QVector<Position> m_unsortedPositions;
+};
+
+}
+}
+
+#endif // MARBLE_OSMNODESTORE_H
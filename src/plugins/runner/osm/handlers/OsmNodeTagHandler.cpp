@@ -13,11 +13,11 @@
 #include "GeoParser.h"
 #include "GeoDataPoint.h"
 #include "MarbleDebug.h"
-#include "OsmNodeFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
 #include "OsmElementDictionary.h"
+#include "OsmParser.h"
 
 namespace Marble
 {
@@ -34,12 +34,15 @@ GeoNode* OsmNodeTagHandler::parse( GeoParser& parser ) const
 
     Q_ASSERT( parser.isStartElement() );
 
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
+    if ( !osmParser )
+        return 0;
+
     qreal lon = parser.attribute( "lon" ).toDouble();
     qreal lat = parser.attribute( "lat" ).toDouble();
 
-    GeoDataPoint *point = new GeoDataPoint( GeoDataCoordinates( lon, lat, 0, GeoDataCoordinates::Degree ) );
-    osm::OsmNodeFactory::appendPoint( parser.attribute( "id" ).toULongLong(), point );
-    return point;
+    osmParser->nodes().append( parser.attribute( "id" ).toULongLong(), lon, lat );
+    return osmParser->nodePoint( GeoDataCoordinates( lon, lat, 0, GeoDataCoordinates::Degree ) );
 }
 
 }
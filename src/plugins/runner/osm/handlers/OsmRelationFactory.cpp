@@ -17,7 +17,6 @@ namespace Marble
 {
 namespace osm
 {
-QMap<quint64, GeoDataPolygon *> OsmRelationFactory::m_polygons;
 
 // This is a class for keeping all the relations accessible
 // for when needed by other relations. As OSM detail level
@@ -29,7 +28,7 @@ void OsmRelationFactory::appendPolygon( quint64 id, GeoDataPolygon* p )
     m_polygons[id] = p;
 }
 
-GeoDataPolygon* OsmRelationFactory::polygon( quint64 id )
+GeoDataPolygon* OsmRelationFactory::polygon( quint64 id ) const
 {
     return m_polygons.value( id );
 }
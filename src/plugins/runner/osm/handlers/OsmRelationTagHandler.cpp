@@ -13,12 +13,12 @@
 #include "OsmRelationTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmRelationFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
 #include "GeoDataPolygon.h"
 #include "OsmElementDictionary.h"
+#include "OsmParser.h"
 #include "MarbleDebug.h"
 
 namespace Marble
@@ -36,6 +36,10 @@ GeoNode* OsmRelationTagHandler::parse( GeoParser& parser ) const
 
     Q_ASSERT( parser.isStartElement() );
 
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
+    if ( !osmParser )
+        return 0;
+
     GeoDataDocument* doc = geoDataDoc( parser );
     Q_ASSERT( doc );
 
@@ -48,7 +52,7 @@ GeoNode* OsmRelationTagHandler::parse( GeoParser& parser ) const
     placemark->setVisible( false );
     doc->append( placemark );
 
-    osm::OsmRelationFactory::appendPolygon( parser.attribute( "id" ).toULongLong(), polygon );
+    osmParser->relations().appendPolygon( parser.attribute( "id" ).toULongLong(), polygon );
 
     return polygon;
 }
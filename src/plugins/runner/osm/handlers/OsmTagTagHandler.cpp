@@ -11,7 +11,6 @@
 #include "OsmTagTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmNodeFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
@@ -19,6 +18,7 @@
 #include "MarbleDebug.h"
 #include "OsmElementDictionary.h"
 #include "OsmGlobals.h"
+#include "OsmParser.h"
 #include "GeoDataStyle.h"
 
 namespace Marble
@@ -35,6 +35,10 @@ GeoNode* OsmTagTagHandler::parse( GeoParser& parser ) const
 {
     Q_ASSERT( parser.isStartElement() );
 
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
+    if ( !osmParser )
+        return 0;
+
     GeoStackItem parentItem = parser.parentElement();
     GeoDataDocument* doc = geoDataDoc( parser );
     QString key = parser.attribute( "k" );
@@ -76,7 +80,7 @@ GeoNode* OsmTagTagHandler::parse( GeoParser& parser ) const
         //Convert area ways or relations to polygons
         if( !dynamic_cast<GeoDataPolygon*>( geometry ) && OsmGlobals::tagNeedArea( key + '=' + value ) )
         {
-            placemark = convertWayToPolygon( doc, placemark, geometry );
+            placemark = convertWayToPolygon( osmParser, doc, placemark, geometry );
         }
         if ( key == "building" && value == "yes" && placemark->visualCategory() == GeoDataFeature::Default )
         {
@@ -157,12 +161,12 @@ GeoDataPlacemark* OsmTagTagHandler::createPOI( GeoDataDocument* doc, GeoDataGeom
     return placemark;
 }
 
-GeoDataPlacemark *OsmTagTagHandler::convertWayToPolygon( GeoDataDocument *doc, GeoDataPlacemark *placemark, GeoDataGeometry *geometry ) const
+GeoDataPlacemark *OsmTagTagHandler::convertWayToPolygon( OsmParser *parser, GeoDataDocument *doc, GeoDataPlacemark *placemark, GeoDataGeometry *geometry ) const
 {
     GeoDataLineString *polyline = dynamic_cast<GeoDataLineString *>( geometry );
     Q_ASSERT( polyline );
     doc->remove( doc->childPosition( placemark ) );
-    OsmGlobals::addDummyPlacemark( placemark );
+    parser->addDummyPlacemark( placemark );
     GeoDataPlacemark *newPlacemark = new GeoDataPlacemark( *placemark );
     GeoDataPolygon *polygon = new GeoDataPolygon;
     polygon->setOuterBoundary( *polyline );
@@ -17,7 +17,6 @@ namespace Marble
 {
 namespace osm
 {
-QMap<quint64, GeoDataLineString *> OsmWayFactory::m_lines;
 
 // This is a class for keeping all the ways accessible
 // for when needed by relations. Relations have only the ids of
@@ -28,7 +27,7 @@ void OsmWayFactory::appendLine( quint64 id, GeoDataLineString* l )
     m_lines[id] = l;
 }
 
-GeoDataLineString* OsmWayFactory::line( quint64 id )
+GeoDataLineString* OsmWayFactory::line( quint64 id ) const
 {
     return m_lines.value( id );
 }
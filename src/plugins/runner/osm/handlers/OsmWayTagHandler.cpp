@@ -11,12 +11,12 @@
 #include "OsmWayTagHandler.h"
 
 #include "GeoParser.h"
-#include "OsmWayFactory.h"
 #include "GeoDataDocument.h"
 #include "GeoDataPlacemark.h"
 #include "GeoDataParser.h"
 #include "GeoDataLineString.h"
 #include "OsmElementDictionary.h"
+#include "OsmParser.h"
 
 namespace Marble
 {
@@ -33,10 +33,16 @@ GeoNode* OsmWayTagHandler::parse( GeoParser& parser ) const
 
     Q_ASSERT( parser.isStartElement() );
 
+    OsmParser *osmParser = dynamic_cast<OsmParser *>( &parser );
+    if ( !osmParser )
+        return 0;
+
     GeoDataDocument* doc = geoDataDoc( parser );
     Q_ASSERT( doc );
 
     GeoDataLineString *polyline = new GeoDataLineString();
+    // Ways make up most of the geometry of large extracts
+    polyline->setCompact( true );
     GeoDataPlacemark *placemark = new GeoDataPlacemark();
     placemark->setGeometry( polyline );
 
@@ -45,7 +51,7 @@ GeoNode* OsmWayTagHandler::parse( GeoParser& parser ) const
     placemark->setVisible( false );
     doc->append( placemark );
 
-    osm::OsmWayFactory::appendLine( parser.attribute( "id" ).toULongLong(), polyline );
+    osmParser->ways().appendLine( parser.attribute( "id" ).toULongLong(), polyline );
 
     return polyline;
 }
@@ -0,0 +1,190 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QtCore/QDataStream>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtTest/QtTest>
+#include "DiscCache.h"
+
+namespace Marble
+{
+
+class DiscCacheTest : public QObject
+{
+    Q_OBJECT
+
+ private slots:
+    void init();
+    void cleanup();
+
+    void testReopen();
+    void testReplayJournal();
+    void testTornJournal();
+
+ private:
+    static void fillCache( DiscCache &cache );
+    static void copyDirectory( const QString &source, const QString &destination );
+    static void removeDirectory( const QString &path );
+
+    QString m_cacheDirectory;
+    QString m_crashDirectory;
+};
+
+void DiscCacheTest::init()
+{
+    const QString baseName = QDir::tempPath() + QString( "/DiscCacheTest-%1" ).arg( QCoreApplication::applicationPid() );
+    m_cacheDirectory = baseName + "-cache";
+    m_crashDirectory = baseName + "-crash";
+
+    removeDirectory( m_cacheDirectory );
+    removeDirectory( m_crashDirectory );
+    QDir().mkpath( m_cacheDirectory );
+}
+
+void DiscCacheTest::cleanup()
+{
+    removeDirectory( m_cacheDirectory );
+    removeDirectory( m_crashDirectory );
+}
+
+// Leaves the entries ordered b, c, a from the least to the most recently used one
+void DiscCacheTest::fillCache( DiscCache &cache )
+{
+    QVERIFY( cache.insert( "a", QByteArray( 100, 'a' ) ) );
+    QVERIFY( cache.insert( "b", QByteArray( 100, 'b' ) ) );
+    QVERIFY( cache.insert( "c", QByteArray( 100, 'c' ) ) );
+
+    QByteArray data;
+    QVERIFY( cache.find( "a", data ) );
+    QCOMPARE( data, QByteArray( 100, 'a' ) );
+
+    // also writes the pending touch of a to the journal
+    cache.setCacheLimit( 1000 );
+}
+
+// Takes a snapshot of a cache that is still in use, as if it had crashed
+void DiscCacheTest::copyDirectory( const QString &source, const QString &destination )
+{
+    removeDirectory( destination );
+    QDir().mkpath( destination );
+
+    foreach( const QString &fileName, QDir( source ).entryList( QDir::Files ) ) {
+        QVERIFY( QFile::copy( source + '/' + fileName, destination + '/' + fileName ) );
+    }
+}
+
+void DiscCacheTest::removeDirectory( const QString &path )
+{
+    QDir directory( path );
+    foreach( const QString &fileName, directory.entryList( QDir::Files ) ) {
+        directory.remove( fileName );
+    }
+    QDir().rmdir( path );
+}
+
+void DiscCacheTest::testReopen()
+{
+    {
+        DiscCache cache( m_cacheDirectory );
+        fillCache( cache );
+    }
+
+    // the journal is folded into the index on shutdown
+    QVERIFY( QFile::exists( m_cacheDirectory + "/cache_index.lru" ) );
+    QVERIFY( !QFile::exists( m_cacheDirectory + "/cache_index.journal" ) );
+
+    DiscCache cache( m_cacheDirectory );
+    QCOMPARE( cache.cacheLimit(), quint64( 1000 ) );
+    QVERIFY( cache.exists( "a" ) );
+    QVERIFY( cache.exists( "b" ) );
+    QVERIFY( cache.exists( "c" ) );
+
+    QByteArray data;
+    QVERIFY( cache.find( "b", data ) );
+    QCOMPARE( data, QByteArray( 100, 'b' ) );
+
+    // b is the most recently used entry now, so c is evicted first
+    cache.setCacheLimit( 250 );
+    QVERIFY( cache.exists( "a" ) );
+    QVERIFY( cache.exists( "b" ) );
+    QVERIFY( !cache.exists( "c" ) );
+}
+
+void DiscCacheTest::testReplayJournal()
+{
+    DiscCache cache( m_cacheDirectory );
+    fillCache( cache );
+    QVERIFY( cache.insert( "d", QByteArray( 100, 'd' ) ) );
+    cache.remove( "d" );
+
+    copyDirectory( m_cacheDirectory, m_crashDirectory );
+    QVERIFY( !QFile::exists( m_crashDirectory + "/cache_index.lru" ) );
+    QVERIFY( QFile::exists( m_crashDirectory + "/cache_index.journal" ) );
+
+    DiscCache replayed( m_crashDirectory );
+    QCOMPARE( replayed.cacheLimit(), quint64( 1000 ) );
+    QVERIFY( replayed.exists( "a" ) );
+    QVERIFY( replayed.exists( "b" ) );
+    QVERIFY( replayed.exists( "c" ) );
+    QVERIFY( !replayed.exists( "d" ) );
+
+    // the touch of a was replayed, so b is the least recently used entry
+    replayed.setCacheLimit( 250 );
+    QVERIFY( replayed.exists( "a" ) );
+    QVERIFY( !replayed.exists( "b" ) );
+    QVERIFY( replayed.exists( "c" ) );
+}
+
+void DiscCacheTest::testTornJournal()
+{
+    {
+        DiscCache cache( m_cacheDirectory );
+        fillCache( cache );
+        copyDirectory( m_cacheDirectory, m_crashDirectory );
+    }
+
+    // append the beginning of an insert record for a key of ten characters
+    QFile journal( m_crashDirectory + "/cache_index.journal" );
+    QVERIFY( journal.open( QIODevice::WriteOnly | QIODevice::Append ) );
+    const qint64 validSize = journal.size();
+    QDataStream s( &journal );
+    s.setVersion( 8 );
+    s << quint8( 0 ) << quint32( 20 );
+    s.writeRawData( "\0t\0o\0r", 6 );
+    journal.close();
+
+    {
+        DiscCache cache( m_crashDirectory );
+        QCOMPARE( cache.cacheLimit(), quint64( 1000 ) );
+        QVERIFY( cache.exists( "a" ) );
+        QVERIFY( cache.exists( "b" ) );
+        QVERIFY( cache.exists( "c" ) );
+        QCOMPARE( journal.size(), validSize );
+
+        // records appended after recovering have to be replayed as well
+        QVERIFY( cache.insert( "d", QByteArray( 100, 'd' ) ) );
+        copyDirectory( m_crashDirectory, m_cacheDirectory );
+    }
+
+    DiscCache cache( m_cacheDirectory );
+    QVERIFY( cache.exists( "a" ) );
+    QVERIFY( cache.exists( "b" ) );
+    QVERIFY( cache.exists( "c" ) );
+    QVERIFY( cache.exists( "d" ) );
+
+    QByteArray data;
+    QVERIFY( cache.find( "d", data ) );
+    QCOMPARE( data, QByteArray( 100, 'd' ) );
+}
+
+}
+
+QTEST_MAIN( Marble::DiscCacheTest )
+
+#include "DiscCacheTest.moc"
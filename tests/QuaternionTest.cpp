@@ -9,6 +9,7 @@
 //
 
 #include <QtCore/QMetaType>
+#include <QtCore/QVector>
 #include <QtTest/QtTest>
 #include "Quaternion.h"
 #include "MarbleGlobal.h"
@@ -29,6 +30,8 @@ class QuaternionTest : public QObject
 
     void testSpherical_data();
     void testSpherical();
+
+    void testRotateToSpherical();
 };
 
 void QuaternionTest::testEuler_data()
@@ -168,6 +171,45 @@ void QuaternionTest::testSpherical()
     QCOMPARE( _lon * RAD2DEG, lon );
 }
 
+void QuaternionTest::testRotateToSpherical()
+{
+    matrix m;
+    Quaternion::fromEuler( 10.0 * DEG2RAD, 20.0 * DEG2RAD, 30.0 * DEG2RAD ).toMatrix( m );
+
+    // an odd number of vectors, covering the poles and the date line
+    QVector<qreal> x, y, z;
+    for ( int lat = -90; lat <= 90; lat += 15 ) {
+        for ( int lon = -180; lon <= 180; lon += 15 ) {
+            const Quaternion quat = Quaternion::fromSpherical( lon * DEG2RAD, lat * DEG2RAD );
+            x << quat.v[Q_X];
+            y << quat.v[Q_Y];
+            z << quat.v[Q_Z];
+        }
+    }
+    x << 0.0;
+    y << 0.0;
+    z << 0.0;
+
+    QVector<qreal> lon( x.size() );
+    QVector<qreal> lat( x.size() );
+    Quaternion::rotateToSpherical( m, x.size(), x.constData(), y.constData(), z.constData(), lon.data(), lat.data() );
+
+    for ( int i = 0; i < x.size(); ++i ) {
+        Quaternion quat( 0.0, x[i], y[i], z[i] );
+        quat.rotateAroundAxis( m );
+
+        qreal expectedLon, expectedLat;
+        quat.getSpherical( expectedLon, expectedLat );
+
+        // +180 and -180 degrees are the same longitude
+        if ( fabs( lon[i] - expectedLon ) > M_PI )
+            expectedLon += lon[i] > expectedLon ? 2 * M_PI : -2 * M_PI;
+
+        QFUZZYCOMPARE( lon[i], expectedLon, 0.000000001 );
+        QFUZZYCOMPARE( lat[i], expectedLat, 0.000000001 );
+    }
+}
+
 }
 
 QTEST_MAIN( Marble::QuaternionTest )
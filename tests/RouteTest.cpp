@@ -0,0 +1,119 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QtTest/QtTest>
+
+#include "routing/Route.h"
+#include "routing/RouteSegment.h"
+#include "GeoDataLineString.h"
+
+namespace Marble
+{
+
+class RouteTest : public QObject
+{
+    Q_OBJECT
+
+ private slots:
+    void testEmpty();
+    void testClosestSegment();
+    void testSinglePoint();
+
+ private:
+    static Route zigzagRoute();
+    static qreal bruteForceDistance( const Route &route, const GeoDataCoordinates &position );
+};
+
+Route RouteTest::zigzagRoute()
+{
+    // 40 segments of 25 nodes each, wiggling eastwards around 50 deg north
+    Route route;
+    for ( int i = 0; i < 40; ++i ) {
+        GeoDataLineString path;
+        for ( int j = 0; j < 25; ++j ) {
+            const int node = i * 24 + j;
+            const qreal lon = -10.0 + 0.02 * node;
+            const qreal lat = 50.0 + 0.05 * sin( node * 0.3 ) + ( ( node % 7 ) == 0 ? 0.01 : 0.0 );
+            path << GeoDataCoordinates( lon, lat, 0.0, GeoDataCoordinates::Degree );
+        }
+        RouteSegment segment;
+        segment.setPath( path );
+        route.addRouteSegment( segment );
+    }
+    return route;
+}
+
+qreal RouteTest::bruteForceDistance( const Route &route, const GeoDataCoordinates &position )
+{
+    qreal result = -1.0;
+    for ( int i = 0; i < route.size(); ++i ) {
+        GeoDataCoordinates closest, interpolated;
+        const qreal distance = route.at( i ).distanceTo( position, closest, interpolated );
+        if ( result < 0.0 || distance < result ) {
+            result = distance;
+        }
+    }
+    return result;
+}
+
+void RouteTest::testEmpty()
+{
+    Route route;
+    route.setPosition( GeoDataCoordinates( 1.0, 2.0, 0.0, GeoDataCoordinates::Degree ) );
+    QVERIFY( !route.currentSegment().isValid() );
+}
+
+void RouteTest::testClosestSegment()
+{
+    Route route = zigzagRoute();
+
+    // Follow the route, then jump around, as position updates do
+    QList<GeoDataCoordinates> positions;
+    for ( int i = 0; i < 200; ++i ) {
+        positions << GeoDataCoordinates( -10.0 + 0.1 * i, 50.02, 0.0, GeoDataCoordinates::Degree );
+    }
+    for ( int i = 0; i < 200; ++i ) {
+        const qreal lon = -12.0 + ( ( i * 37 ) % 200 ) * 0.2;
+        const qreal lat = 48.0 + ( ( i * 53 ) % 100 ) * 0.04;
+        positions << GeoDataCoordinates( lon, lat, 0.0, GeoDataCoordinates::Degree );
+    }
+
+    foreach( const GeoDataCoordinates &position, positions ) {
+        route.setPosition( position );
+        const RouteSegment &segment = route.currentSegment();
+        QVERIFY( segment.isValid() );
+
+        GeoDataCoordinates closest, interpolated;
+        const qreal distance = segment.distanceTo( position, closest, interpolated );
+        QCOMPARE( distance, bruteForceDistance( route, position ) );
+        QCOMPARE( route.positionOnRoute(), interpolated );
+        QCOMPARE( route.currentWaypoint(), closest );
+    }
+}
+
+void RouteTest::testSinglePoint()
+{
+    GeoDataLineString path;
+    path << GeoDataCoordinates( 7.0, 49.0, 0.0, GeoDataCoordinates::Degree );
+    RouteSegment segment;
+    segment.setPath( path );
+
+    Route route;
+    route.addRouteSegment( segment );
+    route.setPosition( GeoDataCoordinates( 7.5, 49.5, 0.0, GeoDataCoordinates::Degree ) );
+
+    QVERIFY( route.currentSegment().isValid() );
+    QCOMPARE( route.positionOnRoute(), path.first() );
+    QCOMPARE( route.currentWaypoint(), path.first() );
+}
+
+}
+
+QTEST_MAIN( Marble::RouteTest )
+
+#include "RouteTest.moc"
@@ -0,0 +1,155 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QtTest/QtTest>
+
+#include "GeoDataLineString.h"
+#include "MarbleGlobal.h"
+#include "ScreenPolygonCache.h"
+#include "ViewportParams.h"
+
+Q_DECLARE_METATYPE( Marble::Projection )
+
+namespace Marble
+{
+
+class ScreenPolygonCacheTest : public QObject
+{
+    Q_OBJECT
+
+ private slots:
+    void translatedPolygons_data();
+    void translatedPolygons();
+
+    void modifiedLineString();
+
+ private:
+    static QVector<QPolygonF> projected( const GeoDataLineString &lineString, const ViewportParams *viewport );
+    static bool fuzzyCompare( const QVector<QPolygonF> &polygons, const QVector<QPolygonF> &expected );
+};
+
+QVector<QPolygonF> ScreenPolygonCacheTest::projected( const GeoDataLineString &lineString, const ViewportParams *viewport )
+{
+    QVector<QPolygonF*> polygons;
+    viewport->screenCoordinates( lineString, polygons );
+
+    QVector<QPolygonF> result;
+    foreach( QPolygonF* polygon, polygons ) {
+        result << *polygon;
+    }
+    qDeleteAll( polygons );
+
+    return result;
+}
+
+bool ScreenPolygonCacheTest::fuzzyCompare( const QVector<QPolygonF> &polygons, const QVector<QPolygonF> &expected )
+{
+    if ( polygons.size() != expected.size() )
+        return false;
+
+    for ( int i = 0; i < polygons.size(); ++i ) {
+        if ( polygons[i].size() != expected[i].size() )
+            return false;
+
+        for ( int j = 0; j < polygons[i].size(); ++j ) {
+            if ( qAbs( polygons[i][j].x() - expected[i][j].x() ) > 1e-6
+                 || qAbs( polygons[i][j].y() - expected[i][j].y() ) > 1e-6 )
+                return false;
+        }
+    }
+
+    return true;
+}
+
+void ScreenPolygonCacheTest::translatedPolygons_data()
+{
+    QTest::addColumn<Projection>( "projection" );
+    QTest::addColumn<qreal>( "fromLon" );
+    QTest::addColumn<qreal>( "toLon" );
+    QTest::addColumn<qreal>( "toLat" );
+
+    QTest::newRow( "equirect" ) << Equirectangular << 10.0 << 12.5 << -3.0;
+    QTest::newRow( "mercator" ) << Mercator << 10.0 << 12.5 << -3.0;
+    QTest::newRow( "equirect date line" ) << Equirectangular << 179.0 << -179.0 << 0.0;
+    QTest::newRow( "mercator date line" ) << Mercator << 179.0 << -179.0 << 0.0;
+    QTest::newRow( "equirect date line west" ) << Equirectangular << -178.0 << 177.5 << 2.0;
+}
+
+void ScreenPolygonCacheTest::translatedPolygons()
+{
+    QFETCH( Projection, projection );
+    QFETCH( qreal, fromLon );
+    QFETCH( qreal, toLon );
+    QFETCH( qreal, toLat );
+
+    ViewportParams viewport;
+    viewport.setProjection( projection );
+    viewport.setRadius( 100 );
+    viewport.setSize( QSize( 300, 200 ) );
+    viewport.centerOn( fromLon * DEG2RAD, 0.0 );
+
+    GeoDataLineString lineString( Tessellate );
+    lineString << GeoDataCoordinates( -170.0, 10.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( -20.0, -15.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 5.0, 5.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 20.0, 12.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 175.0, -8.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( -175.0, 4.0, 0.0, GeoDataCoordinates::Degree );
+
+    ScreenPolygonCache cache;
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+
+    viewport.centerOn( toLon * DEG2RAD, toLat * DEG2RAD );
+
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+
+    // and back again
+    viewport.centerOn( fromLon * DEG2RAD, 0.0 );
+
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+}
+
+void ScreenPolygonCacheTest::modifiedLineString()
+{
+    ViewportParams viewport;
+    viewport.setProjection( Equirectangular );
+    viewport.setRadius( 100 );
+    viewport.setSize( QSize( 300, 200 ) );
+    viewport.centerOn( 10.0 * DEG2RAD, 0.0 );
+
+    GeoDataLineString lineString;
+    lineString << GeoDataCoordinates( 0.0, 0.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 10.0, 10.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 20.0, 0.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 15.0, 10.0, 0.0, GeoDataCoordinates::Degree );
+
+    ScreenPolygonCache cache;
+    const QVector<QPolygonF> original = cache.polygons( lineString, &viewport );
+
+    // neither the size nor the bounding box change
+    lineString[1].setLongitude( 5.0, GeoDataCoordinates::Degree );
+    QVERIFY( !fuzzyCompare( projected( lineString, &viewport ), original ) );
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+
+    lineString.setTessellate( true );
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+
+    // a different line string with the same nodes at the same address
+    lineString = GeoDataLineString();
+    lineString << GeoDataCoordinates( 0.0, 0.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 10.0, 0.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 20.0, 10.0, 0.0, GeoDataCoordinates::Degree )
+               << GeoDataCoordinates( 15.0, 10.0, 0.0, GeoDataCoordinates::Degree );
+    QVERIFY( fuzzyCompare( cache.polygons( lineString, &viewport ), projected( lineString, &viewport ) ) );
+}
+
+}
+
+QTEST_MAIN( Marble::ScreenPolygonCacheTest )
+
+#include "ScreenPolygonCacheTest.moc"
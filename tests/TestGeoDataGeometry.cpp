@@ -26,6 +26,7 @@ private slots:
     void deleteAndDetachTest1();
     void deleteAndDetachTest2();
     void deleteAndDetachTest3();
+    void compactLineStringTest();
 };
 
 void TestGeoDataGeometry::downcastPointTest_data()
@@ -85,6 +86,60 @@ void TestGeoDataGeometry::deleteAndDetachTest3()
     line2 << GeoDataCoordinates();
 }
 
+void TestGeoDataGeometry::compactLineStringTest()
+{
+    GeoDataLineString expanded;
+    expanded << GeoDataCoordinates( 0.1, 0.2 )
+             << GeoDataCoordinates( -3.1, 1.5, 250.0 )
+             << GeoDataCoordinates( 3.1, -1.5 );
+
+    GeoDataLineString line;
+    line.setCompact( true );
+    QVERIFY( line.isCompact() );
+    line << expanded;
+    QVERIFY( line.isCompact() );
+    QCOMPARE( line.size(), 3 );
+
+    for ( int i = 0; i < line.size(); ++i ) {
+        qreal lon, lat;
+        line.geoCoordinates( i, lon, lat );
+        QVERIFY( qAbs( lon - expanded.at( i ).longitude() ) < 1e-8 );
+        QVERIFY( qAbs( lat - expanded.at( i ).latitude() ) < 1e-8 );
+        QCOMPARE( line.altitude( i ), expanded.at( i ).altitude() );
+    }
+
+    const GeoDataLatLonAltBox box = line.latLonAltBox();
+    QVERIFY( line.isCompact() );
+    QVERIFY( qAbs( box.north() - expanded.latLonAltBox().north() ) < 1e-8 );
+    QVERIFY( qAbs( box.west() - expanded.latLonAltBox().west() ) < 1e-8 );
+    QCOMPARE( box.maxAltitude(), 250.0 );
+    QVERIFY( qAbs( line.length( 1.0 ) - expanded.length( 1.0 ) ) < 1e-7 );
+
+    // Nodes are decoded on the fly, and the copy used for projecting stays compact
+    QVERIFY( qAbs( line.coordinates( 2 ).latitude() + 1.5 ) < 1e-8 );
+    QCOMPARE( line.coordinates( 1 ).altitude(), 250.0 );
+    QVERIFY( line.toRangeCorrected().isCompact() );
+    QCOMPARE( line.toRangeCorrected().size(), 3 );
+
+    // Copies share the compact nodes
+    GeoDataLineString copy = line;
+    QVERIFY( copy.isCompact() );
+
+    // Nodes with a detail level can't be stored compactly
+    GeoDataCoordinates detailed( 0.5, 0.5 );
+    detailed.setDetail( 3 );
+    copy << detailed;
+    QVERIFY( !copy.isCompact() );
+    QCOMPARE( copy.size(), 4 );
+    QCOMPARE( copy.at( 3 ).detail(), 3 );
+    QVERIFY( line.isCompact() );
+
+    // Accessing nodes by reference expands them
+    QVERIFY( qAbs( line.at( 1 ).longitude() + 3.1 ) < 1e-8 );
+    QVERIFY( !line.isCompact() );
+    QCOMPARE( line.at( 1 ).altitude(), 250.0 );
+}
+
 QTEST_MAIN( TestGeoDataGeometry )
 #include "TestGeoDataGeometry.moc"
 
@@ -0,0 +1,118 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QtCore/QObject>
+#include <QtTest/QtTest>
+
+#include "TestUtils.h"
+#include <GeoDataDocument.h>
+#include <GeoDataParser.h>
+#include <GeoDataPlacemark.h>
+#include <GeoDataLineString.h>
+#include <MarbleDebug.h>
+
+using namespace Marble;
+
+
+class TestKmlCoordinates : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void lineString_data();
+    void lineString();
+    void point();
+};
+
+void TestKmlCoordinates::initTestCase()
+{
+    MarbleDebug::enable = true;
+}
+
+void TestKmlCoordinates::lineString_data()
+{
+    QTest::addColumn<QString>( "coordinates" );
+    QTest::addColumn<QString>( "expected" );
+
+    addRow() << "1,2 3,4" << "1,2,0 3,4,0";
+    addRow() << "1,2,3 4,5,6" << "1,2,3 4,5,6";
+    addRow() << "\n\t 1,2,3\n  4,5,6 \n" << "1,2,3 4,5,6";
+    addRow() << "1 , 2 ,3   4,  5,6" << "1,2,3 4,5,6";
+    addRow() << "-12.5,0.000123 1e1,2.5E-1,-7" << "-12.5,0.000123,0 10,0.25,-7";
+    addRow() << "1,2 3 5,6" << "1,2,0 0,0,0 5,6,0";
+    addRow() << "1,2,3,4 5,6" << "0,0,0 5,6,0";
+    addRow() << "&#49;,2 3&#44;4" << "1,2,0 3,4,0";
+    addRow() << "<![CDATA[1,2 3]]>,4" << "1,2,0 3,4,0";
+}
+
+void TestKmlCoordinates::lineString()
+{
+    QFETCH( QString, coordinates );
+    QFETCH( QString, expected );
+
+    QString const content (
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<kml xmlns=\"http://earth.google.com/kml/2.2\">"
+        "<Document>"
+          "<Placemark>"
+            "<LineString>"
+              "<coordinates>" + coordinates + "</coordinates>"
+            "</LineString>"
+          "</Placemark>"
+        "</Document>"
+    "</kml>");
+
+    GeoDataDocument* dataDocument = parseKml( content );
+    QCOMPARE( dataDocument->size(), 1 );
+    GeoDataPlacemark *placemark = dynamic_cast<GeoDataPlacemark*>( dataDocument->child( 0 ) );
+    QVERIFY( placemark != 0 );
+    GeoDataLineString *lineString = dynamic_cast<GeoDataLineString*>( placemark->geometry() );
+    QVERIFY( lineString != 0 );
+
+    const QStringList expectedNodes = expected.split( ' ' );
+    QCOMPARE( lineString->size(), expectedNodes.size() );
+
+    for ( int i = 0; i < expectedNodes.size(); ++i ) {
+        const QStringList values = expectedNodes.at( i ).split( ',' );
+        QFUZZYCOMPARE( lineString->at( i ).longitude( GeoDataCoordinates::Degree ), values.at( 0 ).toDouble(), 0.0000001 );
+        QFUZZYCOMPARE( lineString->at( i ).latitude( GeoDataCoordinates::Degree ), values.at( 1 ).toDouble(), 0.0000001 );
+        QFUZZYCOMPARE( lineString->at( i ).altitude(), values.at( 2 ).toDouble(), 0.0000001 );
+    }
+
+    delete dataDocument;
+}
+
+void TestKmlCoordinates::point()
+{
+    QString const content (
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>"
+    "<kml xmlns=\"http://earth.google.com/kml/2.2\">"
+        "<Document>"
+          "<Placemark>"
+            "<Point>"
+              "<coordinates> 13.5 , 52.25 , 40 </coordinates>"
+            "</Point>"
+          "</Placemark>"
+        "</Document>"
+    "</kml>");
+
+    GeoDataDocument* dataDocument = parseKml( content );
+    QCOMPARE( dataDocument->size(), 1 );
+    GeoDataPlacemark *placemark = dynamic_cast<GeoDataPlacemark*>( dataDocument->child( 0 ) );
+    QVERIFY( placemark != 0 );
+
+    QFUZZYCOMPARE( placemark->coordinate().longitude( GeoDataCoordinates::Degree ), 13.5, 0.0000001 );
+    QFUZZYCOMPARE( placemark->coordinate().latitude( GeoDataCoordinates::Degree ), 52.25, 0.0000001 );
+    QFUZZYCOMPARE( placemark->coordinate().altitude(), 40.0, 0.0000001 );
+
+    delete dataDocument;
+}
+
+QTEST_MAIN( TestKmlCoordinates )
+
+#include "TestKmlCoordinates.moc"
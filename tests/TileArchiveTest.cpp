@@ -0,0 +1,184 @@
+//
+// This file is part of the Marble Virtual Globe.
+//
+// This program is free software licensed under the GNU LGPL. You can
+// find a copy of this license in LICENSE.txt in the top directory of
+// the source code.
+//
+
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QFileInfo>
+#include <QtTest/QtTest>
+#include "TileArchive.h"
+
+namespace Marble
+{
+
+class TileArchiveTest : public QObject
+{
+    Q_OBJECT
+
+ private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void testTileFileName();
+    void testWriteAndRead();
+    void testInsert();
+    void testMissingArchive();
+    void testTornRecord();
+
+ private:
+    QString m_fileName;
+};
+
+void TileArchiveTest::initTestCase()
+{
+    m_fileName = QDir::tempPath() + QString( "/TileArchiveTest-%1.tiles" ).arg( QCoreApplication::applicationPid() );
+    QFile::remove( m_fileName );
+}
+
+void TileArchiveTest::cleanupTestCase()
+{
+    QFile::remove( m_fileName );
+}
+
+void TileArchiveTest::testTileFileName()
+{
+    const QString fileName = TileArchive::tileFileName( "/maps/earth/srtm/tiles.archive", 3, 7, 5 );
+
+    QString archiveFileName;
+    int level = -1;
+    int x = -1;
+    int y = -1;
+    QVERIFY( TileArchive::parseTileFileName( fileName, archiveFileName, level, x, y ) );
+    QCOMPARE( archiveFileName, QString( "/maps/earth/srtm/tiles.archive" ) );
+    QCOMPARE( level, 3 );
+    QCOMPARE( x, 7 );
+    QCOMPARE( y, 5 );
+
+    QVERIFY( !TileArchive::parseTileFileName( "maps/earth/srtm/3/000005/000005_000007.jpg", archiveFileName, level, x, y ) );
+}
+
+void TileArchiveTest::testWriteAndRead()
+{
+    {
+        TileArchiveWriter writer( m_fileName );
+        // added in arbitrary order, and one tile twice
+        QVERIFY( writer.addTile( 1, 3, 1, "tile 1/3/1" ) );
+        QVERIFY( writer.addTile( 0, 1, 0, "tile 0/1/0, old" ) );
+        QVERIFY( writer.addTile( 0, 0, 0, "tile 0/0/0" ) );
+        QVERIFY( writer.addTile( 1, 0, 1, "tile 1/0/1" ) );
+        QVERIFY( writer.addTile( 0, 1, 0, "tile 0/1/0" ) );
+        QVERIFY( writer.finish() );
+    }
+
+    QVERIFY( !QFile::exists( m_fileName + ".new" ) );
+
+    TileArchive *const archive = TileArchive::archive( m_fileName );
+    QVERIFY( archive != 0 );
+    QCOMPARE( TileArchive::archive( m_fileName ), archive );
+    QCOMPARE( archive->maximumTileLevel(), 1 );
+
+    QByteArray data;
+    QVERIFY( archive->tileData( 0, 0, 0, data ) );
+    QCOMPARE( data, QByteArray( "tile 0/0/0" ) );
+    QVERIFY( archive->tileData( 0, 1, 0, data ) );
+    QCOMPARE( data, QByteArray( "tile 0/1/0" ) );
+    QVERIFY( archive->tileData( 1, 3, 1, data ) );
+    QCOMPARE( data, QByteArray( "tile 1/3/1" ) );
+    QVERIFY( archive->tileData( 1, 0, 1, data ) );
+    QCOMPARE( data, QByteArray( "tile 1/0/1" ) );
+
+    QVERIFY( !archive->contains( 1, 1, 1 ) );
+    QVERIFY( !archive->contains( 2, 0, 0 ) );
+    QVERIFY( !archive->lastModified( 1, 1, 1 ).isValid() );
+    QVERIFY( archive->lastModified( 1, 0, 1 ).isValid() );
+}
+
+void TileArchiveTest::testInsert()
+{
+    TileArchive *const archive = TileArchive::archive( m_fileName );
+    QVERIFY( archive != 0 );
+
+    // opened for reading only
+    QVERIFY( !archive->insert( 2, 5, 3, "tile 2/5/3" ) );
+    QCOMPARE( TileArchive::writableArchive( m_fileName ), archive );
+
+    QVERIFY( archive->insert( 2, 5, 3, "tile 2/5/3" ) );
+    QVERIFY( archive->insert( 0, 0, 0, "tile 0/0/0, new" ) );
+
+    QCOMPARE( archive->maximumTileLevel(), 2 );
+
+    QByteArray data;
+    QVERIFY( archive->tileData( 2, 5, 3, data ) );
+    QCOMPARE( data, QByteArray( "tile 2/5/3" ) );
+    QVERIFY( archive->tileData( 0, 0, 0, data ) );
+    QCOMPARE( data, QByteArray( "tile 0/0/0, new" ) );
+    QVERIFY( archive->tileData( 0, 1, 0, data ) );
+    QCOMPARE( data, QByteArray( "tile 0/1/0" ) );
+}
+
+void TileArchiveTest::testMissingArchive()
+{
+    const QString fileName = m_fileName + ".missing";
+    QFile::remove( fileName );
+
+    // looking up tiles doesn't create an archive
+    QVERIFY( TileArchive::archive( fileName ) == 0 );
+    QVERIFY( !QFile::exists( fileName ) );
+
+    TileArchive *const archive = TileArchive::writableArchive( fileName );
+    QVERIFY( archive != 0 );
+    QVERIFY( QFile::exists( fileName ) );
+    QCOMPARE( TileArchive::archive( fileName ), archive );
+
+    QVERIFY( archive->insert( 0, 0, 0, "tile 0/0/0" ) );
+    QVERIFY( archive->contains( 0, 0, 0 ) );
+
+    QFile::remove( fileName );
+}
+
+void TileArchiveTest::testTornRecord()
+{
+    const QString fileName = m_fileName + ".torn";
+    {
+        TileArchiveWriter writer( fileName );
+        QVERIFY( writer.addTile( 0, 0, 0, "tile 0/0/0" ) );
+        QVERIFY( writer.finish() );
+    }
+
+    // a record whose data was cut off: magic "TILE", level 1, x 0, y 0, size 100, modified 0
+    const char record[] = "TILE\1\0\0\0\0\0\0\0\0\0\0\0\x64\0\0\0\0\0\0\0partial";
+    {
+        QFile file( fileName );
+        QVERIFY( file.open( QIODevice::Append ) );
+        QCOMPARE( file.write( record, sizeof( record ) - 1 ), qint64( sizeof( record ) - 1 ) );
+    }
+    const qint64 size = QFileInfo( fileName ).size();
+
+    // readers leave the file alone, another process may still be appending
+    TileArchive *const archive = TileArchive::archive( fileName );
+    QVERIFY( archive != 0 );
+    QVERIFY( archive->contains( 0, 0, 0 ) );
+    QVERIFY( !archive->contains( 1, 0, 0 ) );
+    QCOMPARE( QFileInfo( fileName ).size(), size );
+
+    // the writer replaces the torn record
+    QCOMPARE( TileArchive::writableArchive( fileName ), archive );
+    QVERIFY( archive->insert( 1, 1, 0, "tile 1/1/0" ) );
+
+    QByteArray data;
+    QVERIFY( archive->tileData( 1, 1, 0, data ) );
+    QCOMPARE( data, QByteArray( "tile 1/1/0" ) );
+    QVERIFY( !archive->contains( 1, 0, 0 ) );
+
+    QFile::remove( fileName );
+}
+
+}
+
+QTEST_MAIN( Marble::TileArchiveTest )
+
+#include "TileArchiveTest.moc"
@@ -43,6 +43,8 @@ class ViewportParamsTest : public QObject
     void setInvalidRadius();
 
     void setFocusPoint();
+
+    void projectionGeneration();
 };
 
 void ViewportParamsTest::constructorDefaultValues()
@@ -498,6 +500,44 @@ void ViewportParamsTest::setFocusPoint()
     QCOMPARE( viewport.focusPoint(), center );
 }
 
+void ViewportParamsTest::projectionGeneration()
+{
+    ViewportParams viewport( Equirectangular, 0, 0, 1000, QSize( 800, 600 ) );
+    ViewportParams other( Equirectangular, 0, 0, 1000, QSize( 800, 600 ) );
+    QVERIFY( viewport.projectionGeneration() != other.projectionGeneration() );
+
+    int generation = viewport.projectionGeneration();
+    int scaleGeneration = viewport.scaleGeneration();
+
+    // moving the center changes the projection, but not the scale
+    viewport.centerOn( 0.5, 0.2 );
+    QVERIFY( viewport.projectionGeneration() != generation );
+    QCOMPARE( viewport.scaleGeneration(), scaleGeneration );
+    generation = viewport.projectionGeneration();
+
+    viewport.setRadius( 2000 );
+    QVERIFY( viewport.projectionGeneration() != generation );
+    QVERIFY( viewport.scaleGeneration() != scaleGeneration );
+    generation = viewport.projectionGeneration();
+    scaleGeneration = viewport.scaleGeneration();
+
+    viewport.setSize( QSize( 1024, 768 ) );
+    QVERIFY( viewport.projectionGeneration() != generation );
+    QVERIFY( viewport.scaleGeneration() != scaleGeneration );
+    generation = viewport.projectionGeneration();
+    scaleGeneration = viewport.scaleGeneration();
+
+    viewport.setProjection( Mercator );
+    QVERIFY( viewport.projectionGeneration() != generation );
+    QVERIFY( viewport.scaleGeneration() != scaleGeneration );
+    generation = viewport.projectionGeneration();
+
+    // nothing changes
+    viewport.setSize( QSize( 1024, 768 ) );
+    viewport.setRadius( 0 );
+    QCOMPARE( viewport.projectionGeneration(), generation );
+}
+
 }
 
 Q_DECLARE_METATYPE( Marble::GeoDataLinearRing )
@@ -50,9 +50,12 @@ SqlWriter::SqlWriter( const QString &filename, QObject* parent ) :
                " name VARCHAR(50),"
                " lon FLOAT(8),"
                " lat FLOAT(8) )" );
+    execQuery( "DROP TABLE IF EXISTS namesFts" );
+    execQuery( "DROP TABLE IF EXISTS placemarksRtree" );
     execQuery( "DROP VIEW IF EXISTS places" );
     execQuery( "CREATE VIEW places AS "
                " SELECT"
+               "  placemarks.rowid AS id,"
                "  placemarks.regionId AS region,"
                "  names.name AS name,"
                "  placemarks.number AS number,"
@@ -71,6 +74,13 @@ SqlWriter::~SqlWriter()
     execQuery( "CREATE INDEX namesIndex ON names(name)" );
     execQuery( "CREATE INDEX placemarksIndex ON placemarks(regionId,nameId,category)" );
     execQuery( "CREATE INDEX regionsIndex ON regions(name,parent,lft,rgt)" );
+
+    // Optional indices used by the local-osm-search plugin if present. They
+    // need SQLite's FTS4 and R*Tree modules, which some builds lack.
+    createOptionalIndex( "CREATE VIRTUAL TABLE namesFts USING fts4(name)",
+                         "INSERT INTO namesFts(docid, name) SELECT id, name FROM names" );
+    createOptionalIndex( "CREATE VIRTUAL TABLE placemarksRtree USING rtree(id, minLon, maxLon, minLat, maxLat)",
+                         "INSERT INTO placemarksRtree SELECT rowid, lon, lon, lat, lat FROM placemarks" );
 }
 
 void SqlWriter::addOsmRegion( const OsmRegion &region )
@@ -120,6 +130,17 @@ void SqlWriter::addOsmPlacemark( const OsmPlacemark &placemark )
     execQuery( query );
 }
 
+void SqlWriter::createOptionalIndex( const QString &createQuery, const QString &fillQuery ) const
+{
+    QSqlQuery createIndex( createQuery );
+    if ( createIndex.lastError().isValid() ) {
+        qWarning() << "Skipping optional index, SQL error:" << createIndex.lastError();
+        return;
+    }
+
+    execQuery( fillQuery );
+}
+
 void SqlWriter::execQuery( const QString &query ) const
 {
     QSqlQuery sqlQuery( query );
@@ -38,6 +38,8 @@ private:
 
     void execQuery( const QString &query ) const;
 
+    void createOptionalIndex( const QString &createQuery, const QString &fillQuery ) const;
+
     QMap<QString, int> m_placemarks;
 
     QPair<int, QString> m_lastPlacemark;